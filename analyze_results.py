@@ -10,6 +10,11 @@ import pandas as pd
 import argparse
 import sys
 
+# Benchmarks whose records compare matching models; their summaries are kept
+# per model instead of being pooled with the verification and existence sweeps
+MODEL_COMPARISON_BENCHMARKS = ('model_comparison', 'partial_vs_complete',
+                               'k_hai_comparison', 'k_hai_existence_patterns')
+
 def parse_benchmark_output(filename):
     """Parse benchmark output from the C program."""
     results = {
@@ -41,7 +46,7 @@ def parse_benchmark_output(filename):
             continue
         
         # Parse data lines
-        if current_section and line and not line.startswith('=') and not line.startswith('Testing') and not line.startswith('Agents') and not line.startswith('------') and not line.startswith('Note'):
+        if current_section and line and not line.startswith('=') and not line.startswith('Testing') and not line.startswith('Agents') and not line.startswith('Model') and not line.startswith('-----') and not line.startswith('Note'):
             parts = line.split('\t')
             # Filter out empty parts
             parts = [p for p in parts if p.strip()]
@@ -53,6 +58,7 @@ def parse_benchmark_output(filename):
                         std_dev = float(parts[2])
                         trials = int(parts[3])
                         results['verification'].append({
+                            'benchmark': 'verification_complexity',
                             'agents': agents,
                             'avg_time': avg_time,
                             'std_dev': std_dev,
@@ -66,6 +72,7 @@ def parse_benchmark_output(filename):
                         trials = int(parts[4])
                         exists_rate = float(parts[5])
                         results['existence'].append({
+                            'benchmark': 'existence_complexity',
                             'agents': agents,
                             'k_ratio': k_ratio,
                             'avg_time': avg_time,
@@ -73,12 +80,95 @@ def parse_benchmark_output(filename):
                             'trials': trials,
                             'exists_rate': exists_rate
                         })
+                    elif current_section == 'model_comparison':
+                        results['model_comparison'].append({
+                            'benchmark': 'model_comparison',
+                            'model': parts[0].strip(),
+                            'avg_time': float(parts[1]),
+                            'std_dev': float(parts[2]),
+                            'trials': int(parts[3])
+                        })
                 except (ValueError, IndexError) as e:
                     print(f"Error parsing line: {line} -> {parts} -> {e}")
                     continue
     
     return results
 
+def load_result_records(filename):
+    """Load per-trial records written with --output (JSONL or CSV) into the
+    same per-size summaries parse_benchmark_output builds from the tables,
+    one series per benchmark. avg_time and std_dev are wall times, as in the
+    tables; avg_cpu_time is the CPU time (summed over threads for parallel
+    searches)."""
+    results = {
+        'verification': [],
+        'existence': [],
+        'model_comparison': []
+    }
+    
+    try:
+        if filename.endswith('.csv'):
+            df = pd.read_csv(filename)
+        else:
+            df = pd.read_json(filename, lines=True)
+    except (FileNotFoundError, ValueError) as e:
+        print(f"Error: Could not read records from {filename}: {e}")
+        return results
+    
+    if df.empty:
+        return results
+    
+    # Records from before weights were written count once each
+    if 'weight' not in df.columns:
+        df['weight'] = 1
+    
+    models = df[df['benchmark'].isin(MODEL_COMPARISON_BENCHMARKS)]
+    for (benchmark, model, agents, k, algorithm), group in models.groupby(
+            ['benchmark', 'model', 'n', 'k', 'algorithm']):
+        results['model_comparison'].append({
+            'benchmark': benchmark,
+            'model': model,
+            'agents': int(agents),
+            'k': int(k),
+            'algorithm': algorithm,
+            'avg_time': group['wall_ms'].mean(),
+            'std_dev': group['wall_ms'].std(ddof=0),
+            'avg_cpu_time': group['cpu_ms'].mean(),
+            'trials': len(group),
+            'positive_rate': np.average(group['result'], weights=group['weight'])
+        })
+    
+    # Every other benchmark either verifies or searches, like the two tables
+    sweeps = df[~df['benchmark'].isin(MODEL_COMPARISON_BENCHMARKS)]
+    verification = sweeps[sweeps['algorithm'] == 'verify']
+    for (benchmark, agents), group in verification.groupby(['benchmark', 'n']):
+        results['verification'].append({
+            'benchmark': benchmark,
+            'agents': int(agents),
+            'avg_time': group['wall_ms'].mean(),
+            'std_dev': group['wall_ms'].std(ddof=0),
+            'avg_cpu_time': group['cpu_ms'].mean(),
+            'trials': len(group)
+        })
+    
+    # A brute-force record stands for its whole orbit of profiles, so rates
+    # are weighted; times stay per searched instance
+    existence = sweeps[sweeps['algorithm'] != 'verify']
+    for (benchmark, agents, k), group in existence.groupby(['benchmark', 'n', 'k']):
+        results['existence'].append({
+            'benchmark': benchmark,
+            'agents': int(agents),
+            'k_ratio': round(k / agents, 2),
+            'avg_time': group['wall_ms'].mean(),
+            'std_dev': group['wall_ms'].std(ddof=0),
+            'avg_cpu_time': group['cpu_ms'].mean(),
+            'trials': len(group),
+            'instances': int(group['weight'].sum()),
+            'exists_rate': np.average(group['result'], weights=group['weight'])
+        })
+    
+    return results
+
 def plot_verification_complexity(results):
     """Plot verification complexity results."""
     if not results['verification']:
@@ -89,25 +179,26 @@ def plot_verification_complexity(results):
     
     plt.figure(figsize=(10, 6))
     
-    # Plot actual times
-    plt.errorbar(df['agents'], df['avg_time'], yerr=df['std_dev'], 
-                marker='o', capsize=5, label='Actual Times')
-    
-    # Plot polynomial fits
-    x = df['agents'].values
-    y = df['avg_time'].values
-    
-    # Try different polynomial degrees
-    for degree in [2, 3, 4]:
-        coeffs = np.polyfit(x, y, degree)
-        poly = np.poly1d(coeffs)
-        x_fit = np.linspace(x.min(), x.max(), 100)
-        y_fit = poly(x_fit)
-        plt.plot(x_fit, y_fit, '--', alpha=0.7, 
-                label=f'Polynomial degree {degree}')
+    for benchmark, subset in df.groupby('benchmark'):
+        # Plot actual times
+        plt.errorbar(subset['agents'], subset['avg_time'], yerr=subset['std_dev'], 
+                    marker='o', capsize=5, label=f'{benchmark} times')
+        
+        # Plot polynomial fits
+        x = subset['agents'].values
+        y = subset['avg_time'].values
+        
+        # Try different polynomial degrees the sizes can determine
+        for degree in [d for d in [2, 3, 4] if d < len(x)]:
+            coeffs = np.polyfit(x, y, degree)
+            poly = np.poly1d(coeffs)
+            x_fit = np.linspace(x.min(), x.max(), 100)
+            y_fit = poly(x_fit)
+            plt.plot(x_fit, y_fit, '--', alpha=0.7, 
+                    label=f'{benchmark} polynomial degree {degree}')
     
     plt.xlabel('Number of Agents (n)')
-    plt.ylabel('Average Time (ms)')
+    plt.ylabel('Average Wall Time (ms)')
     plt.title('k-Stability Verification Complexity\n(Should be polynomial)')
     plt.legend()
     plt.grid(True, alpha=0.3)
@@ -125,24 +216,29 @@ def plot_existence_complexity(results):
     
     fig, (ax1, ax2) = plt.subplots(1, 2, figsize=(15, 6))
     
+    # One series per benchmark and size, named by size alone when only one
+    # benchmark ran
+    series = list(df.groupby(['benchmark', 'agents']))
+    single = df['benchmark'].nunique() == 1
+    def series_label(benchmark, agents):
+        return f'n={agents}' if single else f'{benchmark} n={agents}'
+    
     # Plot 1: Time vs k/n ratio
-    for agents in df['agents'].unique():
-        subset = df[df['agents'] == agents]
+    for (benchmark, agents), subset in series:
         ax1.errorbar(subset['k_ratio'], subset['avg_time'], 
                     yerr=subset['std_dev'], marker='o', 
-                    label=f'n={agents}', capsize=3)
+                    label=series_label(benchmark, agents), capsize=3)
     
     ax1.set_xlabel('k/n Ratio')
-    ax1.set_ylabel('Average Time (ms)')
+    ax1.set_ylabel('Average Wall Time (ms)')
     ax1.set_title('Existence Checking Time vs k/n Ratio')
     ax1.legend()
     ax1.grid(True, alpha=0.3)
     
     # Plot 2: Existence rate vs k/n ratio
-    for agents in df['agents'].unique():
-        subset = df[df['agents'] == agents]
+    for (benchmark, agents), subset in series:
         ax2.plot(subset['k_ratio'], subset['exists_rate'], 
-                marker='o', label=f'n={agents}')
+                marker='o', label=series_label(benchmark, agents))
     
     ax2.set_xlabel('k/n Ratio')
     ax2.set_ylabel('Existence Rate')
@@ -165,27 +261,28 @@ def analyze_complexity_trends(results):
         print(f"\nVerification Complexity:")
         print(f"  - Tested {len(df_ver)} different problem sizes")
         print(f"  - Range: {df_ver['agents'].min()} to {df_ver['agents'].max()} agents")
-        print(f"  - Time range: {df_ver['avg_time'].min():.3f} to {df_ver['avg_time'].max():.3f} ms")
+        print(f"  - Wall time range: {df_ver['avg_time'].min():.3f} to {df_ver['avg_time'].max():.3f} ms")
         
-        # Check if growth is polynomial
-        x = df_ver['agents'].values
-        y = df_ver['avg_time'].values
-        
-        # Calculate growth rate
-        if len(x) > 1:
-            growth_rates = []
-            for i in range(1, len(x)):
-                rate = (y[i] - y[i-1]) / (x[i] - x[i-1])
-                growth_rates.append(rate)
-            
-            avg_growth_rate = np.mean(growth_rates)
-            print(f"  - Average growth rate: {avg_growth_rate:.3f} ms/agent")
+        for benchmark, subset in df_ver.groupby('benchmark'):
+            # Check if growth is polynomial
+            x = subset['agents'].values
+            y = subset['avg_time'].values
             
-            # Check for exponential growth (should not be exponential)
-            if max(growth_rates) / min(growth_rates) > 10:
-                print("  - WARNING: Growth rate varies significantly - may not be polynomial")
-            else:
-                print("  - Growth appears polynomial (good)")
+            # Calculate growth rate
+            if len(x) > 1:
+                growth_rates = []
+                for i in range(1, len(x)):
+                    rate = (y[i] - y[i-1]) / (x[i] - x[i-1])
+                    growth_rates.append(rate)
+                
+                avg_growth_rate = np.mean(growth_rates)
+                print(f"  - {benchmark}: average growth rate {avg_growth_rate:.3f} ms/agent")
+                
+                # Check for exponential growth (should not be exponential)
+                if min(growth_rates) <= 0 or max(growth_rates) / min(growth_rates) > 10:
+                    print("    WARNING: Growth rate varies significantly - may not be polynomial")
+                else:
+                    print("    Growth appears polynomial (good)")
     
     # Existence complexity analysis
     if results['existence']:
@@ -202,20 +299,34 @@ def analyze_complexity_trends(results):
         
         # Analyze relationship between k/n ratio and computation time
         avg_time_by_ratio = df_ex.groupby('k_ratio')['avg_time'].mean()
-        print(f"  - Average computation times by k/n ratio:")
+        print(f"  - Average wall times by k/n ratio:")
         for ratio, time in avg_time_by_ratio.items():
             print(f"    k/n = {ratio:.2f}: {time:.3f} ms")
+    
+    # Model comparison analysis
+    if results['model_comparison']:
+        df_mod = pd.DataFrame(results['model_comparison'])
+        print(f"\nModel Comparison:")
+        for _, row in df_mod.iterrows():
+            size = f" n={row['agents']} k={row['k']}" if 'agents' in row else ""
+            rate = (f", positive rate {row['positive_rate']:.3f}"
+                    if 'positive_rate' in row else "")
+            print(f"  - {row['benchmark']} {row['model']}{size}: "
+                  f"{row['avg_time']:.3f} ms over {row['trials']} trials{rate}")
 
 def main():
     parser = argparse.ArgumentParser(description='Analyze k-stable matching simulation results')
-    parser.add_argument('input_file', help='Input file with benchmark results')
+    parser.add_argument('input_file', help='Benchmark output, or records written with --output (.jsonl/.csv)')
     parser.add_argument('--plot', action='store_true', help='Generate plots')
     parser.add_argument('--analyze', action='store_true', help='Print analysis')
     
     args = parser.parse_args()
     
     # Parse results
-    results = parse_benchmark_output(args.input_file)
+    if args.input_file.endswith(('.jsonl', '.csv')):
+        results = load_result_records(args.input_file)
+    else:
+        results = parse_benchmark_output(args.input_file)
     
     if not any(results.values()):
         print("No results found in input file")
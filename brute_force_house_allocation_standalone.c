@@ -7,9 +7,11 @@
 // Standalone program for brute force house allocation analysis
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        printf("Usage: %s <n> <k>\n", argv[0]);
-        printf("  n: number of agents/objects (1-8)\n");
+        printf("Usage: %s <n> <k> [sample [threads]]\n", argv[0]);
+        printf("  n: number of agents/objects (1-12)\n");
         printf("  k: stability parameter (1-n)\n");
+        printf("  sample: number of matchings to list (default: all for n <= 4)\n");
+        printf("  threads: worker threads (default: all cores)\n");
         printf("\nExample: %s 3 2\n", argv[0]);
         return 1;
     }
@@ -17,8 +19,8 @@ int main(int argc, char* argv[]) {
     int n = atoi(argv[1]);
     int k = atoi(argv[2]);
     
-    if (n <= 0 || n > 8) {
-        printf("Error: n must be between 1 and 8 for brute force analysis\n");
+    if (n <= 0 || n > 12) {
+        printf("Error: n must be between 1 and 12 for brute force analysis\n");
         return 1;
     }
     
@@ -32,7 +34,11 @@ int main(int argc, char* argv[]) {
     printf("n = %d agents/objects, k = %d\n\n", n, k);
     
     // Run the analysis
-    analyze_all_house_allocations(n, k);
+    if (argc >= 4) {
+        analyze_all_house_allocations_sampled(n, k, atoi(argv[3]), argc >= 5 ? atoi(argv[4]) : 0);
+    } else {
+        analyze_all_house_allocations(n, k);
+    }
     
     return 0;
 }
@@ -0,0 +1,148 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Bitsets over agent / object ids: membership tests are a shift and a mask,
+// cardinalities come from popcount (one instruction per 64 ids where the
+// target has it). Fixed widths live on the stack or inside other structs;
+// bitset_t is a view over any word array, so the same kernels serve a
+// fixed-width set, an arena allocation or a heap buffer.
+
+#define BITSET_WORD_BITS 64
+
+// Fixed-width sets
+typedef uint64_t bitset64_t;
+typedef struct { uint64_t words[4]; } bitset256_t;
+
+// Dynamic set: num_bits ids backed by num_words words (bits past num_bits stay 0)
+typedef struct {
+    uint64_t* words;
+    int num_words;
+    int num_bits;
+} bitset_t;
+
+// Words needed for num_bits ids
+static inline int bitset_words(int num_bits) {
+    return (num_bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+// Bytes of word storage for num_bits ids
+static inline size_t bitset_bytes(int num_bits) {
+    return (size_t)bitset_words(num_bits) * sizeof(uint64_t);
+}
+
+static inline int bitset_popcount64(uint64_t word) {
+    return __builtin_popcountll(word);
+}
+
+// 64-bit sets
+static inline bool bitset64_test(bitset64_t set, int id) {
+    return (set >> id) & 1;
+}
+
+static inline void bitset64_set(bitset64_t* set, int id) {
+    *set |= (uint64_t)1 << id;
+}
+
+static inline void bitset64_clear(bitset64_t* set, int id) {
+    *set &= ~((uint64_t)1 << id);
+}
+
+static inline int bitset64_count(bitset64_t set) {
+    return bitset_popcount64(set);
+}
+
+// 256-bit sets
+static inline bool bitset256_test(const bitset256_t* set, int id) {
+    return (set->words[id >> 6] >> (id & 63)) & 1;
+}
+
+static inline void bitset256_set(bitset256_t* set, int id) {
+    set->words[id >> 6] |= (uint64_t)1 << (id & 63);
+}
+
+static inline void bitset256_clear(bitset256_t* set, int id) {
+    set->words[id >> 6] &= ~((uint64_t)1 << (id & 63));
+}
+
+static inline int bitset256_count(const bitset256_t* set) {
+    return bitset_popcount64(set->words[0]) + bitset_popcount64(set->words[1]) +
+           bitset_popcount64(set->words[2]) + bitset_popcount64(set->words[3]);
+}
+
+// View words (at least bitset_words(num_bits) of them) as an empty set
+static inline void bitset_attach(bitset_t* set, uint64_t* words, int num_bits) {
+    set->words = words;
+    set->num_bits = num_bits;
+    set->num_words = bitset_words(num_bits);
+    memset(words, 0, (size_t)set->num_words * sizeof(uint64_t));
+}
+
+static inline void bitset_clear_all(bitset_t* set) {
+    memset(set->words, 0, (size_t)set->num_words * sizeof(uint64_t));
+}
+
+static inline bool bitset_test(const bitset_t* set, int id) {
+    return (set->words[id >> 6] >> (id & 63)) & 1;
+}
+
+static inline void bitset_set(bitset_t* set, int id) {
+    set->words[id >> 6] |= (uint64_t)1 << (id & 63);
+}
+
+static inline void bitset_clear(bitset_t* set, int id) {
+    set->words[id >> 6] &= ~((uint64_t)1 << (id & 63));
+}
+
+// Number of ids in the set
+static inline int bitset_count(const bitset_t* set) {
+    int count = 0;
+    for (int w = 0; w < set->num_words; w++) {
+        count += bitset_popcount64(set->words[w]);
+    }
+    return count;
+}
+
+// Number of ids below limit in the set
+static inline int bitset_count_prefix(const bitset_t* set, int limit) {
+    int full = limit >> 6;
+    int count = 0;
+    for (int w = 0; w < full; w++) {
+        count += bitset_popcount64(set->words[w]);
+    }
+    if (limit & 63) {
+        count += bitset_popcount64(set->words[full] & (((uint64_t)1 << (limit & 63)) - 1));
+    }
+    return count;
+}
+
+// |a & b| for sets of the same width
+static inline int bitset_count_and(const bitset_t* a, const bitset_t* b) {
+    int count = 0;
+    for (int w = 0; w < a->num_words; w++) {
+        count += bitset_popcount64(a->words[w] & b->words[w]);
+    }
+    return count;
+}
+
+// Smallest id >= from in the set, or -1
+static inline int bitset_next(const bitset_t* set, int from) {
+    if (from >= set->num_bits) {
+        return -1;
+    }
+    int w = from >> 6;
+    uint64_t word = set->words[w] & (~(uint64_t)0 << (from & 63));
+    while (word == 0) {
+        if (++w >= set->num_words) {
+            return -1;
+        }
+        word = set->words[w];
+    }
+    return w * BITSET_WORD_BITS + __builtin_ctzll(word);
+}
+
+#endif // BITSET_H
@@ -2,10 +2,9 @@
 #define MATCHING_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
-
-// Maximum number of agents for static allocation
-#define MAX_AGENTS 1000
+#include "bitset.h"
 
 // Matching models
 typedef enum {
@@ -15,27 +14,112 @@ typedef enum {
     HOUSE_ALLOCATION_PARTIAL  // k-hai with partial preferences
 } matching_model_t;
 
-// Agent structure
-typedef struct {
-    int id;
-    int preferences[MAX_AGENTS];  // Preference list (0 = most preferred)
-    int num_preferences;
-    bool has_indifferences;       // For k-hai: whether agent has ties in preferences
-    int indifference_groups[MAX_AGENTS]; // For k-hai: group objects with same preference
-} agent_t;
-
 // Matching structure
 typedef struct {
-    int pairs[MAX_AGENTS];  // pairs[i] = j means agent i is matched with agent j, -1 if unmatched
+    int* pairs;             // pairs[i] = j means agent i is matched with agent j, -1 if unmatched
+                            // (num_agents entries, allocated together with the matching)
     int num_agents;
     matching_model_t model;
 } matching_t;
 
+// Scratch arena: a bump allocator for candidate matchings and search buffers.
+// Allocations are released in bulk (reset) or back to a mark, never one by one,
+// so verification and search do no heap traffic per coalition or per node.
+typedef struct {
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+} matching_arena_t;
+
+// Byte alignment of every arena allocation
+#define MATCHING_ARENA_ALIGNMENT 16
+
+// Arena bytes taken by an allocation of the given size (rounded up to the alignment)
+static inline size_t matching_arena_bytes(size_t bytes) {
+    return (bytes + MATCHING_ARENA_ALIGNMENT - 1) & ~(size_t)(MATCHING_ARENA_ALIGNMENT - 1);
+}
+
+// Current fill level, to be passed back to matching_arena_release
+static inline size_t matching_arena_mark(const matching_arena_t* arena) {
+    return arena->used;
+}
+
+// Free everything allocated since mark
+static inline void matching_arena_release(matching_arena_t* arena, size_t mark) {
+    arena->used = mark;
+}
+
+// Free everything
+static inline void matching_arena_reset(matching_arena_t* arena) {
+    arena->used = 0;
+}
+
+// Overlay of changed pairs on top of a base matching: an alternative matching
+// that costs O(changed agents) to build, read and discard instead of an O(n) copy.
+// An entry is overridden when stamps[agent] == generation; clearing the overlay
+// just starts a new generation.
+typedef struct {
+    const matching_t* base;
+    int* values;                  // Overridden partners (num_agents entries)
+    unsigned int* stamps;         // Generation in which each entry was overridden
+    unsigned int generation;
+    int* changed;                 // Agents overridden in the current generation
+    int num_changed;
+} matching_overlay_t;
+
+// Partner of an agent in the overlay (-1 if unmatched)
+static inline int matching_overlay_partner(const matching_overlay_t* overlay, int agent) {
+    return (overlay->stamps[agent] == overlay->generation) ? overlay->values[agent]
+                                                           : overlay->base->pairs[agent];
+}
+
+// Undo trail for in-place search: every assignment made through
+// matching_trail_set records the previous partner so that backtracking
+// restores exactly the entries changed since a mark.
+typedef struct {
+    int* agents;
+    int* previous;
+    int size;
+    int capacity;
+} matching_trail_t;
+
+// Current trail length, to be passed back to matching_trail_undo
+static inline int matching_trail_mark(const matching_trail_t* trail) {
+    return trail->size;
+}
+
+// Rank of a target that does not appear in an agent's preference list
+#define RANK_UNACCEPTABLE -1
+
 // Problem instance
+// Preferences are stored in CSR form: agent i ranks the targets
+// preferences[pref_offsets[i]] .. preferences[pref_offsets[i + 1] - 1]
+// (0 = most preferred). tie_groups runs parallel to preferences and is only
+// allocated for instances with indifferences (k-hai).
 typedef struct {
-    agent_t agents[MAX_AGENTS];
     int num_agents;
     matching_model_t model;
+    int* pref_offsets;            // num_agents + 1 entries
+    int* preferences;             // Preference pool, pref_offsets[num_agents] entries
+    int* tie_groups;              // Indifference group per preference entry, NULL if strict
+    bool* has_indifferences;      // Per agent flag, NULL if strict
+    int pref_capacity;            // Allocated size of the preference pool
+    int agent_capacity;           // Agents pref_offsets (and has_indifferences) has room for
+    int num_agents_added;         // Agents filled in so far by instance_add_agent
+    // Inverse rank index built by instance_finalize. Dense when the lists are
+    // close to complete: rank_table[agent * num_targets + target] = rank,
+    // RANK_UNACCEPTABLE if not listed. Otherwise (truncated lists) rank_table is
+    // NULL and each agent owns an open-addressing table of preference indices,
+    // rank_hash_slots[rank_hash_offsets[agent] ..], sized to a power of two.
+    int* rank_table;
+    size_t rank_table_capacity;   // Allocated cells of rank_table
+    int* rank_hash_offsets;       // num_agents + 1 entries, NULL if dense
+    int* rank_hash_slots;         // Rank of the stored target, RANK_UNACCEPTABLE if empty
+    int num_targets;              // Targets are ids 0 .. num_targets-1
+    // Read-only file mapping the arrays point into (load_problem_instance),
+    // NULL for instances built in memory
+    void* mapping;
+    size_t mapping_bytes;
     // Model-specific metadata
     union {
         struct {
@@ -47,11 +131,57 @@ typedef struct {
         } house_data;
         struct {
             int num_houses;
-            int num_acceptable_objects[MAX_AGENTS]; // For k-hai: number of acceptable objects per agent
         } house_partial_data;
     } model_data;
 } problem_instance_t;
 
+// Preference list of an agent (slice of the instance preference pool)
+static inline const int* instance_preferences(const problem_instance_t* instance, int agent) {
+    return instance->preferences + instance->pref_offsets[agent];
+}
+
+// Length of an agent's preference list
+static inline int instance_num_preferences(const problem_instance_t* instance, int agent) {
+    return instance->pref_offsets[agent + 1] - instance->pref_offsets[agent];
+}
+
+// Hashed rank lookup for instances with truncated lists (see get_agent_rank)
+int instance_rank_hashed(const problem_instance_t* instance, int agent, int target_id);
+
+// Get the rank of a target in an agent's preference list (0 = most preferred)
+// Returns RANK_UNACCEPTABLE (-1) if target is not in preferences
+static inline int get_agent_rank(const problem_instance_t* instance, int agent, int target_id) {
+    if (target_id < 0 || target_id >= instance->num_targets) {
+        return RANK_UNACCEPTABLE;
+    }
+    if (instance->rank_table == NULL) {
+        return instance_rank_hashed(instance, agent, target_id);
+    }
+    return instance->rank_table[(size_t)agent * instance->num_targets + target_id];
+}
+
+// Check if agent prefers a over b (-1 = unmatched)
+static inline bool agent_prefers(const problem_instance_t* instance, int agent, int a, int b) {
+    int rank_a = get_agent_rank(instance, agent, a);
+    
+    // Being unmatched is never preferred; any acceptable target beats it
+    if (rank_a == RANK_UNACCEPTABLE) {
+        return false;
+    }
+    if (b == -1) {
+        return true;
+    }
+    
+    // If b is not in preferences, return false; lower rank = more preferred
+    int rank_b = get_agent_rank(instance, agent, b);
+    return rank_b != RANK_UNACCEPTABLE && rank_a < rank_b;
+}
+
+// Indifference groups of an agent, parallel to its preference list (NULL if strict)
+static inline const int* instance_tie_groups(const problem_instance_t* instance, int agent) {
+    return instance->tie_groups != NULL ? instance->tie_groups + instance->pref_offsets[agent] : NULL;
+}
+
 // Function declarations
 
 // Core matching functions
@@ -62,6 +192,51 @@ void print_matching(const matching_t* matching);
 // k-stability verification (polynomial time)
 bool is_k_stable(const matching_t* matching, const problem_instance_t* instance, int k);
 bool is_k_stable_direct(const matching_t* matching, const problem_instance_t* instance, int k);
+bool is_k_stable_in_arena(const matching_t* matching, const problem_instance_t* instance, int k,
+                          matching_arena_t* arena);
+size_t k_stability_scratch_bytes(const problem_instance_t* instance);
+
+// Exact blocking number (largest set of agents made strictly better off at once)
+int blocking_number(const matching_t* matching, const problem_instance_t* instance);
+int blocking_number_in_arena(const matching_t* matching, const problem_instance_t* instance,
+                             int limit, matching_arena_t* arena);
+size_t blocking_number_scratch_bytes(const problem_instance_t* instance);
+int house_allocation_prefix_bound(const problem_instance_t* instance, const int* prefix_lengths,
+                                  int limit, matching_arena_t* arena);
+
+// Verifier context: what checking many matchings of one instance shares, built
+// once so that each check does no setup or heap allocation. partner_ranks runs
+// parallel to preferences and holds the listing agent's rank in its target's
+// list (RANK_UNACCEPTABLE if unlisted, PARTNER_NONE if the two cannot be
+// partners); it replaces two rank lookups per entry when building the
+// improvement graph. House allocation lists houses, so it has none.
+#define PARTNER_NONE -2
+
+typedef struct {
+    const problem_instance_t* instance;
+    matching_arena_t arena;       // Scratch for one check, left empty between checks
+    int* partner_ranks;           // NULL for house allocation
+    int* current_ranks;           // Scratch: rank of each agent's current partner
+} verifier_context_t;
+
+bool verifier_context_init(verifier_context_t* context, const problem_instance_t* instance);
+void verifier_context_destroy(verifier_context_t* context);
+int verifier_blocking_number(verifier_context_t* context, const matching_t* matching, int limit);
+bool verifier_is_k_stable(verifier_context_t* context, const matching_t* matching, int k);
+bool verify_batch_blocking_numbers(verifier_context_t* context, const matching_t* const* matchings,
+                                   int count, int limit, int* blocking_numbers);
+bool verify_batch_k_stable(verifier_context_t* context, const matching_t* const* matchings, int count,
+                           const int* k_values, int num_k, bool* stable);
+
+// Incremental house allocation blocking number for enumerations that change a
+// few agents' houses per step (see blocking_number.c)
+typedef struct blocking_tracker blocking_tracker_t;
+
+blocking_tracker_t* create_blocking_tracker(const problem_instance_t* instance, const matching_t* matching);
+void destroy_blocking_tracker(blocking_tracker_t* tracker);
+int blocking_tracker_update(blocking_tracker_t* tracker, const matching_t* matching,
+                            const int* agents, int num_changed);
+int blocking_tracker_value(const blocking_tracker_t* tracker);
 
 // k-stable matching existence checking
 bool k_stable_matching_exists(const problem_instance_t* instance, int k);
@@ -69,18 +244,130 @@ matching_t* find_k_stable_matching(const problem_instance_t* instance, int k);
 bool k_stable_matching_exists_efficient(const problem_instance_t* instance, int k);
 bool k_stable_matching_exists_small_k(const problem_instance_t* instance, int k);
 bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k);
+// -1 if the dp backend is selected and cannot count a house allocation
+// instance, or the count does not fit an int (count_k_stable_matchings_dp
+// reports it in full). Other models are always counted by the recursion.
 int count_k_stable_matchings(const problem_instance_t* instance, int k);
 
+// Exact k-stable counting for house allocation by dynamic programming over
+// subsets of decided agents, memoized on their improving house sets (see
+// subset_counting.c). Counts the matchings count_k_stable_matchings searches.
+#define COUNT_DP_MAX_N 20
+
+typedef struct {
+    int k;
+    long long search_leaves;              // k-stable leaves of the recursive search (its count)
+    long long k_stable;                   // Distinct k-stable matchings
+    long long total;                      // Distinct matchings searched
+    long long blocking_histogram[COUNT_DP_MAX_N + 1];  // By blocking number; [k] holds k and above
+    long long subproblems;                // Subproblems solved
+    long long memo_hits;                  // Subproblems answered from the memo
+    long long uncached;                   // Solved subproblems left out of a full memo
+} matching_count_t;
+
+typedef enum {
+    COUNT_BACKEND_RECURSIVE,              // Enumerate and verify every leaf
+    COUNT_BACKEND_SUBSET_DP               // count_k_stable_matchings_dp for house allocation
+} count_backend_t;
+
+bool count_k_stable_matchings_dp(const problem_instance_t* instance, int k, matching_count_t* result);
+void set_count_backend(count_backend_t backend);
+count_backend_t count_backend(void);
+void set_count_memo_budget(size_t budget_bytes);
+size_t count_memo_budget(void);
+
+// Per-call search statistics. Counting is compiled in with MATCHING_SEARCH_STATS
+// (make SEARCH_STATS=1, the default); without it the _with_stats variants leave
+// every field zero and the searches carry no instrumentation.
+typedef struct {
+    long long nodes_expanded;     // Search nodes entered, leaves included
+    int max_depth;                // Deepest agent index reached
+    long long leaves_verified;    // Complete matchings checked for k-stability
+    long long prunes_promising;   // Cut by is_promising_partial_matching_enhanced
+    long long prunes_conflict;    // Cut by has_conflict_early_detection
+    long long prunes_reachable;   // Cut by can_reach_k_stable
+    long long prunes_invalid;     // Cut by is_partial_matching_valid
+    double verify_ms;             // Wall time spent verifying leaves
+    long long table_hits;         // Subtrees answered by the transposition table
+    long long table_misses;       // Transposition table probes that found nothing
+    long long memo_subproblems;   // Subproblems the dp counting backend solved
+    long long memo_hits;          // Of those, answered from its memo
+} search_stats_t;
+
+void search_stats_reset(search_stats_t* stats);
+bool k_stable_matching_exists_with_stats(const problem_instance_t* instance, int k, search_stats_t* stats);
+int count_k_stable_matchings_with_stats(const problem_instance_t* instance, int k, search_stats_t* stats);
+
+// Replays steps on the enhanced search's incremental tally: {a, p} pairs the
+// unmatched agents a and p, {-1, -1} undoes the latest pairing. Returns the
+// first step after which the tally differs from a recount of the matching,
+// num_steps if none does, or -1 for an invalid step or out of memory.
+int search_tally_replay(const problem_instance_t* instance, const int (*steps)[2], int num_steps);
+
+// Transposition table shared by the recursive searches: a process-wide,
+// lock-free table of subtree results keyed by Zobrist hashes of (agent index,
+// partial matching), salted per search (--table-mb M, 16 MiB by default)
+bool transposition_table_configure(size_t budget_bytes);
+size_t transposition_table_bytes(void);
+uint64_t transposition_table_salt(void);
+uint64_t zobrist_pair_key(int a, int b);
+uint64_t zobrist_depth_key(int depth);
+bool transposition_table_probe(uint64_t key, uint64_t* value);
+void transposition_table_store(uint64_t key, uint64_t value);
+
+// Parallel existence search (exact leaves, work-stealing threads; the witness is
+// the first k-stable matching in depth-first order for any thread count).
+// *complete (may be NULL) is false if the search failed, so that a NULL witness
+// or false answer says nothing.
+matching_t* find_k_stable_matching_parallel(const problem_instance_t* instance, int k, int nthreads,
+                                            bool* complete);
+bool k_stable_matching_exists_parallel(const problem_instance_t* instance, int k, int nthreads,
+                                       bool* complete);
+
 // Utility functions
-int get_agent_rank(const agent_t* agent, int target_id);
-bool agent_prefers(const agent_t* agent, int a, int b);
 int count_improved_agents(const matching_t* current, const matching_t* alternative, 
                          const problem_instance_t* instance);
 bool is_valid_matching(const matching_t* matching, const problem_instance_t* instance);
 matching_t* copy_matching(const matching_t* original);
+bool is_valid_matching_in_arena(const matching_t* matching, const problem_instance_t* instance,
+                                matching_arena_t* arena);
+
+// Scratch arenas
+bool matching_arena_init(matching_arena_t* arena, size_t capacity);
+void matching_arena_destroy(matching_arena_t* arena);
+void* matching_arena_alloc(matching_arena_t* arena, size_t bytes);
+matching_t* matching_arena_create_matching(matching_arena_t* arena, int num_agents, matching_model_t model);
+matching_t* matching_arena_copy_matching(matching_arena_t* arena, const matching_t* original);
+size_t matching_arena_matching_bytes(int num_agents);
+bool bitset_init_in_arena(bitset_t* set, int num_bits, matching_arena_t* arena);
+
+// Matching overlays and undo trails (storage drawn from an arena)
+bool matching_overlay_init(matching_overlay_t* overlay, const matching_t* base, matching_arena_t* arena);
+void matching_overlay_set(matching_overlay_t* overlay, int agent, int partner);
+void matching_overlay_clear(matching_overlay_t* overlay);
+size_t matching_overlay_bytes(int num_agents);
+int count_improved_agents_overlay(const matching_overlay_t* alternative, const problem_instance_t* instance);
+bool matching_trail_init(matching_trail_t* trail, int capacity, matching_arena_t* arena);
+void matching_trail_set(matching_t* matching, matching_trail_t* trail, int agent, int partner);
+void matching_trail_undo(matching_t* matching, matching_trail_t* trail, int mark);
+size_t matching_trail_bytes(int capacity);
+
+// Problem instance construction
+problem_instance_t* create_problem_instance(int num_agents, matching_model_t model,
+                                            int pref_capacity, bool with_ties);
+int* instance_add_agent(problem_instance_t* instance, int num_preferences);
+int* instance_agent_tie_groups(problem_instance_t* instance, int agent);
+bool instance_finalize(problem_instance_t* instance);
+void destroy_problem_instance(problem_instance_t* instance);
+
+// Binary instance files (versioned, checksummed; layout in generators.c).
+// Loaded instances are read-only views of a file mapping.
+bool save_problem_instance(const problem_instance_t* instance, const char* path);
+problem_instance_t* load_problem_instance(const char* path);
 
 // Test case generators
 problem_instance_t* generate_random_house_allocation(int num_agents, uint32_t seed);
+problem_instance_t* generate_house_allocation_from_profile(int n, const int* profile);
 problem_instance_t* generate_random_marriage(int num_men, int num_women, uint32_t seed);
 problem_instance_t* generate_random_roommates(int num_agents, uint32_t seed);
 problem_instance_t* generate_test_case_1(void);
@@ -91,14 +378,175 @@ void print_problem_instance(const problem_instance_t* instance);
 // k-hai (partial preferences) generators
 problem_instance_t* generate_k_hai_instance(int num_agents, int num_objects, uint32_t seed);
 problem_instance_t* generate_k_hai_with_indifferences(int num_agents, int num_objects, uint32_t seed);
-bool is_object_acceptable_to_agent(const agent_t* agent, int object_id, int num_objects);
-bool agent_indifferent_between(const agent_t* agent, int obj1, int obj2);
+problem_instance_t* generate_truncated_house_allocation(int num_agents, int list_length, uint32_t seed);
+bool is_object_acceptable_to_agent(const problem_instance_t* instance, int agent, int object_id);
+bool agent_indifferent_between(const problem_instance_t* instance, int agent, int obj1, int obj2);
+
+// Ranked enumeration (lexicographic permutations; profiles as base-n! numbers,
+// agent 0 most significant). Counts are 0 when they overflow 64 bits.
+uint64_t permutation_count(int n);
+uint64_t preference_profile_count(int n);
+void unrank_permutation(uint64_t rank, int n, int* perm);
+void unrank_preference_profile(uint64_t rank, int n, int* profile);
+uint64_t rank_permutation(const int* perm, int n);
+uint64_t rank_preference_profile(const int* profile, int n);
+uint64_t canonical_profile_orbit_size(const int* profile, int n);
+void shard_range(uint64_t count, int shard, int num_shards, uint64_t* begin, uint64_t* end);
+
+// Profiles of rank begin .. end - 1 in rank order, each one step from the
+// last (the last agent's list advances, carrying into earlier agents)
+#define PROFILE_MAX_N 6
+
+typedef struct {
+    int n;
+    uint64_t rank;               // rank of profile
+    uint64_t end;
+    uint64_t orbit_size;         // set by the canonical iterator
+    int profile[PROFILE_MAX_N * PROFILE_MAX_N];
+} profile_iterator_t;
+
+bool profile_iterator_init(profile_iterator_t* iterator, int n, uint64_t begin, uint64_t end);
+bool profile_iterator_next(profile_iterator_t* iterator);
+
+// Only the orbit representatives among those profiles (see canonical_profile_orbit_size)
+bool canonical_profile_iterator_init(profile_iterator_t* iterator, int n, uint64_t begin, uint64_t end);
+bool canonical_profile_iterator_next(profile_iterator_t* iterator);
+
+// Chunked parallel loop over [0, count); fn receives the worker id (< num_threads)
+typedef void (*index_chunk_fn)(void* context, int worker, uint64_t begin, uint64_t end);
+bool parallel_for_chunks(uint64_t count, uint64_t chunk_size, int num_threads,
+                         index_chunk_fn fn, void* context);
+int default_thread_count(void);
+
+// Timing: monotonic wall clock and per-thread / process CPU clocks, in milliseconds
+double wall_time_ms(void);
+double thread_cpu_time_ms(void);
+double process_cpu_time_ms(void);
+
+typedef struct {
+    double wall_start;
+    double cpu_start;
+    double wall_ms;               // Elapsed wall time, set by stopwatch_stop
+    double cpu_ms;                // Elapsed CPU time of the timing thread
+} stopwatch_t;
+
+void stopwatch_start(stopwatch_t* watch);
+void stopwatch_stop(stopwatch_t* watch);
+
+// Process-wide profile of nested named phases (generate, preprocess, search,
+// verify, ...), opened and closed on the main thread; printed with --profile
+void phase_begin(const char* name);
+void phase_end(stopwatch_t* elapsed);
+void phase_add(const char* name, double wall_ms, double cpu_ms, long long calls);
+void phase_profile_reset(void);
+void phase_profile_print(void);
+
+// Per-trial benchmark records, streamed as JSON lines or CSV rows
+// (--output-format jsonl|csv, --output FILE)
+typedef enum {
+    RESULT_FORMAT_JSONL,
+    RESULT_FORMAT_CSV
+} result_format_t;
+
+typedef struct {
+    const char* benchmark;        // Emitting benchmark, e.g. "existence_complexity"
+    const char* algorithm;        // "verify", or the existence algorithm dispatched to
+    matching_model_t model;
+    int n;
+    int k;
+    uint64_t seed;                // Generator seed (profile rank for enumerated instances)
+    double wall_ms;
+    double cpu_ms;
+    long long result;             // 1/0 for decisions, a count otherwise, -1 if none
+    long long nodes;              // Search nodes expanded, -1 if not counted
+    long long weight;             // Instances the trial stands for (orbit size when enumerating)
+} trial_record_t;
+
+bool parse_result_format(const char* name, result_format_t* format);
+bool result_sink_open(const char* path, result_format_t format);
+bool result_sink_active(void);
+void result_sink_emit(const trial_record_t* record);
+bool result_sink_close(void);
+
+// Trial runner: batches of independent benchmark trials on worker threads
+// (--threads T, all cores by default). Generated trials are seeded with the
+// process-wide base (--seed S, default 1) plus an offset per trial.
+typedef enum {
+    TRIAL_HOUSE_ALLOCATION,       // generate_random_house_allocation(n)
+    TRIAL_MARRIAGE,               // generate_random_marriage(n / 2, n / 2)
+    TRIAL_ROOMMATES,              // generate_random_roommates(n)
+    TRIAL_K_HAI,                  // generate_k_hai_instance(n, param objects)
+    TRIAL_K_HAI_INDIFFERENCES,    // generate_k_hai_with_indifferences(n, param objects)
+    TRIAL_TRUNCATED,              // generate_truncated_house_allocation(n, param houses per list)
+    TRIAL_FIXED                   // the batch's instance, not generated
+} trial_source_t;
+
+typedef enum {
+    TRIAL_VERIFY,                 // Verify a fixed simple matching
+    TRIAL_SEARCH                  // k_stable_matching_exists
+} trial_task_t;
+
+typedef struct {
+    trial_source_t source;
+    trial_task_t task;
+    int n;
+    int param;
+    int k;
+    uint32_t seed;
+    int group;                    // Totals the outcome is added to
+} trial_job_t;
+
+// Outcomes of one group of trials. Counts do not depend on the thread count.
+typedef struct {
+    int trials;                   // Trials run (instances that could be generated)
+    int positive;                 // k-stable (verify) or k-stable matching exists (search)
+    double wall_ms;               // Task wall time, summed
+    double wall_sq_ms;            // Squared task wall times, summed
+    double min_wall_ms;
+    double max_wall_ms;
+    double generate_ms;           // Generation wall time, summed
+    search_stats_t stats;         // Search counters summed (max_depth is the maximum)
+} trial_totals_t;
+
+typedef struct {
+    trial_job_t* jobs;
+    int num_jobs;
+    int capacity;
+    int num_groups;
+    trial_totals_t* totals;       // [num_groups], filled by trial_batch_run
+    const problem_instance_t* instance;   // For TRIAL_FIXED jobs
+} trial_batch_t;
+
+void set_trial_threads(int num_threads);
+int trial_threads(void);
+void set_trial_base_seed(uint32_t seed);
+uint32_t trial_seed(uint32_t offset);
+// The instance of a generated source, built into buffer (an instance from
+// any generator, or NULL for a new one) so that repeated calls reuse its
+// arrays; the same instance the source's generator returns. On failure the
+// buffer is destroyed and NULL returned.
+problem_instance_t* generate_trial_instance(problem_instance_t* buffer, trial_source_t source,
+                                            int n, int param, uint32_t seed);
+void trial_batch_init(trial_batch_t* batch, const problem_instance_t* instance);
+int trial_batch_add_group(trial_batch_t* batch, trial_source_t source, trial_task_t task,
+                          int n, int param, int k, uint32_t seed_offset, int num_trials);
+bool trial_batch_run(trial_batch_t* batch, const char* benchmark, bool collect_stats);
+void trial_batch_destroy(trial_batch_t* batch);
+double trial_mean_ms(const trial_totals_t* totals);
+double trial_std_dev_ms(const trial_totals_t* totals);
+const char* existence_algorithm_name(int n, int k);
+void record_trial(const char* benchmark, const char* algorithm, matching_model_t model,
+                  int n, int k, uint64_t seed, long long weight, const stopwatch_t* timer,
+                  long long result, const search_stats_t* stats);
 
 // Benchmarking
 void benchmark_verification_complexity(int max_agents, int num_trials);
 void benchmark_existence_complexity(int max_agents, int num_trials);
 void benchmark_model_comparison(int num_agents, int num_trials);
 void analyze_k_ratio_effect(int num_agents, int num_trials);
+void benchmark_verification_scaling(int list_length, int num_trials);
+void benchmark_loaded_instance(const problem_instance_t* instance, int num_trials);
+void benchmark_search_stats(int num_agents, int num_trials);
 
 // Enhanced benchmarking functions
 void benchmark_brute_force_small_instances(int max_agents);
@@ -113,6 +561,22 @@ void analyze_k_hai_existence_patterns(int num_agents, int num_objects, int num_t
 
 // Brute force house allocation analysis
 void analyze_all_house_allocations(int n, int k);
+void analyze_all_house_allocations_sampled(int n, int k, int sample_size, int num_threads);
+
+// Totals over all n! matchings of one house allocation instance
+#define MATCHING_CENSUS_MAX_N 12
+
+typedef struct {
+    long long total;
+    long long k_stable;                   // Feasible matchings with blocking number below k
+    long long preferring_sum;             // Agents ranking some house above their own, summed
+    int min_preferring;
+    int max_preferring;
+    long long blocking_histogram[MATCHING_CENSUS_MAX_N + 1];
+} matching_census_t;
+
+bool house_allocation_matching_census(const problem_instance_t* instance, int k, int num_threads,
+                                      matching_census_t* census);
 void run_brute_force_analysis(void);
 
 #endif // MATCHING_H
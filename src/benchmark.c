@@ -1,11 +1,31 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
-#include <math.h>
 #include "matching.h"
 
+// Every benchmark runs as a named phase of the process-wide phase profile
+// (timing.c). Its trials are queued as groups of a trial batch, one group per
+// table cell, and run on the trial runner's worker threads (trial_runner.c),
+// which charge instance generation, searches and verifications to nested
+// "generate" / "search" / "verify" phases. Seeds are the base seed (--seed)
+// plus the trial's offset, so tables and records are reproducible and their
+// counts are the same for any --threads. Tables report wall time on the
+// monotonic clock; records carry wall and CPU time separately.
+
+// Forward declarations
+static bool run_benchmark_trials(trial_batch_t* batch, bool queued, const char* benchmark,
+                                 bool collect_stats);
+static void model_comparison_row(const char* label, const char* phase, trial_source_t source,
+                                 int num_agents, int num_trials);
+static search_stats_t* trial_stats(search_stats_t* stats);
+
+// Step between instance sizes of the verification complexity sweep
+#define VERIFICATION_SIZE_STEP(n) (((n) < 20) ? 3 : ((n) < 50) ? 5 : 10)
+
 // Benchmark k-stability verification complexity
 void benchmark_verification_complexity(int max_agents, int num_trials) {
+    phase_begin("verification_complexity");
     printf("=== Benchmarking k-Stability Verification Complexity ===\n");
     printf("Testing polynomial time claim: verification should be O(n^c) for some constant c\n");
     printf("Max agents: %d, Trials per size: %d\n\n", max_agents, num_trials);
@@ -13,72 +33,38 @@ void benchmark_verification_complexity(int max_agents, int num_trials) {
     printf("Agents\tAvg Time (ms)\tStd Dev\t\tMin Time\tMax Time\tTrials\tSuccess Rate\n");
     printf("------\t-------------\t-------\t\t--------\t--------\t------\t------------\n");
     
-    // Use better step sizes for more comprehensive testing
-    for (int n = 5; n <= max_agents; n += (n < 20) ? 3 : (n < 50) ? 5 : 10) {
-        // printf("DEBUG: Testing with %d agents...\n", n);
-        double total_time = 0.0;
-        double sum_squared = 0.0;
-        double min_time = 1e9;
-        double max_time = 0.0;
-        int successful_trials = 0;
-        
-        for (int trial = 0; trial < num_trials; trial++) {
-            // printf("DEBUG: Trial %d/%d for n=%d\n", trial+1, num_trials, n);
-            
-            // Generate random instance
-            problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial);
-            if (instance == NULL) {
-                // printf("DEBUG: Failed to generate instance for trial %d\n", trial);
-                continue;
-            }
-            
-            // Create a random matching
-            matching_t* matching = create_matching(n, HOUSE_ALLOCATION);
-            if (matching == NULL) {
-                // printf("DEBUG: Failed to create matching for trial %d\n", trial);
-                free(instance);
-                continue;
-            }
-            
-            // Create a simple matching (assign agent i to house i)
-            for (int i = 0; i < n; i++) {
-                matching->pairs[i] = i;
+    // Use better step sizes for more comprehensive testing; each trial verifies
+    // the matching of agent i to house i with k = n/2
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int n = 5; queued && n <= max_agents; n += VERIFICATION_SIZE_STEP(n)) {
+        queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_VERIFY, n, 0, n/2,
+                                       0, num_trials) >= 0;
+    }
+    
+    if (run_benchmark_trials(&batch, queued, "verification_complexity", false)) {
+        int group = 0;
+        for (int n = 5; n <= max_agents; n += VERIFICATION_SIZE_STEP(n)) {
+            const trial_totals_t* totals = &batch.totals[group++];
+            if (totals->trials > 0) {
+                double success_rate = (double)totals->trials / num_trials;
+                printf("%d\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\t%.2f\n",
+                       n, trial_mean_ms(totals), trial_std_dev_ms(totals), totals->min_wall_ms,
+                       totals->max_wall_ms, totals->trials, success_rate);
             }
-            
-            // Benchmark verification
-            // printf("DEBUG: Starting verification for trial %d...\n", trial);
-            clock_t start = clock();
-            is_k_stable_direct(matching, instance, n/2);  // k = n/2
-            clock_t end = clock();
-            // printf("DEBUG: Verification completed for trial %d\n", trial);
-            
-            double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-            total_time += time_ms;
-            sum_squared += time_ms * time_ms;
-            if (time_ms < min_time) min_time = time_ms;
-            if (time_ms > max_time) max_time = time_ms;
-            successful_trials++;
-            
-            destroy_matching(matching);
-            free(instance);
-        }
-        
-        if (successful_trials > 0) {
-            double avg_time = total_time / successful_trials;
-            double variance = (sum_squared / successful_trials) - (avg_time * avg_time);
-            double std_dev = sqrt(variance);
-            double success_rate = (double)successful_trials / num_trials;
-            
-            printf("%d\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\t%.2f\n", 
-                   n, avg_time, std_dev, min_time, max_time, successful_trials, success_rate);
         }
     }
+    trial_batch_destroy(&batch);
     
     printf("\nNote: Times should grow polynomially (not exponentially) with n\n");
+    
+    phase_end(NULL);
 }
 
 // Benchmark k-stable matching existence complexity
 void benchmark_existence_complexity(int max_agents, int num_trials) {
+    phase_begin("existence_complexity");
     printf("=== Benchmarking k-Stable Matching Existence Complexity ===\n");
     printf("Testing complexity claims for different k/n ratios\n");
     printf("Max agents: %d, Trials per size: %d\n\n", max_agents, num_trials);
@@ -86,431 +72,520 @@ void benchmark_existence_complexity(int max_agents, int num_trials) {
     printf("Agents\tk/n\tAvg Time (ms)\tStd Dev\t\tTrials\tExists\n");
     printf("------\t---\t-------------\t-------\t\t------\t------\n");
     
-    for (int n = 4; n <= max_agents; n += 2) {
-        // printf("DEBUG: Testing existence with %d agents...\n", n);
-        // Test different k/n ratios
-        double ratios[] = {0.25, 0.5, 0.75};
-        int num_ratios = sizeof(ratios) / sizeof(ratios[0]);
-        
-        for (int r = 0; r < num_ratios; r++) {
+    // Test different k/n ratios
+    double ratios[] = {0.25, 0.5, 0.75};
+    int num_ratios = sizeof(ratios) / sizeof(ratios[0]);
+    
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int n = 4; queued && n <= max_agents; n += 2) {
+        for (int r = 0; queued && r < num_ratios; r++) {
             int k = (int)(n * ratios[r]);
             if (k <= 0) k = 1;
-            
-            // printf("DEBUG: Testing k=%d (ratio=%.2f) for n=%d\n", k, ratios[r], n);
-            
-            double total_time = 0.0;
-            double sum_squared = 0.0;
-            int successful_trials = 0;
-            int exists_count = 0;
-            
-            for (int trial = 0; trial < num_trials; trial++) {
-                // printf("DEBUG: Existence trial %d/%d for n=%d, k=%d\n", trial+1, num_trials, n, k);
-                
-                // Generate random instance
-                problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial);
-                if (instance == NULL) {
-                    // printf("DEBUG: Failed to generate instance for existence trial %d\n", trial);
-                    continue;
+            queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, n, 0, k,
+                                           0, num_trials) >= 0;
+        }
+    }
+    
+    if (run_benchmark_trials(&batch, queued, "existence_complexity", false)) {
+        int group = 0;
+        for (int n = 4; n <= max_agents; n += 2) {
+            for (int r = 0; r < num_ratios; r++) {
+                const trial_totals_t* totals = &batch.totals[group++];
+                if (totals->trials > 0) {
+                    double exists_rate = (double)totals->positive / totals->trials;
+                    printf("%d\t%.2f\t%.3f\t\t%.3f\t\t%d\t%.2f\n",
+                           n, ratios[r], trial_mean_ms(totals), trial_std_dev_ms(totals),
+                           totals->trials, exists_rate);
                 }
-                
-                // Benchmark existence checking
-                // printf("DEBUG: Starting existence check for trial %d...\n", trial);
-                clock_t start = clock();
-                bool exists = k_stable_matching_exists(instance, k);
-                clock_t end = clock();
-                // printf("DEBUG: Existence check completed for trial %d (result: %s)\n", trial, exists ? "EXISTS" : "NOT EXISTS");
-                
-                double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-                total_time += time_ms;
-                sum_squared += time_ms * time_ms;
-                successful_trials++;
-                
-                if (exists) exists_count++;
-                
-                free(instance);
-            }
-            
-            if (successful_trials > 0) {
-                double avg_time = total_time / successful_trials;
-                double variance = (sum_squared / successful_trials) - (avg_time * avg_time);
-                double std_dev = sqrt(variance);
-                double exists_rate = (double)exists_count / successful_trials;
-                
-                printf("%d\t%.2f\t%.3f\t\t%.3f\t\t%d\t%.2f\n", 
-                       n, ratios[r], avg_time, std_dev, successful_trials, exists_rate);
             }
         }
     }
+    trial_batch_destroy(&batch);
     
     printf("\nNote: Complexity should vary with k/n ratio as predicted by theory\n");
+    
+    phase_end(NULL);
 }
 
 // Compare different matching models
 void benchmark_model_comparison(int num_agents, int num_trials) {
+    phase_begin("model_comparison");
     printf("=== Comparing Different Matching Models ===\n");
     printf("Agents: %d, Trials: %d\n\n", num_agents, num_trials);
     
     printf("Model\t\t\tAvg Time (ms)\tStd Dev\t\tTrials\n");
     printf("-----\t\t\t-------------\t-------\t\t------\n");
     
-    // Test House Allocation
-    double total_time = 0.0;
-    double sum_squared = 0.0;
-    int successful_trials = 0;
+    // Each model verifies its simplest complete matching with k = n/2: agent i
+    // with house i, man i with woman i, or adjacent roommates
+    model_comparison_row("House Allocation\t", "house", TRIAL_HOUSE_ALLOCATION, num_agents, num_trials);
+    if (num_agents % 2 == 0) {
+        model_comparison_row("Marriage\t\t", "marriage", TRIAL_MARRIAGE, num_agents, num_trials);
+    }
+    model_comparison_row("Roommates\t\t", "roommates", TRIAL_ROOMMATES, num_agents, num_trials);
     
-    for (int trial = 0; trial < num_trials; trial++) {
-        problem_instance_t* instance = generate_random_house_allocation(num_agents, time(NULL) + trial);
-        if (instance == NULL) continue;
-        
-        matching_t* matching = create_matching(num_agents, HOUSE_ALLOCATION);
-        if (matching == NULL) {
-            free(instance);
-            continue;
-        }
-        
-        for (int i = 0; i < num_agents; i++) {
-            matching->pairs[i] = i;
-        }
-        
-        clock_t start = clock();
-        is_k_stable_direct(matching, instance, num_agents/2);
-        clock_t end = clock();
-        
-        double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-        total_time += time_ms;
-        sum_squared += time_ms * time_ms;
-        successful_trials++;
-        
-        destroy_matching(matching);
-        free(instance);
+    phase_end(NULL);
+}
+
+// One row of the model comparison, run as its own phase
+static void model_comparison_row(const char* label, const char* phase, trial_source_t source,
+                                 int num_agents, int num_trials) {
+    phase_begin(phase);
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = trial_batch_add_group(&batch, source, TRIAL_VERIFY, num_agents, 0, num_agents/2,
+                                        0, num_trials) >= 0;
+    if (run_benchmark_trials(&batch, queued, "model_comparison", false) && batch.totals[0].trials > 0) {
+        printf("%s%.3f\t\t%.3f\t\t%d\n", label, trial_mean_ms(&batch.totals[0]),
+               trial_std_dev_ms(&batch.totals[0]), batch.totals[0].trials);
     }
+    trial_batch_destroy(&batch);
+    phase_end(NULL);
+}
+
+// Analyze the relationship between k/n ratio and existence probability
+void analyze_k_ratio_effect(int num_agents, int num_trials) {
+    phase_begin("analyze_k_ratio_effect");
+    printf("=== Analyzing k/n Ratio Effect on Existence ===\n");
+    printf("Agents: %d, Trials: %d\n\n", num_agents, num_trials);
+    
+    printf("k/n\t\tExistence Rate\tAvg Time (ms)\tStd Dev\n");
+    printf("---\t\t--------------\t-------------\t-------\n");
     
-    if (successful_trials > 0) {
-        double avg_time = total_time / successful_trials;
-        double variance = (sum_squared / successful_trials) - (avg_time * avg_time);
-        double std_dev = sqrt(variance);
-        printf("House Allocation\t%.3f\t\t%.3f\t\t%d\n", avg_time, std_dev, successful_trials);
+    // Every k searches the same instances
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int k = 1; queued && k <= num_agents; k++) {
+        queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, num_agents, 0, k,
+                                       0, num_trials) >= 0;
     }
     
-    // Test Marriage (if num_agents is even)
-    if (num_agents % 2 == 0) {
-        total_time = 0.0;
-        sum_squared = 0.0;
-        successful_trials = 0;
-        
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_random_marriage(num_agents/2, num_agents/2, time(NULL) + trial);
-            if (instance == NULL) continue;
-            
-            matching_t* matching = create_matching(num_agents, MARRIAGE);
-            if (matching == NULL) {
-                free(instance);
-                continue;
-            }
-            
-            // Simple matching: man i with woman i
-            for (int i = 0; i < num_agents/2; i++) {
-                matching->pairs[i] = num_agents/2 + i;
-                matching->pairs[num_agents/2 + i] = i;
+    if (run_benchmark_trials(&batch, queued, "k_ratio_effect", false)) {
+        for (int k = 1; k <= num_agents; k++) {
+            const trial_totals_t* totals = &batch.totals[k - 1];
+            if (totals->trials > 0) {
+                double exists_rate = (double)totals->positive / totals->trials;
+                double k_ratio = (double)k / num_agents;
+                
+                printf("%.2f\t\t%.3f\t\t%.3f\t\t%.3f\n",
+                       k_ratio, exists_rate, trial_mean_ms(totals), trial_std_dev_ms(totals));
             }
-            
-            clock_t start = clock();
-            is_k_stable_direct(matching, instance, num_agents/2);
-            clock_t end = clock();
-            
-            double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-            total_time += time_ms;
-            sum_squared += time_ms * time_ms;
-            successful_trials++;
-            
-            destroy_matching(matching);
-            free(instance);
         }
-        
-        if (successful_trials > 0) {
-            double avg_time = total_time / successful_trials;
-            double variance = (sum_squared / successful_trials) - (avg_time * avg_time);
-            double std_dev = sqrt(variance);
-            printf("Marriage\t\t%.3f\t\t%.3f\t\t%d\n", avg_time, std_dev, successful_trials);
+    }
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
+}
+
+// Benchmark verification on large markets with truncated preference lists
+void benchmark_verification_scaling(int list_length, int num_trials) {
+    phase_begin("verification_scaling");
+    printf("=== Verification Scaling on Large Markets ===\n");
+    printf("House allocation with truncated lists of %d houses, k = n/2\n", list_length);
+    printf("Trials per size: %d\n\n", num_trials);
+    
+    printf("Agents\tPref Entries\tGen Time (ms)\tAvg Verify (ms)\tMax Verify (ms)\tTrials\n");
+    printf("------\t------------\t-------------\t---------------\t---------------\t------\n");
+    
+    int sizes[] = {1000, 10000, 100000};
+    int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    
+    // Each trial verifies the matching of agent i to house i
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int s = 0; queued && s < num_sizes; s++) {
+        queued = trial_batch_add_group(&batch, TRIAL_TRUNCATED, TRIAL_VERIFY, sizes[s], list_length,
+                                       sizes[s]/2, 0, num_trials) >= 0;
+    }
+    
+    if (run_benchmark_trials(&batch, queued, "verification_scaling", false)) {
+        for (int s = 0; s < num_sizes; s++) {
+            int n = sizes[s];
+            const trial_totals_t* totals = &batch.totals[s];
+            if (totals->trials > 0) {
+                printf("%d\t%lld\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\n",
+                       n, (long long)n * list_length, totals->generate_ms / totals->trials,
+                       trial_mean_ms(totals), totals->max_wall_ms, totals->trials);
+            }
         }
     }
+    trial_batch_destroy(&batch);
     
-    // Test Roommates
-    total_time = 0.0;
-    sum_squared = 0.0;
-    successful_trials = 0;
+    printf("\nNote: Memory and time should grow with n * list length, not n^2\n");
     
-    for (int trial = 0; trial < num_trials; trial++) {
-        problem_instance_t* instance = generate_random_roommates(num_agents, time(NULL) + trial);
-        if (instance == NULL) continue;
-        
-        matching_t* matching = create_matching(num_agents, ROOMMATES);
-        if (matching == NULL) {
-            free(instance);
+    phase_end(NULL);
+}
+
+// Time verification and existence on one saved instance (--benchmark --load FILE)
+void benchmark_loaded_instance(const problem_instance_t* instance, int num_trials) {
+    phase_begin("loaded_instance");
+    const char* model_names[] = {"house", "marriage", "roommates", "house (partial)"};
+    int n = instance->num_agents;
+    
+    printf("=== Benchmark on Loaded Instance ===\n");
+    printf("Model: %s, agents: %d, preference entries: %d, trials: %d\n\n",
+           model_names[instance->model], n, instance->pref_offsets[n], num_trials);
+    
+    // Verification runs against the empty matching, which is feasible in every model
+    matching_t* matching = create_matching(n, instance->model);
+    if (matching == NULL) {
+        printf("Error: Could not create matching\n");
+        phase_end(NULL);
+        return;
+    }
+    printf("Blocking number of the empty matching: %d\n\n", blocking_number(matching, instance));
+    destroy_matching(matching);
+    
+    printf("k\tVerify (ms)\tExistence (ms)\tExists\n");
+    printf("-\t-----------\t--------------\t------\n");
+    
+    // A verify group and a search group per k; every trial reruns the same instance
+    int key_k[] = {1, 2, 3, n / 4, n / 2, (3 * n) / 4, n};
+    int num_key_k = sizeof(key_k) / sizeof(key_k[0]);
+    trial_batch_t batch;
+    trial_batch_init(&batch, instance);
+    bool queued = true;
+    int previous_k = 0;
+    for (int i = 0; queued && i < num_key_k; i++) {
+        int k = key_k[i];
+        if (k <= previous_k || k > n) {
             continue;
         }
-        
-        // Simple matching: pair adjacent agents
-        for (int i = 0; i < num_agents - 1; i += 2) {
-            matching->pairs[i] = i + 1;
-            matching->pairs[i + 1] = i;
-        }
-        
-        clock_t start = clock();
-        is_k_stable_direct(matching, instance, num_agents/2);
-        clock_t end = clock();
-        
-        double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-        total_time += time_ms;
-        sum_squared += time_ms * time_ms;
-        successful_trials++;
-        
-        destroy_matching(matching);
-        free(instance);
+        previous_k = k;
+        queued = trial_batch_add_group(&batch, TRIAL_FIXED, TRIAL_VERIFY, n, 0, k, 0, num_trials) >= 0 &&
+                 trial_batch_add_group(&batch, TRIAL_FIXED, TRIAL_SEARCH, n, 0, k, 0, num_trials) >= 0;
     }
     
-    if (successful_trials > 0) {
-        double avg_time = total_time / successful_trials;
-        double variance = (sum_squared / successful_trials) - (avg_time * avg_time);
-        double std_dev = sqrt(variance);
-        printf("Roommates\t\t%.3f\t\t%.3f\t\t%d\n", avg_time, std_dev, successful_trials);
+    if (run_benchmark_trials(&batch, queued, "loaded_instance", false)) {
+        int group = 0;
+        previous_k = 0;
+        for (int i = 0; i < num_key_k; i++) {
+            int k = key_k[i];
+            if (k <= previous_k || k > n) {
+                continue;
+            }
+            previous_k = k;
+            const trial_totals_t* verify = &batch.totals[group++];
+            const trial_totals_t* search = &batch.totals[group++];
+            printf("%d\t%.3f\t\t%.3f\t\t%s\n", k, trial_mean_ms(verify), trial_mean_ms(search),
+                   search->positive > 0 ? "yes" : "no");
+        }
     }
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
 }
 
-// Analyze the relationship between k/n ratio and existence probability
-void analyze_k_ratio_effect(int num_agents, int num_trials) {
-    printf("=== Analyzing k/n Ratio Effect on Existence ===\n");
-    printf("Agents: %d, Trials: %d\n\n", num_agents, num_trials);
-    
-    printf("k/n\t\tExistence Rate\tAvg Time (ms)\tStd Dev\n");
-    printf("---\t\t--------------\t-------------\t-------\n");
+// Where the existence search spends its effort: nodes, verified leaves and the
+// prunes each rule makes, averaged per trial for every k
+void benchmark_search_stats(int num_agents, int num_trials) {
+    phase_begin("search_stats");
+    printf("=== Existence Search Statistics ===\n");
+    printf("House allocation, agents: %d, trials per k: %d\n\n", num_agents, num_trials);
+#ifndef MATCHING_SEARCH_STATS
+    printf("Search statistics are compiled out (build with SEARCH_STATS=1)\n");
+    phase_end(NULL);
+    return;
+#endif
+    
+    printf("k\tAlgorithm\tNodes\t\tLeaves\tMax Depth\tPromising\tConflict\tReachable\tInvalid\tTable Hits\tVerify (ms)\n");
+    printf("-\t---------\t-----\t\t------\t---------\t---------\t--------\t---------\t-------\t----------\t-----------\n");
+    
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int k = 1; queued && k <= num_agents; k++) {
+        queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, num_agents, 0, k,
+                                       0, num_trials) >= 0;
+    }
     
-    for (int k = 1; k <= num_agents; k++) {
-        double total_time = 0.0;
-        double sum_squared = 0.0;
-        int successful_trials = 0;
-        int exists_count = 0;
-        
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_random_house_allocation(num_agents, time(NULL) + trial);
-            if (instance == NULL) continue;
-            
-            clock_t start = clock();
-            bool exists = k_stable_matching_exists(instance, k);
-            clock_t end = clock();
-            
-            double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-            total_time += time_ms;
-            sum_squared += time_ms * time_ms;
-            successful_trials++;
-            
-            if (exists) exists_count++;
-            
-            free(instance);
-        }
-        
-        if (successful_trials > 0) {
-            double avg_time = total_time / successful_trials;
-            double variance = (sum_squared / successful_trials) - (avg_time * avg_time);
-            double std_dev = sqrt(variance);
-            double exists_rate = (double)exists_count / successful_trials;
-            double k_ratio = (double)k / num_agents;
-            
-            printf("%.2f\t\t%.3f\t\t%.3f\t\t%.3f\n", 
-                   k_ratio, exists_rate, avg_time, std_dev);
+    if (run_benchmark_trials(&batch, queued, "search_stats", true)) {
+        for (int k = 1; k <= num_agents; k++) {
+            const trial_totals_t* totals = &batch.totals[k - 1];
+            if (totals->trials > 0) {
+                const search_stats_t* total = &totals->stats;
+                double trials = totals->trials;
+                printf("%d\t%s\t\t%.1f\t\t%.1f\t%d\t\t%.1f\t\t%.1f\t\t%.1f\t\t%.1f\t%.1f\t\t%.3f\n",
+                       k, existence_algorithm_name(num_agents, k), total->nodes_expanded / trials,
+                       total->leaves_verified / trials, total->max_depth, total->prunes_promising / trials,
+                       total->prunes_conflict / trials, total->prunes_reachable / trials,
+                       total->prunes_invalid / trials, total->table_hits / trials, total->verify_ms / trials);
+            }
         }
     }
+    trial_batch_destroy(&batch);
+    
+    printf("\nNote: prune columns count the subtrees each rule cut; Table Hits counts failed subtrees reached\n");
+    printf("again and answered from the transposition table; Verify is wall time in leaf checks\n");
+    
+    phase_end(NULL);
 }
 
+// Largest n whose profiles are all enumerated (one per orbit); larger n are sampled
+#define PROFILE_EXHAUSTIVE_MAX_N 5
+
 // Forward declaration for helper function
-static void generate_all_preference_profiles(int n, int* total_instances, 
-                                           int* k_stable_count, double* total_time);
+static bool generate_all_preference_profiles(int n, long long* total_instances, long long* searched_instances,
+                                           long long* k_stable_count, double* total_time);
 
 // Brute force enumeration for small instances - check all possible preference profiles
 void benchmark_brute_force_small_instances(int max_agents) {
+    phase_begin("brute_force_small_instances");
     printf("=== Brute Force Analysis for Small Instances ===\n");
-    printf("Testing all possible preference profiles for n <= %d\n", max_agents);
-    printf("Note: This is computationally intensive for n > 4\n\n");
+    printf("Testing all possible preference profiles for n <= %d\n",
+           max_agents < PROFILE_EXHAUSTIVE_MAX_N ? max_agents : PROFILE_EXHAUSTIVE_MAX_N);
+    if (max_agents > PROFILE_EXHAUSTIVE_MAX_N) {
+        printf("Note: n > %d has too many profiles, so random samples are tested instead\n",
+               PROFILE_EXHAUSTIVE_MAX_N);
+    }
+    printf("\n");
     
     for (int n = 2; n <= max_agents; n++) {
-        printf("--- n = %d agents ---\n", n);
+        // For small n, we can enumerate all possible preference profiles, one
+        // per orbit of relabelings. n = 5 has 207,360,024 orbits (about an
+        // hour on one core, divided among all cores); n = 6 has about 10^15,
+        // so it tests random samples (rows labeled as sampled)
+        bool sampled = n > PROFILE_EXHAUSTIVE_MAX_N;
+        if (sampled) {
+            printf("--- n = %d agents (sampled: %d!^%d profiles are too many) ---\n", n, n, n);
+        } else {
+            printf("--- n = %d agents ---\n", n);
+        }
         printf("k\tTotal Instances\tk-Stable Exist\tExistence Rate\tAvg Time (ms)\n");
         printf("-\t--------------\t--------------\t--------------\t-------------\n");
         
-        // For small n, we can enumerate all possible preference profiles
-        // This is only feasible for n <= 4 due to factorial growth
-        if (n > 4) {
-            printf("Skipping n=%d (too many combinations: %d!^%d)\n", n, n, n);
+        // Generate all possible preference profiles
+        long long total_instances = 0;
+        long long searched_instances = 0;
+        long long* k_stable_count = calloc(n + 1, sizeof(long long));
+        double* total_time = calloc(n + 1, sizeof(double));
+        if (k_stable_count == NULL || total_time == NULL) {
+            free(k_stable_count);
+            free(total_time);
             continue;
         }
         
-        // Generate all possible preference profiles
-        int total_instances = 0;
-        int k_stable_count[MAX_AGENTS + 1] = {0};
-        double total_time[MAX_AGENTS + 1] = {0.0};
-        
         // Use systematic generation of preference profiles
-        generate_all_preference_profiles(n, &total_instances, k_stable_count, total_time);
+        if (!generate_all_preference_profiles(n, &total_instances, &searched_instances,
+                                              k_stable_count, total_time)) {
+            printf("Out of memory for n=%d\n\n", n);
+            free(k_stable_count);
+            free(total_time);
+            continue;
+        }
         
-        // Report results for each k
+        // Report results for each k (times are per searched instance)
         for (int k = 1; k <= n; k++) {
             double existence_rate = (double)k_stable_count[k] / total_instances;
-            double avg_time = total_time[k] / total_instances;
+            double avg_time = total_time[k] / searched_instances;
             
-            printf("%d\t%d\t\t%d\t\t%.4f\t\t%.3f\n", 
-                   k, total_instances, k_stable_count[k], existence_rate, avg_time);
+            printf("%d\t%lld%s\t%lld\t\t%.4f\t\t%.3f\n", 
+                   k, total_instances, sampled ? " sampled" : "\t", k_stable_count[k], existence_rate, avg_time);
+        }
+        if (searched_instances < total_instances) {
+            printf("Searched %lld orbit representatives for %lld profiles\n", searched_instances, total_instances);
         }
         printf("\n");
+        
+        free(k_stable_count);
+        free(total_time);
     }
+    
+    phase_end(NULL);
 }
 
+// Profile prefixes (or samples) handed to each worker per claim
+#define PROFILE_CHUNK_SIZE 8
+
+// Agents whose lists make up the prefixes the exhaustive sweep is split by
+#define PROFILE_PREFIX_ROWS 2
+
+// Per-worker histograms, merged once all workers have finished. Counts are
+// weighted by orbit size, so they are over all labeled profiles.
+typedef struct {
+    long long searched;          // instances searched (orbit representatives or samples)
+    long long* k_stable_count;   // [n + 1]
+    double* total_time;          // [n + 1], thread CPU milliseconds
+    double total_wall;           // wall milliseconds over all searches
+} profile_tally_t;
+
+typedef struct {
+    int n;
+    bool sampled;                    // index is a generator seed rather than a profile prefix
+    uint64_t prefix_span;            // profiles sharing one prefix of PROFILE_PREFIX_ROWS lists
+    profile_tally_t* tallies;        // one per worker
+} profile_sweep_t;
+
 // Forward declarations for systematic enumeration
-static void generate_all_agent_permutations(int* base_perm, int n, int agent_index,
-                                          int* total_instances, int* k_stable_count, double* total_time);
-static void generate_agent_permutation(int* arr, int start, int end, int agent_index, int n,
-                                     int* total_instances, int* k_stable_count, double* total_time);
-static void process_complete_preference_profile(int n, int* k_stable_count, double* total_time);
-static void swap(int* a, int* b);
-
-// Generate all possible preference profiles for small instances using systematic enumeration
-static void generate_all_preference_profiles(int n, int* total_instances, 
-                                           int* k_stable_count, double* total_time) {
+static void sweep_profile_chunk(void* context, int worker, uint64_t begin, uint64_t end);
+static void tally_profile_instance(const problem_instance_t* instance, int n, uint64_t seed,
+                                   long long weight, profile_tally_t* tally);
+
+// Generate all possible preference profiles for small instances using systematic enumeration.
+// The profile space is split by the first agents' lists into chunks that worker
+// threads claim independently. Only one profile per orbit of relabelings is generated
+// and searched, its answers counting once for every profile in the orbit.
+static bool generate_all_preference_profiles(int n, long long* total_instances, long long* searched_instances,
+                                           long long* k_stable_count, double* total_time) {
     // For systematic enumeration, we need to generate all possible preference profiles
     // Each agent can have any permutation of the n objects
     // Total combinations = n!^n
-    
-    if (n > 3) {
-        // For n > 3, use random sampling as fallback due to computational complexity
-        // n=4: 4!^4 = 24^4 = 331,776 combinations (too many)
-        int num_samples = (n == 4) ? 1000 : (n == 5) ? 100 : 10;
-        *total_instances = num_samples;
-        
-        for (int sample = 0; sample < num_samples; sample++) {
-            problem_instance_t* instance = generate_random_house_allocation(n, sample);
-            if (instance == NULL) continue;
-            
-            for (int k = 1; k <= n; k++) {
-                clock_t start = clock();
-                bool exists = k_stable_matching_exists(instance, k);
-                clock_t end = clock();
-                
-                double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-                total_time[k] += time_ms;
-                
-                if (exists) {
-                    k_stable_count[k]++;
-                }
-            }
-            
-            free(instance);
+    profile_sweep_t sweep = { n, false, 1, NULL };
+    uint64_t count;
+    
+    if (n > PROFILE_EXHAUSTIVE_MAX_N) {
+        // For n > 5, use random sampling as fallback due to computational complexity
+        // n=6: 6!^6 ~ 1.4 * 10^17 combinations (too many, even per orbit)
+        // Generation is reentrant, so each worker generates its own samples
+        sweep.sampled = true;
+        count = 10;
+    } else {
+        // For n <= 5, use true systematic enumeration
+        // n=2: 2!^2 = 4 combinations (3 orbits)
+        // n=3: 3!^3 = 216 combinations (38 orbits)
+        // n=4: 4!^4 = 331,776 combinations (13,902 orbits)
+        // n=5: 5!^5 ~ 2.5 * 10^10 combinations (207,360,024 orbits)
+        int prefix_rows = n < PROFILE_PREFIX_ROWS ? n : PROFILE_PREFIX_ROWS;
+        count = 1;
+        for (int a = 0; a < prefix_rows; a++) {
+            count *= permutation_count(n);
         }
-        return;
+        sweep.prefix_span = preference_profile_count(n) / count;
     }
     
-    // For n <= 3, use true systematic enumeration
-    // n=2: 2!^2 = 4 combinations
-    // n=3: 3!^3 = 216 combinations
-    *total_instances = 0;
-    
-    // Initialize the base permutation
-    int base_perm[MAX_AGENTS];
-    for (int i = 0; i < n; i++) {
-        base_perm[i] = i;
+    int num_threads = trial_threads();
+    sweep.tallies = calloc(num_threads, sizeof(profile_tally_t));
+    bool ok = sweep.tallies != NULL;
+    for (int t = 0; ok && t < num_threads; t++) {
+        sweep.tallies[t].k_stable_count = calloc(n + 1, sizeof(long long));
+        sweep.tallies[t].total_time = calloc(n + 1, sizeof(double));
+        ok = sweep.tallies[t].k_stable_count != NULL && sweep.tallies[t].total_time != NULL;
     }
-    
-    // Generate all possible combinations of preference profiles
-    generate_all_agent_permutations(base_perm, n, 0, total_instances, k_stable_count, total_time);
-}
-
-// Global storage for current preference profile being generated
-static int current_preferences[MAX_AGENTS][MAX_AGENTS];
-
-// Generate all permutations for all agents systematically
-static void generate_all_agent_permutations(int* base_perm, int n, int agent_index,
-                                          int* total_instances, int* k_stable_count, double* total_time) {
-    if (agent_index >= n) {
-        // All agents have been assigned preferences, process this complete profile
-        process_complete_preference_profile(n, k_stable_count, total_time);
-        (*total_instances)++;
-        return;
+    phase_begin("sweep");
+    if (ok) {
+        ok = parallel_for_chunks(count, PROFILE_CHUNK_SIZE, num_threads, sweep_profile_chunk, &sweep);
     }
     
-    // Generate all permutations for the current agent
-    int agent_perm[MAX_AGENTS];
-    for (int i = 0; i < n; i++) {
-        agent_perm[i] = base_perm[i];
+    // Merge the per-worker histograms; the searches the workers timed are
+    // charged to a phase nested in the sweep
+    double search_wall = 0.0;
+    double search_cpu = 0.0;
+    *total_instances = (long long)(count * sweep.prefix_span);
+    *searched_instances = 0;
+    for (int t = 0; sweep.tallies != NULL && t < num_threads; t++) {
+        profile_tally_t* tally = &sweep.tallies[t];
+        *searched_instances += tally->searched;
+        for (int k = 1; ok && k <= n; k++) {
+            k_stable_count[k] += tally->k_stable_count[k];
+            total_time[k] += tally->total_time[k];
+            search_cpu += tally->total_time[k];
+        }
+        search_wall += tally->total_wall;
+        free(tally->k_stable_count);
+        free(tally->total_time);
     }
+    free(sweep.tallies);
+    if (ok) {
+        phase_add("search", search_wall, search_cpu, *searched_instances * n);
+    }
+    phase_end(NULL);
     
-    generate_agent_permutation(agent_perm, 0, n-1, agent_index, n, total_instances, k_stable_count, total_time);
+    return ok;
 }
 
-// Generate all permutations for a single agent
-static void generate_agent_permutation(int* arr, int start, int end, int agent_index, int n,
-                                     int* total_instances, int* k_stable_count, double* total_time) {
-    if (start == end) {
-        // Store this permutation for the current agent
-        for (int i = 0; i < n; i++) {
-            current_preferences[agent_index][i] = arr[i];
+// Process the orbit representatives under profile prefixes (or samples) [begin, end)
+// into the worker's histograms
+static void sweep_profile_chunk(void* context, int worker, uint64_t begin, uint64_t end) {
+    profile_sweep_t* sweep = context;
+    profile_tally_t* tally = &sweep->tallies[worker];
+    
+    for (uint64_t index = begin; index < end; index++) {
+        if (sweep->sampled) {
+            problem_instance_t* sample = generate_random_house_allocation(sweep->n, (uint32_t)index);
+            if (sample != NULL) {
+                tally_profile_instance(sample, sweep->n, (uint32_t)index, 1, tally);
+                destroy_problem_instance(sample);
+            }
+            continue;
         }
         
-        // Move to next agent
-        generate_all_agent_permutations(arr, n, agent_index + 1, total_instances, k_stable_count, total_time);
-        return;
-    }
-    
-    for (int i = start; i <= end; i++) {
-        swap(&arr[start], &arr[i]);
-        generate_agent_permutation(arr, start + 1, end, agent_index, n, total_instances, k_stable_count, total_time);
-        swap(&arr[start], &arr[i]); // backtrack
+        profile_iterator_t iterator;
+        if (!canonical_profile_iterator_init(&iterator, sweep->n, index * sweep->prefix_span,
+                                             (index + 1) * sweep->prefix_span)) {
+            continue;
+        }
+        do {
+            problem_instance_t* instance = generate_house_allocation_from_profile(sweep->n, iterator.profile);
+            if (instance == NULL) continue;
+            tally_profile_instance(instance, sweep->n, iterator.rank, (long long)iterator.orbit_size, tally);
+            destroy_problem_instance(instance);
+        } while (canonical_profile_iterator_next(&iterator));
     }
 }
 
-// Process a complete preference profile (all agents have been assigned preferences)
-static void process_complete_preference_profile(int n, int* k_stable_count, double* total_time) {
-    // Create a problem instance with the current complete preference profile
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
-    if (instance == NULL) return;
-    
-    instance->num_agents = n;
-    instance->model = HOUSE_ALLOCATION;
-    instance->model_data.house_data.num_houses = n;
-    
-    // Set preferences for all agents
-    for (int agent = 0; agent < n; agent++) {
-        instance->agents[agent].id = agent;
-        instance->agents[agent].num_preferences = n;
-        
-        for (int i = 0; i < n; i++) {
-            instance->agents[agent].preferences[i] = current_preferences[agent][i];
-        }
-    }
-    
-    // Test k-stability for all k values
+// Test k-stability for all k values and record the outcome in the worker's histograms,
+// counted weight times (the weight goes into its records too). seed is the profile rank, or
+// the generator seed of a sampled instance.
+static void tally_profile_instance(const problem_instance_t* instance, int n, uint64_t seed,
+                                   long long weight, profile_tally_t* tally) {
+    tally->searched++;
     for (int k = 1; k <= n; k++) {
-        clock_t start = clock();
-        bool exists = k_stable_matching_exists(instance, k);
-        clock_t end = clock();
-        
-        double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-        total_time[k] += time_ms;
+        search_stats_t stats;
+        stopwatch_t timer;
+        stopwatch_start(&timer);
+        bool exists = k_stable_matching_exists_with_stats(instance, k, trial_stats(&stats));
+        stopwatch_stop(&timer);
+        tally->total_time[k] += timer.cpu_ms;
+        tally->total_wall += timer.wall_ms;
+        record_trial("brute_force_small", existence_algorithm_name(n, k), HOUSE_ALLOCATION, n, k, seed,
+                     weight, &timer, exists, &stats);
         
         if (exists) {
-            k_stable_count[k]++;
+            tally->k_stable_count[k] += weight;
         }
     }
-    
-    free(instance);
 }
 
-// Helper function to swap two integers
-static void swap(int* a, int* b) {
-    int temp = *a;
-    *a = *b;
-    *b = temp;
+// Stats to collect for a trial: only while records are being written, so the
+// tables time the searches without instrumentation
+static search_stats_t* trial_stats(search_stats_t* stats) {
+    return result_sink_active() ? stats : NULL;
+}
+
+// Run a queued batch under the benchmark's name (queued is false if queuing
+// ran out of memory); reports the failure and returns false if it did not run
+static bool run_benchmark_trials(trial_batch_t* batch, bool queued, const char* benchmark,
+                                 bool collect_stats) {
+    if (queued && trial_batch_run(batch, benchmark, collect_stats)) {
+        return true;
+    }
+    printf("Error: Out of memory running %s trials\n", benchmark);
+    return false;
+}
+
+// k values the large random analysis tests at n: constant k, proportional k,
+// and boundary cases. Out-of-range values stay in place (callers skip them),
+// so a k's index, which picks its seeds, is the same for every n.
+#define LARGE_RANDOM_NUM_K 13
+
+static void large_random_k_values(int n, int* k_values) {
+    int values[LARGE_RANDOM_NUM_K] = {
+        1, 2, 3, 4, 5,                    // Constant k values
+        n/4, n/3, n/2, 2*n/3, 3*n/4,     // Proportional k values
+        n-2, n-1, n                       // Boundary cases
+    };
+    for (int ki = 0; ki < LARGE_RANDOM_NUM_K; ki++) {
+        k_values[ki] = values[ki];
+    }
 }
 
 // Large random instances analysis with comprehensive k testing
 void benchmark_large_random_instances(int min_agents, int max_agents, int num_trials) {
+    phase_begin("large_random_instances");
     printf("=== Large Random Instances Analysis ===\n");
     printf("Testing k-stable matching existence across different k values\n");
     printf("Agents: %d to %d, Trials per size: %d\n\n", min_agents, max_agents, num_trials);
@@ -518,59 +593,53 @@ void benchmark_large_random_instances(int min_agents, int max_agents, int num_tr
     printf("Agents\tk\tk/n\t\tExists\tTime (ms)\tAlgorithm\n");
     printf("------\t-\t---\t\t------\t---------\t---------\n");
     
-    for (int n = min_agents; n <= max_agents; n += (n < 20) ? 2 : 5) {
-        // Test different k values: constant k, proportional k, and boundary cases
-        int k_values[] = {
-            1, 2, 3, 4, 5,                    // Constant k values
-            n/4, n/3, n/2, 2*n/3, 3*n/4,     // Proportional k values
-            n-2, n-1, n                       // Boundary cases
-        };
-        int num_k_values = sizeof(k_values) / sizeof(k_values[0]);
-        
-        for (int ki = 0; ki < num_k_values; ki++) {
+    // A group per (n, k); the k at index ki draws its instances from seed offset ki * 1000
+    int k_values[LARGE_RANDOM_NUM_K];
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int n = min_agents; queued && n <= max_agents; n += (n < 20) ? 2 : 5) {
+        large_random_k_values(n, k_values);
+        for (int ki = 0; queued && ki < LARGE_RANDOM_NUM_K; ki++) {
             int k = k_values[ki];
             if (k <= 0 || k > n) continue;
-            
-            double total_time = 0.0;
-            int exists_count = 0;
-            int successful_trials = 0;
-            
-            for (int trial = 0; trial < num_trials; trial++) {
-                problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial + ki * 1000);
-                if (instance == NULL) continue;
-                
-                clock_t start = clock();
-                bool exists = k_stable_matching_exists(instance, k);
-                clock_t end = clock();
-                
-                double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-                total_time += time_ms;
-                successful_trials++;
-                
-                if (exists) exists_count++;
-                
-                free(instance);
-            }
-            
-            if (successful_trials > 0) {
-                double avg_time = total_time / successful_trials;
-                double k_ratio = (double)k / n;
-                double exists_rate = (double)exists_count / successful_trials;
-                
-                // Determine which algorithm was used
-                const char* algorithm = (k_ratio <= 0.1) ? "small-k" : 
-                                       (k_ratio >= 0.8) ? "large-k" : "pruning";
+            queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, n, 0, k,
+                                           (uint32_t)ki * 1000, num_trials) >= 0;
+        }
+    }
+    
+    if (run_benchmark_trials(&batch, queued, "large_random_instances", false)) {
+        int group = 0;
+        for (int n = min_agents; n <= max_agents; n += (n < 20) ? 2 : 5) {
+            large_random_k_values(n, k_values);
+            for (int ki = 0; ki < LARGE_RANDOM_NUM_K; ki++) {
+                int k = k_values[ki];
+                if (k <= 0 || k > n) continue;
                 
-                printf("%d\t%d\t%.3f\t\t%.3f\t%.3f\t\t%s\n", 
-                       n, k, k_ratio, exists_rate, avg_time, algorithm);
+                const trial_totals_t* totals = &batch.totals[group++];
+                if (totals->trials > 0) {
+                    double k_ratio = (double)k / n;
+                    double exists_rate = (double)totals->positive / totals->trials;
+                    
+                    // Determine which algorithm was used
+                    const char* algorithm = existence_algorithm_name(n, k);
+                    
+                    printf("%d\t%d\t%.3f\t\t%.3f\t%.3f\t\t%s\n",
+                           n, k, k_ratio, exists_rate, trial_mean_ms(totals), algorithm);
+                }
             }
+            printf("\n");
         }
-        printf("\n");
     }
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
 }
 
+
 // Comprehensive analysis combining both approaches
 void benchmark_comprehensive_analysis() {
+    phase_begin("comprehensive_analysis");
     printf("=== Comprehensive k-Stable Matching Analysis ===\n");
     printf("Combining brute force (small instances) and random sampling (large instances)\n\n");
     
@@ -588,12 +657,44 @@ void benchmark_comprehensive_analysis() {
     printf("\nPHASE 3: Focused Analysis on Key k Values\n");
     printf("==========================================\n");
     analyze_key_k_values();
+    
+    phase_end(NULL);
 }
 
 // Analyze specific k values that are theoretically interesting
 void analyze_key_k_values() {
+    phase_begin("analyze_key_k_values");
     printf("Analyzing key k values across different instance sizes:\n\n");
     
+    // Both tables are queued into one batch: a group of 50 trials per cell,
+    // constant k first. Proportional column i draws from seed offset i * 100.
+    int trials = 50;
+    double ratios[] = {0.1, 0.25, 0.5, 0.75, 0.9};
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int n = 5; queued && n <= 25; n += 5) {
+        for (int k = 1; queued && k <= 5 && k <= n; k++) {
+            queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, n, 0, k,
+                                           0, trials) >= 0;
+        }
+    }
+    for (int n = 10; queued && n <= 30; n += 5) {
+        for (int i = 0; queued && i < 5; i++) {
+            int k = (int)(n * ratios[i]);
+            if (k <= 0) k = 1;
+            if (k > n) k = n;
+            queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, n, 0, k,
+                                           (uint32_t)i * 100, trials) >= 0;
+        }
+    }
+    if (!run_benchmark_trials(&batch, queued, "key_k_values", false)) {
+        trial_batch_destroy(&batch);
+        phase_end(NULL);
+        return;
+    }
+    int group = 0;
+    
     // Test constant k values
     printf("CONSTANT k VALUES:\n");
     printf("n\tk=1\tk=2\tk=3\tk=4\tk=5\n");
@@ -607,20 +708,7 @@ void analyze_key_k_values() {
                 continue;
             }
             
-            int exists_count = 0;
-            int trials = 50;
-            
-            for (int trial = 0; trial < trials; trial++) {
-                problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial);
-                if (instance == NULL) continue;
-                
-                bool exists = k_stable_matching_exists(instance, k);
-                if (exists) exists_count++;
-                
-                free(instance);
-            }
-            
-            double rate = (double)exists_count / trials;
+            double rate = (double)batch.totals[group++].positive / trials;
             printf("\t%.2f", rate);
         }
         printf("\n");
@@ -633,35 +721,20 @@ void analyze_key_k_values() {
     
     for (int n = 10; n <= 30; n += 5) {
         printf("%d", n);
-        double ratios[] = {0.1, 0.25, 0.5, 0.75, 0.9};
-        
         for (int i = 0; i < 5; i++) {
-            int k = (int)(n * ratios[i]);
-            if (k <= 0) k = 1;
-            if (k > n) k = n;
-            
-            int exists_count = 0;
-            int trials = 50;
-            
-            for (int trial = 0; trial < trials; trial++) {
-                problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial + i * 100);
-                if (instance == NULL) continue;
-                
-                bool exists = k_stable_matching_exists(instance, k);
-                if (exists) exists_count++;
-                
-                free(instance);
-            }
-            
-            double rate = (double)exists_count / trials;
+            double rate = (double)batch.totals[group++].positive / trials;
             printf("\t%.2f", rate);
         }
         printf("\n");
     }
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
 }
 
 // Benchmark k-hai vs complete preferences comparison
 void benchmark_k_hai_comparison(int num_agents, int num_objects, int num_trials) {
+    phase_begin("k_hai_comparison");
     printf("=== k-hai vs Complete Preferences Comparison ===\n");
     printf("Agents: %d, Objects: %d, Trials: %d\n\n", num_agents, num_objects, num_trials);
     
@@ -672,163 +745,121 @@ void benchmark_k_hai_comparison(int num_agents, int num_objects, int num_trials)
     int k_values[] = {1, 2, 3, num_agents/2, num_agents-1, num_agents};
     int num_k_values = sizeof(k_values) / sizeof(k_values[0]);
     
-    for (int ki = 0; ki < num_k_values; ki++) {
+    // Complete preferences (house allocation) and partial preferences (k-hai,
+    // seed offset 1000) for each k
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int ki = 0; queued && ki < num_k_values; ki++) {
         int k = k_values[ki];
         if (k <= 0 || k > num_agents) continue;
-        
-        // Test complete preferences (house allocation)
-        double total_time_complete = 0.0;
-        int exists_count_complete = 0;
-        
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_random_house_allocation(num_agents, time(NULL) + trial);
-            if (instance == NULL) continue;
-            
-            clock_t start = clock();
-            bool exists = k_stable_matching_exists(instance, k);
-            clock_t end = clock();
-            
-            double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-            total_time_complete += time_ms;
-            
-            if (exists) exists_count_complete++;
-            
-            free(instance);
-        }
-        
-        double avg_time_complete = total_time_complete / num_trials;
-        double exists_rate_complete = (double)exists_count_complete / num_trials;
-        double k_ratio = (double)k / num_agents;
-        const char* algorithm = (k_ratio <= 0.1) ? "small-k" : (k_ratio >= 0.8) ? "large-k" : "pruning";
-        
-        printf("Complete Preferences\t%d\t%.2f\t%.3f\t\t%s\n", k, exists_rate_complete, avg_time_complete, algorithm);
-        
-        // Test partial preferences (k-hai)
-        double total_time_partial = 0.0;
-        int exists_count_partial = 0;
-        
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_k_hai_instance(num_agents, num_objects, time(NULL) + trial + 1000);
-            if (instance == NULL) continue;
-            
-            clock_t start = clock();
-            bool exists = k_stable_matching_exists(instance, k);
-            clock_t end = clock();
-            
-            double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
-            total_time_partial += time_ms;
+        queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, num_agents, 0, k,
+                                       0, num_trials) >= 0 &&
+                 trial_batch_add_group(&batch, TRIAL_K_HAI, TRIAL_SEARCH, num_agents, num_objects, k,
+                                       1000, num_trials) >= 0;
+    }
+    
+    if (run_benchmark_trials(&batch, queued, "k_hai_comparison", false)) {
+        int group = 0;
+        for (int ki = 0; ki < num_k_values; ki++) {
+            int k = k_values[ki];
+            if (k <= 0 || k > num_agents) continue;
             
-            if (exists) exists_count_partial++;
+            const trial_totals_t* complete = &batch.totals[group++];
+            const trial_totals_t* partial = &batch.totals[group++];
+            const char* algorithm = existence_algorithm_name(num_agents, k);
             
-            free(instance);
+            printf("Complete Preferences\t%d\t%.2f\t%.3f\t\t%s\n", k,
+                   (double)complete->positive / num_trials, complete->wall_ms / num_trials, algorithm);
+            printf("Partial Preferences\t%d\t%.2f\t%.3f\t\t%s\n", k,
+                   (double)partial->positive / num_trials, partial->wall_ms / num_trials, algorithm);
+            printf("\n");
         }
-        
-        double avg_time_partial = total_time_partial / num_trials;
-        double exists_rate_partial = (double)exists_count_partial / num_trials;
-        
-        printf("Partial Preferences\t%d\t%.2f\t%.3f\t\t%s\n", k, exists_rate_partial, avg_time_partial, algorithm);
-        printf("\n");
     }
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
 }
 
 // Benchmark partial vs complete preferences
 void benchmark_partial_vs_complete_preferences(int num_agents, int num_trials) {
+    phase_begin("partial_vs_complete_preferences");
     printf("=== Partial vs Complete Preferences Analysis ===\n");
     printf("Agents: %d, Trials: %d\n\n", num_agents, num_trials);
     
     printf("Preference Type\t\tk=1\tk=2\tk=3\tk=n/2\tk=n-1\tk=n\n");
     printf("----------------\t---\t---\t---\t-----\t------\t---\n");
     
-    // Test complete preferences
-    printf("Complete\t\t");
-    for (int k = 1; k <= num_agents; k++) {
-        if (k == 1 || k == 2 || k == 3 || k == num_agents/2 || k == num_agents-1 || k == num_agents) {
-            int exists_count = 0;
-            
-            for (int trial = 0; trial < num_trials; trial++) {
-                problem_instance_t* instance = generate_random_house_allocation(num_agents, time(NULL) + trial);
-                if (instance == NULL) continue;
-                
-                bool exists = k_stable_matching_exists(instance, k);
-                if (exists) exists_count++;
-                
-                free(instance);
+    // A row of groups for complete preferences, then one for partial
+    // preferences (k-hai with as many objects as agents, seed offset 2000)
+    trial_source_t sources[] = {TRIAL_HOUSE_ALLOCATION, TRIAL_K_HAI};
+    uint32_t seed_offsets[] = {0, 2000};
+    const char* labels[] = {"Complete\t\t", "Partial\t\t\t"};
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int row = 0; queued && row < 2; row++) {
+        for (int k = 1; queued && k <= num_agents; k++) {
+            if (k == 1 || k == 2 || k == 3 || k == num_agents/2 || k == num_agents-1 || k == num_agents) {
+                queued = trial_batch_add_group(&batch, sources[row], TRIAL_SEARCH, num_agents, num_agents, k,
+                                               seed_offsets[row], num_trials) >= 0;
             }
-            
-            double rate = (double)exists_count / num_trials;
-            printf("%.2f\t", rate);
         }
     }
-    printf("\n");
     
-    // Test partial preferences
-    printf("Partial\t\t\t");
-    for (int k = 1; k <= num_agents; k++) {
-        if (k == 1 || k == 2 || k == 3 || k == num_agents/2 || k == num_agents-1 || k == num_agents) {
-            int exists_count = 0;
-            
-            for (int trial = 0; trial < num_trials; trial++) {
-                problem_instance_t* instance = generate_k_hai_instance(num_agents, num_agents, time(NULL) + trial + 2000);
-                if (instance == NULL) continue;
-                
-                bool exists = k_stable_matching_exists(instance, k);
-                if (exists) exists_count++;
-                
-                free(instance);
+    if (run_benchmark_trials(&batch, queued, "partial_vs_complete", false)) {
+        int group = 0;
+        for (int row = 0; row < 2; row++) {
+            printf("%s", labels[row]);
+            for (int k = 1; k <= num_agents; k++) {
+                if (k == 1 || k == 2 || k == 3 || k == num_agents/2 || k == num_agents-1 || k == num_agents) {
+                    double rate = (double)batch.totals[group++].positive / num_trials;
+                    printf("%.2f\t", rate);
+                }
             }
-            
-            double rate = (double)exists_count / num_trials;
-            printf("%.2f\t", rate);
+            printf("\n");
         }
     }
-    printf("\n");
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
 }
 
 // Analyze k-hai existence patterns
 void analyze_k_hai_existence_patterns(int num_agents, int num_objects, int num_trials) {
+    phase_begin("analyze_k_hai_existence_patterns");
     printf("=== k-hai Existence Patterns Analysis ===\n");
     printf("Agents: %d, Objects: %d, Trials: %d\n\n", num_agents, num_objects, num_trials);
     
     printf("k\tk/n\t\tComplete\tPartial\t\tWith Indifferences\n");
     printf("-\t---\t\t--------\t-------\t\t------------------\n");
     
-    for (int k = 1; k <= num_agents; k++) {
-        double k_ratio = (double)k / num_agents;
-        
-        // Test complete preferences
-        int exists_complete = 0;
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_random_house_allocation(num_agents, time(NULL) + trial);
-            if (instance == NULL) continue;
-            
-            if (k_stable_matching_exists(instance, k)) exists_complete++;
-            free(instance);
-        }
-        
-        // Test partial preferences
-        int exists_partial = 0;
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_k_hai_instance(num_agents, num_objects, time(NULL) + trial + 3000);
-            if (instance == NULL) continue;
-            
-            if (k_stable_matching_exists(instance, k)) exists_partial++;
-            free(instance);
-        }
-        
-        // Test partial preferences with indifferences
-        int exists_indifferences = 0;
-        for (int trial = 0; trial < num_trials; trial++) {
-            problem_instance_t* instance = generate_k_hai_with_indifferences(num_agents, num_objects, time(NULL) + trial + 4000);
-            if (instance == NULL) continue;
+    // For each k: complete preferences, partial preferences (seed offset 3000)
+    // and partial preferences with indifferences (seed offset 4000)
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    bool queued = true;
+    for (int k = 1; queued && k <= num_agents; k++) {
+        queued = trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, num_agents, 0, k,
+                                       0, num_trials) >= 0 &&
+                 trial_batch_add_group(&batch, TRIAL_K_HAI, TRIAL_SEARCH, num_agents, num_objects, k,
+                                       3000, num_trials) >= 0 &&
+                 trial_batch_add_group(&batch, TRIAL_K_HAI_INDIFFERENCES, TRIAL_SEARCH, num_agents,
+                                       num_objects, k, 4000, num_trials) >= 0;
+    }
+    
+    if (run_benchmark_trials(&batch, queued, "k_hai_existence_patterns", false)) {
+        for (int k = 1; k <= num_agents; k++) {
+            const trial_totals_t* totals = &batch.totals[3 * (k - 1)];
+            double k_ratio = (double)k / num_agents;
+            double rate_complete = (double)totals[0].positive / num_trials;
+            double rate_partial = (double)totals[1].positive / num_trials;
+            double rate_indifferences = (double)totals[2].positive / num_trials;
             
-            if (k_stable_matching_exists(instance, k)) exists_indifferences++;
-            free(instance);
+            printf("%d\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\n", k, k_ratio, rate_complete, rate_partial, rate_indifferences);
         }
-        
-        double rate_complete = (double)exists_complete / num_trials;
-        double rate_partial = (double)exists_partial / num_trials;
-        double rate_indifferences = (double)exists_indifferences / num_trials;
-        
-        printf("%d\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\n", k, k_ratio, rate_complete, rate_partial, rate_indifferences);
     }
+    trial_batch_destroy(&batch);
+    
+    phase_end(NULL);
 }
@@ -0,0 +1,1474 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include "../include/matching.h"
+
+// Exact blocking numbers: the largest number of agents that can all be made
+// strictly better off at once by some alternative matching.
+//
+// "Strictly better" follows agent_prefers: an unmatched agent improves with any
+// listed partner; an agent holding an unlisted partner never counts as improved.
+// Agents outside the improving set may be left worse off or unmatched.
+//
+// House allocation: a maximum bipartite matching between agents and the houses
+// each agent strictly prefers to its current one (Hopcroft-Karp, O(m sqrt(n))).
+//
+// Marriage and roommates: every pair of the alternative matching improves one
+// or both partners, so the blocking number is a maximum weight matching with
+// edge weights in {1, 2}. Marriage graphs are bipartite, which lets the weights
+// be peeled off with two Hopcroft-Karp runs (Kao, Lam, Sung and Ting's
+// decomposition: heavy edges first, then whatever their minimum vertex cover
+// leaves). Roommates graphs need Edmonds' weighted blossom algorithm, O(n^3).
+
+#define UNREACHED INT_MAX
+
+// Scratch arrays for one Hopcroft-Karp run. Left vertex a has edges
+// edge_targets[edge_start[a]] .. edge_targets[edge_start[a] + degree[a] - 1].
+typedef struct {
+    const int* edge_start;
+    const int* edge_targets;
+    int* degree;
+    int* left_match;    // Right vertex matched to each left vertex, -1 if none
+    int* right_match;   // Left vertex matched to each right vertex, -1 if none
+    int* dist;          // BFS layer of each left vertex
+    int* queue;
+    int* next_edge;     // DFS edge iterator per left vertex
+    int* stack;         // DFS path of left vertices
+    int* via_right;     // Right vertex used to leave stack[i] towards stack[i + 1]
+    int num_left;
+    int num_right;
+} hopcroft_karp_t;
+
+// Improving pairs {edge_u[e], edge_v[e]} of a marriage or roommates matching;
+// edge_weight[e] is how many of the two partners would be better off (1 or 2)
+typedef struct {
+    int* edge_u;
+    int* edge_v;
+    int* edge_weight;
+    int num_edges;
+} improvement_graph_t;
+
+// Variable-length int lists kept in one arena block. A list is released by
+// clearing its owner's pointer; live lists are compacted to the front when
+// the free tail is too short.
+typedef struct {
+    int* data;
+    int* owner;             // Blossom whose list starts at each offset (stale entries allowed)
+    int capacity;
+    int used;
+} blossom_pool_t;
+
+// State of Edmonds' weighted blossom algorithm. Vertices are 0..n-1, blossoms
+// n..2n-1. Edge e has endpoints 2e (edge_u side) and 2e + 1 (edge_v side).
+typedef struct {
+    const improvement_graph_t* graph;
+    int num_vertices;
+    int* neighbor_start;    // CSR over vertices of remote endpoints
+    int* neighbor_end;
+    int* mate;              // Remote endpoint of each vertex's matched edge, -1 if free
+    int* label;             // 0 free, 1 S, 2 T (5 marks a scanned S-blossom)
+    int* label_end;         // Endpoint through which a label was assigned
+    int* in_blossom;        // Top-level blossom containing each vertex
+    int* blossom_parent;
+    int* blossom_base;
+    int* best_edge;         // Least-slack edge to an S-blossom, -1 if none
+    int* dual;
+    bool* allow_edge;       // Tight edges usable in the current stage
+    int* queue;             // S-vertices waiting to be scanned
+    int queue_size;
+    int* unused;            // Free blossom ids
+    int num_unused;
+    int** childs;           // Sub-blossoms of each blossom, in cycle order from the base
+    int** endps;            // Endpoints linking consecutive sub-blossoms (stored after childs)
+    int* num_childs;
+    int** best_edges;       // Least-slack edges to neighbouring S-blossoms
+    int* num_best_edges;
+    blossom_pool_t child_pool;  // Child and endpoint lists: fewer than 2n children are live at once
+    blossom_pool_t edge_pool;   // Best-edge lists of top-level S-blossoms: each edge is in at most two
+    int* best_edge_to;      // Scratch: least-slack edge per neighbouring blossom
+    int* walk_stack;        // Scratch: blossom tree traversal
+    int* leaves;            // Scratch: vertices of one blossom
+    int* scan_path;         // Scratch: blossoms visited while looking for a common base
+    int* scratch_childs;    // Scratch: new or rotated child lists
+    int* scratch_endps;
+} blossom_matching_t;
+
+static size_t int_array_bytes(size_t count) {
+    return matching_arena_bytes(count * sizeof(int));
+}
+
+// Number of houses an instance can refer to
+static int instance_num_houses(const problem_instance_t* instance) {
+    int num_houses = instance->num_targets;
+    if (instance->model == HOUSE_ALLOCATION_PARTIAL &&
+        instance->model_data.house_partial_data.num_houses > num_houses) {
+        num_houses = instance->model_data.house_partial_data.num_houses;
+    }
+    return num_houses;
+}
+
+static size_t hopcroft_karp_bytes(int num_left, int num_right) {
+    return 7 * int_array_bytes(num_left) + int_array_bytes(num_right);
+}
+
+// Scratch bytes blocking_number_in_arena needs for an instance
+size_t blocking_number_scratch_bytes(const problem_instance_t* instance) {
+    size_t n = (size_t)instance->num_agents;
+    size_t num_prefs = (size_t)instance->pref_offsets[instance->num_agents];
+    size_t edges = 3 * int_array_bytes(num_prefs);
+
+    switch (instance->model) {
+        case HOUSE_ALLOCATION:
+        case HOUSE_ALLOCATION_PARTIAL:
+            return hopcroft_karp_bytes(instance->num_agents, instance_num_houses(instance));
+
+        case MARRIAGE:
+            // Edge list, one CSR graph at a time, vertex cover flags
+            return edges + int_array_bytes(n + 1) + int_array_bytes(num_prefs) +
+                   int_array_bytes(n) + hopcroft_karp_bytes(instance->num_agents, instance->num_agents);
+
+        case ROOMMATES:
+            return edges +
+                   int_array_bytes(n + 1) + int_array_bytes(2 * num_prefs) +     // Neighbour lists
+                   matching_arena_bytes(num_prefs * sizeof(bool)) +              // Allowed edges
+                   11 * int_array_bytes(2 * n) +                                 // Per-blossom arrays
+                   8 * int_array_bytes(n + 1) +                                  // Per-vertex arrays
+                   3 * matching_arena_bytes(2 * n * sizeof(int*)) +              // Per-blossom lists
+                   2 * int_array_bytes(4 * n) +                                  // Child list pool
+                   2 * int_array_bytes(2 * num_prefs + n);                       // Best-edge list pool
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Hopcroft-Karp
+// ---------------------------------------------------------------------------
+
+// Allocate the Hopcroft-Karp arrays from the arena
+static bool hopcroft_karp_init(hopcroft_karp_t* hk, int num_left, int num_right, matching_arena_t* arena) {
+    hk->num_left = num_left;
+    hk->num_right = num_right;
+
+    hk->degree = matching_arena_alloc(arena, num_left * sizeof(int));
+    hk->left_match = matching_arena_alloc(arena, num_left * sizeof(int));
+    hk->right_match = matching_arena_alloc(arena, num_right * sizeof(int));
+    hk->dist = matching_arena_alloc(arena, num_left * sizeof(int));
+    hk->queue = matching_arena_alloc(arena, num_left * sizeof(int));
+    hk->next_edge = matching_arena_alloc(arena, num_left * sizeof(int));
+    hk->stack = matching_arena_alloc(arena, num_left * sizeof(int));
+    hk->via_right = matching_arena_alloc(arena, num_left * sizeof(int));
+
+    return hk->degree != NULL && hk->left_match != NULL && hk->right_match != NULL &&
+           hk->dist != NULL && hk->queue != NULL && hk->next_edge != NULL &&
+           hk->stack != NULL && hk->via_right != NULL;
+}
+
+// BFS from all free left vertices; returns true if some free right vertex is reachable
+static bool hopcroft_karp_bfs(hopcroft_karp_t* hk) {
+    int head = 0;
+    int tail = 0;
+
+    for (int a = 0; a < hk->num_left; a++) {
+        if (hk->left_match[a] == -1 && hk->degree[a] > 0) {
+            hk->dist[a] = 0;
+            hk->queue[tail++] = a;
+        } else {
+            hk->dist[a] = UNREACHED;
+        }
+    }
+
+    bool found_free_right = false;
+    while (head < tail) {
+        int a = hk->queue[head++];
+        const int* targets = hk->edge_targets + hk->edge_start[a];
+
+        for (int e = 0; e < hk->degree[a]; e++) {
+            int owner = hk->right_match[targets[e]];
+            if (owner == -1) {
+                found_free_right = true;
+            } else if (hk->dist[owner] == UNREACHED) {
+                hk->dist[owner] = hk->dist[a] + 1;
+                hk->queue[tail++] = owner;
+            }
+        }
+    }
+
+    return found_free_right;
+}
+
+// Iterative layered DFS from a free left vertex; augments and returns true on success
+static bool hopcroft_karp_augment(hopcroft_karp_t* hk, int root) {
+    int top = 0;
+    hk->stack[0] = root;
+
+    while (top >= 0) {
+        int a = hk->stack[top];
+
+        if (hk->next_edge[a] >= hk->degree[a]) {
+            // Dead end: never revisit this vertex in the current phase
+            hk->dist[a] = UNREACHED;
+            top--;
+            continue;
+        }
+
+        int right = hk->edge_targets[hk->edge_start[a] + hk->next_edge[a]++];
+        int owner = hk->right_match[right];
+
+        if (owner == -1) {
+            // Free right vertex reached: flip the path
+            hk->via_right[top] = right;
+            for (int i = top; i >= 0; i--) {
+                hk->left_match[hk->stack[i]] = hk->via_right[i];
+                hk->right_match[hk->via_right[i]] = hk->stack[i];
+            }
+            return true;
+        }
+
+        if (hk->dist[owner] == hk->dist[a] + 1) {
+            hk->via_right[top] = right;
+            hk->stack[++top] = owner;
+        }
+    }
+
+    return false;
+}
+
+// Grow a matching of the given size in hk by phases of shortest augmenting
+// paths until it is maximum or reaches limit; returns the new size
+static int hopcroft_karp_phases(hopcroft_karp_t* hk, int size, int limit) {
+    while (size < limit && hopcroft_karp_bfs(hk)) {
+        for (int a = 0; a < hk->num_left; a++) {
+            hk->next_edge[a] = 0;
+        }
+        for (int a = 0; a < hk->num_left && size < limit; a++) {
+            if (hk->left_match[a] == -1 && hk->dist[a] == 0 && hopcroft_karp_augment(hk, a)) {
+                size++;
+            }
+        }
+    }
+    return size;
+}
+
+// Maximum matching size of the graph set in hk, stopping early once limit is
+// reached. When it runs to completion, dist marks the left vertices reachable
+// from free ones by alternating paths (anything else is UNREACHED).
+static int hopcroft_karp_run(hopcroft_karp_t* hk, int limit) {
+    int size = 0;
+
+    for (int r = 0; r < hk->num_right; r++) {
+        hk->right_match[r] = -1;
+    }
+    for (int a = 0; a < hk->num_left; a++) {
+        hk->left_match[a] = -1;
+    }
+
+    // Greedy start: most vertices get their first free neighbour
+    for (int a = 0; a < hk->num_left && size < limit; a++) {
+        const int* targets = hk->edge_targets + hk->edge_start[a];
+        for (int e = 0; e < hk->degree[a]; e++) {
+            if (hk->right_match[targets[e]] == -1) {
+                hk->right_match[targets[e]] = a;
+                hk->left_match[a] = targets[e];
+                size++;
+                break;
+            }
+        }
+    }
+
+    return hopcroft_karp_phases(hk, size, limit);
+}
+
+// ---------------------------------------------------------------------------
+// House allocation
+// ---------------------------------------------------------------------------
+
+// Number of improving houses of an agent: they are exactly the prefix of its
+// list ranked above its current house
+static int improving_house_count(const matching_t* matching, const problem_instance_t* instance, int agent) {
+    int current = matching->pairs[agent];
+    if (current == -1) {
+        return instance_num_preferences(instance, agent);
+    }
+    int rank = get_agent_rank(instance, agent, current);
+    return (rank == RANK_UNACCEPTABLE) ? 0 : rank;
+}
+
+// Maximum number of agents that can simultaneously get a strictly better house
+static int house_allocation_blocking_number(const matching_t* matching, const problem_instance_t* instance,
+                                            int limit, matching_arena_t* arena) {
+    hopcroft_karp_t hk;
+    if (!hopcroft_karp_init(&hk, instance->num_agents, instance_num_houses(instance), arena)) {
+        return -1;
+    }
+
+    hk.edge_start = instance->pref_offsets;
+    hk.edge_targets = instance->preferences;
+    for (int a = 0; a < instance->num_agents; a++) {
+        hk.degree[a] = improving_house_count(matching, instance, a);
+    }
+
+    return hopcroft_karp_run(&hk, limit);
+}
+
+// Maximum matching of agents into the first prefix_lengths[a] houses of their
+// lists, capped at limit (-1 if scratch ran out). When each agent's improving
+// houses include that prefix, this is a lower bound on the blocking number.
+int house_allocation_prefix_bound(const problem_instance_t* instance, const int* prefix_lengths,
+                                  int limit, matching_arena_t* arena) {
+    if (instance == NULL || prefix_lengths == NULL || arena == NULL ||
+        (instance->model != HOUSE_ALLOCATION && instance->model != HOUSE_ALLOCATION_PARTIAL)) {
+        return -1;
+    }
+
+    size_t mark = matching_arena_mark(arena);
+    hopcroft_karp_t hk;
+    if (!hopcroft_karp_init(&hk, instance->num_agents, instance_num_houses(instance), arena)) {
+        matching_arena_release(arena, mark);
+        return -1;
+    }
+    hk.edge_start = instance->pref_offsets;
+    hk.edge_targets = instance->preferences;
+    memcpy(hk.degree, prefix_lengths, instance->num_agents * sizeof(int));
+
+    int size = hopcroft_karp_run(&hk, limit);
+    matching_arena_release(arena, mark);
+    return size;
+}
+
+// A house allocation blocking number kept up to date while a matching changes
+// a few agents at a time. The maximum improving matching is kept between
+// updates: a changed agent drops its improving house only if that house no
+// longer ranks above its new one, and augmenting phases restart from what is
+// left. A step costs a few O(m) searches rather than a full Hopcroft-Karp run,
+// and none at all when it only removed edges the matching does not use.
+struct blocking_tracker {
+    const problem_instance_t* instance;
+    matching_arena_t arena;
+    hopcroft_karp_t hk;
+    int size;
+};
+
+// Tracker for a house allocation matching (NULL for other models or on failure)
+blocking_tracker_t* create_blocking_tracker(const problem_instance_t* instance, const matching_t* matching) {
+    if (instance == NULL || matching == NULL || matching->num_agents != instance->num_agents ||
+        (instance->model != HOUSE_ALLOCATION && instance->model != HOUSE_ALLOCATION_PARTIAL)) {
+        return NULL;
+    }
+
+    blocking_tracker_t* tracker = malloc(sizeof(blocking_tracker_t));
+    if (tracker == NULL) {
+        return NULL;
+    }
+    int num_houses = instance_num_houses(instance);
+    if (!matching_arena_init(&tracker->arena, hopcroft_karp_bytes(instance->num_agents, num_houses))) {
+        free(tracker);
+        return NULL;
+    }
+    if (!hopcroft_karp_init(&tracker->hk, instance->num_agents, num_houses, &tracker->arena)) {
+        destroy_blocking_tracker(tracker);
+        return NULL;
+    }
+
+    tracker->instance = instance;
+    tracker->hk.edge_start = instance->pref_offsets;
+    tracker->hk.edge_targets = instance->preferences;
+    for (int a = 0; a < instance->num_agents; a++) {
+        tracker->hk.degree[a] = improving_house_count(matching, instance, a);
+    }
+    tracker->size = hopcroft_karp_run(&tracker->hk, INT_MAX);
+    return tracker;
+}
+
+void destroy_blocking_tracker(blocking_tracker_t* tracker) {
+    if (tracker == NULL) {
+        return;
+    }
+    matching_arena_destroy(&tracker->arena);
+    free(tracker);
+}
+
+// Account for new houses of the listed agents in matching; returns the
+// blocking number of the updated matching
+int blocking_tracker_update(blocking_tracker_t* tracker, const matching_t* matching,
+                            const int* agents, int num_changed) {
+    hopcroft_karp_t* hk = &tracker->hk;
+    const problem_instance_t* instance = tracker->instance;
+    int previous_size = tracker->size;
+    bool gained_edges = false;
+    for (int i = 0; i < num_changed; i++) {
+        int a = agents[i];
+        int degree = improving_house_count(matching, instance, a);
+        gained_edges = gained_edges || degree > hk->degree[a];
+        hk->degree[a] = degree;
+
+        // Keep the agent's improving house while it still ranks above the new one
+        int house = hk->left_match[a];
+        if (house != -1 && get_agent_rank(instance, a, house) >= degree) {
+            hk->right_match[house] = -1;
+            hk->left_match[a] = -1;
+            tracker->size--;
+        }
+    }
+
+    // With no edge added the maximum cannot grow, so an intact matching is
+    // still maximum; otherwise search for augmenting paths
+    if (gained_edges || tracker->size < previous_size) {
+        tracker->size = hopcroft_karp_phases(hk, tracker->size, INT_MAX);
+    }
+    return tracker->size;
+}
+
+// Blocking number of the matching last given to the tracker
+int blocking_tracker_value(const blocking_tracker_t* tracker) {
+    return tracker->size;
+}
+
+// ---------------------------------------------------------------------------
+// Improvement graph (marriage and roommates)
+// ---------------------------------------------------------------------------
+
+// Whether two agents may be partners under the instance's model
+static bool can_be_partners(const problem_instance_t* instance, int a, int b) {
+    if (a == b || b < 0 || b >= instance->num_agents) {
+        return false;
+    }
+    if (instance->model == MARRIAGE) {
+        int num_men = instance->model_data.marriage_data.num_men;
+        return (a < num_men) != (b < num_men);
+    }
+    return true;
+}
+
+// Append the pair of a and b, improving one or both (mutual) partners
+static void improvement_graph_add(improvement_graph_t* graph, const problem_instance_t* instance,
+                                  int a, int b, bool mutual) {
+    int e = graph->num_edges++;
+    bool a_first = (instance->model != MARRIAGE) ||
+                   a < instance->model_data.marriage_data.num_men;
+    graph->edge_u[e] = a_first ? a : b;
+    graph->edge_v[e] = a_first ? b : a;
+    graph->edge_weight[e] = mutual ? 2 : 1;
+}
+
+// improvement_graph_init with a verifier context's partner ranks: one rank
+// lookup per agent instead of two per preference entry
+static void improvement_graph_collect_ranked(improvement_graph_t* graph, const matching_t* matching,
+                                             const problem_instance_t* instance,
+                                             verifier_context_t* context) {
+    int n = instance->num_agents;
+    int* current_ranks = context->current_ranks;
+    for (int a = 0; a < n; a++) {
+        int current = matching->pairs[a];
+        current_ranks[a] = (current == -1) ? INT_MAX : get_agent_rank(instance, a, current);
+    }
+
+    for (int a = 0; a < n; a++) {
+        int rank = (current_ranks[a] == INT_MAX) ? instance_num_preferences(instance, a) : current_ranks[a];
+        const int* preferences = instance_preferences(instance, a);
+        const int* partner_ranks = context->partner_ranks + instance->pref_offsets[a];
+        for (int j = 0; j < rank; j++) {
+            int partner_rank = partner_ranks[j];
+            if (partner_rank == PARTNER_NONE) {
+                continue;
+            }
+
+            // Same test as agent_prefers: an unmatched partner (INT_MAX) improves
+            // with any listed agent, one holding an unlisted partner (-1) never
+            int b = preferences[j];
+            bool mutual = partner_rank != RANK_UNACCEPTABLE && partner_rank < current_ranks[b];
+            if (mutual && b < a) {
+                continue;
+            }
+            improvement_graph_add(graph, instance, a, b, mutual);
+        }
+    }
+}
+
+// Collect every pair in which at least one partner improves. Each pair is
+// listed once: a pair both partners prefer is taken from the smaller agent's
+// list. For marriage, edge_u is always the man. context may be NULL.
+static bool improvement_graph_init(improvement_graph_t* graph, const matching_t* matching,
+                                   const problem_instance_t* instance, verifier_context_t* context,
+                                   matching_arena_t* arena) {
+    int num_prefs = instance->pref_offsets[instance->num_agents];
+    graph->edge_u = matching_arena_alloc(arena, num_prefs * sizeof(int));
+    graph->edge_v = matching_arena_alloc(arena, num_prefs * sizeof(int));
+    graph->edge_weight = matching_arena_alloc(arena, num_prefs * sizeof(int));
+    graph->num_edges = 0;
+    if (graph->edge_u == NULL || graph->edge_v == NULL || graph->edge_weight == NULL) {
+        return false;
+    }
+
+    if (context != NULL && context->partner_ranks != NULL) {
+        improvement_graph_collect_ranked(graph, matching, instance, context);
+        return true;
+    }
+
+    for (int a = 0; a < instance->num_agents; a++) {
+        int current = matching->pairs[a];
+        int rank = (current == -1) ? instance_num_preferences(instance, a) :
+                   get_agent_rank(instance, a, current);
+        if (rank == RANK_UNACCEPTABLE) {
+            continue;
+        }
+
+        const int* preferences = instance_preferences(instance, a);
+        for (int j = 0; j < rank; j++) {
+            int b = preferences[j];
+            if (!can_be_partners(instance, a, b)) {
+                continue;
+            }
+
+            bool mutual = agent_prefers(instance, b, a, matching->pairs[b]);
+            if (mutual && b < a) {
+                continue;
+            }
+            improvement_graph_add(graph, instance, a, b, mutual);
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Marriage: two Hopcroft-Karp runs
+// ---------------------------------------------------------------------------
+
+// Point hk at the pairs whose weight left after subtracting the cover is at
+// least threshold (men on the left, women on the right)
+static void build_marriage_layer(hopcroft_karp_t* hk, const improvement_graph_t* graph, int num_men,
+                                 const int* cover, int threshold, int* edge_start, int* edge_targets) {
+    for (int a = 0; a <= num_men; a++) {
+        edge_start[a] = 0;
+    }
+    for (int e = 0; e < graph->num_edges; e++) {
+        int u = graph->edge_u[e];
+        int v = graph->edge_v[e];
+        if (graph->edge_weight[e] - cover[u] - cover[v] >= threshold) {
+            edge_start[u + 1]++;
+        }
+    }
+    for (int a = 0; a < num_men; a++) {
+        edge_start[a + 1] += edge_start[a];
+        hk->degree[a] = 0;
+    }
+    for (int e = 0; e < graph->num_edges; e++) {
+        int u = graph->edge_u[e];
+        int v = graph->edge_v[e];
+        if (graph->edge_weight[e] - cover[u] - cover[v] >= threshold) {
+            edge_targets[edge_start[u] + hk->degree[u]++] = v - num_men;
+        }
+    }
+
+    hk->edge_start = edge_start;
+    hk->edge_targets = edge_targets;
+}
+
+// Maximum weight of an alternative marriage: a maximum matching on the pairs
+// both partners prefer, plus a maximum matching on the reduced weights that
+// remain after subtracting that matching's minimum vertex cover
+static int marriage_blocking_number(const matching_t* matching, const problem_instance_t* instance,
+                                    int limit, verifier_context_t* context, matching_arena_t* arena) {
+    int n = instance->num_agents;
+    int num_men = instance->model_data.marriage_data.num_men;
+    int num_women = n - num_men;
+    int num_prefs = instance->pref_offsets[n];
+
+    improvement_graph_t graph;
+    hopcroft_karp_t hk;
+    int* edge_start = matching_arena_alloc(arena, (num_men + 1) * sizeof(int));
+    int* edge_targets = matching_arena_alloc(arena, num_prefs * sizeof(int));
+    int* cover = matching_arena_alloc(arena, n * sizeof(int));
+    if (!improvement_graph_init(&graph, matching, instance, context, arena) ||
+        edge_start == NULL || edge_targets == NULL || cover == NULL ||
+        !hopcroft_karp_init(&hk, num_men, num_women, arena)) {
+        return -1;
+    }
+
+    // Heavy layer: pairs that improve both partners
+    memset(cover, 0, n * sizeof(int));
+    build_marriage_layer(&hk, &graph, num_men, cover, 2, edge_start, edge_targets);
+    int heavy = hopcroft_karp_run(&hk, INT_MAX);
+    if (2 * heavy >= limit) {
+        return limit;
+    }
+
+    // Konig cover: matched men unreachable from free men, plus reachable women
+    for (int a = 0; a < num_men; a++) {
+        cover[a] = (hk.left_match[a] != -1 && hk.dist[a] == UNREACHED);
+        if (hk.dist[a] != UNREACHED) {
+            for (int e = 0; e < hk.degree[a]; e++) {
+                cover[num_men + edge_targets[edge_start[a] + e]] = 1;
+            }
+        }
+    }
+
+    // Light layer: weights the cover leaves positive are all exactly 1
+    build_marriage_layer(&hk, &graph, num_men, cover, 1, edge_start, edge_targets);
+    int light = hopcroft_karp_run(&hk, limit - heavy);
+    return heavy + light;
+}
+
+// ---------------------------------------------------------------------------
+// Roommates: Edmonds' weighted blossom algorithm
+// ---------------------------------------------------------------------------
+
+static inline int blossom_endpoint(const blossom_matching_t* bm, int p) {
+    return (p & 1) ? bm->graph->edge_v[p >> 1] : bm->graph->edge_u[p >> 1];
+}
+
+static inline int blossom_slack(const blossom_matching_t* bm, int e) {
+    return bm->dual[bm->graph->edge_u[e]] + bm->dual[bm->graph->edge_v[e]] - 2 * bm->graph->edge_weight[e];
+}
+
+// Child lists are walked with indices in (-len, len), negative ones counting from the end
+static inline int wrap_child(int j, int len) {
+    return (j < 0) ? j + len : j;
+}
+
+// Append the vertices inside blossom b to out; returns the new count
+static int blossom_leaves(blossom_matching_t* bm, int b, int* out, int count) {
+    int top = 0;
+    bm->walk_stack[top++] = b;
+    while (top > 0) {
+        int t = bm->walk_stack[--top];
+        if (t < bm->num_vertices) {
+            out[count++] = t;
+        } else {
+            for (int i = bm->num_childs[t] - 1; i >= 0; i--) {
+                bm->walk_stack[top++] = bm->childs[t][i];
+            }
+        }
+    }
+    return count;
+}
+
+static bool blossom_pool_init(blossom_pool_t* pool, int capacity, matching_arena_t* arena) {
+    pool->data = matching_arena_alloc(arena, (capacity > 0 ? capacity : 1) * sizeof(int));
+    pool->owner = matching_arena_alloc(arena, (capacity > 0 ? capacity : 1) * sizeof(int));
+    pool->capacity = capacity;
+    pool->used = 0;
+    if (pool->data == NULL || pool->owner == NULL) {
+        return false;
+    }
+    for (int i = 0; i < capacity; i++) {
+        pool->owner[i] = -1;
+    }
+    return true;
+}
+
+// Room for a list of width * count ints (at least one) owned by blossom b. Live
+// lists are lists[c] with counts[c] entries; they move if the pool is compacted.
+static int* blossom_pool_alloc(blossom_pool_t* pool, int b, int count, int width,
+                               int** lists, const int* counts) {
+    int size = count > 0 ? width * count : 1;
+
+    if (size > pool->capacity - pool->used) {
+        int used = 0;
+        for (int i = 0; i < pool->used; i++) {
+            int c = pool->owner[i];
+            if (c < 0 || lists[c] != pool->data + i) {
+                continue;
+            }
+            int length = counts[c] > 0 ? width * counts[c] : 1;
+            memmove(pool->data + used, pool->data + i, length * sizeof(int));
+            pool->owner[used] = c;
+            lists[c] = pool->data + used;
+            used += length;
+            i += length - 1;
+        }
+        pool->used = used;
+        if (size > pool->capacity - pool->used) {
+            return NULL;
+        }
+    }
+
+    int* list = pool->data + pool->used;
+    pool->owner[pool->used] = b;
+    pool->used += size;
+    return list;
+}
+
+static bool blossom_matching_init(blossom_matching_t* bm, const improvement_graph_t* graph, int n,
+                                  matching_arena_t* arena) {
+    int m = graph->num_edges;
+    bm->graph = graph;
+    bm->num_vertices = n;
+
+    bm->neighbor_start = matching_arena_alloc(arena, (n + 1) * sizeof(int));
+    bm->neighbor_end = matching_arena_alloc(arena, 2 * m * sizeof(int));
+    bm->allow_edge = matching_arena_alloc(arena, m * sizeof(bool));
+    bm->mate = matching_arena_alloc(arena, n * sizeof(int));
+    bm->in_blossom = matching_arena_alloc(arena, n * sizeof(int));
+    bm->queue = matching_arena_alloc(arena, (n + 1) * sizeof(int));
+    bm->unused = matching_arena_alloc(arena, n * sizeof(int));
+    bm->leaves = matching_arena_alloc(arena, n * sizeof(int));
+    bm->scratch_childs = matching_arena_alloc(arena, n * sizeof(int));
+    bm->scratch_endps = matching_arena_alloc(arena, n * sizeof(int));
+    bm->label = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->label_end = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->blossom_parent = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->blossom_base = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->best_edge = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->dual = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->num_childs = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->num_best_edges = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->best_edge_to = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->walk_stack = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->scan_path = matching_arena_alloc(arena, 2 * n * sizeof(int));
+    bm->childs = matching_arena_alloc(arena, 2 * n * sizeof(int*));
+    bm->endps = matching_arena_alloc(arena, 2 * n * sizeof(int*));
+    bm->best_edges = matching_arena_alloc(arena, 2 * n * sizeof(int*));
+
+    if (bm->neighbor_start == NULL || bm->neighbor_end == NULL || bm->allow_edge == NULL ||
+        bm->mate == NULL || bm->in_blossom == NULL || bm->queue == NULL || bm->unused == NULL ||
+        bm->leaves == NULL || bm->scratch_childs == NULL || bm->scratch_endps == NULL ||
+        bm->label == NULL || bm->label_end == NULL || bm->blossom_parent == NULL ||
+        bm->blossom_base == NULL || bm->best_edge == NULL || bm->dual == NULL ||
+        bm->num_childs == NULL || bm->num_best_edges == NULL || bm->best_edge_to == NULL ||
+        bm->walk_stack == NULL || bm->scan_path == NULL || bm->childs == NULL ||
+        bm->endps == NULL || bm->best_edges == NULL ||
+        !blossom_pool_init(&bm->child_pool, 4 * n, arena) ||
+        !blossom_pool_init(&bm->edge_pool, 2 * m + n, arena)) {
+        return false;
+    }
+
+    // Remote endpoints of each vertex's edges
+    for (int v = 0; v <= n; v++) {
+        bm->neighbor_start[v] = 0;
+    }
+    for (int e = 0; e < m; e++) {
+        bm->neighbor_start[graph->edge_u[e] + 1]++;
+        bm->neighbor_start[graph->edge_v[e] + 1]++;
+    }
+    for (int v = 0; v < n; v++) {
+        bm->neighbor_start[v + 1] += bm->neighbor_start[v];
+        bm->mate[v] = 0;  // Fill cursor until the lists are built
+    }
+    for (int e = 0; e < m; e++) {
+        int u = graph->edge_u[e];
+        int v = graph->edge_v[e];
+        bm->neighbor_end[bm->neighbor_start[u] + bm->mate[u]++] = 2 * e + 1;
+        bm->neighbor_end[bm->neighbor_start[v] + bm->mate[v]++] = 2 * e;
+    }
+
+    int max_weight = 0;
+    for (int e = 0; e < m; e++) {
+        if (graph->edge_weight[e] > max_weight) {
+            max_weight = graph->edge_weight[e];
+        }
+    }
+
+    for (int b = 0; b < 2 * n; b++) {
+        bm->label[b] = 0;
+        bm->label_end[b] = -1;
+        bm->blossom_parent[b] = -1;
+        bm->blossom_base[b] = (b < n) ? b : -1;
+        bm->best_edge[b] = -1;
+        bm->dual[b] = (b < n) ? max_weight : 0;
+        bm->childs[b] = NULL;
+        bm->endps[b] = NULL;
+        bm->num_childs[b] = 0;
+        bm->best_edges[b] = NULL;
+        bm->num_best_edges[b] = 0;
+    }
+    for (int v = 0; v < n; v++) {
+        bm->mate[v] = -1;
+        bm->in_blossom[v] = v;
+        bm->unused[v] = 2 * n - 1 - v;
+    }
+    bm->num_unused = n;
+    bm->queue_size = 0;
+    return true;
+}
+
+// Label the top-level blossom containing w with t (1 = S, 2 = T), reached through endpoint p
+static void blossom_assign_label(blossom_matching_t* bm, int w, int t, int p) {
+    int b = bm->in_blossom[w];
+    bm->label[w] = bm->label[b] = t;
+    bm->label_end[w] = bm->label_end[b] = p;
+    bm->best_edge[w] = bm->best_edge[b] = -1;
+
+    if (t == 1) {
+        bm->queue_size = blossom_leaves(bm, b, bm->queue, bm->queue_size);
+    } else {
+        int base_mate = bm->mate[bm->blossom_base[b]];
+        blossom_assign_label(bm, blossom_endpoint(bm, base_mate), 1, base_mate ^ 1);
+    }
+}
+
+// Trace back from v and w to find a new blossom's base, or -1 for an augmenting path
+static int blossom_scan(blossom_matching_t* bm, int v, int w) {
+    int path_length = 0;
+    int base = -1;
+
+    while (v != -1 || w != -1) {
+        int b = bm->in_blossom[v];
+        if (bm->label[b] & 4) {
+            base = bm->blossom_base[b];
+            break;
+        }
+        bm->scan_path[path_length++] = b;
+        bm->label[b] = 5;
+
+        if (bm->label_end[b] == -1) {
+            v = -1;
+        } else {
+            v = blossom_endpoint(bm, bm->label_end[b]);
+            b = bm->in_blossom[v];
+            v = blossom_endpoint(bm, bm->label_end[b]);
+        }
+        if (w != -1) {
+            int swap = v;
+            v = w;
+            w = swap;
+        }
+    }
+
+    for (int i = 0; i < path_length; i++) {
+        bm->label[bm->scan_path[i]] = 1;
+    }
+    return base;
+}
+
+// Keep edge k as blossom b's best link to the S-blossom at its other end if it has least slack
+static void blossom_offer_best_edge(blossom_matching_t* bm, int b, int k) {
+    int other = bm->graph->edge_v[k];
+    if (bm->in_blossom[other] == b) {
+        other = bm->graph->edge_u[k];
+    }
+    int bo = bm->in_blossom[other];
+    if (bo != b && bm->label[bo] == 1 &&
+        (bm->best_edge_to[bo] == -1 || blossom_slack(bm, k) < blossom_slack(bm, bm->best_edge_to[bo]))) {
+        bm->best_edge_to[bo] = k;
+    }
+}
+
+// Fold the cycle closed by edge e into a new S-blossom with the given base
+static bool blossom_add(blossom_matching_t* bm, int base, int e) {
+    int n = bm->num_vertices;
+    int v = bm->graph->edge_u[e];
+    int w = bm->graph->edge_v[e];
+    int bb = bm->in_blossom[base];
+    int bv = bm->in_blossom[v];
+    int bw = bm->in_blossom[w];
+
+    // Walk both sides back to the base: v side first, w side after it
+    int v_side = 0;
+    while (bv != bb) {
+        bm->scratch_childs[v_side] = bv;
+        bm->scratch_endps[v_side] = bm->label_end[bv];
+        v_side++;
+        bv = bm->in_blossom[blossom_endpoint(bm, bm->label_end[bv])];
+    }
+    int w_side = 0;
+    while (bw != bb) {
+        bm->scratch_childs[v_side + w_side] = bw;
+        bm->scratch_endps[v_side + w_side] = bm->label_end[bw] ^ 1;
+        w_side++;
+        bw = bm->in_blossom[blossom_endpoint(bm, bm->label_end[bw])];
+    }
+
+    int length = 1 + v_side + w_side;
+    int b = bm->unused[bm->num_unused - 1];
+    int* childs = blossom_pool_alloc(&bm->child_pool, b, length, 2, bm->childs, bm->num_childs);
+    if (childs == NULL) {
+        return false;
+    }
+    for (int c = n; c < 2 * n; c++) {
+        if (bm->childs[c] != NULL) {
+            bm->endps[c] = bm->childs[c] + bm->num_childs[c];
+        }
+    }
+    int* endps = childs + length;
+
+    // Cycle order: base, v side reversed, w side
+    childs[0] = bb;
+    for (int i = 0; i < v_side; i++) {
+        childs[1 + i] = bm->scratch_childs[v_side - 1 - i];
+        endps[i] = bm->scratch_endps[v_side - 1 - i];
+    }
+    endps[v_side] = 2 * e;
+    for (int i = 0; i < w_side; i++) {
+        childs[1 + v_side + i] = bm->scratch_childs[v_side + i];
+        endps[1 + v_side + i] = bm->scratch_endps[v_side + i];
+    }
+
+    bm->num_unused--;
+    bm->blossom_base[b] = base;
+    bm->blossom_parent[b] = -1;
+    bm->childs[b] = childs;
+    bm->endps[b] = endps;
+    bm->num_childs[b] = length;
+    for (int i = 0; i < length; i++) {
+        bm->blossom_parent[childs[i]] = b;
+    }
+
+    bm->label[b] = 1;
+    bm->label_end[b] = bm->label_end[bb];
+    bm->dual[b] = 0;
+
+    // Former T-vertices become S-vertices and need scanning
+    int num_leaves = blossom_leaves(bm, b, bm->leaves, 0);
+    for (int i = 0; i < num_leaves; i++) {
+        int leaf = bm->leaves[i];
+        if (bm->label[bm->in_blossom[leaf]] == 2) {
+            bm->queue[bm->queue_size++] = leaf;
+        }
+        bm->in_blossom[leaf] = b;
+    }
+
+    // Merge the children's least-slack edges towards other S-blossoms
+    for (int i = 0; i < 2 * n; i++) {
+        bm->best_edge_to[i] = -1;
+    }
+    for (int c = 0; c < length; c++) {
+        int child = childs[c];
+        if (bm->best_edges[child] != NULL) {
+            for (int i = 0; i < bm->num_best_edges[child]; i++) {
+                blossom_offer_best_edge(bm, b, bm->best_edges[child][i]);
+            }
+        } else {
+            // No cached list: consider every edge of every vertex in the child
+            int num_leaves = blossom_leaves(bm, child, bm->leaves, 0);
+            for (int i = 0; i < num_leaves; i++) {
+                int leaf = bm->leaves[i];
+                for (int q = bm->neighbor_start[leaf]; q < bm->neighbor_start[leaf + 1]; q++) {
+                    blossom_offer_best_edge(bm, b, bm->neighbor_end[q] >> 1);
+                }
+            }
+        }
+
+        bm->best_edges[child] = NULL;
+        bm->num_best_edges[child] = 0;
+        bm->best_edge[child] = -1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < 2 * n; i++) {
+        if (bm->best_edge_to[i] != -1) {
+            count++;
+        }
+    }
+    int* best_edges = blossom_pool_alloc(&bm->edge_pool, b, count, 1, bm->best_edges, bm->num_best_edges);
+    if (best_edges == NULL) {
+        return false;
+    }
+    count = 0;
+    bm->best_edge[b] = -1;
+    for (int i = 0; i < 2 * n; i++) {
+        int k = bm->best_edge_to[i];
+        if (k != -1) {
+            best_edges[count++] = k;
+            if (bm->best_edge[b] == -1 || blossom_slack(bm, k) < blossom_slack(bm, bm->best_edge[b])) {
+                bm->best_edge[b] = k;
+            }
+        }
+    }
+    bm->best_edges[b] = best_edges;
+    bm->num_best_edges[b] = count;
+    return true;
+}
+
+// Dissolve blossom b into its children; mid-stage T-blossoms relabel the
+// children along the path that runs through them
+static void blossom_expand(blossom_matching_t* bm, int b, bool end_stage) {
+    int n = bm->num_vertices;
+    int length = bm->num_childs[b];
+
+    for (int c = 0; c < length; c++) {
+        int s = bm->childs[b][c];
+        bm->blossom_parent[s] = -1;
+        if (s < n) {
+            bm->in_blossom[s] = s;
+        } else if (end_stage && bm->dual[s] == 0) {
+            blossom_expand(bm, s, end_stage);
+        } else {
+            int num_leaves = blossom_leaves(bm, s, bm->leaves, 0);
+            for (int i = 0; i < num_leaves; i++) {
+                bm->in_blossom[bm->leaves[i]] = s;
+            }
+        }
+    }
+
+    if (!end_stage && bm->label[b] == 2) {
+        int* childs = bm->childs[b];
+        int* endps = bm->endps[b];
+        int entry_child = bm->in_blossom[blossom_endpoint(bm, bm->label_end[b] ^ 1)];
+        int j = 0;
+        while (childs[j] != entry_child) {
+            j++;
+        }
+
+        int j_step;
+        int endp_trick;
+        if (j & 1) {
+            j -= length;
+            j_step = 1;
+            endp_trick = 0;
+        } else {
+            j_step = -1;
+            endp_trick = 1;
+        }
+
+        // Relabel the even-length path from the entry child to the base
+        int p = bm->label_end[b];
+        while (j != 0) {
+            bm->label[blossom_endpoint(bm, p ^ 1)] = 0;
+            bm->label[blossom_endpoint(bm, endps[wrap_child(j - endp_trick, length)] ^ endp_trick ^ 1)] = 0;
+            blossom_assign_label(bm, blossom_endpoint(bm, p ^ 1), 2, p);
+            bm->allow_edge[endps[wrap_child(j - endp_trick, length)] >> 1] = true;
+            j += j_step;
+            p = endps[wrap_child(j - endp_trick, length)] ^ endp_trick;
+            bm->allow_edge[p >> 1] = true;
+            j += j_step;
+        }
+
+        int bv = childs[wrap_child(j, length)];
+        bm->label[blossom_endpoint(bm, p ^ 1)] = bm->label[bv] = 2;
+        bm->label_end[blossom_endpoint(bm, p ^ 1)] = bm->label_end[bv] = p;
+        bm->best_edge[bv] = -1;
+
+        // Children off the path keep a T-label only if reached from outside
+        j += j_step;
+        while (childs[wrap_child(j, length)] != entry_child) {
+            bv = childs[wrap_child(j, length)];
+            if (bm->label[bv] == 1) {
+                j += j_step;
+                continue;
+            }
+
+            int num_leaves = blossom_leaves(bm, bv, bm->leaves, 0);
+            int reached = -1;
+            for (int i = 0; i < num_leaves; i++) {
+                if (bm->label[bm->leaves[i]] != 0) {
+                    reached = bm->leaves[i];
+                    break;
+                }
+            }
+            if (reached != -1) {
+                bm->label[reached] = 0;
+                bm->label[blossom_endpoint(bm, bm->mate[bm->blossom_base[bv]])] = 0;
+                blossom_assign_label(bm, reached, 2, bm->label_end[reached]);
+            }
+            j += j_step;
+        }
+    }
+
+    bm->label[b] = bm->label_end[b] = -1;
+    bm->childs[b] = NULL;
+    bm->endps[b] = NULL;
+    bm->best_edges[b] = NULL;
+    bm->num_childs[b] = 0;
+    bm->num_best_edges[b] = 0;
+    bm->blossom_base[b] = -1;
+    bm->best_edge[b] = -1;
+    bm->unused[bm->num_unused++] = b;
+}
+
+// Swap matched and unmatched edges along the even path from vertex v to the base of blossom b
+static void blossom_augment(blossom_matching_t* bm, int b, int v) {
+    int n = bm->num_vertices;
+    int t = v;
+    while (bm->blossom_parent[t] != b) {
+        t = bm->blossom_parent[t];
+    }
+    if (t >= n) {
+        blossom_augment(bm, t, v);
+    }
+
+    int length = bm->num_childs[b];
+    int* childs = bm->childs[b];
+    int* endps = bm->endps[b];
+    int i = 0;
+    while (childs[i] != t) {
+        i++;
+    }
+
+    int j = i;
+    int j_step;
+    int endp_trick;
+    if (i & 1) {
+        j -= length;
+        j_step = 1;
+        endp_trick = 0;
+    } else {
+        j_step = -1;
+        endp_trick = 1;
+    }
+
+    while (j != 0) {
+        j += j_step;
+        t = childs[wrap_child(j, length)];
+        int p = endps[wrap_child(j - endp_trick, length)] ^ endp_trick;
+        if (t >= n) {
+            blossom_augment(bm, t, blossom_endpoint(bm, p));
+        }
+        j += j_step;
+        t = childs[wrap_child(j, length)];
+        if (t >= n) {
+            blossom_augment(bm, t, blossom_endpoint(bm, p ^ 1));
+        }
+        bm->mate[blossom_endpoint(bm, p)] = p ^ 1;
+        bm->mate[blossom_endpoint(bm, p ^ 1)] = p;
+    }
+
+    // Rotate so the child containing v becomes the base
+    for (int c = 0; c < length; c++) {
+        bm->scratch_childs[c] = childs[(i + c) % length];
+        bm->scratch_endps[c] = endps[(i + c) % length];
+    }
+    memcpy(childs, bm->scratch_childs, length * sizeof(int));
+    memcpy(endps, bm->scratch_endps, length * sizeof(int));
+    bm->blossom_base[b] = bm->blossom_base[childs[0]];
+}
+
+// Augment along the path through edge e between two S-blossoms
+static void blossom_augment_matching(blossom_matching_t* bm, int e) {
+    int n = bm->num_vertices;
+    int starts[2] = { bm->graph->edge_u[e], bm->graph->edge_v[e] };
+    int endpoints[2] = { 2 * e + 1, 2 * e };
+
+    for (int side = 0; side < 2; side++) {
+        int s = starts[side];
+        int p = endpoints[side];
+        for (;;) {
+            int bs = bm->in_blossom[s];
+            if (bs >= n) {
+                blossom_augment(bm, bs, s);
+            }
+            bm->mate[s] = p;
+            if (bm->label_end[bs] == -1) {
+                break;  // Reached a free vertex
+            }
+
+            int t = blossom_endpoint(bm, bm->label_end[bs]);
+            int bt = bm->in_blossom[t];
+            s = blossom_endpoint(bm, bm->label_end[bt]);
+            int j = blossom_endpoint(bm, bm->label_end[bt] ^ 1);
+            if (bt >= n) {
+                blossom_augment(bm, bt, j);
+            }
+            bm->mate[j] = bm->label_end[bt];
+            p = bm->label_end[bt] ^ 1;
+        }
+    }
+}
+
+// Total weight of the current matching
+static int blossom_matching_weight(const blossom_matching_t* bm) {
+    int weight = 0;
+    for (int v = 0; v < bm->num_vertices; v++) {
+        if (bm->mate[v] != -1) {
+            weight += bm->graph->edge_weight[bm->mate[v] >> 1];
+        }
+    }
+    return weight / 2;
+}
+
+// One stage: grow alternating trees from free vertices, adjusting duals until
+// an augmenting path appears (true) or no further gain is possible (false).
+// Sets *failed if a blossom could not be allocated.
+static bool blossom_stage(blossom_matching_t* bm, bool* failed) {
+    int n = bm->num_vertices;
+    const improvement_graph_t* graph = bm->graph;
+
+    for (int b = 0; b < 2 * n; b++) {
+        bm->label[b] = 0;
+        bm->best_edge[b] = -1;
+    }
+    for (int b = n; b < 2 * n; b++) {
+        bm->best_edges[b] = NULL;
+        bm->num_best_edges[b] = 0;
+    }
+    bm->edge_pool.used = 0;
+    for (int e = 0; e < graph->num_edges; e++) {
+        bm->allow_edge[e] = false;
+    }
+    bm->queue_size = 0;
+
+    for (int v = 0; v < n; v++) {
+        if (bm->mate[v] == -1 && bm->label[bm->in_blossom[v]] == 0) {
+            blossom_assign_label(bm, v, 1, -1);
+        }
+    }
+
+    for (;;) {
+        // Scan S-vertices over tight edges
+        while (bm->queue_size > 0) {
+            int v = bm->queue[--bm->queue_size];
+
+            for (int q = bm->neighbor_start[v]; q < bm->neighbor_start[v + 1]; q++) {
+                int p = bm->neighbor_end[q];
+                int k = p >> 1;
+                int w = blossom_endpoint(bm, p);
+                if (bm->in_blossom[v] == bm->in_blossom[w]) {
+                    continue;
+                }
+
+                int k_slack = 0;
+                if (!bm->allow_edge[k]) {
+                    k_slack = blossom_slack(bm, k);
+                    if (k_slack <= 0) {
+                        bm->allow_edge[k] = true;
+                    }
+                }
+
+                if (bm->allow_edge[k]) {
+                    if (bm->label[bm->in_blossom[w]] == 0) {
+                        blossom_assign_label(bm, w, 2, p ^ 1);
+                    } else if (bm->label[bm->in_blossom[w]] == 1) {
+                        int base = blossom_scan(bm, v, w);
+                        if (base >= 0) {
+                            if (!blossom_add(bm, base, k)) {
+                                *failed = true;
+                                return false;
+                            }
+                        } else {
+                            blossom_augment_matching(bm, k);
+                            return true;
+                        }
+                    } else if (bm->label[w] == 0) {
+                        // w is inside a T-blossom but not yet reached itself
+                        bm->label[w] = 2;
+                        bm->label_end[w] = p ^ 1;
+                    }
+                } else if (bm->label[bm->in_blossom[w]] == 1) {
+                    int b = bm->in_blossom[v];
+                    if (bm->best_edge[b] == -1 || k_slack < blossom_slack(bm, bm->best_edge[b])) {
+                        bm->best_edge[b] = k;
+                    }
+                } else if (bm->label[w] == 0) {
+                    if (bm->best_edge[w] == -1 || k_slack < blossom_slack(bm, bm->best_edge[w])) {
+                        bm->best_edge[w] = k;
+                    }
+                }
+            }
+        }
+
+        // Dual adjustment: the smallest step that makes progress
+        int delta_type = 1;
+        int delta = INT_MAX;
+        int delta_edge = -1;
+        int delta_blossom = -1;
+
+        for (int v = 0; v < n; v++) {
+            if (bm->dual[v] < delta) {
+                delta = bm->dual[v];
+            }
+        }
+        for (int v = 0; v < n; v++) {
+            if (bm->label[bm->in_blossom[v]] == 0 && bm->best_edge[v] != -1) {
+                int d = blossom_slack(bm, bm->best_edge[v]);
+                if (d < delta) {
+                    delta = d;
+                    delta_type = 2;
+                    delta_edge = bm->best_edge[v];
+                }
+            }
+        }
+        for (int b = 0; b < 2 * n; b++) {
+            if (bm->blossom_parent[b] == -1 && bm->label[b] == 1 && bm->best_edge[b] != -1) {
+                int d = blossom_slack(bm, bm->best_edge[b]) / 2;
+                if (d < delta) {
+                    delta = d;
+                    delta_type = 3;
+                    delta_edge = bm->best_edge[b];
+                }
+            }
+        }
+        for (int b = n; b < 2 * n; b++) {
+            if (bm->blossom_base[b] >= 0 && bm->blossom_parent[b] == -1 && bm->label[b] == 2 &&
+                bm->dual[b] < delta) {
+                delta = bm->dual[b];
+                delta_type = 4;
+                delta_blossom = b;
+            }
+        }
+
+        for (int v = 0; v < n; v++) {
+            if (bm->label[bm->in_blossom[v]] == 1) {
+                bm->dual[v] -= delta;
+            } else if (bm->label[bm->in_blossom[v]] == 2) {
+                bm->dual[v] += delta;
+            }
+        }
+        for (int b = n; b < 2 * n; b++) {
+            if (bm->blossom_base[b] >= 0 && bm->blossom_parent[b] == -1) {
+                if (bm->label[b] == 1) {
+                    bm->dual[b] += delta;
+                } else if (bm->label[b] == 2) {
+                    bm->dual[b] -= delta;
+                }
+            }
+        }
+
+        if (delta_type == 1) {
+            return false;  // Vertex duals hit zero: the matching is optimal
+        } else if (delta_type == 2) {
+            bm->allow_edge[delta_edge] = true;
+            int i = graph->edge_u[delta_edge];
+            if (bm->label[bm->in_blossom[i]] == 0) {
+                i = graph->edge_v[delta_edge];
+            }
+            bm->queue[bm->queue_size++] = i;
+        } else if (delta_type == 3) {
+            bm->allow_edge[delta_edge] = true;
+            bm->queue[bm->queue_size++] = graph->edge_u[delta_edge];
+        } else {
+            blossom_expand(bm, delta_blossom, false);
+        }
+    }
+}
+
+// Maximum weight of an alternative roommates matching
+static int roommates_blocking_number(const matching_t* matching, const problem_instance_t* instance,
+                                     int limit, verifier_context_t* context, matching_arena_t* arena) {
+    int n = instance->num_agents;
+    improvement_graph_t graph;
+    blossom_matching_t bm;
+    if (!improvement_graph_init(&graph, matching, instance, context, arena) ||
+        !blossom_matching_init(&bm, &graph, n, arena)) {
+        return -1;
+    }
+
+    int weight = 0;
+    bool failed = false;
+    for (int stage = 0; stage < n && weight < limit; stage++) {
+        if (!blossom_stage(&bm, &failed)) {
+            break;
+        }
+        weight = blossom_matching_weight(&bm);
+
+        // Blossoms whose dual dropped to zero are no longer needed
+        for (int b = n; b < 2 * n; b++) {
+            if (bm.blossom_parent[b] == -1 && bm.blossom_base[b] >= 0 &&
+                bm.label[b] == 1 && bm.dual[b] == 0) {
+                blossom_expand(&bm, b, true);
+            }
+        }
+    }
+
+    if (!failed) {
+        weight = blossom_matching_weight(&bm);
+    }
+    return failed ? -1 : (weight < limit ? weight : limit);
+}
+
+// ---------------------------------------------------------------------------
+// Public entry points
+// ---------------------------------------------------------------------------
+
+// Dispatch on the model; context (may be NULL) supplies partner ranks
+static int compute_blocking_number(const matching_t* matching, const problem_instance_t* instance,
+                                   int limit, verifier_context_t* context, matching_arena_t* arena) {
+    size_t mark = matching_arena_mark(arena);
+    int result = -1;
+    switch (instance->model) {
+        case HOUSE_ALLOCATION:
+        case HOUSE_ALLOCATION_PARTIAL:
+            result = house_allocation_blocking_number(matching, instance, limit, arena);
+            break;
+        case MARRIAGE:
+            result = marriage_blocking_number(matching, instance, limit, context, arena);
+            break;
+        case ROOMMATES:
+            result = roommates_blocking_number(matching, instance, limit, context, arena);
+            break;
+    }
+    matching_arena_release(arena, mark);
+    return result;
+}
+
+// Blocking number of a matching, drawing scratch from arena (at least
+// blocking_number_scratch_bytes free; left as it was found). Counting stops
+// once limit agents are found, so the result is min(blocking number, limit).
+// Returns -1 if the model is unknown or scratch runs out.
+int blocking_number_in_arena(const matching_t* matching, const problem_instance_t* instance,
+                             int limit, matching_arena_t* arena) {
+    if (matching == NULL || instance == NULL || arena == NULL ||
+        matching->num_agents != instance->num_agents) {
+        return -1;
+    }
+    return compute_blocking_number(matching, instance, limit, NULL, arena);
+}
+
+// Exact blocking number of a matching (-1 on failure)
+int blocking_number(const matching_t* matching, const problem_instance_t* instance) {
+    if (matching == NULL || instance == NULL) {
+        return -1;
+    }
+
+    matching_arena_t arena;
+    if (!matching_arena_init(&arena, blocking_number_scratch_bytes(instance))) {
+        return -1;
+    }
+
+    int result = blocking_number_in_arena(matching, instance, INT_MAX, &arena);
+    matching_arena_destroy(&arena);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Verifier contexts
+// ---------------------------------------------------------------------------
+
+// Build the per-instance state for checking many matchings of instance: one
+// arena sized for a full k-stability check, and each preference entry's rank
+// on the other side
+bool verifier_context_init(verifier_context_t* context, const problem_instance_t* instance) {
+    if (context == NULL || instance == NULL) {
+        return false;
+    }
+
+    int n = instance->num_agents;
+    int num_prefs = instance->pref_offsets[n];
+    bool lists_agents = (instance->model == MARRIAGE || instance->model == ROOMMATES);
+    context->instance = instance;
+    context->partner_ranks = NULL;
+    context->current_ranks = NULL;
+    if (!matching_arena_init(&context->arena, k_stability_scratch_bytes(instance))) {
+        return false;
+    }
+    if (lists_agents) {
+        context->partner_ranks = malloc((num_prefs > 0 ? num_prefs : 1) * sizeof(int));
+        context->current_ranks = malloc((n > 0 ? n : 1) * sizeof(int));
+        if (context->partner_ranks == NULL || context->current_ranks == NULL) {
+            verifier_context_destroy(context);
+            return false;
+        }
+
+        for (int a = 0; a < n; a++) {
+            const int* preferences = instance_preferences(instance, a);
+            int* partner_ranks = context->partner_ranks + instance->pref_offsets[a];
+            for (int j = 0; j < instance_num_preferences(instance, a); j++) {
+                int b = preferences[j];
+                partner_ranks[j] = can_be_partners(instance, a, b) ? get_agent_rank(instance, b, a)
+                                                                   : PARTNER_NONE;
+            }
+        }
+    }
+    return true;
+}
+
+void verifier_context_destroy(verifier_context_t* context) {
+    if (context == NULL) {
+        return;
+    }
+    matching_arena_destroy(&context->arena);
+    free(context->partner_ranks);
+    free(context->current_ranks);
+    context->partner_ranks = NULL;
+    context->current_ranks = NULL;
+}
+
+// min(blocking number, limit) of a matching of the context's instance, -1 on failure
+int verifier_blocking_number(verifier_context_t* context, const matching_t* matching, int limit) {
+    if (context == NULL || matching == NULL ||
+        matching->num_agents != context->instance->num_agents) {
+        return -1;
+    }
+    return compute_blocking_number(matching, context->instance, limit, context, &context->arena);
+}
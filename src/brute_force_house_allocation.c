@@ -2,28 +2,84 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "../include/matching.h"
 
-// Structure to hold matching analysis results
+// Largest n whose matchings are all listed when no sample size is given
+#define DEFAULT_DETAIL_MAX_N 4
+
+// Positions permuted by Heap's algorithm within one chunk (7! = 5040 matchings)
+#define CENSUS_HEAP_POSITIONS 7
+
+// One sampled matching
 typedef struct {
     matching_t* matching;
     int agents_preferring_others;
+    int blocking_number;
     bool is_k_stable;
 } matching_analysis_t;
 
+// Per-worker state of the census. Within a chunk, matchings follow Heap's
+// order, so consecutive matchings differ by one swap of two agents' houses:
+// per-agent state and the blocking number are updated for the swapped agents
+// only. Nothing is stored per matching, so memory is O(n) per worker.
+typedef struct {
+    matching_t* matching;            // Permutation being evaluated
+    int* owner;                      // Agent holding each house (inverse permutation)
+    int* heap_counters;              // Loop counters of the iterative Heap's algorithm
+    int* changed;                    // Agents whose house a jump changed
+    blocking_tracker_t* tracker;     // Blocking number of the current matching
+    int preferring;                  // Agents ranking some house above their own
+    int symmetric;                   // Agents with pairs[pairs[a]] == a; feasible iff all n are
+    matching_census_t census;        // Totals over the chunks this worker took
+} census_worker_t;
+
+// One census. Chunk c covers the matchings whose first n - m houses are
+// those of the permutation of lexicographic rank c * m! (found by Lehmer-code
+// unranking), the last m = min(n, CENSUS_HEAP_POSITIONS) positions being
+// permuted in Heap's order. Matching number c * m! + j is the j-th of chunk c,
+// which fixes the enumeration order independently of the thread count.
+typedef struct {
+    const problem_instance_t* instance;
+    int k;
+    int heap_positions;              // m
+    uint64_t chunk_matchings;        // m!
+    census_worker_t* workers;
+    matching_analysis_t* sample;     // sample[i]: matching number i
+    int sample_size;
+} census_run_t;
+
 // Forward declarations
-static void generate_all_matchings_recursive(int n, int* current_matching, int agent_index, 
-                                           bool* used_objects, matching_analysis_t* results, 
-                                           int* result_count, const problem_instance_t* instance, int k);
-static int count_agents_preferring_others(const matching_t* matching, const problem_instance_t* instance);
-static bool is_matching_k_stable(const matching_t* matching, const problem_instance_t* instance, int k);
+static bool run_census(const problem_instance_t* instance, int k, int num_threads,
+                       matching_analysis_t* sample, int sample_size, matching_census_t* census);
+static bool census_worker_init(census_worker_t* worker, const problem_instance_t* instance);
+static void census_worker_destroy(census_worker_t* worker);
+static void census_chunks(void* context, int worker_id, uint64_t begin, uint64_t end);
+static void enumerate_chunk(census_run_t* run, census_worker_t* worker, uint64_t chunk);
+static void jump_to_permutation(census_worker_t* worker, const problem_instance_t* instance, uint64_t rank);
+static void swap_houses(census_worker_t* worker, const problem_instance_t* instance, int x, int y);
+static void record_matching(census_run_t* run, census_worker_t* worker, uint64_t index);
+static void merge_census(matching_census_t* total, const matching_census_t* part);
+static void print_matching_census(const matching_census_t* census, int n);
+static bool prefers_other_house(const matching_t* matching, const problem_instance_t* instance, int agent);
+static bool is_symmetric_pair(const matching_t* matching, int agent);
+static int compare_sampled_matchings(const void* a, const void* b);
 static void print_matching_analysis(const matching_analysis_t* analysis, int matching_index);
 static long long factorial(int n);
 
-// Main function to analyze all possible matchings for house allocation
+// Main function to analyze all possible matchings for house allocation; the
+// matchings are listed for n <= 4
 void analyze_all_house_allocations(int n, int k) {
-    if (n <= 0 || n > 8) {  // Limit to prevent excessive computation
-        printf("Error: n must be between 1 and 8 for brute force analysis\n");
+    int sample_size = (n >= 1 && n <= DEFAULT_DETAIL_MAX_N) ? (int)factorial(n) : 0;
+    analyze_all_house_allocations_sampled(n, k, sample_size, 0);
+}
+
+// Analyze all n! matchings of a random house allocation instance on
+// num_threads workers (all cores if <= 0), listing the first sample_size of
+// them (in enumeration order). The output does not depend on the thread count.
+void analyze_all_house_allocations_sampled(int n, int k, int sample_size, int num_threads) {
+    if (n <= 0 || n > MATCHING_CENSUS_MAX_N) {
+        printf("Error: n must be between 1 and %d for brute force analysis\n", MATCHING_CENSUS_MAX_N);
         return;
     }
     
@@ -36,7 +92,9 @@ void analyze_all_house_allocations(int n, int k) {
     printf("n = %d agents/objects, k = %d\n", n, k);
     
     // Generate a random house allocation instance
+    phase_begin("generate");
     problem_instance_t* instance = generate_random_house_allocation(n, 12345);
+    phase_end(NULL);
     if (instance == NULL) {
         printf("Error: Could not generate problem instance\n");
         return;
@@ -49,159 +107,325 @@ void analyze_all_house_allocations(int n, int k) {
     long long total_matchings = factorial(n);
     printf("\nTotal possible matchings: %lld\n", total_matchings);
     
-    // Allocate space for results
-    matching_analysis_t* results = malloc(total_matchings * sizeof(matching_analysis_t));
-    if (results == NULL) {
-        printf("Error: Could not allocate memory for results\n");
-        free(instance);
+    if (sample_size > total_matchings) {
+        sample_size = (int)total_matchings;
+    }
+    if (sample_size < 0) {
+        sample_size = 0;
+    }
+    matching_analysis_t* sample = calloc(sample_size > 0 ? sample_size : 1, sizeof(matching_analysis_t));
+    if (sample == NULL) {
+        printf("Error: Could not allocate memory for the analysis\n");
+        destroy_problem_instance(instance);
         return;
     }
     
-    // Initialize tracking variables
-    int* current_matching = malloc(n * sizeof(int));
-    bool* used_objects = malloc(n * sizeof(bool));
-    int result_count = 0;
+    printf("\nGenerating and analyzing all matchings...\n");
     
-    if (current_matching == NULL || used_objects == NULL) {
-        printf("Error: Could not allocate memory for tracking variables\n");
-        free(results);
-        free(current_matching);
-        free(used_objects);
-        free(instance);
-        return;
-    }
+    // Each matching is verified as it is generated, then forgotten
+    matching_census_t census;
+    phase_begin("verify");
+    bool ok = run_census(instance, k, num_threads, sample, sample_size, &census);
+    phase_end(NULL);
     
-    // Initialize used_objects array
-    for (int i = 0; i < n; i++) {
-        used_objects[i] = false;
+    if (!ok) {
+        printf("Error: Could not allocate memory for the analysis\n");
+    } else {
+        printf("Analysis complete! Generated %lld matchings.\n\n", census.total);
+        
+        print_matching_census(&census, n);
+        
+        // Print detailed results for the sampled matchings, in lexicographic order
+        if (sample_size > 0) {
+            qsort(sample, sample_size, sizeof(matching_analysis_t), compare_sampled_matchings);
+            printf("\n=== DETAILED RESULTS ===\n");
+            for (int i = 0; i < sample_size; i++) {
+                print_matching_analysis(&sample[i], i);
+            }
+        }
     }
     
-    printf("\nGenerating and analyzing all matchings...\n");
+    // Clean up
+    for (int i = 0; i < sample_size; i++) {
+        destroy_matching(sample[i].matching);
+    }
+    free(sample);
+    destroy_problem_instance(instance);
+}
+
+// Totals over all n! matchings of a house allocation instance (agent a gets
+// house pairs[a]), computed on num_threads workers (all cores if <= 0). The
+// result is the same for every thread count.
+bool house_allocation_matching_census(const problem_instance_t* instance, int k, int num_threads,
+                                      matching_census_t* census) {
+    if (instance == NULL || census == NULL ||
+        (instance->model != HOUSE_ALLOCATION && instance->model != HOUSE_ALLOCATION_PARTIAL) ||
+        instance->num_agents <= 0 || instance->num_agents > MATCHING_CENSUS_MAX_N) {
+        return false;
+    }
+    return run_census(instance, k, num_threads, NULL, 0, census);
+}
+
+static bool run_census(const problem_instance_t* instance, int k, int num_threads,
+                       matching_analysis_t* sample, int sample_size, matching_census_t* census) {
+    if (num_threads <= 0) {
+        num_threads = default_thread_count();
+    }
+    int n = instance->num_agents;
+    int heap_positions = (n < CENSUS_HEAP_POSITIONS) ? n : CENSUS_HEAP_POSITIONS;
+    uint64_t chunk_matchings = permutation_count(heap_positions);
+    uint64_t num_chunks = permutation_count(n) / chunk_matchings;
+    if ((uint64_t)num_threads > num_chunks) {
+        num_threads = (int)num_chunks;
+    }
     
-    // Generate all possible matchings and analyze them
-    generate_all_matchings_recursive(n, current_matching, 0, used_objects, results, 
-                                   &result_count, instance, k);
+    census_run_t run = { instance, k, heap_positions, chunk_matchings, NULL, sample, sample_size };
+    run.workers = calloc(num_threads, sizeof(census_worker_t));
+    if (run.workers == NULL) {
+        return false;
+    }
+    bool ok = true;
+    for (int t = 0; t < num_threads && ok; t++) {
+        ok = census_worker_init(&run.workers[t], instance);
+    }
     
-    printf("Analysis complete! Generated %d matchings.\n\n", result_count);
+    // Integer totals merge the same way whatever chunks each worker took
+    memset(census, 0, sizeof(*census));
+    census->min_preferring = instance->num_agents;
+    if (ok) {
+        ok = parallel_for_chunks(num_chunks, 1, num_threads, census_chunks, &run);
+    }
+    for (int t = 0; t < num_threads; t++) {
+        if (ok) {
+            merge_census(census, &run.workers[t].census);
+        }
+        census_worker_destroy(&run.workers[t]);
+    }
+    free(run.workers);
+    return ok;
+}
+
+static bool census_worker_init(census_worker_t* worker, const problem_instance_t* instance) {
+    int n = instance->num_agents;
+    memset(worker, 0, sizeof(*worker));
+    worker->census.min_preferring = n;
     
-    // Print summary statistics
-    int k_stable_count = 0;
-    int total_preferring_others = 0;
-    int min_preferring = n;
-    int max_preferring = 0;
+    // Start from the identity; chunks jump from wherever the last one ended
+    worker->matching = create_matching(n, HOUSE_ALLOCATION);
+    worker->owner = malloc(n * sizeof(int));
+    worker->heap_counters = malloc(n * sizeof(int));
+    worker->changed = malloc(n * sizeof(int));
+    if (worker->matching == NULL || worker->owner == NULL || worker->heap_counters == NULL ||
+        worker->changed == NULL) {
+        return false;
+    }
+    for (int a = 0; a < n; a++) {
+        worker->matching->pairs[a] = a;
+        worker->owner[a] = a;
+    }
+    for (int a = 0; a < n; a++) {
+        worker->preferring += prefers_other_house(worker->matching, instance, a);
+        worker->symmetric += is_symmetric_pair(worker->matching, a);
+    }
+    worker->tracker = create_blocking_tracker(instance, worker->matching);
+    return worker->tracker != NULL;
+}
+
+static void census_worker_destroy(census_worker_t* worker) {
+    destroy_blocking_tracker(worker->tracker);
+    free(worker->changed);
+    free(worker->heap_counters);
+    free(worker->owner);
+    destroy_matching(worker->matching);
+}
+
+static void census_chunks(void* context, int worker_id, uint64_t begin, uint64_t end) {
+    census_run_t* run = context;
+    for (uint64_t chunk = begin; chunk < end; chunk++) {
+        enumerate_chunk(run, &run->workers[worker_id], chunk);
+    }
+}
+
+// Evaluate the m! matchings of a chunk: jump to its first permutation, then
+// run Heap's algorithm over positions n - m .. n - 1
+static void enumerate_chunk(census_run_t* run, census_worker_t* worker, uint64_t chunk) {
+    const problem_instance_t* instance = run->instance;
+    int base = instance->num_agents - run->heap_positions;
+    int* counters = worker->heap_counters;
+    uint64_t index = chunk * run->chunk_matchings;
     
-    for (int i = 0; i < result_count; i++) {
-        if (results[i].is_k_stable) {
-            k_stable_count++;
+    jump_to_permutation(worker, instance, index);
+    record_matching(run, worker, index++);
+    for (int i = 0; i < run->heap_positions; i++) {
+        counters[i] = 0;
+    }
+    int i = 1;
+    while (i < run->heap_positions) {
+        if (counters[i] < i) {
+            swap_houses(worker, instance, base + ((i % 2 == 0) ? 0 : counters[i]), base + i);
+            record_matching(run, worker, index++);
+            counters[i]++;
+            i = 1;
+        } else {
+            counters[i] = 0;
+            i++;
         }
-        total_preferring_others += results[i].agents_preferring_others;
-        if (results[i].agents_preferring_others < min_preferring) {
-            min_preferring = results[i].agents_preferring_others;
+    }
+}
+
+// Set the worker's matching to the permutation of the given lexicographic
+// rank (Lehmer code), recomputing its state from scratch
+static void jump_to_permutation(census_worker_t* worker, const problem_instance_t* instance, uint64_t rank) {
+    int n = instance->num_agents;
+    matching_t* matching = worker->matching;
+    unrank_permutation(rank, n, matching->pairs);
+    
+    worker->preferring = 0;
+    worker->symmetric = 0;
+    for (int a = 0; a < n; a++) {
+        worker->owner[matching->pairs[a]] = a;
+        worker->changed[a] = a;
+    }
+    for (int a = 0; a < n; a++) {
+        worker->preferring += prefers_other_house(matching, instance, a);
+        worker->symmetric += is_symmetric_pair(matching, a);
+    }
+    blocking_tracker_update(worker->tracker, matching, worker->changed, n);
+}
+
+// Exchange the houses of agents x and y, updating the per-agent counts of the
+// agents whose state can change and the blocking number
+static void swap_houses(census_worker_t* worker, const problem_instance_t* instance, int x, int y) {
+    matching_t* matching = worker->matching;
+    
+    // pairs[a] == a's partner check changes only for x, y and the agents
+    // holding houses x and y (the holders after the swap are among these)
+    int affected[4] = {x, y, worker->owner[x], worker->owner[y]};
+    int num_affected = 0;
+    for (int i = 0; i < 4; i++) {
+        bool seen = false;
+        for (int j = 0; j < num_affected; j++) {
+            seen = seen || affected[j] == affected[i];
         }
-        if (results[i].agents_preferring_others > max_preferring) {
-            max_preferring = results[i].agents_preferring_others;
+        if (!seen) {
+            affected[num_affected++] = affected[i];
         }
     }
     
-    printf("=== SUMMARY STATISTICS ===\n");
-    printf("Total matchings: %d\n", result_count);
-    printf("k-stable matchings: %d (%.2f%%)\n", k_stable_count, 
-           (double)k_stable_count / result_count * 100);
-    printf("Average agents preferring others: %.2f\n", 
-           (double)total_preferring_others / result_count);
-    printf("Min agents preferring others: %d\n", min_preferring);
-    printf("Max agents preferring others: %d\n", max_preferring);
+    for (int i = 0; i < num_affected; i++) {
+        worker->symmetric -= is_symmetric_pair(matching, affected[i]);
+    }
+    worker->preferring -= prefers_other_house(matching, instance, x) +
+                          prefers_other_house(matching, instance, y);
     
-    // Print detailed results for small instances
-    if (n <= 4) {
-        printf("\n=== DETAILED RESULTS ===\n");
-        for (int i = 0; i < result_count; i++) {
-            print_matching_analysis(&results[i], i);
-        }
+    int house_x = matching->pairs[x];
+    matching->pairs[x] = matching->pairs[y];
+    matching->pairs[y] = house_x;
+    worker->owner[matching->pairs[x]] = x;
+    worker->owner[matching->pairs[y]] = y;
+    
+    for (int i = 0; i < num_affected; i++) {
+        worker->symmetric += is_symmetric_pair(matching, affected[i]);
     }
+    worker->preferring += prefers_other_house(matching, instance, x) +
+                          prefers_other_house(matching, instance, y);
     
-    // Clean up
-    for (int i = 0; i < result_count; i++) {
-        destroy_matching(results[i].matching);
+    int swapped[2] = {x, y};
+    blocking_tracker_update(worker->tracker, matching, swapped, 2);
+}
+
+// Fold the current matching into the worker's totals. Its exact blocking
+// number also answers k-stability, which requires a feasible matching.
+static void record_matching(census_run_t* run, census_worker_t* worker, uint64_t index) {
+    int n = run->instance->num_agents;
+    int blocking = blocking_tracker_value(worker->tracker);
+    int preferring = worker->preferring;
+    bool stable = worker->symmetric == n && blocking < run->k;
+    
+    matching_census_t* census = &worker->census;
+    census->total++;
+    census->k_stable += stable;
+    census->preferring_sum += preferring;
+    census->blocking_histogram[blocking]++;
+    if (preferring < census->min_preferring) {
+        census->min_preferring = preferring;
+    }
+    if (preferring > census->max_preferring) {
+        census->max_preferring = preferring;
+    }
+    
+    // Each index belongs to one chunk, so sample slots are written by one worker
+    if (index < (uint64_t)run->sample_size) {
+        matching_analysis_t* analysis = &run->sample[index];
+        analysis->matching = copy_matching(worker->matching);
+        analysis->agents_preferring_others = preferring;
+        analysis->blocking_number = blocking;
+        analysis->is_k_stable = stable;
     }
-    free(results);
-    free(current_matching);
-    free(used_objects);
-    free(instance);
 }
 
-// Recursively generate all possible matchings
-static void generate_all_matchings_recursive(int n, int* current_matching, int agent_index, 
-                                           bool* used_objects, matching_analysis_t* results, 
-                                           int* result_count, const problem_instance_t* instance, int k) {
-    if (agent_index == n) {
-        // We have a complete matching
-        matching_t* matching = create_matching(n, HOUSE_ALLOCATION);
-        if (matching == NULL) {
-            return;
-        }
-        
-        // Set the matching
-        for (int i = 0; i < n; i++) {
-            matching->pairs[i] = current_matching[i];
-        }
-        
-        // Analyze this matching
-        results[*result_count].matching = matching;
-        results[*result_count].agents_preferring_others = 
-            count_agents_preferring_others(matching, instance);
-        results[*result_count].is_k_stable = 
-            is_matching_k_stable(matching, instance, k);
-        
-        (*result_count)++;
+static void merge_census(matching_census_t* total, const matching_census_t* part) {
+    if (part->total == 0) {
         return;
     }
-    
-    // Try each unused object for the current agent
-    for (int obj = 0; obj < n; obj++) {
-        if (!used_objects[obj]) {
-            current_matching[agent_index] = obj;
-            used_objects[obj] = true;
-            
-            generate_all_matchings_recursive(n, current_matching, agent_index + 1, 
-                                           used_objects, results, result_count, instance, k);
-            
-            used_objects[obj] = false;
-        }
+    total->total += part->total;
+    total->k_stable += part->k_stable;
+    total->preferring_sum += part->preferring_sum;
+    if (part->min_preferring < total->min_preferring) {
+        total->min_preferring = part->min_preferring;
+    }
+    if (part->max_preferring > total->max_preferring) {
+        total->max_preferring = part->max_preferring;
+    }
+    for (int b = 0; b <= MATCHING_CENSUS_MAX_N; b++) {
+        total->blocking_histogram[b] += part->blocking_histogram[b];
     }
 }
 
-// Count how many agents prefer other matchings over the current one
-static int count_agents_preferring_others(const matching_t* matching, const problem_instance_t* instance) {
-    int count = 0;
-    int n = instance->num_agents;
+static void print_matching_census(const matching_census_t* census, int n) {
+    long long total = census->total > 0 ? census->total : 1;
     
-    for (int agent = 0; agent < n; agent++) {
-        int current_object = matching->pairs[agent];
-        int current_rank = get_agent_rank(&instance->agents[agent], current_object);
-        
-        // Check if there's any other object this agent prefers more
-        bool prefers_other = false;
-        for (int pref_rank = 0; pref_rank < current_rank; pref_rank++) {
-            int preferred_object = instance->agents[agent].preferences[pref_rank];
-            // If the preferred object is assigned to someone else, this agent would prefer a different matching
-            if (preferred_object != current_object) {
-                prefers_other = true;
-                break;
-            }
-        }
-        
-        if (prefers_other) {
-            count++;
+    printf("=== SUMMARY STATISTICS ===\n");
+    printf("Total matchings: %lld\n", census->total);
+    printf("k-stable matchings: %lld (%.2f%%)\n", census->k_stable, 
+           (double)census->k_stable / total * 100);
+    printf("Average agents preferring others: %.2f\n", 
+           (double)census->preferring_sum / total);
+    printf("Min agents preferring others: %d\n", census->min_preferring);
+    printf("Max agents preferring others: %d\n", census->max_preferring);
+    
+    printf("\n=== BLOCKING NUMBER DISTRIBUTION ===\n");
+    printf("Blocking\tMatchings\tShare\n");
+    for (int b = 0; b <= n; b++) {
+        if (census->blocking_histogram[b] > 0) {
+            printf("%d\t\t%lld\t\t%.2f%%\n", b, census->blocking_histogram[b],
+                   (double)census->blocking_histogram[b] / total * 100);
         }
     }
-    
-    return count;
 }
 
-// Check if a matching is k-stable
-static bool is_matching_k_stable(const matching_t* matching, const problem_instance_t* instance, int k) {
-    return is_k_stable_direct(matching, instance, k);
+// Whether an agent ranks some house above its own (its list holds distinct
+// houses, so any house ranked higher is another one)
+static bool prefers_other_house(const matching_t* matching, const problem_instance_t* instance, int agent) {
+    return get_agent_rank(instance, agent, matching->pairs[agent]) > 0;
+}
+
+// is_valid_matching reads pairs as symmetric in every model: agent a passes
+// when pairs[pairs[a]] == a
+static bool is_symmetric_pair(const matching_t* matching, int agent) {
+    int partner = matching->pairs[agent];
+    return partner >= 0 && partner < matching->num_agents && matching->pairs[partner] == agent;
+}
+
+static int compare_sampled_matchings(const void* a, const void* b) {
+    const matching_t* left = ((const matching_analysis_t*)a)->matching;
+    const matching_t* right = ((const matching_analysis_t*)b)->matching;
+    for (int i = 0; i < left->num_agents; i++) {
+        if (left->pairs[i] != right->pairs[i]) {
+            return (left->pairs[i] < right->pairs[i]) ? -1 : 1;
+        }
+    }
+    return 0;
 }
 
 // Print analysis of a single matching
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../include/matching.h"
+
+// Ranked enumeration of permutations and preference profiles, so that an
+// index range can be split into independent chunks.
+//
+// Permutations of 0..n-1 are ranked in lexicographic order via the Lehmer code
+// (factorial number system). A preference profile gives every agent one
+// permutation of the n houses; its rank reads the agents' permutation ranks as
+// digits in base n!, agent 0 most significant.
+//
+// Relabeling agent i and house i together (a matching pairs agent i with
+// house i, so the two share a label) maps a profile to one with the same
+// k-stability answers. Each orbit of such relabelings is represented by its
+// member of smallest rank, so exhaustive studies search one profile per orbit
+// and weight it by the orbit size. The canonical iterator generates these
+// representatives agent by agent, dropping a list as soon as a relabeling of
+// the agents up to it makes the lists so far smaller, so the profiles it
+// visits grow with the number of orbits rather than with (n!)^n.
+
+// n! as a 64-bit count, or 0 if it does not fit
+uint64_t permutation_count(int n) {
+    if (n < 0 || n > 20) {
+        return 0;
+    }
+    uint64_t count = 1;
+    for (int i = 2; i <= n; i++) {
+        count *= (uint64_t)i;
+    }
+    return count;
+}
+
+// (n!)^n, or 0 if it does not fit in 64 bits (n > 6)
+uint64_t preference_profile_count(int n) {
+    uint64_t base = permutation_count(n);
+    if (base == 0) {
+        return 0;
+    }
+    uint64_t count = 1;
+    for (int a = 0; a < n; a++) {
+        if (count > UINT64_MAX / base) {
+            return 0;
+        }
+        count *= base;
+    }
+    return count;
+}
+
+// Write the permutation of 0..n-1 with the given lexicographic rank (< n!)
+void unrank_permutation(uint64_t rank, int n, int* perm) {
+    // Digits of the factorial number system, most significant first
+    for (int i = n - 1; i >= 0; i--) {
+        uint64_t radix = (uint64_t)(n - i);
+        perm[i] = (int)(rank % radix);
+        rank /= radix;
+    }
+
+    // Digit i picks among the values not used by positions 0..i-1
+    for (int i = n - 1; i >= 0; i--) {
+        for (int j = i + 1; j < n; j++) {
+            if (perm[j] >= perm[i]) {
+                perm[j]++;
+            }
+        }
+    }
+}
+
+// Lexicographic rank of a permutation of 0..n-1 (inverse of unrank_permutation)
+uint64_t rank_permutation(const int* perm, int n) {
+    uint64_t rank = 0;
+    for (int i = 0; i < n; i++) {
+        int smaller_after = 0;
+        for (int j = i + 1; j < n; j++) {
+            smaller_after += perm[j] < perm[i];
+        }
+        rank = rank * (uint64_t)(n - i) + (uint64_t)smaller_after;
+    }
+    return rank;
+}
+
+// Rank of a profile of n rows of n houses (inverse of unrank_preference_profile)
+uint64_t rank_preference_profile(const int* profile, int n) {
+    uint64_t base = permutation_count(n);
+    uint64_t rank = 0;
+    for (int a = 0; a < n; a++) {
+        rank = rank * base + rank_permutation(profile + (size_t)a * n, n);
+    }
+    return rank;
+}
+
+// Ranks [begin, end) of shard number shard (0-based) out of num_shards equal
+// slices of [0, count); the first count % num_shards shards take one extra
+void shard_range(uint64_t count, int shard, int num_shards, uint64_t* begin, uint64_t* end) {
+    if (num_shards <= 0 || shard < 0 || shard >= num_shards) {
+        *begin = *end = 0;
+        return;
+    }
+    uint64_t size = count / (uint64_t)num_shards;
+    uint64_t extra = count % (uint64_t)num_shards;
+    uint64_t index = (uint64_t)shard;
+    *begin = index * size + (index < extra ? index : extra);
+    *end = *begin + size + (index < extra ? 1 : 0);
+}
+
+// Position the iterator on profile begin; false if the range is empty or
+// n is outside 1..PROFILE_MAX_N
+bool profile_iterator_init(profile_iterator_t* iterator, int n, uint64_t begin, uint64_t end) {
+    uint64_t count = preference_profile_count(n);
+    if (n < 1 || n > PROFILE_MAX_N || end > count || begin >= end) {
+        return false;
+    }
+    iterator->n = n;
+    iterator->rank = begin;
+    iterator->end = end;
+    unrank_preference_profile(begin, n, iterator->profile);
+    return true;
+}
+
+// Step to the next profile; false once the range is exhausted
+bool profile_iterator_next(profile_iterator_t* iterator) {
+    if (iterator->rank + 1 >= iterator->end) {
+        return false;
+    }
+    iterator->rank++;
+    
+    // next_permutation on the last agent's list; when it wraps around to the
+    // sorted list, the previous agent advances
+    int n = iterator->n;
+    for (int a = n - 1; a >= 0; a--) {
+        int* row = iterator->profile + (size_t)a * n;
+        int pivot = n - 2;
+        while (pivot >= 0 && row[pivot] > row[pivot + 1]) {
+            pivot--;
+        }
+        if (pivot >= 0) {
+            int successor = n - 1;
+            while (row[successor] < row[pivot]) {
+                successor--;
+            }
+            int house = row[pivot];
+            row[pivot] = row[successor];
+            row[successor] = house;
+        }
+        for (int left = pivot + 1, right = n - 1; left < right; left++, right--) {
+            int house = row[left];
+            row[left] = row[right];
+            row[right] = house;
+        }
+        if (pivot >= 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+// Compare the first rows rows of the profile relabeled by relabel with those
+// of the profile itself (<0, 0 or >0, as profile ranks order them)
+static int relabeled_prefix_order(const int* profile, int n, const int* relabel, int rows) {
+    int inverse[PROFILE_MAX_N];
+    for (int i = 0; i < n; i++) {
+        inverse[relabel[i]] = i;
+    }
+    
+    // Row y of the relabeled profile is agent inverse[y]'s list with every
+    // house relabeled; profile ranks order rows lexicographically
+    for (int y = 0; y < rows; y++) {
+        const int* row = profile + (size_t)inverse[y] * n;
+        for (int i = 0; i < n; i++) {
+            int order = relabel[row[i]] - profile[(size_t)y * n + i];
+            if (order != 0) {
+                return order;
+            }
+        }
+    }
+    return 0;
+}
+
+// Orbit size of a profile under relabelings if it is its orbit's
+// representative (the smallest rank), else 0. Also 0 for n outside 1..6.
+uint64_t canonical_profile_orbit_size(const int* profile, int n) {
+    if (n < 1 || n > PROFILE_MAX_N) {
+        return 0;
+    }
+    
+    int relabel[PROFILE_MAX_N];
+    uint64_t count = permutation_count(n);
+    uint64_t stabilizer = 0;
+    for (uint64_t r = 0; r < count; r++) {
+        unrank_permutation(r, n, relabel);
+        int order = relabeled_prefix_order(profile, n, relabel, n);
+        if (order < 0) {
+            return 0;
+        }
+        if (order == 0) {
+            stabilizer++;
+        }
+    }
+    return count / stabilizer;
+}
+
+// Whether the first rows agents' lists can begin an orbit representative.
+// Relabelings that map labels 0..rows-1 among themselves rearrange only those
+// rows, so one that makes them smaller rules out every completion.
+static bool canonical_profile_prefix(const int* profile, int n, int rows) {
+    int low[PROFILE_MAX_N];
+    int high[PROFILE_MAX_N];
+    int relabel[PROFILE_MAX_N];
+    uint64_t low_count = permutation_count(rows);
+    uint64_t high_count = permutation_count(n - rows);
+    
+    for (uint64_t r = 0; r < low_count; r++) {
+        unrank_permutation(r, rows, low);
+        for (uint64_t s = 0; s < high_count; s++) {
+            unrank_permutation(s, n - rows, high);
+            for (int i = 0; i < rows; i++) {
+                relabel[i] = low[i];
+            }
+            for (int i = rows; i < n; i++) {
+                relabel[i] = rows + high[i - rows];
+            }
+            if (relabeled_prefix_order(profile, n, relabel, rows) < 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Move the iterator forward, from its current profile, to the first orbit
+// representative; false if none is left in the range. A prefix that cannot
+// begin a representative is skipped whole by carrying past its last completion.
+static bool canonical_profile_iterator_seek(profile_iterator_t* iterator) {
+    int n = iterator->n;
+    for (;;) {
+        int rows = 1;
+        while (rows < n && canonical_profile_prefix(iterator->profile, n, rows)) {
+            rows++;
+        }
+        
+        if (rows == n) {
+            iterator->orbit_size = canonical_profile_orbit_size(iterator->profile, n);
+            if (iterator->orbit_size > 0) {
+                return true;
+            }
+        } else {
+            // Last completion of the prefix: the later agents' lists descending
+            for (int a = rows; a < n; a++) {
+                for (int i = 0; i < n; i++) {
+                    iterator->profile[(size_t)a * n + i] = n - 1 - i;
+                }
+            }
+            iterator->rank = rank_preference_profile(iterator->profile, n);
+            if (iterator->rank >= iterator->end) {
+                return false;
+            }
+        }
+        if (!profile_iterator_next(iterator)) {
+            return false;
+        }
+    }
+}
+
+// Position the iterator on the first orbit representative of rank in
+// [begin, end), with its orbit size in orbit_size; false if there is none
+bool canonical_profile_iterator_init(profile_iterator_t* iterator, int n, uint64_t begin, uint64_t end) {
+    return profile_iterator_init(iterator, n, begin, end) && canonical_profile_iterator_seek(iterator);
+}
+
+// Step to the next orbit representative; false once the range is exhausted
+bool canonical_profile_iterator_next(profile_iterator_t* iterator) {
+    return profile_iterator_next(iterator) && canonical_profile_iterator_seek(iterator);
+}
+
+// Write the profile with the given rank (< (n!)^n) as n rows of n houses
+void unrank_preference_profile(uint64_t rank, int n, int* profile) {
+    uint64_t base = permutation_count(n);
+    for (int a = n - 1; a >= 0; a--) {
+        unrank_permutation(rank % base, n, profile + (size_t)a * n);
+        rank /= base;
+    }
+}
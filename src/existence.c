@@ -1,30 +1,109 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 #include "../include/matching.h"
 
+// Search statistics: SEARCH_STAT(stats, field++) updates a counter when the
+// caller asked for stats, and expands to nothing when they are compiled out.
+#ifdef MATCHING_SEARCH_STATS
+#define SEARCH_STAT(stats, update) do { if ((stats) != NULL) { (stats)->update; } } while (0)
+#else
+#define SEARCH_STAT(stats, update) ((void)0)
+#endif
+
+// Aggregates behind the enhanced search's pruning tests, kept up to date as
+// pairs are assigned and unassigned instead of being recounted at every node.
+// Each matched agent's contribution depends only on its own partner, except
+// for the "a top-2 choice is still unmatched" flag, which is refreshed for the
+// agents watching a choice whenever that choice's matched status changes.
+typedef struct {
+    bitset_t matched;              // pairs[i] != -1
+    bitset_t half_dissatisfied;    // matched, partner ranked in the bottom half (prefix counts)
+    unsigned char* flags;          // per-agent TALLY_* contributions
+    int* watcher_offsets;          // agents listing each agent among their top 2 choices (CSR)
+    int* watchers;
+    int unmatched;
+    int dissatisfied;              // matched, partner outside the top 3
+    int poor_matches;              // matched, partner in the bottom fifth
+    int mutual_dissatisfaction;    // matched, both sides in their bottom half
+    int better_unmatched;          // matched, a top-2 choice is still unmatched
+} search_tally_t;
+
+#define TALLY_DISSATISFIED      0x1
+#define TALLY_POOR_MATCH        0x2
+#define TALLY_MUTUAL            0x4
+#define TALLY_BETTER_UNMATCHED  0x8
+
+// Scratch shared by one search: the arena holds per-node partner buffers, the
+// trail undoes assignments on backtracking, and the verifier context checks leaves.
+// hash is the Zobrist hash of the current partial matching, kept up to date with
+// the trail, under which subtree results go to the transposition table.
+typedef struct {
+    matching_arena_t arena;
+    verifier_context_t verifier;
+    matching_trail_t trail;
+    search_tally_t tally;
+    search_stats_t* stats;         // NULL unless the caller wants statistics
+    uint64_t hash;
+    uint64_t table_salt;           // This search's salt for transposition table keys
+} search_scratch_t;
+
+// Nodes with fewer agents left to assign are searched without a table probe
+#define TABLE_MIN_REMAINING 2
+
 // Forward declarations
+static bool search_scratch_init(search_scratch_t* scratch, const problem_instance_t* instance);
+static void search_scratch_destroy(search_scratch_t* scratch);
+static size_t search_tally_bytes(const problem_instance_t* instance);
+static bool search_tally_init(search_tally_t* tally, const problem_instance_t* instance, matching_arena_t* arena);
+static void search_tally_assign(search_tally_t* tally, const problem_instance_t* instance,
+                                const matching_t* matching, int agent, int partner);
+static void search_tally_unassign(search_tally_t* tally, const problem_instance_t* instance,
+                                  const matching_t* matching, int agent, int partner);
 static bool find_k_stable_matching_recursive(const problem_instance_t* instance, int k, 
-                                           matching_t* current_matching, int agent_index);
+                                           matching_t* current_matching, int agent_index,
+                                           search_scratch_t* scratch);
 static bool find_k_stable_matching_recursive_enhanced(const problem_instance_t* instance, int k, 
-                                                    matching_t* current_matching, int agent_index);
+                                                    matching_t* current_matching, int agent_index,
+                                                    search_scratch_t* scratch);
 static bool is_partial_matching_valid(const matching_t* matching, const problem_instance_t* instance, 
                                     int up_to_agent);
 // Removed unused function declaration
-static bool find_k_stable_with_pruning(const problem_instance_t* instance, int k);
+static bool find_k_stable_with_pruning(const problem_instance_t* instance, int k, search_stats_t* stats);
+static bool exists_small_k(const problem_instance_t* instance, int k, search_stats_t* stats);
+static bool exists_large_k(const problem_instance_t* instance, int k, search_stats_t* stats);
+static bool verify_leaf(const matching_t* matching, const problem_instance_t* instance, int k,
+                        verifier_context_t* verifier, search_stats_t* stats);
+static void enter_search_node(search_stats_t* stats, int depth);
+static bool table_lookup(search_scratch_t* scratch, const problem_instance_t* instance,
+                         int agent_index, uint64_t* value);
+static void table_store(const search_scratch_t* scratch, const problem_instance_t* instance,
+                        int agent_index, uint64_t value);
 static bool is_promising_partial_matching(const matching_t* partial_matching, const problem_instance_t* instance, 
                                         int k, int agents_processed);
-static bool is_promising_partial_matching_enhanced(const matching_t* partial_matching, const problem_instance_t* instance, 
+static bool is_promising_partial_matching_enhanced(const search_tally_t* tally, const problem_instance_t* instance, 
                                                  int k, int agents_processed);
 static int estimate_blocking_potential(const matching_t* matching, const problem_instance_t* instance, int k);
-static int estimate_blocking_potential_enhanced(const matching_t* matching, const problem_instance_t* instance, int k);
-static bool has_conflict_early_detection(const matching_t* partial_matching, const problem_instance_t* instance, int k);
+static int estimate_blocking_potential_enhanced(const search_tally_t* tally);
+static bool has_conflict_early_detection(const search_tally_t* tally, int k);
 static int score_matching_quality(const matching_t* matching, const problem_instance_t* instance, int k);
-static bool can_reach_k_stable(const matching_t* partial_matching, const problem_instance_t* instance, int k, int agents_processed);
+static bool can_reach_k_stable(const search_tally_t* tally, const problem_instance_t* instance,
+                               int k, int agents_processed);
+static bool agent_set_init(bitset_t* set, int num_agents);
 
 // Check if a k-stable matching exists (main function)
 bool k_stable_matching_exists(const problem_instance_t* instance, int k) {
+    return k_stable_matching_exists_with_stats(instance, k, NULL);
+}
+
+// As k_stable_matching_exists, filling stats (if not NULL) for this call
+bool k_stable_matching_exists_with_stats(const problem_instance_t* instance, int k, search_stats_t* stats) {
+    search_stats_reset(stats);
     if (instance == NULL || k <= 0 || k > instance->num_agents) {
         return false;
     }
@@ -35,41 +114,426 @@ bool k_stable_matching_exists(const problem_instance_t* instance, int k) {
     // Use different algorithms based on k/n ratio for efficiency
     if (k_ratio <= 0.1) {
         // For very small k, use specialized small-k algorithm
-        return k_stable_matching_exists_small_k(instance, k);
+        return exists_small_k(instance, k, stats);
     } else if (k_ratio >= 0.8) {
         // For large k, use specialized large-k algorithm
-        return k_stable_matching_exists_large_k(instance, k);
+        return exists_large_k(instance, k, stats);
     } else {
         // For medium k, use improved algorithm with pruning
-        return find_k_stable_with_pruning(instance, k);
+        return find_k_stable_with_pruning(instance, k, stats);
+    }
+}
+
+void search_stats_reset(search_stats_t* stats) {
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+// Verify a complete matching (with the search's verifier context, or with
+// is_k_stable_direct if verifier is NULL), charging a verified leaf and its time to stats
+static bool verify_leaf(const matching_t* matching, const problem_instance_t* instance, int k,
+                        verifier_context_t* verifier, search_stats_t* stats) {
+#ifdef MATCHING_SEARCH_STATS
+    if (stats != NULL) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        bool stable = (verifier != NULL) ? verifier_is_k_stable(verifier, matching, k) :
+                                           is_k_stable_direct(matching, instance, k);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        stats->leaves_verified++;
+        stats->verify_ms += (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+                            (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+        return stable;
+    }
+#else
+    (void)stats;
+#endif
+    return (verifier != NULL) ? verifier_is_k_stable(verifier, matching, k) :
+                                is_k_stable_direct(matching, instance, k);
+}
+
+// Count a search node at the given depth
+static void enter_search_node(search_stats_t* stats, int depth) {
+#ifdef MATCHING_SEARCH_STATS
+    if (stats != NULL) {
+        stats->nodes_expanded++;
+        if (depth > stats->max_depth) {
+            stats->max_depth = depth;
+        }
+    }
+#else
+    (void)stats;
+    (void)depth;
+#endif
+}
+
+// Look the node at agent_index up in the transposition table, counting the
+// probe in stats. Nodes near the leaves are not probed.
+static bool table_lookup(search_scratch_t* scratch, const problem_instance_t* instance,
+                         int agent_index, uint64_t* value) {
+    if (agent_index + TABLE_MIN_REMAINING > instance->num_agents) {
+        return false;
+    }
+    uint64_t key = scratch->hash ^ scratch->table_salt ^ zobrist_depth_key(agent_index);
+    if (transposition_table_probe(key, value)) {
+        SEARCH_STAT(scratch->stats, table_hits++);
+        return true;
+    }
+    SEARCH_STAT(scratch->stats, table_misses++);
+    return false;
+}
+
+// Record the result of the fully searched subtree at agent_index
+static void table_store(const search_scratch_t* scratch, const problem_instance_t* instance,
+                        int agent_index, uint64_t value) {
+    if (agent_index + TABLE_MIN_REMAINING > instance->num_agents) {
+        return;
+    }
+    transposition_table_store(scratch->hash ^ scratch->table_salt ^ zobrist_depth_key(agent_index), value);
+}
+
+// Allocate the scratch for one search over instance
+static bool search_scratch_init(search_scratch_t* scratch, const problem_instance_t* instance) {
+    int n = instance->num_agents;
+    size_t total_preferences = instance->pref_offsets[n];
+    
+    // Each agent level holds at most a partner list and a score list. Every
+    // pairs entry is written at most once on a root-to-leaf path (only while
+    // unmatched), so the trail never holds more than n assignments.
+    size_t bytes = 2 * total_preferences * sizeof(int) +
+                   (size_t)n * 2 * MATCHING_ARENA_ALIGNMENT +
+                   matching_trail_bytes(n) +
+                   search_tally_bytes(instance);
+    if (!matching_arena_init(&scratch->arena, bytes)) {
+        return false;
+    }
+    if (!verifier_context_init(&scratch->verifier, instance)) {
+        matching_arena_destroy(&scratch->arena);
+        return false;
     }
+    if (!matching_trail_init(&scratch->trail, n, &scratch->arena) ||
+        !search_tally_init(&scratch->tally, instance, &scratch->arena)) {
+        search_scratch_destroy(scratch);
+        return false;
+    }
+    scratch->stats = NULL;
+    scratch->hash = 0;
+    scratch->table_salt = transposition_table_salt();
+    return true;
+}
+
+static void search_scratch_destroy(search_scratch_t* scratch) {
+    verifier_context_destroy(&scratch->verifier);
+    matching_arena_destroy(&scratch->arena);
+}
+
+// Arena bytes taken by a search tally
+static size_t search_tally_bytes(const problem_instance_t* instance) {
+    int n = instance->num_agents;
+    return 2 * matching_arena_bytes(bitset_bytes(n > 0 ? n : 1)) +
+           matching_arena_bytes((size_t)n) +
+           matching_arena_bytes((size_t)(n + 1) * sizeof(int)) +
+           matching_arena_bytes((size_t)2 * n * sizeof(int));
+}
+
+// Empty tally (every agent unmatched) plus the top-2 watcher lists
+static bool search_tally_init(search_tally_t* tally, const problem_instance_t* instance, matching_arena_t* arena) {
+    int n = instance->num_agents;
+    size_t mark = matching_arena_mark(arena);
+    tally->flags = matching_arena_alloc(arena, (size_t)n);
+    tally->watcher_offsets = matching_arena_alloc(arena, (size_t)(n + 1) * sizeof(int));
+    tally->watchers = matching_arena_alloc(arena, (size_t)2 * n * sizeof(int));
+    if (!bitset_init_in_arena(&tally->matched, n, arena) ||
+        !bitset_init_in_arena(&tally->half_dissatisfied, n, arena) ||
+        tally->flags == NULL || tally->watcher_offsets == NULL || tally->watchers == NULL) {
+        matching_arena_release(arena, mark);
+        return false;
+    }
+    
+    // Bucket every agent under the (in-range) targets of its first two preferences
+    memset(tally->watcher_offsets, 0, (size_t)(n + 1) * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        const int* preferences = instance_preferences(instance, i);
+        for (int pref_idx = 0; pref_idx < 2 && pref_idx < instance_num_preferences(instance, i); pref_idx++) {
+            if (preferences[pref_idx] < n) {
+                tally->watcher_offsets[preferences[pref_idx] + 1]++;
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        tally->watcher_offsets[i + 1] += tally->watcher_offsets[i];
+    }
+    int* fill = tally->watchers;
+    for (int i = 0; i < n; i++) {
+        const int* preferences = instance_preferences(instance, i);
+        for (int pref_idx = 0; pref_idx < 2 && pref_idx < instance_num_preferences(instance, i); pref_idx++) {
+            int target = preferences[pref_idx];
+            if (target < n) {
+                // Offsets advance to the end of each bucket while filling
+                fill[tally->watcher_offsets[target]++] = i;
+            }
+        }
+    }
+    for (int i = n; i > 0; i--) {
+        tally->watcher_offsets[i] = tally->watcher_offsets[i - 1];
+    }
+    tally->watcher_offsets[0] = 0;
+    
+    memset(tally->flags, 0, (size_t)n);
+    tally->unmatched = n;
+    tally->dissatisfied = 0;
+    tally->poor_matches = 0;
+    tally->mutual_dissatisfaction = 0;
+    tally->better_unmatched = 0;
+    return true;
+}
+
+// Add or remove an agent's flagged contributions to the counters
+static void search_tally_apply(search_tally_t* tally, int agent, unsigned char flags, int sign) {
+    tally->dissatisfied += sign * ((flags & TALLY_DISSATISFIED) != 0);
+    tally->poor_matches += sign * ((flags & TALLY_POOR_MATCH) != 0);
+    tally->mutual_dissatisfaction += sign * ((flags & TALLY_MUTUAL) != 0);
+    tally->better_unmatched += sign * ((flags & TALLY_BETTER_UNMATCHED) != 0);
+    if (sign > 0) {
+        tally->flags[agent] = flags;
+    } else {
+        tally->flags[agent] = 0;
+    }
+}
+
+// Whether a matched agent has one of its first two choices (other than its
+// partner) still unmatched
+static bool has_unmatched_top_choice(const search_tally_t* tally, const problem_instance_t* instance,
+                                     const matching_t* matching, int agent) {
+    const int* preferences = instance_preferences(instance, agent);
+    for (int pref_idx = 0; pref_idx < 2 && pref_idx < instance_num_preferences(instance, agent); pref_idx++) {
+        int preferred = preferences[pref_idx];
+        if (preferred != matching->pairs[agent] && preferred < instance->num_agents &&
+            !bitset_test(&tally->matched, preferred)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Refresh the top-2 flag of the matched agents watching target
+static void search_tally_refresh_watchers(search_tally_t* tally, const problem_instance_t* instance,
+                                          const matching_t* matching, int target) {
+    for (int w = tally->watcher_offsets[target]; w < tally->watcher_offsets[target + 1]; w++) {
+        int watcher = tally->watchers[w];
+        if (!bitset_test(&tally->matched, watcher)) {
+            continue;
+        }
+        
+        bool before = (tally->flags[watcher] & TALLY_BETTER_UNMATCHED) != 0;
+        bool after = has_unmatched_top_choice(tally, instance, matching, watcher);
+        if (before != after) {
+            tally->flags[watcher] ^= TALLY_BETTER_UNMATCHED;
+            tally->better_unmatched += after ? 1 : -1;
+        }
+    }
+}
+
+// Contributions of a matched agent given its current partner
+static unsigned char search_tally_flags(const search_tally_t* tally, const problem_instance_t* instance,
+                                        const matching_t* matching, int agent) {
+    int partner = matching->pairs[agent];
+    int length = instance_num_preferences(instance, agent);
+    int rank = get_agent_rank(instance, agent, partner);
+    unsigned char flags = 0;
+    
+    if (rank > 2) {
+        flags |= TALLY_DISSATISFIED;
+    }
+    if (rank > length * 0.8) {
+        flags |= TALLY_POOR_MATCH;
+    }
+    if (rank > length / 2 &&
+        get_agent_rank(instance, partner, agent) > instance_num_preferences(instance, partner) / 2) {
+        flags |= TALLY_MUTUAL;
+    }
+    if (has_unmatched_top_choice(tally, instance, matching, agent)) {
+        flags |= TALLY_BETTER_UNMATCHED;
+    }
+    return flags;
+}
+
+// Record that agent and partner (both unmatched until now) were just paired
+static void search_tally_assign(search_tally_t* tally, const problem_instance_t* instance,
+                                const matching_t* matching, int agent, int partner) {
+    int ends[2] = {agent, partner};
+    bitset_set(&tally->matched, agent);
+    bitset_set(&tally->matched, partner);
+    tally->unmatched -= 2;
+    
+    for (int e = 0; e < 2; e++) {
+        int x = ends[e];
+        search_tally_apply(tally, x, search_tally_flags(tally, instance, matching, x), 1);
+        if (get_agent_rank(instance, x, matching->pairs[x]) > instance_num_preferences(instance, x) / 2) {
+            bitset_set(&tally->half_dissatisfied, x);
+        }
+    }
+    for (int e = 0; e < 2; e++) {
+        search_tally_refresh_watchers(tally, instance, matching, ends[e]);
+    }
+}
+
+// Record that agent and partner are about to be unpaired again
+static void search_tally_unassign(search_tally_t* tally, const problem_instance_t* instance,
+                                  const matching_t* matching, int agent, int partner) {
+    int ends[2] = {agent, partner};
+    for (int e = 0; e < 2; e++) {
+        int x = ends[e];
+        search_tally_apply(tally, x, tally->flags[x], -1);
+        bitset_clear(&tally->half_dissatisfied, x);
+        bitset_clear(&tally->matched, x);
+    }
+    tally->unmatched += 2;
+    
+    for (int e = 0; e < 2; e++) {
+        search_tally_refresh_watchers(tally, instance, matching, ends[e]);
+    }
+}
+
+// Whether the tally agrees with a recount of every aggregate from the matching
+static bool search_tally_matches_matching(const search_tally_t* tally, const problem_instance_t* instance,
+                                          const matching_t* matching) {
+    int n = instance->num_agents;
+    int unmatched = 0, dissatisfied = 0, poor_matches = 0, mutual = 0, better_unmatched = 0;
+    for (int x = 0; x < n; x++) {
+        int partner = matching->pairs[x];
+        if (bitset_test(&tally->matched, x) != (partner != -1)) {
+            return false;
+        }
+        if (partner == -1) {
+            if (bitset_test(&tally->half_dissatisfied, x) || tally->flags[x] != 0) {
+                return false;
+            }
+            unmatched++;
+            continue;
+        }
+        
+        int length = instance_num_preferences(instance, x);
+        int rank = get_agent_rank(instance, x, partner);
+        if (bitset_test(&tally->half_dissatisfied, x) != (rank > length / 2)) {
+            return false;
+        }
+        dissatisfied += rank > 2;
+        poor_matches += rank > length * 0.8;
+        mutual += rank > length / 2 &&
+                  get_agent_rank(instance, partner, x) > instance_num_preferences(instance, partner) / 2;
+        const int* preferences = instance_preferences(instance, x);
+        for (int pref_idx = 0; pref_idx < 2 && pref_idx < length; pref_idx++) {
+            int preferred = preferences[pref_idx];
+            if (preferred != partner && preferred < n && matching->pairs[preferred] == -1) {
+                better_unmatched++;
+                break;
+            }
+        }
+    }
+    return tally->unmatched == unmatched && tally->dissatisfied == dissatisfied &&
+           tally->poor_matches == poor_matches && tally->mutual_dissatisfaction == mutual &&
+           tally->better_unmatched == better_unmatched;
+}
+
+int search_tally_replay(const problem_instance_t* instance, const int (*steps)[2], int num_steps) {
+    if (instance == NULL || steps == NULL || num_steps < 0) {
+        return -1;
+    }
+    int n = instance->num_agents;
+    matching_t* matching = create_matching(n, instance->model);
+    int* paired = malloc((size_t)(n > 0 ? n : 1) * sizeof(int));   // Agent of each live pairing
+    search_scratch_t scratch;
+    if (matching == NULL || paired == NULL || !search_scratch_init(&scratch, instance)) {
+        destroy_matching(matching);
+        free(paired);
+        return -1;
+    }
+    
+    int depth = 0;
+    int result = num_steps;
+    for (int s = 0; s < num_steps && result == num_steps; s++) {
+        int agent = steps[s][0];
+        int partner = steps[s][1];
+        if (agent < 0) {
+            if (depth == 0) {
+                result = -1;
+                break;
+            }
+            // Unpair as the search backtracks: tally first, then the matching
+            agent = paired[--depth];
+            partner = matching->pairs[agent];
+            search_tally_unassign(&scratch.tally, instance, matching, agent, partner);
+            matching->pairs[agent] = -1;
+            matching->pairs[partner] = -1;
+        } else {
+            if (agent >= n || partner < 0 || partner >= n || agent == partner ||
+                matching->pairs[agent] != -1 || matching->pairs[partner] != -1) {
+                result = -1;
+                break;
+            }
+            matching->pairs[agent] = partner;
+            matching->pairs[partner] = agent;
+            search_tally_assign(&scratch.tally, instance, matching, agent, partner);
+            paired[depth++] = agent;
+        }
+        if (!search_tally_matches_matching(&scratch.tally, instance, matching)) {
+            result = s;
+        }
+    }
+    
+    search_scratch_destroy(&scratch);
+    free(paired);
+    destroy_matching(matching);
+    return result;
+}
+
+// Empty heap-allocated set over the agents (words freed by the caller)
+static bool agent_set_init(bitset_t* set, int num_agents) {
+    uint64_t* words = malloc(bitset_bytes(num_agents > 0 ? num_agents : 1));
+    if (words == NULL) {
+        return false;
+    }
+    bitset_attach(set, words, num_agents);
+    return true;
 }
 
 // Enhanced algorithm with advanced pruning for medium k values
-static bool find_k_stable_with_pruning(const problem_instance_t* instance, int k) {
+static bool find_k_stable_with_pruning(const problem_instance_t* instance, int k, search_stats_t* stats) {
     matching_t* matching = create_matching(instance->num_agents, instance->model);
     if (matching == NULL) {
         return false;
     }
     
+    // Scratch for the whole search, so nodes and leaves never touch the heap
+    search_scratch_t scratch;
+    if (!search_scratch_init(&scratch, instance)) {
+        destroy_matching(matching);
+        return false;
+    }
+    scratch.stats = stats;
+    
     // Initialize all agents as unmatched
     for (int i = 0; i < instance->num_agents; i++) {
         matching->pairs[i] = -1;
     }
     
     // Use enhanced recursive search with advanced pruning strategies
-    bool exists = find_k_stable_matching_recursive_enhanced(instance, k, matching, 0);
+    bool exists = find_k_stable_matching_recursive_enhanced(instance, k, matching, 0, &scratch);
     
+    search_scratch_destroy(&scratch);
     destroy_matching(matching);
     return exists;
 }
 
 // Find a k-stable matching using recursive backtracking with improved pruning
 static bool find_k_stable_matching_recursive(const problem_instance_t* instance, int k, 
-                                           matching_t* current_matching, int agent_index) {
+                                           matching_t* current_matching, int agent_index,
+                                           search_scratch_t* scratch) {
     // Base case: if we've assigned all agents, check if the matching is k-stable
     if (agent_index >= instance->num_agents) {
-        return is_k_stable_direct(current_matching, instance, k);
+        return verifier_is_k_stable(&scratch->verifier, current_matching, k);
     }
     
     // Early pruning: check if partial matching is promising
@@ -79,19 +543,31 @@ static bool find_k_stable_matching_recursive(const problem_instance_t* instance,
     
     // If current agent is already matched, move to next agent
     if (current_matching->pairs[agent_index] != -1) {
-        return find_k_stable_matching_recursive(instance, k, current_matching, agent_index + 1);
+        return find_k_stable_matching_recursive(instance, k, current_matching, agent_index + 1, scratch);
+    }
+    
+    // This partial matching was reached before and has no k-stable completion
+    uint64_t cached;
+    if (table_lookup(scratch, instance, agent_index, &cached)) {
+        return false;
     }
     
     // Get ordered list of potential partners (preference-based ordering)
-    int potential_partners[MAX_AGENTS];
+    const int* preferences = instance_preferences(instance, agent_index);
+    int num_preferences = instance_num_preferences(instance, agent_index);
+    size_t mark = matching_arena_mark(&scratch->arena);
+    int* potential_partners = matching_arena_alloc(&scratch->arena, num_preferences * sizeof(int));
+    if (potential_partners == NULL) {
+        return false;
+    }
     int num_potential = 0;
     
     // Add partners in preference order
-    for (int pref_idx = 0; pref_idx < instance->agents[agent_index].num_preferences; pref_idx++) {
-        int partner = instance->agents[agent_index].preferences[pref_idx];
+    for (int pref_idx = 0; pref_idx < num_preferences; pref_idx++) {
+        int partner = preferences[pref_idx];
         
-        // Skip if trying to match with self
-        if (partner == agent_index) {
+        // Skip if trying to match with self, or with an object outside the agent range (k-hai)
+        if (partner == agent_index || partner >= instance->num_agents) {
             continue;
         }
         
@@ -117,69 +593,93 @@ static bool find_k_stable_matching_recursive(const problem_instance_t* instance,
         int partner = potential_partners[i];
         
         // Try this matching
-        current_matching->pairs[agent_index] = partner;
-        current_matching->pairs[partner] = agent_index;
+        int trail_mark = matching_trail_mark(&scratch->trail);
+        matching_trail_set(current_matching, &scratch->trail, agent_index, partner);
+        matching_trail_set(current_matching, &scratch->trail, partner, agent_index);
+        scratch->hash ^= zobrist_pair_key(agent_index, partner);
         
         // Check if this partial matching is valid and promising
         if (is_partial_matching_valid(current_matching, instance, agent_index)) {
             // Recursively try to complete the matching
-            if (find_k_stable_matching_recursive(instance, k, current_matching, agent_index + 1)) {
+            if (find_k_stable_matching_recursive(instance, k, current_matching, agent_index + 1, scratch)) {
+                matching_arena_release(&scratch->arena, mark);
                 return true;
             }
         }
         
         // Backtrack: undo this matching
-        current_matching->pairs[agent_index] = -1;
-        current_matching->pairs[partner] = -1;
+        matching_trail_undo(current_matching, &scratch->trail, trail_mark);
+        scratch->hash ^= zobrist_pair_key(agent_index, partner);
     }
+    matching_arena_release(&scratch->arena, mark);
     
-    // Also try leaving the current agent unmatched (if allowed by the model)
-    if (instance->model == HOUSE_ALLOCATION || instance->model == ROOMMATES) {
-        return find_k_stable_matching_recursive(instance, k, current_matching, agent_index + 1);
+    // Also try leaving the current agent unmatched (every model allows it;
+    // marriage sides may differ in size)
+    if (find_k_stable_matching_recursive(instance, k, current_matching, agent_index + 1, scratch)) {
+        return true;
     }
     
+    table_store(scratch, instance, agent_index, 0);
     return false;
 }
 
 // Enhanced recursive function with advanced pruning strategies
 static bool find_k_stable_matching_recursive_enhanced(const problem_instance_t* instance, int k, 
-                                                    matching_t* current_matching, int agent_index) {
+                                                    matching_t* current_matching, int agent_index,
+                                                    search_scratch_t* scratch) {
+    enter_search_node(scratch->stats, agent_index);
+    
     // Base case: if we've assigned all agents, check if the matching is k-stable
     if (agent_index >= instance->num_agents) {
-        return is_k_stable_direct(current_matching, instance, k);
+        return verify_leaf(current_matching, instance, k, &scratch->verifier, scratch->stats);
     }
     
     // Enhanced early pruning: multiple pruning strategies
-    if (!is_promising_partial_matching_enhanced(current_matching, instance, k, agent_index)) {
+    if (!is_promising_partial_matching_enhanced(&scratch->tally, instance, k, agent_index)) {
+        SEARCH_STAT(scratch->stats, prunes_promising++);
         return false;
     }
     
     // Early conflict detection
-    if (has_conflict_early_detection(current_matching, instance, k)) {
+    if (has_conflict_early_detection(&scratch->tally, k)) {
+        SEARCH_STAT(scratch->stats, prunes_conflict++);
         return false;
     }
     
     // If current agent is already matched, move to next agent
     if (current_matching->pairs[agent_index] != -1) {
-        return find_k_stable_matching_recursive_enhanced(instance, k, current_matching, agent_index + 1);
+        return find_k_stable_matching_recursive_enhanced(instance, k, current_matching, agent_index + 1, scratch);
+    }
+    
+    // This partial matching was reached before and has no k-stable completion
+    uint64_t cached;
+    if (table_lookup(scratch, instance, agent_index, &cached)) {
+        return false;
     }
     
     // Get ordered list of potential partners with enhanced scoring
-    int potential_partners[MAX_AGENTS];
-    int partner_scores[MAX_AGENTS];
+    const int* preferences = instance_preferences(instance, agent_index);
+    int num_preferences = instance_num_preferences(instance, agent_index);
+    size_t mark = matching_arena_mark(&scratch->arena);
+    int* potential_partners = matching_arena_alloc(&scratch->arena, num_preferences * sizeof(int));
+    int* partner_scores = matching_arena_alloc(&scratch->arena, num_preferences * sizeof(int));
+    if (potential_partners == NULL || partner_scores == NULL) {
+        matching_arena_release(&scratch->arena, mark);
+        return false;
+    }
     int num_potential = 0;
     
     // Score and order potential partners by quality
-    for (int pref_idx = 0; pref_idx < instance->agents[agent_index].num_preferences; pref_idx++) {
-        int partner = instance->agents[agent_index].preferences[pref_idx];
+    for (int pref_idx = 0; pref_idx < num_preferences; pref_idx++) {
+        int partner = preferences[pref_idx];
         
-        // Skip if trying to match with self
-        if (partner == agent_index) {
+        // Skip if trying to match with self, or with an object outside the agent range (k-hai)
+        if (partner == agent_index || partner >= instance->num_agents) {
             continue;
         }
         
         // Skip if partner is already matched
-        if (current_matching->pairs[partner] != -1) {
+        if (bitset_test(&scratch->tally.matched, partner)) {
             continue;
         }
         
@@ -196,16 +696,16 @@ static bool find_k_stable_matching_recursive_enhanced(const problem_instance_t*
         int score = 0;
         
         // Mutual preference score
-        int reverse_rank = get_agent_rank(&instance->agents[partner], agent_index);
+        int reverse_rank = get_agent_rank(instance, partner, agent_index);
         if (reverse_rank != -1) {
-            score += (instance->agents[partner].num_preferences - reverse_rank) * 10;
+            score += (instance_num_preferences(instance, partner) - reverse_rank) * 10;
         }
         
         // Preference rank score (lower rank = higher score)
-        score += (instance->agents[agent_index].num_preferences - pref_idx) * 5;
+        score += (num_preferences - pref_idx) * 5;
         
         // Stability potential score
-        if (reverse_rank != -1 && reverse_rank < instance->agents[partner].num_preferences / 2) {
+        if (reverse_rank != -1 && reverse_rank < instance_num_preferences(instance, partner) / 2) {
             score += 20; // Bonus for mutual high preference
         }
         
@@ -233,30 +733,41 @@ static bool find_k_stable_matching_recursive_enhanced(const problem_instance_t*
         int partner = potential_partners[i];
         
         // Try this matching
-        current_matching->pairs[agent_index] = partner;
-        current_matching->pairs[partner] = agent_index;
+        int trail_mark = matching_trail_mark(&scratch->trail);
+        matching_trail_set(current_matching, &scratch->trail, agent_index, partner);
+        matching_trail_set(current_matching, &scratch->trail, partner, agent_index);
+        search_tally_assign(&scratch->tally, instance, current_matching, agent_index, partner);
+        scratch->hash ^= zobrist_pair_key(agent_index, partner);
         
         // Enhanced validation with quality check
         if (is_partial_matching_valid(current_matching, instance, agent_index)) {
             // Check if this partial matching can still reach k-stability
-            if (can_reach_k_stable(current_matching, instance, k, agent_index + 1)) {
+            if (can_reach_k_stable(&scratch->tally, instance, k, agent_index + 1)) {
                 // Recursively try to complete the matching
-                if (find_k_stable_matching_recursive_enhanced(instance, k, current_matching, agent_index + 1)) {
+                if (find_k_stable_matching_recursive_enhanced(instance, k, current_matching, agent_index + 1, scratch)) {
+                    matching_arena_release(&scratch->arena, mark);
                     return true;
                 }
+            } else {
+                SEARCH_STAT(scratch->stats, prunes_reachable++);
             }
+        } else {
+            SEARCH_STAT(scratch->stats, prunes_invalid++);
         }
         
-        // Backtrack: undo this matching
-        current_matching->pairs[agent_index] = -1;
-        current_matching->pairs[partner] = -1;
+        // Backtrack: undo this matching (both were unmatched before)
+        search_tally_unassign(&scratch->tally, instance, current_matching, agent_index, partner);
+        matching_trail_undo(current_matching, &scratch->trail, trail_mark);
+        scratch->hash ^= zobrist_pair_key(agent_index, partner);
     }
+    matching_arena_release(&scratch->arena, mark);
     
-    // Also try leaving the current agent unmatched (if allowed by the model)
-    if (instance->model == HOUSE_ALLOCATION || instance->model == ROOMMATES || instance->model == HOUSE_ALLOCATION_PARTIAL) {
-        return find_k_stable_matching_recursive_enhanced(instance, k, current_matching, agent_index + 1);
+    // Also try leaving the current agent unmatched (every model allows it)
+    if (find_k_stable_matching_recursive_enhanced(instance, k, current_matching, agent_index + 1, scratch)) {
+        return true;
     }
     
+    table_store(scratch, instance, agent_index, 0);
     return false;
 }
 
@@ -326,7 +837,7 @@ static int estimate_blocking_potential(const matching_t* matching, const problem
             potential++;
         } else {
             // Check if agent has much better alternatives available
-            int current_rank = get_agent_rank(&instance->agents[i], current_partner);
+            int current_rank = get_agent_rank(instance, i, current_partner);
             if (current_rank > 2) { // If current partner is not in top 2 preferences
                 potential++;
             }
@@ -355,8 +866,15 @@ matching_t* find_k_stable_matching(const problem_instance_t* instance, int k) {
         matching->pairs[i] = -1;
     }
     
+    search_scratch_t scratch;
+    if (!search_scratch_init(&scratch, instance)) {
+        destroy_matching(matching);
+        return NULL;
+    }
+    
     // Use recursive backtracking to find a k-stable matching
-    bool found = find_k_stable_matching_recursive(instance, k, matching, 0);
+    bool found = find_k_stable_matching_recursive(instance, k, matching, 0, &scratch);
+    search_scratch_destroy(&scratch);
     
     if (found) {
         return matching;
@@ -388,6 +906,10 @@ bool k_stable_matching_exists_efficient(const problem_instance_t* instance, int
 
 // Efficient algorithm for small k values
 bool k_stable_matching_exists_small_k(const problem_instance_t* instance, int k) {
+    return exists_small_k(instance, k, NULL);
+}
+
+static bool exists_small_k(const problem_instance_t* instance, int k, search_stats_t* stats) {
     // For k=1, any matching is 1-stable (no single agent can block)
     if (k == 1) {
         return true;
@@ -402,16 +924,22 @@ bool k_stable_matching_exists_small_k(const problem_instance_t* instance, int k)
         }
         
         // Try a greedy approach: match agents to their most preferred available partners
-        bool used[MAX_AGENTS] = {false};
+        bitset_t used;
+        if (!agent_set_init(&used, instance->num_agents)) {
+            destroy_matching(matching);
+            return false;
+        }
         
         for (int i = 0; i < instance->num_agents; i++) {
-            if (used[i]) continue;
+            if (bitset_test(&used, i)) continue;
             
             // Find best available partner for agent i
-            for (int pref_idx = 0; pref_idx < instance->agents[i].num_preferences; pref_idx++) {
-                int preferred = instance->agents[i].preferences[pref_idx];
+            const int* preferences = instance_preferences(instance, i);
+            int num_preferences = instance_num_preferences(instance, i);
+            for (int pref_idx = 0; pref_idx < num_preferences; pref_idx++) {
+                int preferred = preferences[pref_idx];
                 
-                if (preferred >= instance->num_agents || used[preferred] || preferred == i) {
+                if (preferred >= instance->num_agents || bitset_test(&used, preferred) || preferred == i) {
                     continue;
                 }
                 
@@ -425,29 +953,36 @@ bool k_stable_matching_exists_small_k(const problem_instance_t* instance, int k)
                 }
                 
                 // Check if preferred agent also likes agent i reasonably well
-                int reverse_rank = get_agent_rank(&instance->agents[preferred], i);
-                if (reverse_rank != -1 && reverse_rank < instance->agents[preferred].num_preferences / 2) {
+                int reverse_rank = get_agent_rank(instance, preferred, i);
+                if (reverse_rank != -1 && reverse_rank < instance_num_preferences(instance, preferred) / 2) {
                     // Make the match
                     matching->pairs[i] = preferred;
                     matching->pairs[preferred] = i;
-                    used[i] = used[preferred] = true;
+                    bitset_set(&used, i);
+                    bitset_set(&used, preferred);
                     break;
                 }
             }
         }
         
+        free(used.words);
+        
         // Check if this matching is k-stable
-        bool is_stable = is_k_stable_direct(matching, instance, k);
+        bool is_stable = verify_leaf(matching, instance, k, NULL, stats);
         destroy_matching(matching);
         return is_stable;
     }
     
     // For slightly larger small k, use the general algorithm
-    return find_k_stable_with_pruning(instance, k);
+    return find_k_stable_with_pruning(instance, k, stats);
 }
 
 // Efficient algorithm for large k values (k close to n)
 bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k) {
+    return exists_large_k(instance, k, NULL);
+}
+
+static bool exists_large_k(const problem_instance_t* instance, int k, search_stats_t* stats) {
     // For large k, we need most agents to be satisfied
     // Try multiple high-quality matching strategies
     
@@ -458,10 +993,19 @@ bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k)
     }
     
     // Use a more sophisticated matching algorithm for large k
-    bool used[MAX_AGENTS] = {false};
+    bitset_t used;
+    if (!agent_set_init(&used, instance->num_agents)) {
+        destroy_matching(matching1);
+        return false;
+    }
+    int* agent_order = malloc(instance->num_agents * sizeof(int));
+    if (agent_order == NULL) {
+        free(used.words);
+        destroy_matching(matching1);
+        return false;
+    }
     
     // Sort agents by their "pickiness" (agents with fewer acceptable partners go first)
-    int agent_order[MAX_AGENTS];
     for (int i = 0; i < instance->num_agents; i++) {
         agent_order[i] = i;
     }
@@ -469,8 +1013,8 @@ bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k)
     // Simple sorting by preference list length (ascending)
     for (int i = 0; i < instance->num_agents - 1; i++) {
         for (int j = i + 1; j < instance->num_agents; j++) {
-            if (instance->agents[agent_order[i]].num_preferences > 
-                instance->agents[agent_order[j]].num_preferences) {
+            if (instance_num_preferences(instance, agent_order[i]) > 
+                instance_num_preferences(instance, agent_order[j])) {
                 int temp = agent_order[i];
                 agent_order[i] = agent_order[j];
                 agent_order[j] = temp;
@@ -481,13 +1025,15 @@ bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k)
     // Match agents in order of pickiness
     for (int idx = 0; idx < instance->num_agents; idx++) {
         int agent = agent_order[idx];
-        if (used[agent]) continue;
+        if (bitset_test(&used, agent)) continue;
         
         // Try to find the best mutual match
-        for (int pref_idx = 0; pref_idx < instance->agents[agent].num_preferences; pref_idx++) {
-            int preferred = instance->agents[agent].preferences[pref_idx];
+        const int* preferences = instance_preferences(instance, agent);
+        int num_preferences = instance_num_preferences(instance, agent);
+        for (int pref_idx = 0; pref_idx < num_preferences; pref_idx++) {
+            int preferred = preferences[pref_idx];
             
-            if (preferred >= instance->num_agents || used[preferred] || preferred == agent) {
+            if (preferred >= instance->num_agents || bitset_test(&used, preferred) || preferred == agent) {
                 continue;
             }
             
@@ -501,19 +1047,23 @@ bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k)
             }
             
             // Check mutual preference (important for large k)
-            int reverse_rank = get_agent_rank(&instance->agents[preferred], agent);
-            if (reverse_rank != -1 && reverse_rank < instance->agents[preferred].num_preferences / 3) {
+            int reverse_rank = get_agent_rank(instance, preferred, agent);
+            if (reverse_rank != -1 && reverse_rank < instance_num_preferences(instance, preferred) / 3) {
                 // Make the match
                 matching1->pairs[agent] = preferred;
                 matching1->pairs[preferred] = agent;
-                used[agent] = used[preferred] = true;
+                bitset_set(&used, agent);
+                bitset_set(&used, preferred);
                 break;
             }
         }
     }
     
+    free(used.words);
+    free(agent_order);
+    
     // Check if this matching is k-stable
-    bool is_stable = is_k_stable_direct(matching1, instance, k);
+    bool is_stable = verify_leaf(matching1, instance, k, NULL, stats);
     destroy_matching(matching1);
     
     if (is_stable) {
@@ -527,19 +1077,40 @@ bool k_stable_matching_exists_large_k(const problem_instance_t* instance, int k)
     }
     
     // Try one more strategy with different priorities
-    return find_k_stable_with_pruning(instance, k);
+    return find_k_stable_with_pruning(instance, k, stats);
 }
 
 // Forward declaration
 static int count_k_stable_matchings_recursive(const problem_instance_t* instance, int k, 
-                                            matching_t* current_matching, int agent_index);
+                                            matching_t* current_matching, int agent_index,
+                                            search_scratch_t* scratch);
 
 // Count the number of k-stable matchings (for analysis)
 int count_k_stable_matchings(const problem_instance_t* instance, int k) {
+    return count_k_stable_matchings_with_stats(instance, k, NULL);
+}
+
+// As count_k_stable_matchings, filling stats (if not NULL) for this call
+int count_k_stable_matchings_with_stats(const problem_instance_t* instance, int k, search_stats_t* stats) {
+    search_stats_reset(stats);
     if (instance == NULL || k <= 0 || k > instance->num_agents) {
         return 0;
     }
     
+    // The subset DP counts the same house allocation leaves without visiting
+    // them. As with --count, a house allocation instance it cannot count is an
+    // error rather than handed to a recursion that would not finish at its
+    // sizes; other models always use the recursion
+    if (count_backend() == COUNT_BACKEND_SUBSET_DP && instance->model == HOUSE_ALLOCATION) {
+        matching_count_t counted;
+        if (!count_k_stable_matchings_dp(instance, k, &counted)) {
+            return -1;
+        }
+        SEARCH_STAT(stats, memo_subproblems += counted.subproblems);
+        SEARCH_STAT(stats, memo_hits += counted.memo_hits);
+        return (counted.search_leaves > INT_MAX) ? -1 : (int)counted.search_leaves;
+    }
+    
     // This is a simplified implementation
     // In practice, you'd implement a more sophisticated counting algorithm
     
@@ -554,32 +1125,50 @@ int count_k_stable_matchings(const problem_instance_t* instance, int k) {
         matching->pairs[i] = -1;
     }
     
+    // Every leaf verification reuses the same verifier context
+    search_scratch_t scratch;
+    if (!search_scratch_init(&scratch, instance)) {
+        destroy_matching(matching);
+        return 0;
+    }
+    scratch.stats = stats;
+    
     // Use recursive counting (this is exponential in the worst case)
-    count = count_k_stable_matchings_recursive(instance, k, matching, 0);
+    count = count_k_stable_matchings_recursive(instance, k, matching, 0, &scratch);
     
+    search_scratch_destroy(&scratch);
     destroy_matching(matching);
     return count;
 }
 
 // Recursive function to count k-stable matchings
 static int count_k_stable_matchings_recursive(const problem_instance_t* instance, int k, 
-                                            matching_t* current_matching, int agent_index) {
+                                            matching_t* current_matching, int agent_index,
+                                            search_scratch_t* scratch) {
+    enter_search_node(scratch->stats, agent_index);
+    
     // Base case: if we've assigned all agents, check if the matching is k-stable
     if (agent_index >= instance->num_agents) {
-        return is_k_stable_direct(current_matching, instance, k) ? 1 : 0;
+        return verify_leaf(current_matching, instance, k, &scratch->verifier, scratch->stats) ? 1 : 0;
     }
     
     // If current agent is already matched, move to next agent
     if (current_matching->pairs[agent_index] != -1) {
-        return count_k_stable_matchings_recursive(instance, k, current_matching, agent_index + 1);
+        return count_k_stable_matchings_recursive(instance, k, current_matching, agent_index + 1, scratch);
+    }
+    
+    // A partial matching reached before (in another assignment order) has the same count
+    uint64_t cached;
+    if (table_lookup(scratch, instance, agent_index, &cached)) {
+        return (int)cached;
     }
     
     int count = 0;
     
     // Try to match the current agent with each possible partner
     for (int partner = 0; partner < instance->num_agents; partner++) {
-        // Skip if trying to match with self
-        if (partner == agent_index) {
+        // Skip if trying to match with self, or with an object outside the agent range (k-hai)
+        if (partner == agent_index || partner >= instance->num_agents) {
             continue;
         }
         
@@ -601,30 +1190,31 @@ static int count_k_stable_matchings_recursive(const problem_instance_t* instance
         }
         
         // Try this matching
-        current_matching->pairs[agent_index] = partner;
-        current_matching->pairs[partner] = agent_index;
+        int trail_mark = matching_trail_mark(&scratch->trail);
+        matching_trail_set(current_matching, &scratch->trail, agent_index, partner);
+        matching_trail_set(current_matching, &scratch->trail, partner, agent_index);
+        scratch->hash ^= zobrist_pair_key(agent_index, partner);
         
         // Recursively count
-        count += count_k_stable_matchings_recursive(instance, k, current_matching, agent_index + 1);
+        count += count_k_stable_matchings_recursive(instance, k, current_matching, agent_index + 1, scratch);
         
         // Backtrack: undo this matching
-        current_matching->pairs[agent_index] = -1;
-        current_matching->pairs[partner] = -1;
+        matching_trail_undo(current_matching, &scratch->trail, trail_mark);
+        scratch->hash ^= zobrist_pair_key(agent_index, partner);
     }
     
-    // Also try leaving the current agent unmatched (if allowed)
-    if (instance->model == HOUSE_ALLOCATION || instance->model == ROOMMATES) {
-        count += count_k_stable_matchings_recursive(instance, k, current_matching, agent_index + 1);
-    }
+    // Also try leaving the current agent unmatched (every model allows it)
+    count += count_k_stable_matchings_recursive(instance, k, current_matching, agent_index + 1, scratch);
     
+    table_store(scratch, instance, agent_index, (uint64_t)count);
     return count;
 }
 
 // Enhanced heuristic check for partial matching promise
-static bool is_promising_partial_matching_enhanced(const matching_t* partial_matching, const problem_instance_t* instance, 
+static bool is_promising_partial_matching_enhanced(const search_tally_t* tally, const problem_instance_t* instance, 
                                                  int k, int agents_processed) {
     // Use enhanced blocking potential estimation
-    int blocking_potential = estimate_blocking_potential_enhanced(partial_matching, instance, k);
+    int blocking_potential = estimate_blocking_potential_enhanced(tally);
     
     // If the blocking potential is already too high, prune this branch
     if (blocking_potential >= k) {
@@ -633,20 +1223,8 @@ static bool is_promising_partial_matching_enhanced(const matching_t* partial_mat
     
     // Check if we can still achieve k-stability with remaining agents
     int remaining_agents = instance->num_agents - agents_processed;
-    int unmatched_count = 0;
-    int dissatisfied_count = 0;
-    
-    for (int i = 0; i < agents_processed; i++) {
-        if (partial_matching->pairs[i] == -1) {
-            unmatched_count++;
-        } else {
-            // Check if agent is dissatisfied with current match
-            int current_rank = get_agent_rank(&instance->agents[i], partial_matching->pairs[i]);
-            if (current_rank > instance->agents[i].num_preferences / 2) {
-                dissatisfied_count++;
-            }
-        }
-    }
+    int unmatched_count = agents_processed - bitset_count_prefix(&tally->matched, agents_processed);
+    int dissatisfied_count = bitset_count_prefix(&tally->half_dissatisfied, agents_processed);
     
     // Enhanced pruning: if too many agents are dissatisfied or unmatched
     if (dissatisfied_count + unmatched_count >= k) {
@@ -662,80 +1240,30 @@ static bool is_promising_partial_matching_enhanced(const matching_t* partial_mat
 }
 
 // Enhanced blocking potential estimation
-static int estimate_blocking_potential_enhanced(const matching_t* matching, const problem_instance_t* instance, int k) {
+static int estimate_blocking_potential_enhanced(const search_tally_t* tally) {
     int potential = 0;
-    int dissatisfied_agents = 0;
-    int unmatched_agents = 0;
     
-    // Count agents who are clearly dissatisfied or unmatched
-    for (int i = 0; i < instance->num_agents; i++) {
-        int current_partner = matching->pairs[i];
-        
-        if (current_partner == -1) {
-            unmatched_agents++;
-        } else {
-            // Check if agent has much better alternatives available
-            int current_rank = get_agent_rank(&instance->agents[i], current_partner);
-            if (current_rank > 2) { // If current partner is not in top 2 preferences
-                dissatisfied_agents++;
-            }
-            
-            // Check if agent has significantly better alternatives
-            for (int pref_idx = 0; pref_idx < 2 && pref_idx < instance->agents[i].num_preferences; pref_idx++) {
-                int preferred = instance->agents[i].preferences[pref_idx];
-                if (preferred != current_partner && matching->pairs[preferred] == -1) {
-                    // Agent has a much better unmatched alternative
-                    potential += 2;
-                    break;
-                }
-            }
-        }
-    }
+    // Matched agents with a much better unmatched alternative
+    potential += tally->better_unmatched * 2;
     
     // Weighted combination of different factors
-    potential += dissatisfied_agents * 2;
-    potential += unmatched_agents * 3;
+    potential += tally->dissatisfied * 2;
+    potential += tally->unmatched * 3;
     
     return potential;
 }
 
 // Early conflict detection
-static bool has_conflict_early_detection(const matching_t* partial_matching, const problem_instance_t* instance, int k) {
+static bool has_conflict_early_detection(const search_tally_t* tally, int k) {
     // Check for obvious conflicts that would prevent k-stability
     
-    // Count agents with very poor matches
-    int poor_matches = 0;
-    for (int i = 0; i < instance->num_agents; i++) {
-        if (partial_matching->pairs[i] != -1) {
-            int current_rank = get_agent_rank(&instance->agents[i], partial_matching->pairs[i]);
-            if (current_rank > instance->agents[i].num_preferences * 0.8) {
-                poor_matches++;
-            }
-        }
-    }
-    
     // If too many agents have poor matches, this is likely to lead to conflicts
-    if (poor_matches >= k) {
+    if (tally->poor_matches >= k) {
         return true;
     }
     
-    // Check for mutual dissatisfaction
-    int mutual_dissatisfaction = 0;
-    for (int i = 0; i < instance->num_agents; i++) {
-        if (partial_matching->pairs[i] != -1) {
-            int partner = partial_matching->pairs[i];
-            int rank_i = get_agent_rank(&instance->agents[i], partner);
-            int rank_j = get_agent_rank(&instance->agents[partner], i);
-            
-            if (rank_i > instance->agents[i].num_preferences / 2 && 
-                rank_j > instance->agents[partner].num_preferences / 2) {
-                mutual_dissatisfaction++;
-            }
-        }
-    }
-    
     // If there's significant mutual dissatisfaction, this could lead to blocking coalitions
-    if (mutual_dissatisfaction >= k / 2) {
+    if (tally->mutual_dissatisfaction >= k / 2) {
         return true;
     }
     
@@ -749,10 +1277,10 @@ static int score_matching_quality(const matching_t* matching, const problem_inst
     
     for (int i = 0; i < instance->num_agents; i++) {
         if (matching->pairs[i] != -1) {
-            int rank = get_agent_rank(&instance->agents[i], matching->pairs[i]);
+            int rank = get_agent_rank(instance, i, matching->pairs[i]);
             if (rank != -1) {
                 // Higher score for better matches (lower rank = better)
-                score += instance->agents[i].num_preferences - rank;
+                score += instance_num_preferences(instance, i) - rank;
             }
         }
     }
@@ -761,11 +1289,12 @@ static int score_matching_quality(const matching_t* matching, const problem_inst
 }
 
 // Check if partial matching can still reach k-stability
-static bool can_reach_k_stable(const matching_t* partial_matching, const problem_instance_t* instance, int k, int agents_processed) {
+static bool can_reach_k_stable(const search_tally_t* tally, const problem_instance_t* instance,
+                               int k, int agents_processed) {
     // Estimate if we can still achieve k-stability with remaining agents
     
     int remaining_agents = instance->num_agents - agents_processed;
-    int current_blocking_potential = estimate_blocking_potential_enhanced(partial_matching, instance, k);
+    int current_blocking_potential = estimate_blocking_potential_enhanced(tally);
     
     // If current blocking potential is already too high
     if (current_blocking_potential >= k) {
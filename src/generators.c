@@ -1,264 +1,690 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "../include/matching.h"
 
-// Improved random number generator using xorshift32
-static uint32_t rng_state = 1;
+// Counter-based random numbers. Agent a's draws under a seed come from the
+// stream keyed by (seed, a): draw i is the SplitMix64 finalizer applied to
+// key + i * gamma, a pure function of (seed, a, i). Agents' lists can thus be
+// generated on any thread and in any order, bit-for-bit the same.
+#define SPLITMIX64_GAMMA 0x9E3779B97F4A7C15ULL
+
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} rng_stream_t;
 
-static uint32_t xorshift32() {
-    // Xorshift32 algorithm - much better quality than LCG
-    rng_state ^= rng_state << 13;
-    rng_state ^= rng_state >> 17;
-    rng_state ^= rng_state << 5;
-    return rng_state;
+static uint64_t splitmix64_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-static void rng_seed(uint32_t seed) {
-    // Ensure seed is never 0 (would break xorshift)
-    rng_state = (seed == 0) ? 1 : seed;
-    
-    // Warm up the generator
-    for (int i = 0; i < 10; i++) {
-        xorshift32();
-    }
+// Stream of one agent; the mix is a bijection, so distinct (seed, agent) give distinct keys
+static rng_stream_t rng_stream(uint32_t seed, int agent) {
+    rng_stream_t stream = { splitmix64_mix(((uint64_t)seed << 32) | (uint32_t)agent), 0 };
+    return stream;
 }
 
-// Wrapper for compatibility
-static uint32_t lcg_rand() {
-    return xorshift32();
+static uint32_t rng_next(rng_stream_t* stream) {
+    stream->counter++;
+    return (uint32_t)(splitmix64_mix(stream->key + stream->counter * SPLITMIX64_GAMMA) >> 32);
 }
 
-static void lcg_seed(uint32_t seed) {
-    rng_seed(seed);
+// Uniform draw in [0, bound) by multiply-shift (bound > 0)
+static int rng_below(rng_stream_t* stream, int bound) {
+    return (int)(((uint64_t)rng_next(stream) * (uint32_t)bound) >> 32);
 }
 
 // Fisher-Yates shuffle algorithm
-static void shuffle_array(int* array, int n) {
+static void shuffle_array(int* array, int n, rng_stream_t* stream) {
     for (int i = n - 1; i > 0; i--) {
-        int j = lcg_rand() % (i + 1);
+        int j = rng_below(stream, i + 1);
         int temp = array[i];
         array[i] = array[j];
         array[j] = temp;
     }
 }
 
-// Generate random house allocation instance
-problem_instance_t* generate_random_house_allocation(int num_agents, uint32_t seed) {
-    if (num_agents <= 0 || num_agents > MAX_AGENTS) {
+// Random generators add every agent first (fixing the list lengths), then fill
+// the lists agent by agent. Large instances are filled on worker threads; each
+// agent touches only its own slice and stream, so the result does not depend
+// on the thread count.
+#define PARALLEL_GENERATION_MIN_ENTRIES (1 << 18)
+#define GENERATION_CHUNK_AGENTS 256
+
+typedef struct generation generation_t;
+
+// Fill the preferences (and tie groups) of one added agent. scratch holds
+// scratch_size ints private to the worker, -1 until first written.
+typedef void (*agent_fill_fn)(const generation_t* generation, int agent, int* scratch);
+
+struct generation {
+    problem_instance_t* instance;
+    uint32_t seed;
+    int num_choices;             // houses or partners each agent draws from
+    agent_fill_fn fill;
+    int scratch_size;
+    int* scratch;                // scratch_size ints per worker
+};
+
+// Forward declarations
+static bool generate_agent_lists(generation_t* generation);
+static void generate_agent_chunk(void* context, int worker, uint64_t begin, uint64_t end);
+static int* agent_slice(const generation_t* generation, int agent, int* length);
+static int partial_list_length(uint32_t seed, int agent, int num_objects);
+static void fill_house_list(const generation_t* generation, int agent, int* scratch);
+static void fill_marriage_list(const generation_t* generation, int agent, int* scratch);
+static void fill_roommates_list(const generation_t* generation, int agent, int* scratch);
+static void fill_partial_list(const generation_t* generation, int agent, int* scratch);
+static void fill_partial_list_with_ties(const generation_t* generation, int agent, int* scratch);
+static void fill_truncated_list(const generation_t* generation, int agent, int* scratch);
+static problem_instance_t* reuse_problem_instance(problem_instance_t* buffer, int num_agents, matching_model_t model,
+                                                  int pref_capacity, bool with_ties);
+static bool finalize_instance(problem_instance_t* instance, bool trim);
+static problem_instance_t* random_house_allocation_into(problem_instance_t* buffer, int num_agents, uint32_t seed);
+static problem_instance_t* random_marriage_into(problem_instance_t* buffer, int num_men, int num_women, uint32_t seed);
+static problem_instance_t* random_roommates_into(problem_instance_t* buffer, int num_agents, uint32_t seed);
+static problem_instance_t* k_hai_into(problem_instance_t* buffer, int num_agents, int num_objects, uint32_t seed,
+                                      bool with_ties);
+static problem_instance_t* truncated_house_allocation_into(problem_instance_t* buffer, int num_agents,
+                                                           int list_length, uint32_t seed);
+
+// Total preference entries for num_agents lists of list_length each, -1 if it overflows the pool
+static int preference_pool_size(int num_agents, int list_length) {
+    long long total = (long long)num_agents * list_length;
+    return (total > INT_MAX) ? -1 : (int)total;
+}
+
+// Create an empty problem instance with room for pref_capacity preference entries.
+// Agents are filled in order with instance_add_agent; the pool grows as needed.
+problem_instance_t* create_problem_instance(int num_agents, matching_model_t model,
+                                            int pref_capacity, bool with_ties) {
+    if (num_agents <= 0 || num_agents == INT_MAX) {
         return NULL;
     }
+    if (pref_capacity < 1) {
+        pref_capacity = 1;
+    }
     
-    lcg_seed(seed);
-    
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    problem_instance_t* instance = calloc(1, sizeof(problem_instance_t));
     if (instance == NULL) {
         return NULL;
     }
     
     instance->num_agents = num_agents;
-    instance->model = HOUSE_ALLOCATION;
-    instance->model_data.house_data.num_houses = num_agents;
+    instance->model = model;
+    instance->pref_capacity = pref_capacity;
+    instance->agent_capacity = num_agents;
+    instance->pref_offsets = malloc((num_agents + 1) * sizeof(int));
+    instance->preferences = malloc(pref_capacity * sizeof(int));
+    if (with_ties) {
+        instance->tie_groups = malloc(pref_capacity * sizeof(int));
+        instance->has_indifferences = calloc(num_agents, sizeof(bool));
+    }
     
-    // Initialize agents
-    for (int i = 0; i < num_agents; i++) {
-        instance->agents[i].id = i;
-        instance->agents[i].num_preferences = num_agents;
+    if (instance->pref_offsets == NULL || instance->preferences == NULL ||
+        (with_ties && (instance->tie_groups == NULL || instance->has_indifferences == NULL))) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
+    
+    instance->pref_offsets[0] = 0;
+    return instance;
+}
+
+// Resize the preference pool (and the parallel tie groups) to new_capacity entries
+static bool resize_preference_pool(problem_instance_t* instance, int new_capacity) {
+    int* preferences = realloc(instance->preferences, new_capacity * sizeof(int));
+    if (preferences == NULL) {
+        return false;
+    }
+    instance->preferences = preferences;
+    
+    if (instance->tie_groups != NULL) {
+        int* tie_groups = realloc(instance->tie_groups, new_capacity * sizeof(int));
+        if (tie_groups == NULL) {
+            return false;
+        }
+        instance->tie_groups = tie_groups;
+    }
+    
+    instance->pref_capacity = new_capacity;
+    return true;
+}
+
+// Empty buffer (a built instance, or NULL) for reuse as the instance
+// create_problem_instance would return, keeping every array that is already
+// large enough: the agent offsets, the preference pool and tie groups, and
+// the dense rank table. Hashed rank tables are rebuilt. Loaded instances are
+// replaced. On failure the buffer is destroyed and NULL returned.
+static problem_instance_t* reuse_problem_instance(problem_instance_t* buffer, int num_agents, matching_model_t model,
+                                                  int pref_capacity, bool with_ties) {
+    if (buffer == NULL || buffer->mapping != NULL || num_agents <= 0 || num_agents == INT_MAX) {
+        destroy_problem_instance(buffer);
+        return create_problem_instance(num_agents, model, pref_capacity, with_ties);
+    }
+    
+    // Strict instances are the ones without tie groups
+    if (!with_ties || num_agents > buffer->agent_capacity) {
+        free(buffer->has_indifferences);
+        buffer->has_indifferences = NULL;
+    }
+    if (!with_ties) {
+        free(buffer->tie_groups);
+        buffer->tie_groups = NULL;
+    }
+    if (num_agents > buffer->agent_capacity) {
+        int* offsets = realloc(buffer->pref_offsets, (size_t)(num_agents + 1) * sizeof(int));
+        if (offsets == NULL) {
+            destroy_problem_instance(buffer);
+            return NULL;
+        }
+        buffer->pref_offsets = offsets;
+        buffer->agent_capacity = num_agents;
+    }
+    if (pref_capacity > buffer->pref_capacity && !resize_preference_pool(buffer, pref_capacity)) {
+        destroy_problem_instance(buffer);
+        return NULL;
+    }
+    if (with_ties) {
+        if (buffer->tie_groups == NULL) {
+            buffer->tie_groups = malloc((size_t)buffer->pref_capacity * sizeof(int));
+        }
+        if (buffer->has_indifferences == NULL) {
+            buffer->has_indifferences = malloc((size_t)buffer->agent_capacity * sizeof(bool));
+        }
+        if (buffer->tie_groups == NULL || buffer->has_indifferences == NULL) {
+            destroy_problem_instance(buffer);
+            return NULL;
+        }
+        memset(buffer->has_indifferences, 0, (size_t)num_agents * sizeof(bool));
+    }
+    
+    free(buffer->rank_hash_offsets);
+    free(buffer->rank_hash_slots);
+    buffer->rank_hash_offsets = NULL;
+    buffer->rank_hash_slots = NULL;
+    buffer->num_agents = num_agents;
+    buffer->model = model;
+    buffer->num_agents_added = 0;
+    buffer->num_targets = 0;
+    memset(&buffer->model_data, 0, sizeof(buffer->model_data));
+    buffer->pref_offsets[0] = 0;
+    return buffer;
+}
+
+// Append the next agent with num_preferences entries.
+// Returns the agent's slice of the preference pool for the caller to fill,
+// valid until the next call to instance_add_agent.
+int* instance_add_agent(problem_instance_t* instance, int num_preferences) {
+    if (instance == NULL || num_preferences < 0 ||
+        instance->num_agents_added >= instance->num_agents) {
+        return NULL;
+    }
+    
+    int agent = instance->num_agents_added;
+    int start = instance->pref_offsets[agent];
+    
+    if (start + num_preferences > instance->pref_capacity) {
+        int new_capacity = instance->pref_capacity * 2;
+        if (new_capacity < start + num_preferences) {
+            new_capacity = start + num_preferences;
+        }
+        if (!resize_preference_pool(instance, new_capacity)) {
+            return NULL;
+        }
+    }
+    
+    instance->pref_offsets[agent + 1] = start + num_preferences;
+    instance->num_agents_added++;
+    return instance->preferences + start;
+}
+
+// Writable indifference groups of an already added agent (NULL if strict)
+int* instance_agent_tie_groups(problem_instance_t* instance, int agent) {
+    if (instance == NULL || instance->tie_groups == NULL ||
+        agent < 0 || agent >= instance->num_agents_added) {
+        return NULL;
+    }
+    return instance->tie_groups + instance->pref_offsets[agent];
+}
+
+// Hash a target id into an agent's open-addressing table
+static inline unsigned int rank_hash(int target_id, unsigned int mask) {
+    return ((unsigned int)target_id * 2654435761u) & mask;
+}
+
+// Hashed rank lookup for instances with truncated lists
+int instance_rank_hashed(const problem_instance_t* instance, int agent, int target_id) {
+    int begin = instance->rank_hash_offsets[agent];
+    int size = instance->rank_hash_offsets[agent + 1] - begin;
+    if (size == 0) {
+        return RANK_UNACCEPTABLE;
+    }
+    
+    const int* slots = instance->rank_hash_slots + begin;
+    const int* preferences = instance_preferences(instance, agent);
+    unsigned int mask = (unsigned int)size - 1;
+    
+    for (unsigned int h = rank_hash(target_id, mask); ; h = (h + 1) & mask) {
+        int rank = slots[h];
+        if (rank == RANK_UNACCEPTABLE || preferences[rank] == target_id) {
+            return rank;
+        }
+    }
+}
+
+// Build per-agent open-addressing rank tables (memory proportional to the preference count)
+static bool build_rank_hash(problem_instance_t* instance) {
+    int n = instance->num_agents;
+    int* offsets = malloc((n + 1) * sizeof(int));
+    if (offsets == NULL) {
+        return false;
+    }
+    
+    // Each table holds at least twice its list length, rounded up to a power of two
+    long long total_slots = 0;
+    for (int agent = 0; agent < n; agent++) {
+        offsets[agent] = (int)total_slots;
+        int length = instance_num_preferences(instance, agent);
+        int size = 0;
+        if (length > 0) {
+            size = 2;
+            while (size < 2 * length) {
+                size *= 2;
+            }
+        }
+        total_slots += size;
+        if (total_slots > INT_MAX) {
+            free(offsets);
+            return false;
+        }
+    }
+    offsets[n] = (int)total_slots;
+    
+    int* slots = malloc((total_slots > 0 ? total_slots : 1) * sizeof(int));
+    if (slots == NULL) {
+        free(offsets);
+        return false;
+    }
+    for (long long s = 0; s < total_slots; s++) {
+        slots[s] = RANK_UNACCEPTABLE;
+    }
+    
+    instance->rank_hash_offsets = offsets;
+    instance->rank_hash_slots = slots;
+    
+    for (int agent = 0; agent < n; agent++) {
+        const int* preferences = instance_preferences(instance, agent);
+        int* table = slots + offsets[agent];
+        unsigned int mask = (unsigned int)(offsets[agent + 1] - offsets[agent]) - 1;
         
-        // Create preference list (houses 0 to num_agents-1)
-        for (int j = 0; j < num_agents; j++) {
-            instance->agents[i].preferences[j] = j;
+        for (int r = 0; r < instance_num_preferences(instance, agent); r++) {
+            int target = preferences[r];
+            if (target < 0) {
+                continue;
+            }
+            unsigned int h = rank_hash(target, mask);
+            while (table[h] != RANK_UNACCEPTABLE && preferences[table[h]] != target) {
+                h = (h + 1) & mask;
+            }
+            // First occurrence wins, matching a linear scan of the list
+            if (table[h] == RANK_UNACCEPTABLE) {
+                table[h] = r;
+            }
+        }
+    }
+    
+    return true;
+}
+
+// Build the inverse rank index (agent x target -> rank) from the preference pool
+static bool build_rank_table(problem_instance_t* instance) {
+    int total = instance->pref_offsets[instance->num_agents];
+    int num_targets = 1;
+    for (int i = 0; i < total; i++) {
+        if (instance->preferences[i] >= num_targets) {
+            num_targets = instance->preferences[i] + 1;
+        }
+    }
+    instance->num_targets = num_targets;
+    
+    // A dense table only pays off when the lists cover most targets. A reused
+    // instance keeps its dense table while it is large enough
+    size_t cells = (size_t)instance->num_agents * num_targets;
+    if (cells > 2 * (size_t)total + 4096 || cells > instance->rank_table_capacity) {
+        free(instance->rank_table);
+        instance->rank_table = NULL;
+        instance->rank_table_capacity = 0;
+    }
+    if (cells > 2 * (size_t)total + 4096) {
+        return build_rank_hash(instance);
+    }
+    
+    int* rank_table = instance->rank_table;
+    if (rank_table == NULL) {
+        rank_table = malloc(cells * sizeof(int));
+        if (rank_table == NULL) {
+            return false;
         }
+        instance->rank_table_capacity = cells;
+    }
+    
+    for (size_t c = 0; c < cells; c++) {
+        rank_table[c] = RANK_UNACCEPTABLE;
+    }
+    
+    for (int agent = 0; agent < instance->num_agents; agent++) {
+        int* row = rank_table + (size_t)agent * num_targets;
+        const int* preferences = instance_preferences(instance, agent);
         
-        // Shuffle preferences for each agent
-        shuffle_array(instance->agents[i].preferences, num_agents);
+        for (int r = 0; r < instance_num_preferences(instance, agent); r++) {
+            int target = preferences[r];
+            // First occurrence wins, matching a linear scan of the list
+            if (target >= 0 && row[target] == RANK_UNACCEPTABLE) {
+                row[target] = r;
+            }
+        }
+    }
+    
+    instance->rank_table = rank_table;
+    return true;
+}
+
+// Complete construction: every agent must have been added.
+// Trims the preference pool to the actual number of entries and builds the rank index.
+bool instance_finalize(problem_instance_t* instance) {
+    return finalize_instance(instance, true);
+}
+
+// As instance_finalize; reused buffers keep their pool untrimmed (trim false)
+static bool finalize_instance(problem_instance_t* instance, bool trim) {
+    if (instance == NULL || instance->num_agents_added != instance->num_agents) {
+        return false;
     }
     
+    int total = instance->pref_offsets[instance->num_agents];
+    if (trim && total > 0 && total < instance->pref_capacity) {
+        resize_preference_pool(instance, total);  // Shrinking cannot lose data
+    }
+    
+    return build_rank_table(instance);
+}
+
+problem_instance_t* generate_trial_instance(problem_instance_t* buffer, trial_source_t source,
+                                            int n, int param, uint32_t seed) {
+    switch (source) {
+        case TRIAL_HOUSE_ALLOCATION:
+            return random_house_allocation_into(buffer, n, seed);
+        case TRIAL_MARRIAGE:
+            return random_marriage_into(buffer, n / 2, n / 2, seed);
+        case TRIAL_ROOMMATES:
+            return random_roommates_into(buffer, n, seed);
+        case TRIAL_K_HAI:
+            return k_hai_into(buffer, n, param, seed, false);
+        case TRIAL_K_HAI_INDIFFERENCES:
+            return k_hai_into(buffer, n, param, seed, true);
+        case TRIAL_TRUNCATED:
+            return truncated_house_allocation_into(buffer, n, param, seed);
+        case TRIAL_FIXED:
+            break;
+    }
+    destroy_problem_instance(buffer);
+    return NULL;
+}
+
+// Destroy a problem instance
+void destroy_problem_instance(problem_instance_t* instance) {
+    if (instance != NULL && instance->mapping != NULL) {
+        // Loaded instance: the arrays live in the file mapping
+        munmap(instance->mapping, instance->mapping_bytes);
+        free(instance);
+        return;
+    }
+    if (instance != NULL) {
+        free(instance->pref_offsets);
+        free(instance->preferences);
+        free(instance->tie_groups);
+        free(instance->has_indifferences);
+        free(instance->rank_table);
+        free(instance->rank_hash_offsets);
+        free(instance->rank_hash_slots);
+        free(instance);
+    }
+}
+
+// Generate random house allocation instance
+problem_instance_t* generate_random_house_allocation(int num_agents, uint32_t seed) {
+    return random_house_allocation_into(NULL, num_agents, seed);
+}
+
+// The generators below build into buffer (reused, see reuse_problem_instance)
+// or, if it is NULL, a new instance; on failure the buffer is destroyed
+static problem_instance_t* random_house_allocation_into(problem_instance_t* buffer, int num_agents, uint32_t seed) {
+    int pool_size = preference_pool_size(num_agents, num_agents);
+    if (num_agents <= 0 || pool_size < 0) {
+        destroy_problem_instance(buffer);
+        return NULL;
+    }
+    
+    problem_instance_t* instance = reuse_problem_instance(buffer, num_agents, HOUSE_ALLOCATION,
+                                                          pool_size, false);
+    if (instance == NULL) {
+        return NULL;
+    }
+    
+    instance->model_data.house_data.num_houses = num_agents;
+    
+    // Every agent ranks all houses in a random order
+    for (int i = 0; i < num_agents; i++) {
+        instance_add_agent(instance, num_agents);
+    }
+    generation_t generation = { instance, seed, num_agents, fill_house_list, 0, NULL };
+    
+    if (!generate_agent_lists(&generation) || !finalize_instance(instance, buffer == NULL)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
+    return instance;
+}
+
+// House allocation instance with agent a ranking the houses profile[a * n .. a * n + n - 1]
+// (rows as written by unrank_preference_profile)
+problem_instance_t* generate_house_allocation_from_profile(int n, const int* profile) {
+    int pool_size = preference_pool_size(n, n);
+    if (n <= 0 || profile == NULL || pool_size < 0) {
+        return NULL;
+    }
+    
+    problem_instance_t* instance = create_problem_instance(n, HOUSE_ALLOCATION, pool_size, false);
+    if (instance == NULL) {
+        return NULL;
+    }
+    
+    instance->model_data.house_data.num_houses = n;
+    
+    for (int agent = 0; agent < n; agent++) {
+        int* preferences = instance_add_agent(instance, n);
+        memcpy(preferences, profile + (size_t)agent * n, n * sizeof(int));
+    }
+    
+    if (!instance_finalize(instance)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
 // Generate random marriage instance
 problem_instance_t* generate_random_marriage(int num_men, int num_women, uint32_t seed) {
-    if (num_men <= 0 || num_women <= 0 || (num_men + num_women) > MAX_AGENTS) {
+    return random_marriage_into(NULL, num_men, num_women, seed);
+}
+
+static problem_instance_t* random_marriage_into(problem_instance_t* buffer, int num_men, int num_women, uint32_t seed) {
+    int pool_size = preference_pool_size(2 * num_men, num_women);
+    if (num_men <= 0 || num_women <= 0 || pool_size < 0) {
+        destroy_problem_instance(buffer);
         return NULL;
     }
     
-    lcg_seed(seed);
-    
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    problem_instance_t* instance = reuse_problem_instance(buffer, num_men + num_women, MARRIAGE,
+                                                          pool_size, false);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = num_men + num_women;
-    instance->model = MARRIAGE;
     instance->model_data.marriage_data.num_men = num_men;
     instance->model_data.marriage_data.num_women = num_women;
     
-    // Initialize men (agents 0 to num_men-1)
+    // Men (agents 0 to num_men-1) rank all women, women all men
     for (int i = 0; i < num_men; i++) {
-        instance->agents[i].id = i;
-        instance->agents[i].num_preferences = num_women;
-        
-        // Create preference list (women num_men to num_men+num_women-1)
-        for (int j = 0; j < num_women; j++) {
-            instance->agents[i].preferences[j] = num_men + j;
-        }
-        
-        // Shuffle preferences
-        shuffle_array(instance->agents[i].preferences, num_women);
+        instance_add_agent(instance, num_women);
     }
-    
-    // Initialize women (agents num_men to num_men+num_women-1)
     for (int i = 0; i < num_women; i++) {
-        int woman_id = num_men + i;
-        instance->agents[woman_id].id = woman_id;
-        instance->agents[woman_id].num_preferences = num_men;
-        
-        // Create preference list (men 0 to num_men-1)
-        for (int j = 0; j < num_men; j++) {
-            instance->agents[woman_id].preferences[j] = j;
-        }
-        
-        // Shuffle preferences
-        shuffle_array(instance->agents[woman_id].preferences, num_men);
+        instance_add_agent(instance, num_men);
     }
+    generation_t generation = { instance, seed, 0, fill_marriage_list, 0, NULL };
     
+    if (!generate_agent_lists(&generation) || !finalize_instance(instance, buffer == NULL)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
 // Generate random roommates instance
 problem_instance_t* generate_random_roommates(int num_agents, uint32_t seed) {
-    if (num_agents <= 0 || num_agents > MAX_AGENTS) {
+    return random_roommates_into(NULL, num_agents, seed);
+}
+
+static problem_instance_t* random_roommates_into(problem_instance_t* buffer, int num_agents, uint32_t seed) {
+    int pool_size = preference_pool_size(num_agents, num_agents - 1);
+    if (num_agents <= 0 || pool_size < 0) {
+        destroy_problem_instance(buffer);
         return NULL;
     }
     
-    lcg_seed(seed);
-    
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    problem_instance_t* instance = reuse_problem_instance(buffer, num_agents, ROOMMATES,
+                                                          pool_size, false);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = num_agents;
-    instance->model = ROOMMATES;
     // Note: For roommates, odd numbers mean one agent will remain unmatched
     
-    // Initialize agents
+    // Every agent ranks all others (not themselves)
     for (int i = 0; i < num_agents; i++) {
-        instance->agents[i].id = i;
-        instance->agents[i].num_preferences = num_agents - 1;  // Can't prefer themselves
-        
-        // Create preference list (all other agents)
-        int pref_count = 0;
-        for (int j = 0; j < num_agents; j++) {
-            if (j != i) {  // Don't include self in preferences
-                instance->agents[i].preferences[pref_count] = j;
-                pref_count++;
-            }
-        }
-        
-        // Shuffle preferences
-        shuffle_array(instance->agents[i].preferences, num_agents - 1);
+        instance_add_agent(instance, num_agents - 1);
     }
+    generation_t generation = { instance, seed, num_agents, fill_roommates_list, 0, NULL };
     
+    if (!generate_agent_lists(&generation) || !finalize_instance(instance, buffer == NULL)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
 // Generate a specific test case for debugging
 problem_instance_t* generate_test_case_1() {
     // Simple 3-agent house allocation case
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    static const int test_preferences[3][3] = {
+        {1, 2, 0},  // Agent 0: prefers house 1 > 2 > 0
+        {2, 0, 1},  // Agent 1: prefers house 2 > 0 > 1
+        {0, 1, 2}   // Agent 2: prefers house 0 > 1 > 2
+    };
+    
+    problem_instance_t* instance = create_problem_instance(3, HOUSE_ALLOCATION, 9, false);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = 3;
-    instance->model = HOUSE_ALLOCATION;
     instance->model_data.house_data.num_houses = 3;
     
-    // Agent 0: prefers house 1 > 2 > 0
-    instance->agents[0].id = 0;
-    instance->agents[0].num_preferences = 3;
-    instance->agents[0].preferences[0] = 1;
-    instance->agents[0].preferences[1] = 2;
-    instance->agents[0].preferences[2] = 0;
-    
-    // Agent 1: prefers house 2 > 0 > 1
-    instance->agents[1].id = 1;
-    instance->agents[1].num_preferences = 3;
-    instance->agents[1].preferences[0] = 2;
-    instance->agents[1].preferences[1] = 0;
-    instance->agents[1].preferences[2] = 1;
-    
-    // Agent 2: prefers house 0 > 1 > 2
-    instance->agents[2].id = 2;
-    instance->agents[2].num_preferences = 3;
-    instance->agents[2].preferences[0] = 0;
-    instance->agents[2].preferences[1] = 1;
-    instance->agents[2].preferences[2] = 2;
+    for (int i = 0; i < 3; i++) {
+        int* preferences = instance_add_agent(instance, 3);
+        memcpy(preferences, test_preferences[i], sizeof(test_preferences[i]));
+    }
     
+    if (!instance_finalize(instance)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
 // Generate a test case where k-stable matching exists
 problem_instance_t* generate_k_stable_exists_case(int num_agents, int k) {
-    if (num_agents <= 0 || num_agents > MAX_AGENTS || k <= 0 || k > num_agents) {
+    int pool_size = preference_pool_size(num_agents, num_agents);
+    if (num_agents <= 0 || pool_size < 0 || k <= 0 || k > num_agents) {
         return NULL;
     }
     
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    problem_instance_t* instance = create_problem_instance(num_agents, HOUSE_ALLOCATION,
+                                                           pool_size, false);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = num_agents;
-    instance->model = HOUSE_ALLOCATION;
     instance->model_data.house_data.num_houses = num_agents;
     
     // Create a case where agents have very similar preferences
     // This makes it more likely that a k-stable matching exists
     for (int i = 0; i < num_agents; i++) {
-        instance->agents[i].id = i;
-        instance->agents[i].num_preferences = num_agents;
+        int* preferences = instance_add_agent(instance, num_agents);
         
         // Each agent prefers houses in a similar order
         for (int j = 0; j < num_agents; j++) {
-            instance->agents[i].preferences[j] = (i + j) % num_agents;
+            preferences[j] = (i + j) % num_agents;
         }
     }
     
+    if (!instance_finalize(instance)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
 // Generate a test case where k-stable matching is unlikely to exist
 problem_instance_t* generate_k_stable_unlikely_case(int num_agents, int k) {
-    if (num_agents <= 0 || num_agents > MAX_AGENTS || k <= 0 || k > num_agents) {
+    int pool_size = preference_pool_size(num_agents, num_agents);
+    if (num_agents <= 0 || pool_size < 0 || k <= 0 || k > num_agents) {
         return NULL;
     }
     
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    problem_instance_t* instance = create_problem_instance(num_agents, HOUSE_ALLOCATION,
+                                                           pool_size, false);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = num_agents;
-    instance->model = HOUSE_ALLOCATION;
     instance->model_data.house_data.num_houses = num_agents;
     
     // Create a case where agents have very different preferences
     // This makes it less likely that a k-stable matching exists
     for (int i = 0; i < num_agents; i++) {
-        instance->agents[i].id = i;
-        instance->agents[i].num_preferences = num_agents;
+        int* preferences = instance_add_agent(instance, num_agents);
         
         // Each agent has completely different preferences
         for (int j = 0; j < num_agents; j++) {
-            instance->agents[i].preferences[j] = (num_agents - 1 - j + i) % num_agents;
+            preferences[j] = (num_agents - 1 - j + i) % num_agents;
         }
     }
     
+    if (!instance_finalize(instance)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
@@ -269,14 +695,15 @@ void print_problem_instance(const problem_instance_t* instance) {
         return;
     }
     
-    const char* model_names[] = {"House Allocation", "Marriage", "Roommates"};
+    const char* model_names[] = {"House Allocation", "Marriage", "Roommates", "House Allocation (partial)"};
     printf("Problem Instance (Model: %s, Agents: %d):\n", 
            model_names[instance->model], instance->num_agents);
     
     for (int i = 0; i < instance->num_agents; i++) {
+        const int* preferences = instance_preferences(instance, i);
         printf("  Agent %d preferences: ", i);
-        for (int j = 0; j < instance->agents[i].num_preferences; j++) {
-            printf("%d ", instance->agents[i].preferences[j]);
+        for (int j = 0; j < instance_num_preferences(instance, i); j++) {
+            printf("%d ", preferences[j]);
         }
         printf("\n");
     }
@@ -284,148 +711,272 @@ void print_problem_instance(const problem_instance_t* instance) {
 
 // Generate k-hai instance with partial preferences
 problem_instance_t* generate_k_hai_instance(int num_agents, int num_objects, uint32_t seed) {
-    if (num_agents <= 0 || num_objects <= 0 || num_agents > MAX_AGENTS || num_objects > MAX_AGENTS) {
+    return k_hai_into(NULL, num_agents, num_objects, seed, false);
+}
+
+// Generate k-hai instance with indifferences
+problem_instance_t* generate_k_hai_with_indifferences(int num_agents, int num_objects, uint32_t seed) {
+    return k_hai_into(NULL, num_agents, num_objects, seed, true);
+}
+
+static problem_instance_t* k_hai_into(problem_instance_t* buffer, int num_agents, int num_objects, uint32_t seed,
+                                      bool with_ties) {
+    if (num_agents <= 0 || num_objects <= 0 || preference_pool_size(num_agents, num_objects) < 0) {
+        destroy_problem_instance(buffer);
         return NULL;
     }
     
-    lcg_seed(seed);
-    
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    // Expected list length is about half the objects; the pool grows if needed
+    problem_instance_t* instance = reuse_problem_instance(buffer, num_agents, HOUSE_ALLOCATION_PARTIAL,
+                                                          num_agents * (num_objects / 2 + 1), with_ties);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = num_agents;
-    instance->model = HOUSE_ALLOCATION_PARTIAL;
     instance->model_data.house_partial_data.num_houses = num_objects;
     
-    // Initialize agents with partial preferences
+    // Each agent finds a random number of objects acceptable (at least 1, at most num_objects)
     for (int i = 0; i < num_agents; i++) {
-        instance->agents[i].id = i;
-        instance->agents[i].has_indifferences = false;
-        
-        // Determine how many objects this agent finds acceptable (at least 1, at most num_objects)
-        int num_acceptable = 1 + (lcg_rand() % num_objects);
-        instance->agents[i].num_preferences = num_acceptable;
-        instance->model_data.house_partial_data.num_acceptable_objects[i] = num_acceptable;
-        
-        // Create list of all objects
-        int all_objects[MAX_AGENTS];
-        for (int j = 0; j < num_objects; j++) {
-            all_objects[j] = j;
-        }
-        
-        // Shuffle and take first num_acceptable objects
-        shuffle_array(all_objects, num_objects);
-        
-        // Set preferences (only over acceptable objects)
-        for (int j = 0; j < num_acceptable; j++) {
-            instance->agents[i].preferences[j] = all_objects[j];
-        }
-        
-        // Initialize indifference groups (no indifferences by default)
-        for (int j = 0; j < num_acceptable; j++) {
-            instance->agents[i].indifference_groups[j] = j; // Each object in its own group
+        if (instance_add_agent(instance, partial_list_length(seed, i, num_objects)) == NULL) {
+            destroy_problem_instance(instance);
+            return NULL;
         }
     }
+    generation_t generation = { instance, seed, num_objects,
+                                with_ties ? fill_partial_list_with_ties : fill_partial_list, num_objects, NULL };
     
+    if (!generate_agent_lists(&generation) || !finalize_instance(instance, buffer == NULL)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
     return instance;
 }
 
-// Generate k-hai instance with indifferences
-problem_instance_t* generate_k_hai_with_indifferences(int num_agents, int num_objects, uint32_t seed) {
-    if (num_agents <= 0 || num_objects <= 0 || num_agents > MAX_AGENTS || num_objects > MAX_AGENTS) {
+// Generate a large-market house allocation instance with truncated preferences:
+// every agent ranks list_length distinct houses drawn uniformly from num_agents.
+// Memory is proportional to num_agents * list_length, so n = 10^5 and beyond is fine.
+problem_instance_t* generate_truncated_house_allocation(int num_agents, int list_length, uint32_t seed) {
+    return truncated_house_allocation_into(NULL, num_agents, list_length, seed);
+}
+
+static problem_instance_t* truncated_house_allocation_into(problem_instance_t* buffer, int num_agents,
+                                                           int list_length, uint32_t seed) {
+    int pool_size = preference_pool_size(num_agents, list_length);
+    if (num_agents <= 0 || list_length <= 0 || list_length > num_agents || pool_size < 0) {
+        destroy_problem_instance(buffer);
         return NULL;
     }
     
-    lcg_seed(seed);
-    
-    problem_instance_t* instance = malloc(sizeof(problem_instance_t));
+    problem_instance_t* instance = reuse_problem_instance(buffer, num_agents, HOUSE_ALLOCATION_PARTIAL,
+                                                          pool_size, false);
     if (instance == NULL) {
         return NULL;
     }
     
-    instance->num_agents = num_agents;
-    instance->model = HOUSE_ALLOCATION_PARTIAL;
-    instance->model_data.house_partial_data.num_houses = num_objects;
+    instance->model_data.house_partial_data.num_houses = num_agents;
     
-    // Initialize agents with partial preferences and indifferences
     for (int i = 0; i < num_agents; i++) {
-        instance->agents[i].id = i;
-        
-        // Determine how many objects this agent finds acceptable
-        int num_acceptable = 1 + (lcg_rand() % num_objects);
-        instance->agents[i].num_preferences = num_acceptable;
-        instance->model_data.house_partial_data.num_acceptable_objects[i] = num_acceptable;
-        
-        // Create list of all objects
-        int all_objects[MAX_AGENTS];
-        for (int j = 0; j < num_objects; j++) {
-            all_objects[j] = j;
+        instance_add_agent(instance, list_length);
+    }
+    
+    // Scratch: last_listed[h] = last agent (of this worker) that drew house h,
+    // to reject duplicates in O(1)
+    generation_t generation = { instance, seed, num_agents, fill_truncated_list, num_agents, NULL };
+    
+    if (!generate_agent_lists(&generation) || !finalize_instance(instance, buffer == NULL)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
+    return instance;
+}
+
+// Fill every added agent's list, on worker threads once the instance is large
+static bool generate_agent_lists(generation_t* generation) {
+    problem_instance_t* instance = generation->instance;
+    int num_agents = instance->num_agents;
+    int num_threads = 1;
+    if (instance->pref_offsets[num_agents] >= PARALLEL_GENERATION_MIN_ENTRIES) {
+        int num_chunks = (num_agents + GENERATION_CHUNK_AGENTS - 1) / GENERATION_CHUNK_AGENTS;
+        num_threads = default_thread_count();
+        if (num_threads > num_chunks) {
+            num_threads = num_chunks;
         }
-        
-        // Shuffle and take first num_acceptable objects
-        shuffle_array(all_objects, num_objects);
-        
-        // Set preferences
-        for (int j = 0; j < num_acceptable; j++) {
-            instance->agents[i].preferences[j] = all_objects[j];
+    }
+    
+    if (generation->scratch_size > 0) {
+        size_t scratch_ints = (size_t)num_threads * generation->scratch_size;
+        generation->scratch = malloc(scratch_ints * sizeof(int));
+        if (generation->scratch == NULL) {
+            return false;
         }
-        
-        // Create indifferences (ties) in preferences
-        instance->agents[i].has_indifferences = (lcg_rand() % 3 == 0); // 1/3 chance of having indifferences
-        
-        if (instance->agents[i].has_indifferences && num_acceptable >= 2) {
-            // Create some indifference groups
-            int num_groups = 1 + (lcg_rand() % (num_acceptable / 2 + 1));
-            int group_id = 0;
-            
-            for (int j = 0; j < num_acceptable; j++) {
-                instance->agents[i].indifference_groups[j] = group_id;
-                // Move to next group with some probability
-                if (j < num_acceptable - 1 && lcg_rand() % 3 == 0) {
-                    group_id++;
-                }
-            }
-        } else {
-            // No indifferences
-            for (int j = 0; j < num_acceptable; j++) {
-                instance->agents[i].indifference_groups[j] = j;
+        for (size_t i = 0; i < scratch_ints; i++) {
+            generation->scratch[i] = -1;
+        }
+    }
+    
+    bool ok = parallel_for_chunks((uint64_t)num_agents, GENERATION_CHUNK_AGENTS, num_threads,
+                                  generate_agent_chunk, generation);
+    free(generation->scratch);
+    generation->scratch = NULL;
+    return ok;
+}
+
+static void generate_agent_chunk(void* context, int worker, uint64_t begin, uint64_t end) {
+    generation_t* generation = context;
+    int* scratch = (generation->scratch != NULL) ?
+                   generation->scratch + (size_t)worker * generation->scratch_size : NULL;
+    for (uint64_t agent = begin; agent < end; agent++) {
+        generation->fill(generation, (int)agent, scratch);
+    }
+}
+
+// An added agent's slice of the preference pool
+static int* agent_slice(const generation_t* generation, int agent, int* length) {
+    const problem_instance_t* instance = generation->instance;
+    *length = instance->pref_offsets[agent + 1] - instance->pref_offsets[agent];
+    return instance->preferences + instance->pref_offsets[agent];
+}
+
+// Length of a partial list: the first draw of the agent's stream
+static int partial_list_length(uint32_t seed, int agent, int num_objects) {
+    rng_stream_t stream = rng_stream(seed, agent);
+    return 1 + rng_below(&stream, num_objects);
+}
+
+// All houses 0 to num_choices-1, shuffled
+static void fill_house_list(const generation_t* generation, int agent, int* scratch) {
+    (void)scratch;
+    int length;
+    int* preferences = agent_slice(generation, agent, &length);
+    for (int j = 0; j < length; j++) {
+        preferences[j] = j;
+    }
+    rng_stream_t stream = rng_stream(generation->seed, agent);
+    shuffle_array(preferences, length, &stream);
+}
+
+// Men rank women num_men to num_men+num_women-1, women rank men 0 to num_men-1
+static void fill_marriage_list(const generation_t* generation, int agent, int* scratch) {
+    (void)scratch;
+    int num_men = generation->instance->model_data.marriage_data.num_men;
+    int first = (agent < num_men) ? num_men : 0;
+    int length;
+    int* preferences = agent_slice(generation, agent, &length);
+    for (int j = 0; j < length; j++) {
+        preferences[j] = first + j;
+    }
+    rng_stream_t stream = rng_stream(generation->seed, agent);
+    shuffle_array(preferences, length, &stream);
+}
+
+// All other agents, shuffled
+static void fill_roommates_list(const generation_t* generation, int agent, int* scratch) {
+    (void)scratch;
+    int length;
+    int* preferences = agent_slice(generation, agent, &length);
+    int pref_count = 0;
+    for (int j = 0; j < generation->num_choices; j++) {
+        if (j != agent) {  // Don't include self in preferences
+            preferences[pref_count++] = j;
+        }
+    }
+    rng_stream_t stream = rng_stream(generation->seed, agent);
+    shuffle_array(preferences, length, &stream);
+}
+
+// Shuffle all objects in scratch and take the first ones; the stream's first
+// draw (the list length) was already spent by partial_list_length
+static void fill_partial_list(const generation_t* generation, int agent, int* scratch) {
+    int num_acceptable;
+    int* preferences = agent_slice(generation, agent, &num_acceptable);
+    rng_stream_t stream = rng_stream(generation->seed, agent);
+    rng_next(&stream);
+    
+    for (int j = 0; j < generation->num_choices; j++) {
+        scratch[j] = j;
+    }
+    shuffle_array(scratch, generation->num_choices, &stream);
+    memcpy(preferences, scratch, num_acceptable * sizeof(int));
+}
+
+// A partial list whose agent has indifferences with probability 1/3, splitting
+// it into tie groups at each position with probability 1/3
+static void fill_partial_list_with_ties(const generation_t* generation, int agent, int* scratch) {
+    problem_instance_t* instance = generation->instance;
+    int num_acceptable;
+    int* preferences = agent_slice(generation, agent, &num_acceptable);
+    rng_stream_t stream = rng_stream(generation->seed, agent);
+    rng_next(&stream);
+    
+    for (int j = 0; j < generation->num_choices; j++) {
+        scratch[j] = j;
+    }
+    shuffle_array(scratch, generation->num_choices, &stream);
+    memcpy(preferences, scratch, num_acceptable * sizeof(int));
+    
+    // Create indifferences (ties) in preferences
+    int* tie_groups = instance->tie_groups + instance->pref_offsets[agent];
+    instance->has_indifferences[agent] = (rng_below(&stream, 3) == 0);
+    
+    if (instance->has_indifferences[agent] && num_acceptable >= 2) {
+        int group_id = 0;
+        for (int j = 0; j < num_acceptable; j++) {
+            tie_groups[j] = group_id;
+            // Move to next group with some probability
+            if (j < num_acceptable - 1 && rng_below(&stream, 3) == 0) {
+                group_id++;
             }
         }
+    } else {
+        // No indifferences
+        for (int j = 0; j < num_acceptable; j++) {
+            tie_groups[j] = j;
+        }
     }
+}
+
+// Draw distinct houses by rejection (cheap while list_length is well below num_agents)
+static void fill_truncated_list(const generation_t* generation, int agent, int* scratch) {
+    int list_length;
+    int* preferences = agent_slice(generation, agent, &list_length);
+    rng_stream_t stream = rng_stream(generation->seed, agent);
     
-    return instance;
+    int count = 0;
+    while (count < list_length) {
+        int house = rng_below(&stream, generation->num_choices);
+        if (scratch[house] != agent) {
+            scratch[house] = agent;
+            preferences[count++] = house;
+        }
+    }
 }
 
 // Check if an object is acceptable to an agent (for k-hai)
-bool is_object_acceptable_to_agent(const agent_t* agent, int object_id, int num_objects) {
-    if (agent == NULL || object_id < 0 || object_id >= num_objects) {
+bool is_object_acceptable_to_agent(const problem_instance_t* instance, int agent, int object_id) {
+    if (instance == NULL || agent < 0 || agent >= instance->num_agents) {
         return false;
     }
     
-    // Check if object is in agent's preference list
-    for (int i = 0; i < agent->num_preferences; i++) {
-        if (agent->preferences[i] == object_id) {
-            return true;
-        }
+    int num_objects = (instance->model == HOUSE_ALLOCATION_PARTIAL) ?
+                      instance->model_data.house_partial_data.num_houses : instance->num_agents;
+    if (object_id < 0 || object_id >= num_objects) {
+        return false;
     }
     
-    return false;
+    // Check if object is in agent's preference list
+    return get_agent_rank(instance, agent, object_id) != -1;
 }
 
 // Check if an agent is indifferent between two objects (for k-hai)
-bool agent_indifferent_between(const agent_t* agent, int obj1, int obj2) {
-    if (agent == NULL || !agent->has_indifferences) {
+bool agent_indifferent_between(const problem_instance_t* instance, int agent, int obj1, int obj2) {
+    if (instance == NULL || agent < 0 || agent >= instance->num_agents ||
+        instance->has_indifferences == NULL || !instance->has_indifferences[agent]) {
         return false;
     }
     
     // Find the positions of obj1 and obj2 in preferences
-    int pos1 = -1, pos2 = -1;
-    for (int i = 0; i < agent->num_preferences; i++) {
-        if (agent->preferences[i] == obj1) pos1 = i;
-        if (agent->preferences[i] == obj2) pos2 = i;
-    }
+    int pos1 = get_agent_rank(instance, agent, obj1);
+    int pos2 = get_agent_rank(instance, agent, obj2);
     
     // If either object is not in preferences, they're not indifferent
     if (pos1 == -1 || pos2 == -1) {
@@ -433,5 +984,368 @@ bool agent_indifferent_between(const agent_t* agent, int obj1, int obj2) {
     }
     
     // Check if they're in the same indifference group
-    return agent->indifference_groups[pos1] == agent->indifference_groups[pos2];
+    const int* tie_groups = instance_tie_groups(instance, agent);
+    return tie_groups[pos1] == tie_groups[pos2];
+}
+
+// ---------------------------------------------------------------------------
+// Binary instance files
+//
+// A file is a 72-byte header followed by the instance arrays, each starting
+// on an 8-byte boundary and zero-padded to one:
+//   pref_offsets       int32[num_agents + 1]
+//   preferences        int32[num_preferences]
+//   tie_groups         int32[num_preferences]      (INSTANCE_FILE_TIES only)
+//   has_indifferences  uint8[num_agents]           (INSTANCE_FILE_TIES only)
+//   rank_table         int32[num_agents * num_targets]   (INSTANCE_FILE_DENSE)
+// or rank_hash_offsets int32[num_agents + 1] and
+//    rank_hash_slots   int32[rank_hash_offsets[num_agents]]
+// The rank index is stored as built by instance_finalize, so a loaded
+// instance maps the file and points into it without building or copying
+// anything. Integers are in host byte order; byte_order tells a file written
+// on a host of the other endianness apart. checksum is a 64-bit FNV-1a over
+// the payload words.
+// ---------------------------------------------------------------------------
+
+#define INSTANCE_FILE_MAGIC "KSTABLE\0"
+#define INSTANCE_FILE_VERSION 1
+#define INSTANCE_FILE_BYTE_ORDER 0x01020304u
+#define INSTANCE_FILE_TIES  0x1u
+#define INSTANCE_FILE_DENSE 0x2u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_bytes;
+    uint32_t flags;
+    int32_t model;
+    int32_t num_agents;
+    int32_t model_data[2];        // num_men / num_women, or num_houses
+    int32_t num_targets;
+    int32_t num_preferences;
+    int32_t num_hash_slots;       // 0 if the rank index is dense
+    uint32_t reserved;
+    uint64_t payload_bytes;
+    uint64_t checksum;
+} instance_file_header_t;
+
+// Byte length of one payload section, padded to 8 bytes
+static size_t instance_section_bytes(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+static uint64_t instance_checksum(const unsigned char* payload, size_t bytes) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t offset = 0; offset < bytes; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, payload + offset, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Payload bytes for the counts recorded in a header (0 if they are out of range)
+static size_t instance_payload_bytes(const instance_file_header_t* header) {
+    size_t n = (size_t)header->num_agents;
+    size_t m = (size_t)header->num_preferences;
+    size_t bytes = instance_section_bytes((n + 1) * sizeof(int32_t)) +
+                   instance_section_bytes(m * sizeof(int32_t));
+    if (header->flags & INSTANCE_FILE_TIES) {
+        bytes += instance_section_bytes(m * sizeof(int32_t)) + instance_section_bytes(n);
+    }
+    if (header->flags & INSTANCE_FILE_DENSE) {
+        if (header->num_targets > 0 && n > SIZE_MAX / sizeof(int32_t) / (size_t)header->num_targets) {
+            return 0;
+        }
+        bytes += instance_section_bytes(n * (size_t)header->num_targets * sizeof(int32_t));
+    } else {
+        bytes += instance_section_bytes((n + 1) * sizeof(int32_t)) +
+                 instance_section_bytes((size_t)header->num_hash_slots * sizeof(int32_t));
+    }
+    return bytes;
+}
+
+// Append one section to the payload buffer, zero-padding it to 8 bytes
+static unsigned char* instance_put_section(unsigned char* out, const void* data, size_t bytes) {
+    size_t padded = instance_section_bytes(bytes);
+    if (bytes > 0) {
+        memcpy(out, data, bytes);
+    }
+    memset(out + bytes, 0, padded - bytes);
+    return out + padded;
+}
+
+// Write a finalized instance to path. Returns false on any I/O error.
+bool save_problem_instance(const problem_instance_t* instance, const char* path) {
+    if (instance == NULL || path == NULL || sizeof(int) != sizeof(int32_t) || sizeof(bool) != 1 ||
+        (instance->rank_table == NULL && instance->rank_hash_offsets == NULL)) {
+        return false;
+    }
+    
+    int n = instance->num_agents;
+    instance_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INSTANCE_FILE_MAGIC, sizeof(header.magic));
+    header.version = INSTANCE_FILE_VERSION;
+    header.byte_order = INSTANCE_FILE_BYTE_ORDER;
+    header.header_bytes = sizeof(header);
+    header.flags = (instance->tie_groups != NULL ? INSTANCE_FILE_TIES : 0) |
+                   (instance->rank_table != NULL ? INSTANCE_FILE_DENSE : 0);
+    header.model = instance->model;
+    header.num_agents = n;
+    if (instance->model == MARRIAGE) {
+        header.model_data[0] = instance->model_data.marriage_data.num_men;
+        header.model_data[1] = instance->model_data.marriage_data.num_women;
+    } else {
+        header.model_data[0] = instance->model_data.house_data.num_houses;
+    }
+    header.num_targets = instance->num_targets;
+    header.num_preferences = instance->pref_offsets[n];
+    header.num_hash_slots = (instance->rank_table == NULL) ? instance->rank_hash_offsets[n] : 0;
+    header.payload_bytes = instance_payload_bytes(&header);
+    if (header.payload_bytes == 0) {
+        return false;
+    }
+    
+    unsigned char* payload = malloc(header.payload_bytes);
+    if (payload == NULL) {
+        return false;
+    }
+    size_t m = (size_t)header.num_preferences;
+    unsigned char* out = payload;
+    out = instance_put_section(out, instance->pref_offsets, (size_t)(n + 1) * sizeof(int));
+    out = instance_put_section(out, instance->preferences, m * sizeof(int));
+    if (header.flags & INSTANCE_FILE_TIES) {
+        out = instance_put_section(out, instance->tie_groups, m * sizeof(int));
+        out = instance_put_section(out, instance->has_indifferences, (size_t)n);
+    }
+    if (header.flags & INSTANCE_FILE_DENSE) {
+        out = instance_put_section(out, instance->rank_table,
+                                   (size_t)n * instance->num_targets * sizeof(int));
+    } else {
+        out = instance_put_section(out, instance->rank_hash_offsets, (size_t)(n + 1) * sizeof(int));
+        out = instance_put_section(out, instance->rank_hash_slots,
+                                   (size_t)header.num_hash_slots * sizeof(int));
+    }
+    header.checksum = instance_checksum(payload, header.payload_bytes);
+    
+    FILE* file = fopen(path, "wb");
+    bool ok = file != NULL &&
+              fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(payload, 1, header.payload_bytes, file) == header.payload_bytes;
+    if (file != NULL && fclose(file) != 0) {
+        ok = false;
+    }
+    free(payload);
+    return ok;
+}
+
+// Take the next section of count int32 entries from the mapped payload
+static const int* instance_take_ints(const unsigned char** cursor, size_t count) {
+    const int* section = (const int*)*cursor;
+    *cursor += instance_section_bytes(count * sizeof(int32_t));
+    return section;
+}
+
+// Check that offsets[0..n] start at 0, never decrease and end at total
+static bool instance_offsets_valid(const int* offsets, int n, int total) {
+    if (offsets[0] != 0 || offsets[n] != total) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        if (offsets[i + 1] < offsets[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check the stored arrays against the header so lookups stay inside them,
+// terminate and return the rank a scan of the list would find
+static bool instance_view_valid(const problem_instance_t* instance) {
+    int n = instance->num_agents;
+    int m = instance->pref_offsets[n];
+    for (int i = 0; i < m; i++) {
+        if (instance->preferences[i] < 0 || instance->preferences[i] >= instance->num_targets) {
+            return false;
+        }
+    }
+    
+    // Model metadata must describe the agents and targets actually listed:
+    // partners are agents, and every listed house exists (a partial model may
+    // also have houses nobody lists)
+    switch (instance->model) {
+        case MARRIAGE:
+            if (instance->model_data.marriage_data.num_men < 0 || instance->model_data.marriage_data.num_women < 0 ||
+                (long long)instance->model_data.marriage_data.num_men +
+                    instance->model_data.marriage_data.num_women != n ||
+                instance->num_targets > n) {
+                return false;
+            }
+            break;
+        case ROOMMATES:
+            if (instance->num_targets > n) {
+                return false;
+            }
+            break;
+        case HOUSE_ALLOCATION:
+            if (instance->model_data.house_data.num_houses != instance->num_targets) {
+                return false;
+            }
+            break;
+        case HOUSE_ALLOCATION_PARTIAL:
+            if (instance->model_data.house_partial_data.num_houses < instance->num_targets) {
+                return false;
+            }
+            break;
+    }
+
+    // Every stored rank must point at an entry for its target, and every listed
+    // target must resolve to its first occurrence in the list
+    if (instance->rank_table != NULL) {
+        for (int agent = 0; agent < n; agent++) {
+            const int* row = instance->rank_table + (size_t)agent * instance->num_targets;
+            const int* preferences = instance_preferences(instance, agent);
+            int length = instance_num_preferences(instance, agent);
+            for (int target = 0; target < instance->num_targets; target++) {
+                if (row[target] < RANK_UNACCEPTABLE || row[target] >= length ||
+                    (row[target] != RANK_UNACCEPTABLE && preferences[row[target]] != target)) {
+                    return false;
+                }
+            }
+            for (int r = 0; r < length; r++) {
+                int rank = row[preferences[r]];
+                if (rank == RANK_UNACCEPTABLE || rank > r) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+    if (!instance_offsets_valid(instance->rank_hash_offsets, n, instance->rank_hash_offsets[n])) {
+        return false;
+    }
+    for (int agent = 0; agent < n; agent++) {
+        int begin = instance->rank_hash_offsets[agent];
+        int size = instance->rank_hash_offsets[agent + 1] - begin;
+        int length = instance_num_preferences(instance, agent);
+        // Open addressing needs a power-of-two table with at least one empty slot
+        if ((size & (size - 1)) != 0 || (length > 0 && size <= length)) {
+            return false;
+        }
+        int empty_slots = 0;
+        for (int s = 0; s < size; s++) {
+            int rank = instance->rank_hash_slots[begin + s];
+            if (rank < RANK_UNACCEPTABLE || rank >= length) {
+                return false;
+            }
+            empty_slots += rank == RANK_UNACCEPTABLE;
+        }
+        // Without an empty slot a probe for an unlisted target never ends
+        if (size > 0 && empty_slots == 0) {
+            return false;
+        }
+        
+        // Probes now terminate; each stored rank must be the one its target
+        // resolves to, and each listed target must resolve to its first occurrence
+        const int* preferences = instance_preferences(instance, agent);
+        for (int s = 0; s < size; s++) {
+            int rank = instance->rank_hash_slots[begin + s];
+            if (rank != RANK_UNACCEPTABLE && instance_rank_hashed(instance, agent, preferences[rank]) != rank) {
+                return false;
+            }
+        }
+        for (int r = 0; r < length; r++) {
+            int rank = instance_rank_hashed(instance, agent, preferences[r]);
+            if (rank == RANK_UNACCEPTABLE || rank > r) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Map an instance file read-only and return an instance whose arrays point
+// into the mapping (released by destroy_problem_instance). Returns NULL if the
+// file cannot be mapped or fails the format, size or checksum checks.
+problem_instance_t* load_problem_instance(const char* path) {
+    if (path == NULL || sizeof(int) != sizeof(int32_t) || sizeof(bool) != 1) {
+        return NULL;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(instance_file_header_t)) {
+        close(fd);
+        return NULL;
+    }
+    size_t file_bytes = (size_t)info.st_size;
+    void* mapping = mmap(NULL, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    
+    const instance_file_header_t* header = mapping;
+    const unsigned char* payload = (const unsigned char*)mapping + sizeof(instance_file_header_t);
+    bool ok = memcmp(header->magic, INSTANCE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == INSTANCE_FILE_VERSION &&
+              header->byte_order == INSTANCE_FILE_BYTE_ORDER &&
+              header->header_bytes == sizeof(instance_file_header_t) &&
+              header->model >= HOUSE_ALLOCATION && header->model <= HOUSE_ALLOCATION_PARTIAL &&
+              header->num_agents > 0 && header->num_agents < INT_MAX &&
+              header->num_preferences >= 0 && header->num_targets > 0 && header->num_hash_slots >= 0 &&
+              header->payload_bytes == file_bytes - sizeof(instance_file_header_t) &&
+              header->payload_bytes == instance_payload_bytes(header) &&
+              header->checksum == instance_checksum(payload, header->payload_bytes);
+    
+    problem_instance_t* instance = ok ? calloc(1, sizeof(problem_instance_t)) : NULL;
+    if (instance == NULL) {
+        munmap(mapping, file_bytes);
+        return NULL;
+    }
+    
+    int n = header->num_agents;
+    size_t m = (size_t)header->num_preferences;
+    instance->num_agents = n;
+    instance->model = (matching_model_t)header->model;
+    instance->num_targets = header->num_targets;
+    instance->pref_capacity = (int)m;
+    instance->num_agents_added = n;
+    if (instance->model == MARRIAGE) {
+        instance->model_data.marriage_data.num_men = header->model_data[0];
+        instance->model_data.marriage_data.num_women = header->model_data[1];
+    } else {
+        instance->model_data.house_data.num_houses = header->model_data[0];
+    }
+    
+    // The arrays are never written through a loaded instance
+    const unsigned char* cursor = payload;
+    instance->pref_offsets = (int*)instance_take_ints(&cursor, (size_t)n + 1);
+    instance->preferences = (int*)instance_take_ints(&cursor, m);
+    if (header->flags & INSTANCE_FILE_TIES) {
+        instance->tie_groups = (int*)instance_take_ints(&cursor, m);
+        instance->has_indifferences = (bool*)cursor;
+        cursor += instance_section_bytes((size_t)n);
+    }
+    if (header->flags & INSTANCE_FILE_DENSE) {
+        instance->rank_table = (int*)instance_take_ints(&cursor, (size_t)n * header->num_targets);
+    } else {
+        instance->rank_hash_offsets = (int*)instance_take_ints(&cursor, (size_t)n + 1);
+        instance->rank_hash_slots = (int*)instance_take_ints(&cursor, (size_t)header->num_hash_slots);
+    }
+    instance->mapping = mapping;
+    instance->mapping_bytes = file_bytes;
+    
+    if (!instance_offsets_valid(instance->pref_offsets, n, (int)m) || !instance_view_valid(instance) ||
+        (instance->rank_table == NULL && instance->rank_hash_offsets[n] != header->num_hash_slots)) {
+        destroy_problem_instance(instance);
+        return NULL;
+    }
+    return instance;
 }
@@ -14,16 +14,226 @@ void print_usage(const char* program_name) {
     printf("  --generate MODEL N  Generate random instance (house|marriage|roommates) with N agents\n");
     printf("  --verify-model MODEL N K  Test verification with specific model\n");
     printf("  --existence-model MODEL N K  Test existence with specific model\n");
-    printf("  --brute-force N     Run brute force analysis for small instances (n <= N)\n");
+    printf("  --existence-parallel MODEL N K T  Exact parallel existence search with T threads\n");
+    printf("  --brute-force N     Run brute force analysis for small instances (n <= N; n = 6 sampled)\n");
     printf("  --large-random MIN MAX TRIALS  Run large random instances analysis\n");
     printf("  --comprehensive     Run comprehensive analysis (brute force + large random)\n");
     printf("  --key-k-values      Analyze key k values (constant and proportional)\n");
     printf("  --k-hai N O T       Run k-hai comparison (N agents, O objects, T trials)\n");
     printf("  --partial-vs-complete N T  Compare partial vs complete preferences\n");
     printf("  --k-hai-patterns N O T     Analyze k-hai existence patterns\n");
-    printf("  --brute-force-house N K    Run brute force house allocation analysis\n");
+    printf("  --brute-force-house N K [S [T]]  Run brute force house allocation analysis (n <= 12)\n");
+    printf("                             on T threads (default: all cores), listing S matchings\n");
+    printf("                             (default: all for n <= 4)\n");
     printf("  --brute-force-all          Run brute force analysis for multiple n,k values\n");
+    printf("  --scaling L T       Verification scaling at n=10^3..10^5 (lists of L houses, T trials)\n");
+    printf("  --search-stats N T  Existence search statistics per k (N agents, T trials)\n");
+    printf("  --count MODEL N K   Count k-stable matchings (with the dp backend: and their\n");
+    printf("                      blocking-number distribution)\n");
     printf("  --help              Show this help message\n");
+    printf("Instance files:\n");
+    printf("  --load FILE         Run --verify/--existence modes (without MODEL and N) on a saved\n");
+    printf("                      instance, print it with --generate, or time it with --benchmark [T]\n");
+    printf("  --save FILE         Save the instance a --generate/--verify/--existence mode ran on\n");
+    printf("Result records:\n");
+    printf("  --output FILE       Stream one record per benchmark trial to FILE ('-' for stdout)\n");
+    printf("  --output-format F   Record format: jsonl (default) or csv\n");
+    printf("Benchmark trials:\n");
+    printf("  --threads T         Run benchmark trials on T worker threads (default: all cores)\n");
+    printf("  --seed S            Base seed of benchmark instances (default: 1); trial seeds are S plus\n");
+    printf("                      a per-trial offset, so runs are reproducible for any --threads\n");
+    printf("Search:\n");
+    printf("  --table-mb M        Transposition table size for the existence and counting searches\n");
+    printf("                      in MiB (default: 16; 0 disables it)\n");
+    printf("  --count-backend B   How --count and count_k_stable_matchings count: recursive (default)\n");
+    printf("                      or dp (subset dynamic programming for house allocation with n <= %d;\n",
+           COUNT_DP_MAX_N);
+    printf("                      other models stay recursive. On random preferences its memo rarely\n");
+    printf("                      hits, so it is a pruned search whose time grows quickly with n and k)\n");
+    printf("  --memo-mb M         Memo budget of the dp backend in MiB (default: 256; 0 disables it);\n");
+    printf("                      subproblems past it are solved uncached\n");
+    printf("Profiling:\n");
+    printf("  --profile           Print wall and CPU time per phase (generate, search, verify, ...) at exit\n");
+}
+
+// Global options, taken out of argv before the mode is parsed
+static const char* load_path = NULL;
+static const char* save_path = NULL;
+static const char* output_path = NULL;
+static const char* output_format = NULL;
+static bool print_profile = false;
+
+// Remove --profile, and --load, --save, --output, --output-format, --threads,
+// --seed, --table-mb, --memo-mb and --count-backend (each with its value), from argv. Returns the remaining
+// argument count, or -1 if an option lacks its value or the value is out of range.
+static int extract_global_options(int argc, char* argv[]) {
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            print_profile = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--table-mb") == 0) {
+            char* end = NULL;
+            long long megabytes = (i + 1 < argc) ? strtoll(argv[i + 1], &end, 10) : -1;
+            if (end == NULL || end == argv[i + 1] || *end != '\0' || megabytes < 0 || megabytes > 65536) {
+                printf("Error: --table-mb requires a size from 0 to 65536 (MiB)\n");
+                return -1;
+            }
+            if (!transposition_table_configure((size_t)megabytes << 20)) {
+                printf("Error: Could not allocate a %lld MiB transposition table\n", megabytes);
+                return -1;
+            }
+            i++;
+            continue;
+        }
+        if (strcmp(argv[i], "--memo-mb") == 0) {
+            char* end = NULL;
+            long long megabytes = (i + 1 < argc) ? strtoll(argv[i + 1], &end, 10) : -1;
+            if (end == NULL || end == argv[i + 1] || *end != '\0' || megabytes < 0 || megabytes > 65536) {
+                printf("Error: --memo-mb requires a size from 0 to 65536 (MiB)\n");
+                return -1;
+            }
+            set_count_memo_budget((size_t)megabytes << 20);
+            i++;
+            continue;
+        }
+        if (strcmp(argv[i], "--count-backend") == 0) {
+            const char* backend = (i + 1 < argc) ? argv[i + 1] : "";
+            if (strcmp(backend, "recursive") == 0) {
+                set_count_backend(COUNT_BACKEND_RECURSIVE);
+            } else if (strcmp(backend, "dp") == 0) {
+                set_count_backend(COUNT_BACKEND_SUBSET_DP);
+            } else {
+                printf("Error: --count-backend must be recursive or dp\n");
+                return -1;
+            }
+            i++;
+            continue;
+        }
+        if (strcmp(argv[i], "--threads") == 0 || strcmp(argv[i], "--seed") == 0) {
+            bool threads = strcmp(argv[i], "--threads") == 0;
+            long long min_value = threads ? 1 : 0;
+            long long max_value = threads ? 256 : (long long)UINT32_MAX;
+            char* end = NULL;
+            long long value = (i + 1 < argc) ? strtoll(argv[i + 1], &end, 10) : -1;
+            if (end == NULL || end == argv[i + 1] || *end != '\0' || value < min_value || value > max_value) {
+                printf("Error: %s requires a value from %lld to %lld\n", argv[i], min_value, max_value);
+                return -1;
+            }
+            if (threads) {
+                set_trial_threads((int)value);
+            } else {
+                set_trial_base_seed((uint32_t)value);
+            }
+            i++;
+            continue;
+        }
+        const char** target = NULL;
+        if (strcmp(argv[i], "--load") == 0) {
+            target = &load_path;
+        } else if (strcmp(argv[i], "--save") == 0) {
+            target = &save_path;
+        } else if (strcmp(argv[i], "--output") == 0) {
+            target = &output_path;
+        } else if (strcmp(argv[i], "--output-format") == 0) {
+            target = &output_format;
+        }
+        if (target == NULL) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printf("Error: %s requires a %s parameter\n", argv[i], (target == &output_format) ? "FORMAT" : "FILE");
+            return -1;
+        }
+        *target = argv[++i];
+    }
+    argv[kept] = NULL;
+    return kept;
+}
+
+// Parse a model name given on the command line
+static bool parse_model(const char* model_str, matching_model_t* model) {
+    if (strcmp(model_str, "house") == 0) {
+        *model = HOUSE_ALLOCATION;
+    } else if (strcmp(model_str, "marriage") == 0) {
+        *model = MARRIAGE;
+    } else if (strcmp(model_str, "roommates") == 0) {
+        *model = ROOMMATES;
+    } else {
+        printf("Error: Unknown model '%s'. Use: house, marriage, or roommates\n", model_str);
+        return false;
+    }
+    return true;
+}
+
+// Command-line name of a model
+static const char* model_name(matching_model_t model) {
+    const char* names[] = {"house", "marriage", "roommates", "house-partial"};
+    return names[model];
+}
+
+// Instance a single-instance mode runs on: the --load file if given, else a
+// random instance of the model with n agents. Written to the --save file if given.
+static problem_instance_t* mode_instance(matching_model_t model, int n) {
+    problem_instance_t* instance;
+    if (load_path != NULL) {
+        phase_begin("load");
+        instance = load_problem_instance(load_path);
+        phase_end(NULL);
+        if (instance == NULL) {
+            printf("Error: Could not load instance file '%s'\n", load_path);
+            return NULL;
+        }
+    } else {
+        phase_begin("generate");
+        if (model == HOUSE_ALLOCATION) {
+            instance = generate_random_house_allocation(n, time(NULL));
+        } else if (model == MARRIAGE) {
+            instance = generate_random_marriage(n/2, n/2, time(NULL));
+        } else {
+            instance = generate_random_roommates(n, time(NULL));
+        }
+        phase_end(NULL);
+    }
+    if (instance == NULL) {
+        printf("Error: Could not generate instance\n");
+        return NULL;
+    }
+    
+    if (save_path != NULL) {
+        if (save_problem_instance(instance, save_path)) {
+            printf("Saved instance to %s\n", save_path);
+        } else {
+            printf("Warning: Could not save instance to '%s'\n", save_path);
+        }
+    }
+    return instance;
+}
+
+// Simple feasible matching for verification tests: agent i gets house i,
+// man i marries woman i, roommates pair up in order
+static void build_test_matching(matching_t* matching, const problem_instance_t* instance) {
+    int n = instance->num_agents;
+    if (instance->model == HOUSE_ALLOCATION || instance->model == HOUSE_ALLOCATION_PARTIAL) {
+        int num_houses = instance->model_data.house_data.num_houses;
+        for (int i = 0; i < n; i++) {
+            matching->pairs[i] = (i < num_houses) ? i : -1;  // Agent i gets house i
+        }
+    } else if (instance->model == MARRIAGE) {
+        int num_men = instance->model_data.marriage_data.num_men;
+        int num_women = instance->model_data.marriage_data.num_women;
+        for (int i = 0; i < num_men && i < num_women; i++) {
+            matching->pairs[i] = num_men + i;
+            matching->pairs[num_men + i] = i;
+        }
+    } else {  // ROOMMATES
+        for (int i = 0; i < n - 1; i += 2) {
+            matching->pairs[i] = i + 1;
+            matching->pairs[i + 1] = i;
+        }
+    }
 }
 
 void run_basic_tests() {
@@ -52,12 +262,53 @@ void run_basic_tests() {
     printf("PASS: k-stability verification (result: %s)\n", is_stable ? "stable" : "unstable");
     
     destroy_matching(test_matching);
-    free(instance);
+    destroy_problem_instance(instance);
     
     printf("All basic tests passed!\n");
 }
 
+// Open the result sink requested with --output / --output-format
+static bool open_result_sink(void) {
+    result_format_t format = RESULT_FORMAT_JSONL;
+    if (output_format != NULL && !parse_result_format(output_format, &format)) {
+        printf("Error: Unknown output format '%s'. Use: jsonl or csv\n", output_format);
+        return false;
+    }
+    if (output_path == NULL) {
+        if (output_format != NULL) {
+            printf("Error: --output-format requires --output FILE\n");
+            return false;
+        }
+        return true;
+    }
+    if (!result_sink_open(output_path, format)) {
+        printf("Error: Could not open output file '%s'\n", output_path);
+        return false;
+    }
+    return true;
+}
+
+static int run_mode(int argc, char* argv[]);
+
 int main(int argc, char* argv[]) {
+    argc = extract_global_options(argc, argv);
+    if (argc < 0 || !open_result_sink()) {
+        return 1;
+    }
+    
+    int status = run_mode(argc, argv);
+    if (print_profile) {
+        phase_profile_print();
+    }
+    if (!result_sink_close()) {
+        printf("Error: Could not write results to '%s'\n", output_path);
+        return 1;
+    }
+    return status;
+}
+
+// Dispatch on the mode argument
+static int run_mode(int argc, char* argv[]) {
     if (argc < 2) {
         print_usage(argv[0]);
         return 1;
@@ -73,6 +324,31 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
+    if (strcmp(argv[1], "--benchmark") == 0 && load_path != NULL) {
+        int num_trials = (argc >= 3) ? atoi(argv[2]) : 10;
+        if (num_trials <= 0) {
+            printf("Error: Invalid number of trials for --benchmark\n");
+            return 1;
+        }
+        
+        problem_instance_t* instance = mode_instance(HOUSE_ALLOCATION, 0);
+        if (instance == NULL) {
+            return 1;
+        }
+        benchmark_loaded_instance(instance, num_trials);
+        destroy_problem_instance(instance);
+        return 0;
+    }
+    
+    // The remaining benchmark modes sweep generated instance sizes
+    if (load_path != NULL && strcmp(argv[1], "--generate") != 0 &&
+        strncmp(argv[1], "--verify", 8) != 0 && strncmp(argv[1], "--existence", 11) != 0 &&
+        strcmp(argv[1], "--count") != 0) {
+        printf("Error: %s sweeps generated instances; use --benchmark --load FILE [T] to time a saved one\n",
+               argv[1]);
+        return 1;
+    }
+    
     if (strcmp(argv[1], "--benchmark") == 0) {
         printf("Running computational complexity benchmarks...\n");
 
@@ -82,208 +358,303 @@ int main(int argc, char* argv[]) {
     }
     
     if (strcmp(argv[1], "--verify") == 0) {
-        if (argc < 4) {
-            printf("Error: --verify requires N and K parameters\n");
+        int num_args = (load_path != NULL) ? 3 : 4;
+        if (argc < num_args) {
+            printf("Error: --verify requires N and K parameters (only K with --load)\n");
             return 1;
         }
-        int n = atoi(argv[2]);
-        int k = atoi(argv[3]);
+        int k = atoi(argv[num_args - 1]);
+        
+        problem_instance_t* instance = mode_instance(HOUSE_ALLOCATION, atoi(argv[2]));
+        if (instance == NULL) {
+            return 1;
+        }
+        int n = instance->num_agents;
         
         printf("Testing k-stability verification with %d agents, k=%d\n", n, k);
         
-        problem_instance_t* instance = generate_random_house_allocation(n, time(NULL));
-        matching_t* matching = create_matching(n, HOUSE_ALLOCATION);
+        matching_t* matching = create_matching(n, instance->model);
         
-        clock_t start = clock();
+        stopwatch_t timer;
+        phase_begin("verify");
         bool result = is_k_stable(matching, instance, k);
-        clock_t end = clock();
+        phase_end(&timer);
         
-        double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
-        printf("Result: %s (took %.6f seconds)\n", result ? "k-stable" : "not k-stable", time_taken);
+        printf("Result: %s (took %.6f seconds, %.6f CPU seconds)\n", result ? "k-stable" : "not k-stable",
+               timer.wall_ms / 1000.0, timer.cpu_ms / 1000.0);
         
         destroy_matching(matching);
-        free(instance);
+        destroy_problem_instance(instance);
         return 0;
     }
     
     if (strcmp(argv[1], "--existence") == 0) {
-        if (argc < 4) {
-            printf("Error: --existence requires N and K parameters\n");
+        int num_args = (load_path != NULL) ? 3 : 4;
+        if (argc < num_args) {
+            printf("Error: --existence requires N and K parameters (only K with --load)\n");
             return 1;
         }
-        int n = atoi(argv[2]);
-        int k = atoi(argv[3]);
+        int k = atoi(argv[num_args - 1]);
         
-        printf("Testing k-stable matching existence with %d agents, k=%d\n", n, k);
+        problem_instance_t* instance = mode_instance(HOUSE_ALLOCATION, atoi(argv[2]));
+        if (instance == NULL) {
+            return 1;
+        }
+        int n = instance->num_agents;
         
-        problem_instance_t* instance = generate_random_house_allocation(n, time(NULL));
+        printf("Testing k-stable matching existence with %d agents, k=%d\n", n, k);
         
-        clock_t start = clock();
+        stopwatch_t timer;
+        phase_begin("search");
         bool exists = k_stable_matching_exists(instance, k);
-        clock_t end = clock();
+        phase_end(&timer);
         
-        double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
-        printf("Result: %s (took %.6f seconds)\n", exists ? "exists" : "does not exist", time_taken);
+        printf("Result: %s (took %.6f seconds, %.6f CPU seconds)\n", exists ? "exists" : "does not exist",
+               timer.wall_ms / 1000.0, timer.cpu_ms / 1000.0);
         
-        free(instance);
+        destroy_problem_instance(instance);
         return 0;
     }
     
     if (strcmp(argv[1], "--generate") == 0) {
-        if (argc < 4) {
+        if (argc < 4 && load_path == NULL) {
             printf("Error: --generate requires MODEL and N parameters\n");
             return 1;
         }
         
-        const char* model_str = argv[2];
-        int n = atoi(argv[3]);
+        matching_model_t model = HOUSE_ALLOCATION;
+        if (load_path == NULL && !parse_model(argv[2], &model)) {
+            return 1;
+        }
         
-        matching_model_t model;
-        if (strcmp(model_str, "house") == 0) {
-            model = HOUSE_ALLOCATION;
-        } else if (strcmp(model_str, "marriage") == 0) {
-            model = MARRIAGE;
-        } else if (strcmp(model_str, "roommates") == 0) {
-            model = ROOMMATES;
-        } else {
-            printf("Error: Unknown model '%s'. Use: house, marriage, or roommates\n", model_str);
+        problem_instance_t* instance = mode_instance(model, (load_path == NULL) ? atoi(argv[3]) : 0);
+        if (instance == NULL) {
             return 1;
         }
         
-        problem_instance_t* instance;
-        if (model == HOUSE_ALLOCATION) {
-            instance = generate_random_house_allocation(n, time(NULL));
-        } else if (model == MARRIAGE) {
-            instance = generate_random_marriage(n/2, n/2, time(NULL));
+        if (load_path != NULL) {
+            printf("Loaded instance with %d agents from %s\n", instance->num_agents, load_path);
         } else {
-            instance = generate_random_roommates(n, time(NULL));
+            printf("Generated %s instance with %d agents\n", argv[2], atoi(argv[3]));
         }
-        
-        printf("Generated %s instance with %d agents\n", model_str, n);
         printf("Agent preferences:\n");
         for (int i = 0; i < instance->num_agents; i++) {
+            const int* preferences = instance_preferences(instance, i);
             printf("Agent %d: ", i);
-            for (int j = 0; j < instance->agents[i].num_preferences; j++) {
-                printf("%d ", instance->agents[i].preferences[j]);
+            for (int j = 0; j < instance_num_preferences(instance, i); j++) {
+                printf("%d ", preferences[j]);
             }
             printf("\n");
         }
         
-        free(instance);
+        destroy_problem_instance(instance);
         return 0;
     }
     
     if (strcmp(argv[1], "--verify-model") == 0) {
-        if (argc < 5) {
-            printf("Error: --verify-model requires MODEL, N, and K parameters\n");
+        int num_args = (load_path != NULL) ? 3 : 5;
+        if (argc < num_args) {
+            printf("Error: --verify-model requires MODEL, N, and K parameters (only K with --load)\n");
             return 1;
         }
         
-        const char* model_str = argv[2];
-        int n = atoi(argv[3]);
-        int k = atoi(argv[4]);
+        matching_model_t model = HOUSE_ALLOCATION;
+        if (load_path == NULL && !parse_model(argv[2], &model)) {
+            return 1;
+        }
+        int k = atoi(argv[num_args - 1]);
         
-        matching_model_t model;
-        if (strcmp(model_str, "house") == 0) {
-            model = HOUSE_ALLOCATION;
-        } else if (strcmp(model_str, "marriage") == 0) {
-            model = MARRIAGE;
-        } else if (strcmp(model_str, "roommates") == 0) {
-            model = ROOMMATES;
-        } else {
-            printf("Error: Unknown model '%s'. Use: house, marriage, or roommates\n", model_str);
+        problem_instance_t* instance = mode_instance(model, (load_path == NULL) ? atoi(argv[3]) : 0);
+        if (instance == NULL) {
             return 1;
         }
+        model = instance->model;
+        int n = instance->num_agents;
+        const char* model_str = model_name(instance->model);
         
         printf("Testing k-stability verification with %s model, %d agents, k=%d\n", model_str, n, k);
         
-        problem_instance_t* instance;
-        if (model == HOUSE_ALLOCATION) {
-            instance = generate_random_house_allocation(n, time(NULL));
-        } else if (model == MARRIAGE) {
-            instance = generate_random_marriage(n/2, n/2, time(NULL));
-        } else {
-            instance = generate_random_roommates(n, time(NULL));
-        }
-        
         matching_t* matching = create_matching(n, model);
         if (matching == NULL) {
             printf("Error: Could not create matching\n");
-            free(instance);
+            destroy_problem_instance(instance);
             return 1;
         }
         
         // Create a simple matching for testing
-        if (model == HOUSE_ALLOCATION) {
-            for (int i = 0; i < n; i++) {
-                matching->pairs[i] = i;  // Agent i gets house i
-            }
-        } else if (model == MARRIAGE) {
-            int half = n / 2;
-            for (int i = 0; i < half; i++) {
-                matching->pairs[i] = half + i;
-                matching->pairs[half + i] = i;
-            }
-        } else {  // ROOMMATES
-            for (int i = 0; i < n - 1; i += 2) {
-                matching->pairs[i] = i + 1;
-                matching->pairs[i + 1] = i;
-            }
-        }
+        phase_begin("preprocess");
+        build_test_matching(matching, instance);
+        phase_end(NULL);
         
-        clock_t start = clock();
+        stopwatch_t timer;
+        phase_begin("verify");
         bool result = is_k_stable_direct(matching, instance, k);
-        clock_t end = clock();
+        phase_end(&timer);
         
-        double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
-        printf("Result: %s (took %.6f seconds)\n", result ? "k-stable" : "not k-stable", time_taken);
+        printf("Result: %s (took %.6f seconds, %.6f CPU seconds)\n", result ? "k-stable" : "not k-stable",
+               timer.wall_ms / 1000.0, timer.cpu_ms / 1000.0);
         
         destroy_matching(matching);
-        free(instance);
+        destroy_problem_instance(instance);
         return 0;
     }
     
     if (strcmp(argv[1], "--existence-model") == 0) {
-        if (argc < 5) {
-            printf("Error: --existence-model requires MODEL, N, and K parameters\n");
+        int num_args = (load_path != NULL) ? 3 : 5;
+        if (argc < num_args) {
+            printf("Error: --existence-model requires MODEL, N, and K parameters (only K with --load)\n");
             return 1;
         }
         
-        const char* model_str = argv[2];
-        int n = atoi(argv[3]);
-        int k = atoi(argv[4]);
+        matching_model_t model = HOUSE_ALLOCATION;
+        if (load_path == NULL && !parse_model(argv[2], &model)) {
+            return 1;
+        }
+        int k = atoi(argv[num_args - 1]);
         
-        matching_model_t model;
-        if (strcmp(model_str, "house") == 0) {
-            model = HOUSE_ALLOCATION;
-        } else if (strcmp(model_str, "marriage") == 0) {
-            model = MARRIAGE;
-        } else if (strcmp(model_str, "roommates") == 0) {
-            model = ROOMMATES;
-        } else {
-            printf("Error: Unknown model '%s'. Use: house, marriage, or roommates\n", model_str);
+        problem_instance_t* instance = mode_instance(model, (load_path == NULL) ? atoi(argv[3]) : 0);
+        if (instance == NULL) {
             return 1;
         }
+        int n = instance->num_agents;
+        const char* model_str = model_name(instance->model);
         
         printf("Testing k-stable matching existence with %s model, %d agents, k=%d\n", model_str, n, k);
         
-        problem_instance_t* instance;
-        if (model == HOUSE_ALLOCATION) {
-            instance = generate_random_house_allocation(n, time(NULL));
-        } else if (model == MARRIAGE) {
-            instance = generate_random_marriage(n/2, n/2, time(NULL));
-        } else {
-            instance = generate_random_roommates(n, time(NULL));
+        stopwatch_t timer;
+        phase_begin("search");
+        bool exists = k_stable_matching_exists(instance, k);
+        phase_end(&timer);
+        
+        printf("Result: %s (took %.6f seconds, %.6f CPU seconds)\n", exists ? "exists" : "does not exist",
+               timer.wall_ms / 1000.0, timer.cpu_ms / 1000.0);
+        
+        destroy_problem_instance(instance);
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "--existence-parallel") == 0) {
+        int num_args = (load_path != NULL) ? 4 : 6;
+        if (argc < num_args) {
+            printf("Error: --existence-parallel requires MODEL, N, K, and T parameters (only K and T with --load)\n");
+            return 1;
         }
         
-        clock_t start = clock();
-        bool exists = k_stable_matching_exists(instance, k);
-        clock_t end = clock();
+        matching_model_t model = HOUSE_ALLOCATION;
+        if (load_path == NULL && !parse_model(argv[2], &model)) {
+            return 1;
+        }
+        int k = atoi(argv[num_args - 2]);
+        
+        // T is checked like --threads: a number from 1 to 256
+        char* end = NULL;
+        long long num_threads = strtoll(argv[num_args - 1], &end, 10);
+        if (end == argv[num_args - 1] || *end != '\0' || num_threads < 1 || num_threads > 256) {
+            printf("Error: T must be a number from 1 to 256\n");
+            return 1;
+        }
+        
+        problem_instance_t* instance = mode_instance(model, (load_path == NULL) ? atoi(argv[3]) : 0);
+        if (instance == NULL) {
+            return 1;
+        }
+        int n = instance->num_agents;
+        if (k <= 0 || k > n) {
+            printf("Error: K must be between 1 and %d\n", n);
+            destroy_problem_instance(instance);
+            return 1;
+        }
+        const char* model_str = model_name(instance->model);
+        
+        printf("Testing exact k-stable matching existence with %s model, %d agents, k=%d, %lld threads\n",
+               model_str, n, k, num_threads);
+        
+        double cpu_start = process_cpu_time_ms();
+        stopwatch_t timer;
+        phase_begin("search");
+        bool complete = false;
+        matching_t* witness = find_k_stable_matching_parallel(instance, k, (int)num_threads, &complete);
+        phase_end(&timer);
+        double cpu_ms = process_cpu_time_ms() - cpu_start;
+        
+        if (!complete) {
+            printf("Error: Out of memory in the parallel search; no answer\n");
+            destroy_problem_instance(instance);
+            return 1;
+        }
+        printf("Result: %s (took %.6f seconds, %.6f CPU seconds over all threads)\n", witness != NULL ? "exists" : "does not exist",
+               timer.wall_ms / 1000.0, cpu_ms / 1000.0);
+        if (witness != NULL) {
+            print_matching(witness);
+            destroy_matching(witness);
+        }
+        
+        destroy_problem_instance(instance);
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "--count") == 0) {
+        int num_args = (load_path != NULL) ? 3 : 5;
+        if (argc < num_args) {
+            printf("Error: --count requires MODEL, N, and K parameters (only K with --load)\n");
+            return 1;
+        }
+        
+        matching_model_t model = HOUSE_ALLOCATION;
+        if (load_path == NULL && !parse_model(argv[2], &model)) {
+            return 1;
+        }
+        int k = atoi(argv[num_args - 1]);
+        
+        problem_instance_t* instance = mode_instance(model, (load_path == NULL) ? atoi(argv[3]) : 0);
+        if (instance == NULL) {
+            return 1;
+        }
+        int n = instance->num_agents;
+        if (k <= 0 || k > n) {
+            printf("Error: K must be between 1 and %d\n", n);
+            destroy_problem_instance(instance);
+            return 1;
+        }
+        
+        printf("Counting k-stable matchings with %s model, %d agents, k=%d\n", model_name(instance->model), n, k);
+        
+        // The dp backend counts house allocation and also yields the distribution.
+        // If it cannot count the instance, falling back to the recursion would not
+        // finish at its sizes
+        matching_count_t counted;
+        stopwatch_t timer;
+        bool by_dp = count_backend() == COUNT_BACKEND_SUBSET_DP && instance->model == HOUSE_ALLOCATION;
+        phase_begin("search");
+        bool counted_ok = by_dp ? count_k_stable_matchings_dp(instance, k, &counted) : true;
+        long long leaves = by_dp ? (counted_ok ? counted.search_leaves : 0)
+                                 : count_k_stable_matchings(instance, k);
+        phase_end(&timer);
+        
+        if (!counted_ok) {
+            if (n > COUNT_DP_MAX_N || instance->num_targets > 32) {
+                printf("Error: The dp backend counts house allocation instances with n <= %d\n",
+                       COUNT_DP_MAX_N);
+            } else {
+                printf("Error: Out of memory counting with the dp backend\n");
+            }
+            destroy_problem_instance(instance);
+            return 1;
+        }
         
-        double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
-        printf("Result: %s (took %.6f seconds)\n", exists ? "exists" : "does not exist", time_taken);
+        printf("Result: %lld k-stable search leaves (%s, took %.6f seconds)\n", leaves,
+               by_dp ? "subset dp" : "recursive search", timer.wall_ms / 1000.0);
+        if (by_dp) {
+            printf("Distinct matchings: %lld k-stable of %lld (%lld subproblems, %lld memo hits, %lld uncached)\n",
+                   counted.k_stable, counted.total, counted.subproblems, counted.memo_hits, counted.uncached);
+            printf("Blocking number\tMatchings\n");
+            for (int b = 0; b < k; b++) {
+                printf("%d\t\t%lld\n", b, counted.blocking_histogram[b]);
+            }
+            printf(">= %d\t\t%lld\n", k, counted.blocking_histogram[k]);
+        }
         
-        free(instance);
+        destroy_problem_instance(instance);
         return 0;
     }
     
@@ -396,7 +767,11 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        analyze_all_house_allocations(n, k);
+        if (argc >= 5) {
+            analyze_all_house_allocations_sampled(n, k, atoi(argv[4]), argc >= 6 ? atoi(argv[5]) : 0);
+        } else {
+            analyze_all_house_allocations(n, k);
+        }
         return 0;
     }
     
@@ -405,6 +780,40 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
+    if (strcmp(argv[1], "--scaling") == 0) {
+        if (argc < 4) {
+            printf("Error: --scaling requires L T parameters\n");
+            return 1;
+        }
+        int list_length = atoi(argv[2]);
+        int num_trials = atoi(argv[3]);
+        
+        if (list_length <= 0 || num_trials <= 0) {
+            printf("Error: Invalid parameters for --scaling\n");
+            return 1;
+        }
+        
+        benchmark_verification_scaling(list_length, num_trials);
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "--search-stats") == 0) {
+        if (argc < 4) {
+            printf("Error: --search-stats requires N T parameters\n");
+            return 1;
+        }
+        int n = atoi(argv[2]);
+        int num_trials = atoi(argv[3]);
+        
+        if (n <= 0 || num_trials <= 0) {
+            printf("Error: Invalid parameters for --search-stats\n");
+            return 1;
+        }
+        
+        benchmark_search_stats(n, num_trials);
+        return 0;
+    }
+    
     printf("Error: Unknown option '%s'\n", argv[1]);
     print_usage(argv[0]);
     return 1;
@@ -6,15 +6,17 @@
 
 // Create a new matching
 matching_t* create_matching(int num_agents, matching_model_t model) {
-    if (num_agents <= 0 || num_agents > MAX_AGENTS) {
+    if (num_agents <= 0 || (size_t)num_agents > (SIZE_MAX - sizeof(matching_t)) / sizeof(int)) {
         return NULL;
     }
     
-    matching_t* matching = malloc(sizeof(matching_t));
+    // The pairs array lives in the same block, right after the header
+    matching_t* matching = malloc(sizeof(matching_t) + (size_t)num_agents * sizeof(int));
     if (matching == NULL) {
         return NULL;
     }
     
+    matching->pairs = (int*)(matching + 1);
     matching->num_agents = num_agents;
     matching->model = model;
     
@@ -50,41 +52,6 @@ void print_matching(const matching_t* matching) {
     }
 }
 
-// Get the rank of a target agent in an agent's preference list
-// Returns -1 if target is not in preferences
-int get_agent_rank(const agent_t* agent, int target_id) {
-    for (int i = 0; i < agent->num_preferences; i++) {
-        if (agent->preferences[i] == target_id) {
-            return i;  // 0 = most preferred
-        }
-    }
-    return -1;  // Not found
-}
-
-// Check if agent prefers a over b
-bool agent_prefers(const agent_t* agent, int a, int b) {
-    // Special case: if b is -1 (unmatched), agent always prefers a if a is valid
-    if (b == -1) {
-        return get_agent_rank(agent, a) != -1;
-    }
-    
-    // Special case: if a is -1 (unmatched), agent never prefers it
-    if (a == -1) {
-        return false;
-    }
-    
-    int rank_a = get_agent_rank(agent, a);
-    int rank_b = get_agent_rank(agent, b);
-    
-    // If either is not in preferences, return false
-    if (rank_a == -1 || rank_b == -1) {
-        return false;
-    }
-    
-    // Lower rank = more preferred
-    return rank_a < rank_b;
-}
-
 // Count how many agents are better off in alternative matching compared to current
 int count_improved_agents(const matching_t* current, const matching_t* alternative, 
                          const problem_instance_t* instance) {
@@ -113,7 +80,7 @@ int count_improved_agents(const matching_t* current, const matching_t* alternati
             is_better = true;
         } else if (current_partner != -1 && alternative_partner != -1) {
             // Both matched, check preference
-            is_better = agent_prefers(&instance->agents[i], alternative_partner, current_partner);
+            is_better = agent_prefers(instance, i, alternative_partner, current_partner);
         }
         
         if (is_better) {
@@ -126,11 +93,50 @@ int count_improved_agents(const matching_t* current, const matching_t* alternati
 
 // Check if a matching is valid for the given model
 bool is_valid_matching(const matching_t* matching, const problem_instance_t* instance) {
+    return is_valid_matching_in_arena(matching, instance, NULL);
+}
+
+// Empty set of assigned houses: in small (on the stack) when the houses fit,
+// else from the arena if given, else from the heap (see release_house_set)
+static bool init_house_set(bitset_t* set, bitset256_t* small, int num_houses, matching_arena_t* arena) {
+    if (num_houses <= 0) {
+        num_houses = 1;
+    }
+    if (num_houses <= 256) {
+        bitset_attach(set, small->words, num_houses);
+        return true;
+    }
+    if (arena != NULL) {
+        return bitset_init_in_arena(set, num_houses, arena);
+    }
+    
+    uint64_t* words = malloc(bitset_bytes(num_houses));
+    if (words == NULL) {
+        return false;
+    }
+    bitset_attach(set, words, num_houses);
+    return true;
+}
+
+static void release_house_set(bitset_t* set, const bitset256_t* small, matching_arena_t* arena, size_t mark) {
+    if (set->words == small->words) {
+        return;
+    }
+    if (arena != NULL) {
+        matching_arena_release(arena, mark);
+    } else {
+        free(set->words);
+    }
+}
+
+// is_valid_matching drawing its scratch memory from arena (NULL = heap)
+bool is_valid_matching_in_arena(const matching_t* matching, const problem_instance_t* instance,
+                                matching_arena_t* arena) {
     if (matching == NULL || instance == NULL) {
         return false;
     }
     
-    if (matching->num_agents != instance->num_agents) {
+    if (matching->num_agents <= 0 || matching->num_agents != instance->num_agents) {
         return false;
     }
     
@@ -154,22 +160,29 @@ bool is_valid_matching(const matching_t* matching, const problem_instance_t* ins
             // In house allocation, each house can only be assigned to one agent
             // and each agent can get at most one house
             // Note: pairs[i] represents the house assigned to agent i (-1 if no house)
-            bool house_assigned[MAX_AGENTS] = {false};
+            size_t mark = (arena != NULL) ? matching_arena_mark(arena) : 0;
+            bitset256_t small;
+            bitset_t house_assigned;
+            if (!init_house_set(&house_assigned, &small, matching->num_agents, arena)) {
+                return false;
+            }
             
-            for (int i = 0; i < matching->num_agents; i++) {
+            bool valid = true;
+            for (int i = 0; i < matching->num_agents && valid; i++) {
                 int house = matching->pairs[i];
                 if (house != -1) {
-                    // Check that house ID is valid
-                    if (house < 0 || house >= matching->num_agents) {
-                        return false;
-                    }
-                    // Check that this house is not assigned to multiple agents
-                    if (house_assigned[house]) {
-                        return false;  // House assigned to multiple agents
+                    // Check that house ID is valid and not assigned to multiple agents
+                    if (house < 0 || house >= matching->num_agents || bitset_test(&house_assigned, house)) {
+                        valid = false;
+                    } else {
+                        bitset_set(&house_assigned, house);
                     }
-                    house_assigned[house] = true;
                 }
             }
+            release_house_set(&house_assigned, &small, arena, mark);
+            if (!valid) {
+                return false;
+            }
             }
             break;
             
@@ -200,22 +213,30 @@ bool is_valid_matching(const matching_t* matching, const problem_instance_t* ins
             // Similar to house allocation but with partial preferences
             // Each house can only be assigned to one agent
             {
-            bool house_assigned[MAX_AGENTS] = {false};
+            int num_houses = instance->model_data.house_partial_data.num_houses;
+            size_t mark = (arena != NULL) ? matching_arena_mark(arena) : 0;
+            bitset256_t small;
+            bitset_t house_assigned;
+            if (!init_house_set(&house_assigned, &small, num_houses, arena)) {
+                return false;
+            }
             
-            for (int i = 0; i < matching->num_agents; i++) {
+            bool valid = true;
+            for (int i = 0; i < matching->num_agents && valid; i++) {
                 int house = matching->pairs[i];
                 if (house != -1) {
-                    // Check that house ID is valid
-                    if (house < 0 || house >= instance->model_data.house_partial_data.num_houses) {
-                        return false;
+                    // Check that house ID is valid and not assigned to multiple agents
+                    if (house < 0 || house >= num_houses || bitset_test(&house_assigned, house)) {
+                        valid = false;
+                    } else {
+                        bitset_set(&house_assigned, house);
                     }
-                    // Check that this house is not assigned to multiple agents
-                    if (house_assigned[house]) {
-                        return false;  // House assigned to multiple agents
-                    }
-                    house_assigned[house] = true;
                 }
             }
+            release_house_set(&house_assigned, &small, arena, mark);
+            if (!valid) {
+                return false;
+            }
             }
             break;
     }
@@ -234,9 +255,225 @@ matching_t* copy_matching(const matching_t* original) {
         return NULL;
     }
     
-    for (int i = 0; i < original->num_agents; i++) {
-        copy->pairs[i] = original->pairs[i];
+    memcpy(copy->pairs, original->pairs, original->num_agents * sizeof(int));
+    
+    return copy;
+}
+
+// Create an arena with capacity bytes of backing storage
+bool matching_arena_init(matching_arena_t* arena, size_t capacity) {
+    if (arena == NULL) {
+        return false;
+    }
+    
+    arena->base = malloc(capacity > 0 ? capacity : 1);
+    arena->capacity = (arena->base != NULL) ? capacity : 0;
+    arena->used = 0;
+    return arena->base != NULL;
+}
+
+// Release an arena's backing storage
+void matching_arena_destroy(matching_arena_t* arena) {
+    if (arena != NULL) {
+        free(arena->base);
+        arena->base = NULL;
+        arena->capacity = 0;
+        arena->used = 0;
+    }
+}
+
+// Allocate bytes from the arena (aligned), NULL if it is exhausted
+void* matching_arena_alloc(matching_arena_t* arena, size_t bytes) {
+    size_t size = matching_arena_bytes(bytes);
+    if (arena == NULL || size > arena->capacity - arena->used) {
+        return NULL;
+    }
+    
+    void* block = arena->base + arena->used;
+    arena->used += size;
+    return block;
+}
+
+// Arena bytes taken by one matching of num_agents agents
+size_t matching_arena_matching_bytes(int num_agents) {
+    return matching_arena_bytes(sizeof(matching_t)) + matching_arena_bytes((size_t)num_agents * sizeof(int));
+}
+
+// Empty set of num_bits ids with its words drawn from the arena (bitset_bytes(num_bits))
+bool bitset_init_in_arena(bitset_t* set, int num_bits, matching_arena_t* arena) {
+    if (set == NULL || num_bits < 0) {
+        return false;
     }
     
+    uint64_t* words = matching_arena_alloc(arena, bitset_bytes(num_bits > 0 ? num_bits : 1));
+    if (words == NULL) {
+        return false;
+    }
+    bitset_attach(set, words, num_bits);
+    return true;
+}
+
+// Create a matching with all agents unmatched inside the arena (released with the arena, not destroy_matching)
+matching_t* matching_arena_create_matching(matching_arena_t* arena, int num_agents, matching_model_t model) {
+    if (num_agents <= 0) {
+        return NULL;
+    }
+    
+    size_t mark = matching_arena_mark(arena);
+    matching_t* matching = matching_arena_alloc(arena, sizeof(matching_t));
+    int* pairs = matching_arena_alloc(arena, (size_t)num_agents * sizeof(int));
+    if (matching == NULL || pairs == NULL) {
+        matching_arena_release(arena, mark);
+        return NULL;
+    }
+    
+    matching->pairs = pairs;
+    matching->num_agents = num_agents;
+    matching->model = model;
+    for (int i = 0; i < num_agents; i++) {
+        pairs[i] = -1;
+    }
+    
+    return matching;
+}
+
+// Copy a matching into the arena
+matching_t* matching_arena_copy_matching(matching_arena_t* arena, const matching_t* original) {
+    if (original == NULL) {
+        return NULL;
+    }
+    
+    size_t mark = matching_arena_mark(arena);
+    matching_t* copy = matching_arena_alloc(arena, sizeof(matching_t));
+    int* pairs = matching_arena_alloc(arena, (size_t)original->num_agents * sizeof(int));
+    if (copy == NULL || pairs == NULL) {
+        matching_arena_release(arena, mark);
+        return NULL;
+    }
+    
+    copy->pairs = pairs;
+    copy->num_agents = original->num_agents;
+    copy->model = original->model;
+    memcpy(pairs, original->pairs, original->num_agents * sizeof(int));
+    
     return copy;
 }
+
+// Bytes an overlay over num_agents agents takes from an arena
+size_t matching_overlay_bytes(int num_agents) {
+    return 2 * matching_arena_bytes((size_t)num_agents * sizeof(int)) +
+           matching_arena_bytes((size_t)num_agents * sizeof(unsigned int));
+}
+
+// Create an empty overlay on top of base (the overlay reads as base until entries are set)
+bool matching_overlay_init(matching_overlay_t* overlay, const matching_t* base, matching_arena_t* arena) {
+    if (overlay == NULL || base == NULL || arena == NULL) {
+        return false;
+    }
+    
+    int n = base->num_agents;
+    size_t mark = matching_arena_mark(arena);
+    overlay->values = matching_arena_alloc(arena, (size_t)n * sizeof(int));
+    overlay->changed = matching_arena_alloc(arena, (size_t)n * sizeof(int));
+    overlay->stamps = matching_arena_alloc(arena, (size_t)n * sizeof(unsigned int));
+    if (overlay->values == NULL || overlay->changed == NULL || overlay->stamps == NULL) {
+        matching_arena_release(arena, mark);
+        return false;
+    }
+    
+    memset(overlay->stamps, 0, (size_t)n * sizeof(unsigned int));
+    overlay->base = base;
+    overlay->generation = 1;
+    overlay->num_changed = 0;
+    return true;
+}
+
+// Override an agent's partner in the overlay
+void matching_overlay_set(matching_overlay_t* overlay, int agent, int partner) {
+    if (overlay->stamps[agent] != overlay->generation) {
+        overlay->stamps[agent] = overlay->generation;
+        overlay->changed[overlay->num_changed++] = agent;
+    }
+    overlay->values[agent] = partner;
+}
+
+// Drop every override, so the overlay reads as its base again (O(1) amortized)
+void matching_overlay_clear(matching_overlay_t* overlay) {
+    overlay->num_changed = 0;
+    overlay->generation++;
+    
+    // On wrap-around old stamps could alias the new generation
+    if (overlay->generation == 0) {
+        memset(overlay->stamps, 0, (size_t)overlay->base->num_agents * sizeof(unsigned int));
+        overlay->generation = 1;
+    }
+}
+
+// count_improved_agents for an overlay against its base. Agents whose entry was
+// not overridden keep their partner and cannot be better off, so only the
+// changed agents are examined.
+int count_improved_agents_overlay(const matching_overlay_t* alternative, const problem_instance_t* instance) {
+    if (alternative == NULL || instance == NULL) {
+        return 0;
+    }
+    
+    int improved_count = 0;
+    
+    for (int c = 0; c < alternative->num_changed; c++) {
+        int i = alternative->changed[c];
+        int current_partner = alternative->base->pairs[i];
+        int alternative_partner = alternative->values[i];
+        
+        if (alternative_partner == -1) {
+            continue;  // Unmatched in the alternative is never an improvement
+        }
+        
+        // Was unmatched and now matched, or now matched to someone preferred
+        if (current_partner == -1 || agent_prefers(instance, i, alternative_partner, current_partner)) {
+            improved_count++;
+        }
+    }
+    
+    return improved_count;
+}
+
+// Bytes a trail of the given capacity takes from an arena
+size_t matching_trail_bytes(int capacity) {
+    return 2 * matching_arena_bytes((size_t)capacity * sizeof(int));
+}
+
+// Create an empty trail holding up to capacity assignments
+bool matching_trail_init(matching_trail_t* trail, int capacity, matching_arena_t* arena) {
+    if (trail == NULL || arena == NULL || capacity < 0) {
+        return false;
+    }
+    
+    size_t mark = matching_arena_mark(arena);
+    trail->agents = matching_arena_alloc(arena, (size_t)capacity * sizeof(int));
+    trail->previous = matching_arena_alloc(arena, (size_t)capacity * sizeof(int));
+    if (trail->agents == NULL || trail->previous == NULL) {
+        matching_arena_release(arena, mark);
+        return false;
+    }
+    
+    trail->size = 0;
+    trail->capacity = capacity;
+    return true;
+}
+
+// Set matching->pairs[agent] = partner, recording the previous value
+void matching_trail_set(matching_t* matching, matching_trail_t* trail, int agent, int partner) {
+    assert(trail->size < trail->capacity);
+    trail->agents[trail->size] = agent;
+    trail->previous[trail->size] = matching->pairs[agent];
+    trail->size++;
+    matching->pairs[agent] = partner;
+}
+
+// Undo every assignment made since mark, newest first
+void matching_trail_undo(matching_t* matching, matching_trail_t* trail, int mark) {
+    while (trail->size > mark) {
+        trail->size--;
+        matching->pairs[trail->agents[trail->size]] = trail->previous[trail->size];
+    }
+}
@@ -0,0 +1,680 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/matching.h"
+
+// Parallel k-stable matching existence search.
+//
+// The search tree assigns agents in index order: each unmatched agent takes a
+// listed, still-free partner in preference order, or stays unmatched (every
+// model allows it; marriage sides may differ in size). Every leaf is checked with the exact k-stability test, so
+// the answer does not depend on pruning heuristics.
+//
+// Subtrees are cut only where no leaf below them can be k-stable. A subtree
+// searched without a witness goes into the transposition table, keyed by the
+// Zobrist hash of (agent index, partial matching): an agent left unmatched can
+// still be taken by a later one, so the same node is reached along several
+// paths. For house allocation, each matched agent's improving houses are fixed,
+// and every free agent will at least prefer the houses above its best possible
+// partner (none if it could get an unlisted one); a maximum matching of agents
+// into those sets that reaches k blocks every leaf below. Marriage and
+// roommates subtrees are only cut by the table.
+//
+// A task is a subtree, named by its path of branch choices from the root. The
+// upper levels are split into tasks on demand and spread over per-thread
+// work-stealing deques (owners pop their newest task, idle threads steal the
+// oldest); small subtrees are searched depth-first by the thread that holds
+// them.
+//
+// The reported matching is always the first k-stable one in depth-first order,
+// whatever the thread count or schedule: a witness cancels only the tasks whose
+// path comes after it, and earlier tasks keep running until they finish.
+
+#define SPLIT_MIN_REMAINING 4   // Subtrees with this few agents left are never split
+#define TASKS_PER_THREAD 4      // Split only while fewer tasks than this per thread are queued
+#define TABLE_MIN_REMAINING 2   // Subtrees with fewer agents left are not kept in the table
+
+typedef struct {
+    int agent_index;
+    int path_length;
+    int* pairs;     // Partial matching, num_agents entries
+    int* path;      // Branch choices from the root, path_length entries
+} search_task_t;
+
+// Tasks live in tasks[head] .. tasks[tail - 1]; the owner works at the tail
+typedef struct {
+    search_task_t** tasks;
+    int head;
+    int tail;
+    int capacity;
+    pthread_mutex_t lock;
+} task_deque_t;
+
+typedef struct {
+    const problem_instance_t* instance;
+    int k;
+    int num_threads;
+    task_deque_t* deques;
+    bool bounded;                   // House allocation: prune by improving-set matchings
+    uint64_t table_salt;
+
+    pthread_mutex_t lock;           // Guards the fields below
+    pthread_cond_t work_available;
+    int queued;                     // Tasks sitting in deques (also read atomically)
+    int outstanding;                // Tasks queued or being processed
+    bool failed;                    // A task could not be allocated
+    bool found;
+    int* best_path;                 // Path of the earliest task with a witness
+    int best_path_length;
+    matching_t* witness;
+    int best_generation;            // Bumped on every improvement (read atomically)
+} search_pool_t;
+
+typedef struct {
+    search_pool_t* pool;
+    int id;
+    matching_arena_t arena;         // Candidate lists and the trail
+    verifier_context_t verifier;    // Leaf verification
+    matching_trail_t trail;
+    matching_t* matching;
+    uint64_t hash;                  // Zobrist hash of the matched pairs
+    int* prefix_lengths;            // Least improving list prefix per agent (bounded pools)
+    const search_task_t* task;      // Task being processed
+    int seen_generation;
+    bool cancelled;
+} search_worker_t;
+
+// ---------------------------------------------------------------------------
+// Task deques
+// ---------------------------------------------------------------------------
+
+static bool deque_init(task_deque_t* deque) {
+    deque->capacity = 64;
+    deque->head = 0;
+    deque->tail = 0;
+    deque->tasks = malloc(deque->capacity * sizeof(search_task_t*));
+    if (deque->tasks == NULL) {
+        return false;
+    }
+    pthread_mutex_init(&deque->lock, NULL);
+    return true;
+}
+
+static void deque_destroy(task_deque_t* deque) {
+    for (int i = deque->head; i < deque->tail; i++) {
+        free(deque->tasks[i]);
+    }
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->lock);
+}
+
+static bool deque_push(task_deque_t* deque, search_task_t* task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        if (deque->head > 0) {
+            // Reclaim the slots thieves have emptied
+            memmove(deque->tasks, deque->tasks + deque->head,
+                    (deque->tail - deque->head) * sizeof(search_task_t*));
+            deque->tail -= deque->head;
+            deque->head = 0;
+        } else {
+            search_task_t** grown = realloc(deque->tasks, 2 * deque->capacity * sizeof(search_task_t*));
+            if (grown == NULL) {
+                pthread_mutex_unlock(&deque->lock);
+                return false;
+            }
+            deque->tasks = grown;
+            deque->capacity *= 2;
+        }
+    }
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+// Owner end: newest task first, keeping each thread depth-first
+static search_task_t* deque_pop(task_deque_t* deque) {
+    search_task_t* task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail > deque->head) {
+        task = deque->tasks[--deque->tail];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+// Thief end: oldest task, which is the largest subtree
+static search_task_t* deque_steal(task_deque_t* deque) {
+    search_task_t* task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail > deque->head) {
+        task = deque->tasks[deque->head++];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+// ---------------------------------------------------------------------------
+// Search tree
+// ---------------------------------------------------------------------------
+
+// Lexicographic order of task paths (depth-first order of disjoint subtrees)
+static int compare_paths(const int* a, int a_length, const int* b, int b_length) {
+    int length = (a_length < b_length) ? a_length : b_length;
+    for (int i = 0; i < length; i++) {
+        if (a[i] != b[i]) {
+            return (a[i] < b[i]) ? -1 : 1;
+        }
+    }
+    return (a_length > b_length) - (a_length < b_length);
+}
+
+// Free partners agent may take, in its preference order; returns the count
+static int collect_candidates(const problem_instance_t* instance, const matching_t* matching,
+                              int agent, int* candidates) {
+    const int* preferences = instance_preferences(instance, agent);
+    int num_preferences = instance_num_preferences(instance, agent);
+    int count = 0;
+
+    for (int i = 0; i < num_preferences; i++) {
+        int partner = preferences[i];
+        if (partner == agent || partner >= instance->num_agents || matching->pairs[partner] != -1) {
+            continue;
+        }
+        if (instance->model == MARRIAGE) {
+            int num_men = instance->model_data.marriage_data.num_men;
+            if ((agent < num_men) == (partner < num_men)) {
+                continue;
+            }
+        }
+        candidates[count++] = partner;
+    }
+    return count;
+}
+
+// First agent at or after agent_index still waiting for a decision
+static int next_open_agent(const matching_t* matching, int agent_index) {
+    while (agent_index < matching->num_agents && matching->pairs[agent_index] != -1) {
+        agent_index++;
+    }
+    return agent_index;
+}
+
+static search_task_t* create_task(int num_agents, const int* pairs, int agent_index,
+                                  const int* path, int path_length, int choice) {
+    search_task_t* task = malloc(sizeof(search_task_t) + (num_agents + path_length + 1) * sizeof(int));
+    if (task == NULL) {
+        return NULL;
+    }
+    task->pairs = (int*)(task + 1);
+    task->path = task->pairs + num_agents;
+    task->agent_index = agent_index;
+    task->path_length = path_length + 1;
+    memcpy(task->pairs, pairs, num_agents * sizeof(int));
+    if (path_length > 0) {
+        memcpy(task->path, path, path_length * sizeof(int));
+    }
+    task->path[path_length] = choice;
+    return task;
+}
+
+// ---------------------------------------------------------------------------
+// Pool
+// ---------------------------------------------------------------------------
+
+static void pool_mark_failed(search_pool_t* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->failed = true;
+    pthread_mutex_unlock(&pool->lock);
+    __atomic_add_fetch(&pool->best_generation, 1, __ATOMIC_RELEASE);
+}
+
+static void pool_push(search_pool_t* pool, int thread, search_task_t* task) {
+    if (!deque_push(&pool->deques[thread], task)) {
+        free(task);
+        pool_mark_failed(pool);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+    pool->outstanding++;
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Next task for a worker: its own newest, else a stolen one; NULL once every task is done
+static search_task_t* pool_take(search_worker_t* worker) {
+    search_pool_t* pool = worker->pool;
+
+    for (;;) {
+        search_task_t* task = deque_pop(&pool->deques[worker->id]);
+        for (int i = 1; task == NULL && i < pool->num_threads; i++) {
+            task = deque_steal(&pool->deques[(worker->id + i) % pool->num_threads]);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (task != NULL) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&pool->lock);
+            return task;
+        }
+        if (pool->outstanding == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        if (__atomic_load_n(&pool->queued, __ATOMIC_RELAXED) == 0) {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void pool_finish(search_pool_t* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->outstanding--;
+    if (pool->outstanding == 0) {
+        pthread_cond_broadcast(&pool->work_available);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Record the worker's matching as a witness if its task precedes the best so far
+static void pool_report(search_worker_t* worker) {
+    search_pool_t* pool = worker->pool;
+    const search_task_t* task = worker->task;
+
+    pthread_mutex_lock(&pool->lock);
+    if (!pool->found || compare_paths(task->path, task->path_length,
+                                      pool->best_path, pool->best_path_length) < 0) {
+        memcpy(pool->best_path, task->path, task->path_length * sizeof(int));
+        pool->best_path_length = task->path_length;
+        memcpy(pool->witness->pairs, worker->matching->pairs, worker->matching->num_agents * sizeof(int));
+        pool->found = true;
+        __atomic_add_fetch(&pool->best_generation, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Whether the current task can stop: a witness precedes it, or the search failed.
+// Costs one atomic load unless the best witness changed since the last check.
+static bool worker_cancelled(search_worker_t* worker) {
+    search_pool_t* pool = worker->pool;
+    int generation = __atomic_load_n(&pool->best_generation, __ATOMIC_ACQUIRE);
+    if (generation != worker->seen_generation) {
+        pthread_mutex_lock(&pool->lock);
+        worker->seen_generation = generation;
+        worker->cancelled = pool->failed ||
+                            (pool->found && compare_paths(pool->best_path, pool->best_path_length,
+                                                          worker->task->path, worker->task->path_length) < 0);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return worker->cancelled;
+}
+
+// ---------------------------------------------------------------------------
+// Workers
+// ---------------------------------------------------------------------------
+
+static bool worker_init(search_worker_t* worker, search_pool_t* pool, int id) {
+    const problem_instance_t* instance = pool->instance;
+    int n = instance->num_agents;
+
+    worker->pool = pool;
+    worker->id = id;
+    worker->task = NULL;
+    worker->seen_generation = -1;
+    worker->cancelled = false;
+
+    // One candidate list per tree level, the trail, and the bound's prefixes and scratch
+    size_t bytes = (size_t)instance->pref_offsets[n] * sizeof(int) +
+                   (size_t)n * MATCHING_ARENA_ALIGNMENT +
+                   matching_trail_bytes(n);
+    if (pool->bounded) {
+        bytes += matching_arena_bytes((size_t)n * sizeof(int)) + blocking_number_scratch_bytes(instance);
+    }
+    if (!matching_arena_init(&worker->arena, bytes)) {
+        return false;
+    }
+    if (!verifier_context_init(&worker->verifier, instance)) {
+        matching_arena_destroy(&worker->arena);
+        return false;
+    }
+    worker->matching = create_matching(n, instance->model);
+    worker->prefix_lengths = NULL;
+    if (worker->matching != NULL && pool->bounded) {
+        worker->prefix_lengths = matching_arena_alloc(&worker->arena, (size_t)n * sizeof(int));
+    }
+    if (worker->matching == NULL || !matching_trail_init(&worker->trail, n, &worker->arena) ||
+        (pool->bounded && worker->prefix_lengths == NULL)) {
+        destroy_matching(worker->matching);
+        verifier_context_destroy(&worker->verifier);
+        matching_arena_destroy(&worker->arena);
+        return false;
+    }
+    return true;
+}
+
+static void worker_destroy(search_worker_t* worker) {
+    destroy_matching(worker->matching);
+    verifier_context_destroy(&worker->verifier);
+    matching_arena_destroy(&worker->arena);
+}
+
+// Out of scratch memory: the search cannot answer
+static void worker_fail(search_worker_t* worker) {
+    pool_mark_failed(worker->pool);
+    worker->cancelled = true;
+}
+
+static uint64_t table_key(const search_worker_t* worker, int agent_index) {
+    return worker->hash ^ worker->pool->table_salt ^ zobrist_depth_key(agent_index);
+}
+
+// Lower bound on the blocking number of every house allocation leaf below the
+// worker's matching at agent_index: matched agents keep their improving houses,
+// and a free agent ends up with at least the least of those its possible
+// partners leave it (it takes a listed free agent on its turn, or a free agent
+// at or after agent_index that lists it takes it)
+static int improvement_lower_bound(search_worker_t* worker, int agent_index) {
+    const problem_instance_t* instance = worker->pool->instance;
+    const matching_t* matching = worker->matching;
+    int n = instance->num_agents;
+
+    for (int a = 0; a < n; a++) {
+        if (matching->pairs[a] != -1) {
+            int rank = get_agent_rank(instance, a, matching->pairs[a]);
+            worker->prefix_lengths[a] = (rank == RANK_UNACCEPTABLE) ? 0 : rank;
+            continue;
+        }
+
+        // Staying unmatched keeps the whole list; a listed partner keeps the
+        // houses above it; an unlisted one leaves none
+        int prefix = instance_num_preferences(instance, a);
+        for (int partner = 0; partner < n && prefix > 0; partner++) {
+            if (partner == a || matching->pairs[partner] != -1) {
+                continue;
+            }
+            int rank = get_agent_rank(instance, a, partner);
+            bool takes = a >= agent_index && rank != RANK_UNACCEPTABLE;
+            bool taken = partner >= agent_index && get_agent_rank(instance, partner, a) != RANK_UNACCEPTABLE;
+            if (takes || taken) {
+                prefix = (rank == RANK_UNACCEPTABLE) ? 0 : (rank < prefix ? rank : prefix);
+            }
+        }
+        worker->prefix_lengths[a] = prefix;
+    }
+    return house_allocation_prefix_bound(instance, worker->prefix_lengths, worker->pool->k, &worker->arena);
+}
+
+// Whether no leaf below the worker's matching at agent_index can be k-stable:
+// the subtree was already searched, or its improving sets block k
+static bool subtree_excluded(search_worker_t* worker, int agent_index) {
+    search_pool_t* pool = worker->pool;
+    uint64_t value;
+    if (pool->instance->num_agents - agent_index >= TABLE_MIN_REMAINING &&
+        transposition_table_probe(table_key(worker, agent_index), &value)) {
+        return true;
+    }
+    return pool->bounded && improvement_lower_bound(worker, agent_index) >= pool->k;
+}
+
+// Record a subtree searched to the end without a witness (not one cut short)
+static void subtree_exhausted(search_worker_t* worker, int agent_index) {
+    if (!worker->cancelled && worker->pool->instance->num_agents - agent_index >= TABLE_MIN_REMAINING) {
+        transposition_table_store(table_key(worker, agent_index), 0);
+    }
+}
+
+// Depth-first search below agent_index; on success the worker's matching holds the witness
+static bool search_subtree(search_worker_t* worker, int agent_index) {
+    const problem_instance_t* instance = worker->pool->instance;
+    matching_t* matching = worker->matching;
+
+    if (worker_cancelled(worker)) {
+        return false;
+    }
+
+    agent_index = next_open_agent(matching, agent_index);
+    if (agent_index >= instance->num_agents) {
+        return verifier_is_k_stable(&worker->verifier, matching, worker->pool->k);
+    }
+    if (subtree_excluded(worker, agent_index)) {
+        return false;
+    }
+
+    size_t mark = matching_arena_mark(&worker->arena);
+    int* candidates = matching_arena_alloc(&worker->arena,
+                                           instance_num_preferences(instance, agent_index) * sizeof(int));
+    if (candidates == NULL) {
+        worker_fail(worker);
+        return false;
+    }
+    int num_candidates = collect_candidates(instance, matching, agent_index, candidates);
+
+    for (int i = 0; i < num_candidates; i++) {
+        int trail_mark = matching_trail_mark(&worker->trail);
+        matching_trail_set(matching, &worker->trail, agent_index, candidates[i]);
+        matching_trail_set(matching, &worker->trail, candidates[i], agent_index);
+        worker->hash ^= zobrist_pair_key(agent_index, candidates[i]);
+
+        if (search_subtree(worker, agent_index + 1)) {
+            matching_arena_release(&worker->arena, mark);
+            return true;
+        }
+        worker->hash ^= zobrist_pair_key(agent_index, candidates[i]);
+        matching_trail_undo(matching, &worker->trail, trail_mark);
+    }
+    matching_arena_release(&worker->arena, mark);
+
+    if (search_subtree(worker, agent_index + 1)) {
+        return true;
+    }
+    subtree_exhausted(worker, agent_index);
+    return false;
+}
+
+// Split a task into one child task per branch (pushed so the first branch is popped first)
+static void split_task(search_worker_t* worker, const search_task_t* task, int agent_index) {
+    search_pool_t* pool = worker->pool;
+    const problem_instance_t* instance = pool->instance;
+    int n = instance->num_agents;
+    matching_t* matching = worker->matching;
+
+    size_t mark = matching_arena_mark(&worker->arena);
+    int* candidates = matching_arena_alloc(&worker->arena,
+                                           instance_num_preferences(instance, agent_index) * sizeof(int));
+    if (candidates == NULL) {
+        pool_mark_failed(pool);
+        return;
+    }
+    int num_candidates = collect_candidates(instance, matching, agent_index, candidates);
+    int num_children = num_candidates + 1;
+
+    for (int choice = num_children - 1; choice >= 0; choice--) {
+        if (choice < num_candidates) {
+            matching->pairs[agent_index] = candidates[choice];
+            matching->pairs[candidates[choice]] = agent_index;
+        }
+        search_task_t* child = create_task(n, matching->pairs, agent_index + 1,
+                                           task->path, task->path_length, choice);
+        if (choice < num_candidates) {
+            matching->pairs[agent_index] = -1;
+            matching->pairs[candidates[choice]] = -1;
+        }
+        if (child == NULL) {
+            pool_mark_failed(pool);
+            break;
+        }
+        pool_push(pool, worker->id, child);
+    }
+    matching_arena_release(&worker->arena, mark);
+}
+
+static void process_task(search_worker_t* worker, const search_task_t* task) {
+    search_pool_t* pool = worker->pool;
+    int n = pool->instance->num_agents;
+
+    worker->task = task;
+    worker->seen_generation = -1;
+    worker->cancelled = false;
+    if (worker_cancelled(worker)) {
+        return;
+    }
+
+    // A witness from the previous task leaves its assignments on the trail
+    matching_trail_undo(worker->matching, &worker->trail, 0);
+    memcpy(worker->matching->pairs, task->pairs, n * sizeof(int));
+    int agent_index = next_open_agent(worker->matching, task->agent_index);
+    worker->hash = 0;
+    for (int a = 0; a < n; a++) {
+        if (task->pairs[a] > a) {
+            worker->hash ^= zobrist_pair_key(a, task->pairs[a]);
+        }
+    }
+
+    // Tasks the table or the bound rule out are neither split nor searched
+    if (agent_index < n && subtree_excluded(worker, agent_index)) {
+        return;
+    }
+
+    bool starving = __atomic_load_n(&pool->queued, __ATOMIC_RELAXED) < pool->num_threads * TASKS_PER_THREAD;
+    if (pool->num_threads > 1 && starving && n - agent_index > SPLIT_MIN_REMAINING) {
+        split_task(worker, task, agent_index);
+    } else if (search_subtree(worker, agent_index)) {
+        pool_report(worker);
+    }
+}
+
+static void* worker_main(void* arg) {
+    search_worker_t* worker = arg;
+    search_task_t* task;
+    while ((task = pool_take(worker)) != NULL) {
+        process_task(worker, task);
+        free(task);
+        pool_finish(worker->pool);
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public entry points
+// ---------------------------------------------------------------------------
+
+// Find the first k-stable matching (in depth-first order) using nthreads threads.
+// Returns NULL if none exists or the search could not complete; *complete (if
+// not NULL) tells the two apart.
+matching_t* find_k_stable_matching_parallel(const problem_instance_t* instance, int k, int nthreads,
+                                            bool* complete) {
+    if (complete != NULL) {
+        *complete = false;
+    }
+    if (instance == NULL || k <= 0 || k > instance->num_agents) {
+        return NULL;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    int n = instance->num_agents;
+    search_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.instance = instance;
+    pool.k = k;
+    pool.num_threads = nthreads;
+    pool.bounded = instance->model == HOUSE_ALLOCATION || instance->model == HOUSE_ALLOCATION_PARTIAL;
+    pool.table_salt = transposition_table_salt();
+    pool.deques = calloc(nthreads, sizeof(task_deque_t));
+    pool.best_path = malloc((n + 1) * sizeof(int));
+    pool.witness = create_matching(n, instance->model);
+    search_worker_t* workers = calloc(nthreads, sizeof(search_worker_t));
+    pthread_t* threads = calloc(nthreads, sizeof(pthread_t));
+    if (pool.deques == NULL || pool.best_path == NULL || pool.witness == NULL ||
+        workers == NULL || threads == NULL) {
+        free(pool.deques);
+        free(pool.best_path);
+        destroy_matching(pool.witness);
+        free(workers);
+        free(threads);
+        return NULL;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.work_available, NULL);
+
+    int num_ready = 0;
+    while (num_ready < nthreads && deque_init(&pool.deques[num_ready])) {
+        if (!worker_init(&workers[num_ready], &pool, num_ready)) {
+            deque_destroy(&pool.deques[num_ready]);
+            break;
+        }
+        num_ready++;
+    }
+
+    if (num_ready == nthreads) {
+        // Root task: nothing assigned, empty path
+        int* empty = malloc(n * sizeof(int));
+        search_task_t* root = NULL;
+        if (empty != NULL) {
+            for (int i = 0; i < n; i++) {
+                empty[i] = -1;
+            }
+            root = create_task(n, empty, 0, NULL, 0, 0);
+            free(empty);
+        }
+        if (root != NULL) {
+            root->path_length = 0;
+            pool_push(&pool, 0, root);
+
+            // The calling thread is worker 0
+            int num_started = 1;
+            for (int t = 1; t < nthreads; t++) {
+                if (pthread_create(&threads[t], NULL, worker_main, &workers[t]) != 0) {
+                    break;
+                }
+                num_started++;
+            }
+            worker_main(&workers[0]);
+            for (int t = 1; t < num_started; t++) {
+                pthread_join(threads[t], NULL);
+            }
+        } else {
+            pool.failed = true;
+        }
+    } else {
+        pool.failed = true;
+    }
+
+    for (int t = 0; t < num_ready; t++) {
+        worker_destroy(&workers[t]);
+        deque_destroy(&pool.deques[t]);
+    }
+    pthread_cond_destroy(&pool.work_available);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.deques);
+    free(pool.best_path);
+    free(workers);
+    free(threads);
+
+    if (complete != NULL) {
+        *complete = !pool.failed;
+    }
+    if (!pool.found || pool.failed) {
+        destroy_matching(pool.witness);
+        return NULL;
+    }
+    return pool.witness;
+}
+
+// Check if a k-stable matching exists using nthreads threads (false with
+// *complete false if the search failed)
+bool k_stable_matching_exists_parallel(const problem_instance_t* instance, int k, int nthreads,
+                                       bool* complete) {
+    matching_t* witness = find_k_stable_matching_parallel(instance, k, nthreads, complete);
+    if (witness == NULL) {
+        return false;
+    }
+    destroy_matching(witness);
+    return true;
+}
@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../include/matching.h"
+
+// Chunked parallel loop over an index range. Workers claim fixed-size chunks
+// from a shared atomic cursor until the range is exhausted; each call to the
+// chunk function carries the worker id so callers can keep per-worker state
+// (histograms, scratch buffers) and merge it afterwards without locking.
+
+typedef struct {
+    uint64_t count;
+    uint64_t chunk_size;
+    uint64_t next;               // first index not yet claimed (atomic)
+    index_chunk_fn fn;
+    void* context;
+} chunk_loop_t;
+
+typedef struct {
+    chunk_loop_t* loop;
+    int id;
+} chunk_worker_t;
+
+static void* chunk_worker_main(void* arg) {
+    chunk_worker_t* worker = arg;
+    chunk_loop_t* loop = worker->loop;
+
+    while (true) {
+        uint64_t begin = __atomic_fetch_add(&loop->next, loop->chunk_size, __ATOMIC_RELAXED);
+        if (begin >= loop->count) {
+            break;
+        }
+        uint64_t end = begin + loop->chunk_size;
+        if (end > loop->count || end < begin) {
+            end = loop->count;
+        }
+        loop->fn(loop->context, worker->id, begin, end);
+    }
+    return NULL;
+}
+
+// Number of online processors (at least 1)
+int default_thread_count(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) {
+        return 1;
+    }
+    return online > 256 ? 256 : (int)online;
+}
+
+// Run fn over [0, count) in chunks on up to num_threads workers; the calling
+// thread is worker 0. Worker ids are below num_threads. If threads cannot be
+// started the remaining workers absorb their share, so every index is still
+// visited exactly once. Returns false only if no work could be scheduled.
+bool parallel_for_chunks(uint64_t count, uint64_t chunk_size, int num_threads,
+                         index_chunk_fn fn, void* context) {
+    if (fn == NULL) {
+        return false;
+    }
+    if (chunk_size == 0) {
+        chunk_size = 1;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    chunk_loop_t loop = { count, chunk_size, 0, fn, context };
+    chunk_worker_t* workers = calloc(num_threads, sizeof(chunk_worker_t));
+    pthread_t* threads = calloc(num_threads, sizeof(pthread_t));
+    if (workers == NULL || threads == NULL) {
+        free(workers);
+        free(threads);
+        return false;
+    }
+
+    int num_started = 1;
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].loop = &loop;
+        workers[t].id = t;
+    }
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, chunk_worker_main, &workers[t]) != 0) {
+            break;
+        }
+        num_started++;
+    }
+    chunk_worker_main(&workers[0]);
+    for (int t = 1; t < num_started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(workers);
+    free(threads);
+    return true;
+}
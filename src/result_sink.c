@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../include/matching.h"
+
+// Process-wide sink for per-trial benchmark records. Records are formatted
+// into a fixed buffer and written out in large blocks whenever it fills, so
+// a sweep streams to disk in constant memory however many trials it runs.
+// Benchmarks running trials on worker threads emit concurrently, hence the
+// lock around the buffer.
+
+#define RESULT_SINK_BUFFER_BYTES (64 * 1024)
+#define RESULT_RECORD_MAX_BYTES 512
+
+typedef struct {
+    FILE* file;
+    bool owns_file;              // false when writing to stdout
+    bool failed;                 // a write has failed; later records are dropped
+    result_format_t format;
+    char* buffer;
+    size_t used;
+    pthread_mutex_t lock;
+} result_sink_t;
+
+static result_sink_t sink = { NULL, false, false, RESULT_FORMAT_JSONL, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+
+static const char* const result_model_names[] = {"house", "marriage", "roommates", "house_partial"};
+
+// Forward declarations
+static int format_record(const trial_record_t* record, char* line, size_t size);
+static void flush_buffer(void);
+
+// Parse a format name given on the command line
+bool parse_result_format(const char* name, result_format_t* format) {
+    if (strcmp(name, "jsonl") == 0) {
+        *format = RESULT_FORMAT_JSONL;
+    } else if (strcmp(name, "csv") == 0) {
+        *format = RESULT_FORMAT_CSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Start streaming records to path ("-" for stdout). CSV output starts with a header row.
+bool result_sink_open(const char* path, result_format_t format) {
+    if (sink.file != NULL || path == NULL) {
+        return false;
+    }
+    
+    bool to_stdout = strcmp(path, "-") == 0;
+    FILE* file = to_stdout ? stdout : fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    char* buffer = malloc(RESULT_SINK_BUFFER_BYTES);
+    if (buffer == NULL) {
+        if (!to_stdout) fclose(file);
+        return false;
+    }
+    
+    sink.file = file;
+    sink.owns_file = !to_stdout;
+    sink.failed = false;
+    sink.format = format;
+    sink.buffer = buffer;
+    sink.used = 0;
+    
+    if (format == RESULT_FORMAT_CSV) {
+        const char* header = "benchmark,model,n,k,seed,algorithm,wall_ms,cpu_ms,result,nodes,weight\n";
+        sink.used = strlen(header);
+        memcpy(sink.buffer, header, sink.used);
+    }
+    return true;
+}
+
+bool result_sink_active(void) {
+    return sink.file != NULL;
+}
+
+// Append one record; a no-op when no sink is open
+void result_sink_emit(const trial_record_t* record) {
+    if (sink.file == NULL) {
+        return;
+    }
+    
+    char line[RESULT_RECORD_MAX_BYTES];
+    int length = format_record(record, line, sizeof(line));
+    if (length <= 0 || (size_t)length >= sizeof(line)) {
+        return;
+    }
+    
+    pthread_mutex_lock(&sink.lock);
+    if (sink.used + (size_t)length > RESULT_SINK_BUFFER_BYTES) {
+        flush_buffer();
+    }
+    memcpy(sink.buffer + sink.used, line, (size_t)length);
+    sink.used += (size_t)length;
+    pthread_mutex_unlock(&sink.lock);
+}
+
+// Write out buffered records and close the sink. Returns false if any write failed.
+bool result_sink_close(void) {
+    if (sink.file == NULL) {
+        return true;
+    }
+    
+    flush_buffer();
+    bool ok = !sink.failed && fflush(sink.file) == 0;
+    if (sink.owns_file && fclose(sink.file) != 0) {
+        ok = false;
+    }
+    free(sink.buffer);
+    sink.file = NULL;
+    sink.buffer = NULL;
+    sink.used = 0;
+    return ok;
+}
+
+// Format one record as a JSON object or CSV row, newline included.
+// Unknown results and uncounted nodes (-1) become null / empty fields.
+static int format_record(const trial_record_t* record, char* line, size_t size) {
+    const char* model = (record->model >= HOUSE_ALLOCATION && record->model <= HOUSE_ALLOCATION_PARTIAL) ?
+                        result_model_names[record->model] : "unknown";
+    char result[24] = "";
+    char nodes[24] = "";
+    if (record->result >= 0) {
+        snprintf(result, sizeof(result), "%lld", record->result);
+    }
+    if (record->nodes >= 0) {
+        snprintf(nodes, sizeof(nodes), "%lld", record->nodes);
+    }
+    
+    if (sink.format == RESULT_FORMAT_CSV) {
+        return snprintf(line, size, "%s,%s,%d,%d,%llu,%s,%.6f,%.6f,%s,%s,%lld\n",
+                        record->benchmark, model, record->n, record->k, (unsigned long long)record->seed,
+                        record->algorithm, record->wall_ms, record->cpu_ms, result, nodes, record->weight);
+    }
+    return snprintf(line, size,
+                    "{\"benchmark\":\"%s\",\"model\":\"%s\",\"n\":%d,\"k\":%d,\"seed\":%llu,"
+                    "\"algorithm\":\"%s\",\"wall_ms\":%.6f,\"cpu_ms\":%.6f,\"result\":%s,\"nodes\":%s,"
+                    "\"weight\":%lld}\n",
+                    record->benchmark, model, record->n, record->k, (unsigned long long)record->seed,
+                    record->algorithm, record->wall_ms, record->cpu_ms,
+                    result[0] != '\0' ? result : "null", nodes[0] != '\0' ? nodes : "null", record->weight);
+}
+
+// Write the buffer to the file (caller holds the lock, or is the only thread)
+static void flush_buffer(void) {
+    if (sink.used > 0 && !sink.failed &&
+        fwrite(sink.buffer, 1, sink.used, sink.file) != sink.used) {
+        sink.failed = true;
+    }
+    sink.used = 0;
+}
@@ -0,0 +1,530 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "../include/matching.h"
+
+// Exact counting of k-stable house allocation matchings by dynamic programming
+// over subsets of decided agents.
+//
+// The matchings are the ones count_k_stable_matchings searches: symmetric
+// pairs (agent a holds house pairs[a]), no agent holding its own index, and any
+// agent may stay unmatched. The lowest undecided agent either stays unmatched
+// or pairs with another undecided agent, which decides both, so each matching
+// is built exactly once. The recursive search reaches a matching with p pairs
+// along 2^p paths (each pair is formed by its lower agent, or by the higher one
+// after the lower one was skipped), and counts it once per path.
+//
+// A house allocation blocking number only depends on the set of houses each
+// agent strictly prefers to its own, a prefix of its list (see
+// blocking_number.c): it is the maximum matching of agents into those sets,
+// the rank of their transversal matroid. A subproblem is (decided agents,
+// multiset of their improving sets), and its value the number of completions
+// by final blocking number. Only the matroid matters, and the sets covered by
+// a maximum matching present the same one, so the others are dropped: the key
+// holds fewer than k sets, and choices that end in the same sets share it.
+// Random preferences rarely repeat a key, and there the memo is overhead and
+// the pruning below does the work; lists that agree with each other (a common
+// ranking, say) repeat them often.
+//
+// Adding agents never lowers a maximum matching, and every undecided agent
+// will prefer at least the houses above its best remaining partner. A
+// subproblem whose decided sets and those least sets already block k is not
+// expanded; the matchings below it are counted in the last histogram bucket,
+// from the total.
+//
+// The memo stays within a byte budget (--memo-mb, 256 MiB by default). Once
+// growing it would exceed the budget, further subproblems are solved uncached:
+// the count is the same, only repeated keys are expanded again.
+
+#define MEMO_MIN_SLOTS 1024
+#define MEMO_DEFAULT_BYTES ((size_t)256 << 20)
+
+// Decided agents and their improving sets, sorted ascending without empty sets
+typedef struct {
+    uint32_t decided;
+    int blocking;                         // Maximum matching of sets, capped at k
+    int size;
+    uint32_t sets[COUNT_DP_MAX_N];
+} improving_family_t;
+
+// Memo entry: key words at keys[key_offset] (decided, size, sets...) and
+// k + 1 values at values[value_offset] (completions by blocking number below
+// k, then search leaves)
+typedef struct {
+    uint64_t hash;
+    long long key_offset;                 // -1 for an empty slot
+    long long value_offset;
+} memo_slot_t;
+
+typedef struct {
+    int n;
+    int k;
+    uint32_t all_agents;
+    uint32_t* prefix_masks;               // Houses above rank r: prefix_masks[prefix_start[a] + r]
+    int* prefix_start;
+    int* list_length;
+    memo_slot_t* slots;
+    size_t num_slots;                     // A power of two
+    size_t used_slots;
+    uint32_t* keys;
+    size_t keys_used;
+    size_t keys_capacity;
+    uint64_t* values;
+    size_t values_used;
+    size_t values_capacity;
+    long long subproblems;
+    long long memo_hits;
+    long long uncached;
+} subset_counter_t;
+
+static count_backend_t selected_backend = COUNT_BACKEND_RECURSIVE;
+static size_t memo_budget = MEMO_DEFAULT_BYTES;
+
+// Forward declarations
+static bool subset_counter_init(subset_counter_t* counter, const problem_instance_t* instance, int k);
+static void subset_counter_destroy(subset_counter_t* counter);
+static uint32_t improving_set(const subset_counter_t* counter, const problem_instance_t* instance,
+                              int agent, int house);
+static uint32_t least_improving_set(const subset_counter_t* counter, const problem_instance_t* instance,
+                                    int agent, uint32_t undecided);
+static void family_add(improving_family_t* family, uint32_t set);
+static int family_reduce(improving_family_t* family, int limit);
+static uint64_t family_hash(const improving_family_t* family);
+static size_t memo_bytes(size_t num_slots, size_t keys_capacity, size_t values_capacity);
+static memo_slot_t* memo_find(subset_counter_t* counter, const improving_family_t* family, uint64_t hash);
+static bool memo_insert(subset_counter_t* counter, const improving_family_t* family, uint64_t hash,
+                        const uint64_t* values);
+static bool count_completions(subset_counter_t* counter, const problem_instance_t* instance,
+                              const improving_family_t* family, uint64_t* values);
+static bool add_completions(subset_counter_t* counter, const problem_instance_t* instance,
+                            const improving_family_t* family, uint64_t leaf_weight, uint64_t* values);
+static long long count_all_matchings(int n);
+
+// Backend used by count_k_stable_matchings (recursive by default)
+void set_count_backend(count_backend_t backend) {
+    selected_backend = backend;
+}
+
+count_backend_t count_backend(void) {
+    return selected_backend;
+}
+
+// Bytes the dp memo may grow to per count (0 disables memoization)
+void set_count_memo_budget(size_t budget_bytes) {
+    memo_budget = budget_bytes;
+}
+
+size_t count_memo_budget(void) {
+    return memo_budget;
+}
+
+// Exact counts for the house allocation matchings of instance at k, with their
+// blocking-number distribution. Returns false if the instance is not house
+// allocation, has more than COUNT_DP_MAX_N agents or 32 houses, or memory ran
+// out.
+bool count_k_stable_matchings_dp(const problem_instance_t* instance, int k, matching_count_t* result) {
+    if (instance == NULL || result == NULL || instance->model != HOUSE_ALLOCATION ||
+        instance->num_agents <= 0 || instance->num_agents > COUNT_DP_MAX_N ||
+        instance->num_targets > 32 || k <= 0 || k > instance->num_agents) {
+        return false;
+    }
+
+    subset_counter_t counter;
+    if (!subset_counter_init(&counter, instance, k)) {
+        return false;
+    }
+
+    improving_family_t root;
+    root.decided = 0;
+    root.blocking = 0;
+    root.size = 0;
+    uint64_t values[COUNT_DP_MAX_N + 1] = {0};
+    bool ok = count_completions(&counter, instance, &root, values);
+
+    if (ok) {
+        memset(result, 0, sizeof(*result));
+        result->k = k;
+        result->total = count_all_matchings(instance->num_agents);
+        for (int b = 0; b < k; b++) {
+            result->blocking_histogram[b] = (long long)values[b];
+            result->k_stable += (long long)values[b];
+        }
+        result->blocking_histogram[k] = result->total - result->k_stable;
+        result->search_leaves = (long long)values[k];
+        result->subproblems = counter.subproblems;
+        result->memo_hits = counter.memo_hits;
+        result->uncached = counter.uncached;
+    }
+    subset_counter_destroy(&counter);
+    return ok;
+}
+
+static bool subset_counter_init(subset_counter_t* counter, const problem_instance_t* instance, int k) {
+    memset(counter, 0, sizeof(*counter));
+    int n = instance->num_agents;
+    counter->n = n;
+    counter->k = k;
+    counter->all_agents = ((uint32_t)1 << n) - 1;
+
+    counter->prefix_start = malloc(n * sizeof(int));
+    counter->list_length = malloc(n * sizeof(int));
+    counter->prefix_masks = malloc((instance->pref_offsets[n] + n) * sizeof(uint32_t));
+    counter->num_slots = MEMO_MIN_SLOTS;
+    counter->slots = malloc(counter->num_slots * sizeof(memo_slot_t));
+    if (counter->prefix_start == NULL || counter->list_length == NULL ||
+        counter->prefix_masks == NULL || counter->slots == NULL) {
+        subset_counter_destroy(counter);
+        return false;
+    }
+    for (size_t s = 0; s < counter->num_slots; s++) {
+        counter->slots[s].key_offset = -1;
+    }
+
+    // Each agent's improving set for every rank its house can have
+    int start = 0;
+    for (int a = 0; a < n; a++) {
+        const int* list = instance_preferences(instance, a);
+        int length = instance_num_preferences(instance, a);
+        counter->prefix_start[a] = start;
+        counter->list_length[a] = length;
+        uint32_t mask = 0;
+        for (int r = 0; r < length; r++) {
+            counter->prefix_masks[start + r] = mask;
+            mask |= (uint32_t)1 << list[r];
+        }
+        counter->prefix_masks[start + length] = mask;
+        start += length + 1;
+    }
+    return true;
+}
+
+static void subset_counter_destroy(subset_counter_t* counter) {
+    free(counter->prefix_masks);
+    free(counter->prefix_start);
+    free(counter->list_length);
+    free(counter->slots);
+    free(counter->keys);
+    free(counter->values);
+    memset(counter, 0, sizeof(*counter));
+}
+
+// Houses agent strictly prefers to house (-1: unmatched), as a bit mask
+static uint32_t improving_set(const subset_counter_t* counter, const problem_instance_t* instance,
+                              int agent, int house) {
+    const uint32_t* masks = counter->prefix_masks + counter->prefix_start[agent];
+    if (house == -1) {
+        return masks[counter->list_length[agent]];
+    }
+    int rank = get_agent_rank(instance, agent, house);
+    return (rank == RANK_UNACCEPTABLE) ? 0 : masks[rank];
+}
+
+// Smallest improving set agent can end up with when its partner is one of the
+// undecided agents or none
+static uint32_t least_improving_set(const subset_counter_t* counter, const problem_instance_t* instance,
+                                    int agent, uint32_t undecided) {
+    const uint32_t* masks = counter->prefix_masks + counter->prefix_start[agent];
+    int length = counter->list_length[agent];
+    uint32_t partners = undecided & ~((uint32_t)1 << agent);
+    if (partners == 0) {
+        return masks[length];
+    }
+    if ((partners & ~masks[length]) != 0) {
+        return 0;                         // An unlisted partner leaves it no better house
+    }
+
+    const int* list = instance_preferences(instance, agent);
+    int rank = 0;
+    while (((partners >> list[rank]) & 1) == 0) {
+        rank++;
+    }
+    return masks[rank];
+}
+
+// Add an agent's improving set, keeping the sets sorted
+static void family_add(improving_family_t* family, uint32_t set) {
+    if (set == 0) {
+        return;
+    }
+
+    int position = family->size;
+    while (position > 0 && family->sets[position - 1] > set) {
+        family->sets[position] = family->sets[position - 1];
+        position--;
+    }
+    family->sets[position] = set;
+    family->size++;
+}
+
+// Maximum matching of the family's sets into distinct houses (augmenting paths
+// over bit masks), capped at limit. Below the cap, the sets left unmatched are
+// dropped: the matched ones present the same transversal matroid.
+static int family_reduce(improving_family_t* family, int limit) {
+    int holder[32];                       // Set matched to each house, -1 if none
+    int house_of[COUNT_DP_MAX_N];         // House matched to each set, -1 if none
+    for (int h = 0; h < 32; h++) {
+        holder[h] = -1;
+    }
+
+    int matched = 0;
+    for (int root = 0; root < family->size && matched < limit; root++) {
+        // Depth-first search for an augmenting path from set root
+        int stack[COUNT_DP_MAX_N];
+        uint32_t untried[COUNT_DP_MAX_N];
+        int came_from[32];
+        uint32_t visited = 0;
+        int depth = 0;
+        stack[0] = root;
+        untried[0] = family->sets[root];
+        house_of[root] = -1;
+
+        while (depth >= 0) {
+            uint32_t options = untried[depth] & ~visited;
+            if (options == 0) {
+                depth--;
+                continue;
+            }
+            int house = __builtin_ctz(options);
+            untried[depth] &= ~((uint32_t)1 << house);
+            visited |= (uint32_t)1 << house;
+            came_from[house] = stack[depth];
+
+            if (holder[house] == -1) {
+                // Flip the path back to root
+                while (house != -1) {
+                    int set = came_from[house];
+                    int previous = house_of[set];
+                    holder[house] = set;
+                    house_of[set] = house;
+                    house = (set == root) ? -1 : previous;
+                }
+                matched++;
+                break;
+            }
+            depth++;
+            stack[depth] = holder[house];
+            untried[depth] = family->sets[holder[house]];
+        }
+    }
+    if (matched < limit) {
+        int kept = 0;
+        for (int i = 0; i < family->size; i++) {
+            if (house_of[i] != -1) {
+                family->sets[kept++] = family->sets[i];
+            }
+        }
+        family->size = kept;
+    }
+    return matched;
+}
+
+static uint64_t family_hash(const improving_family_t* family) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ family->decided;
+    for (int i = 0; i < family->size; i++) {
+        hash = (hash ^ family->sets[i]) * 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 29;
+    }
+    return hash ^ (hash >> 32);
+}
+
+static memo_slot_t* memo_find(subset_counter_t* counter, const improving_family_t* family, uint64_t hash) {
+    size_t mask = counter->num_slots - 1;
+    for (size_t s = hash & mask; ; s = (s + 1) & mask) {
+        memo_slot_t* slot = &counter->slots[s];
+        if (slot->key_offset == -1) {
+            return slot;
+        }
+        const uint32_t* key = counter->keys + slot->key_offset;
+        if (slot->hash == hash && key[0] == family->decided && key[1] == (uint32_t)family->size &&
+            memcmp(key + 2, family->sets, family->size * sizeof(uint32_t)) == 0) {
+            return slot;
+        }
+    }
+}
+
+static size_t memo_bytes(size_t num_slots, size_t keys_capacity, size_t values_capacity) {
+    return num_slots * sizeof(memo_slot_t) + keys_capacity * sizeof(uint32_t) +
+           values_capacity * sizeof(uint64_t);
+}
+
+// Store a solved subproblem, unless the memo would outgrow its budget (then it
+// is left uncached). Returns false only if memory ran out.
+static bool memo_insert(subset_counter_t* counter, const improving_family_t* family, uint64_t hash,
+                        const uint64_t* values) {
+    // Keep the table at most half full
+    size_t key_words = 2 + (size_t)family->size;
+    size_t value_words = (size_t)counter->k + 1;
+    size_t num_slots = counter->num_slots;
+    size_t keys_capacity = counter->keys_capacity;
+    size_t values_capacity = counter->values_capacity;
+    if (2 * (counter->used_slots + 1) > num_slots) {
+        num_slots *= 2;
+    }
+    if (counter->keys_used + key_words > keys_capacity) {
+        keys_capacity = (keys_capacity > 0) ? keys_capacity * 2 : 4096;
+    }
+    if (counter->values_used + value_words > values_capacity) {
+        values_capacity = (values_capacity > 0) ? values_capacity * 2 : 4096;
+    }
+    if (memo_bytes(num_slots, keys_capacity, values_capacity) > memo_budget) {
+        counter->uncached++;
+        return true;
+    }
+
+    if (num_slots != counter->num_slots) {
+        memo_slot_t* slots = malloc(num_slots * sizeof(memo_slot_t));
+        if (slots == NULL) {
+            return false;
+        }
+        for (size_t s = 0; s < num_slots; s++) {
+            slots[s].key_offset = -1;
+        }
+        for (size_t s = 0; s < counter->num_slots; s++) {
+            const memo_slot_t* old = &counter->slots[s];
+            if (old->key_offset == -1) {
+                continue;
+            }
+            size_t t = old->hash & (num_slots - 1);
+            while (slots[t].key_offset != -1) {
+                t = (t + 1) & (num_slots - 1);
+            }
+            slots[t] = *old;
+        }
+        free(counter->slots);
+        counter->slots = slots;
+        counter->num_slots = num_slots;
+    }
+    if (keys_capacity != counter->keys_capacity) {
+        uint32_t* keys = realloc(counter->keys, keys_capacity * sizeof(uint32_t));
+        if (keys == NULL) {
+            return false;
+        }
+        counter->keys = keys;
+        counter->keys_capacity = keys_capacity;
+    }
+    if (values_capacity != counter->values_capacity) {
+        uint64_t* grown = realloc(counter->values, values_capacity * sizeof(uint64_t));
+        if (grown == NULL) {
+            return false;
+        }
+        counter->values = grown;
+        counter->values_capacity = values_capacity;
+    }
+
+    memo_slot_t* slot = memo_find(counter, family, hash);
+    slot->hash = hash;
+    slot->key_offset = (long long)counter->keys_used;
+    slot->value_offset = (long long)counter->values_used;
+    uint32_t* key = counter->keys + counter->keys_used;
+    key[0] = family->decided;
+    key[1] = (uint32_t)family->size;
+    memcpy(key + 2, family->sets, family->size * sizeof(uint32_t));
+    memcpy(counter->values + counter->values_used, values, value_words * sizeof(uint64_t));
+    counter->keys_used += key_words;
+    counter->values_used += value_words;
+    counter->used_slots++;
+    return true;
+}
+
+// Completions of family by final blocking number (values[0..k-1]) and the
+// search leaves among them (values[k]), added to values
+static bool count_completions(subset_counter_t* counter, const problem_instance_t* instance,
+                              const improving_family_t* family, uint64_t* values) {
+    if (family->decided == counter->all_agents) {
+        values[family->blocking]++;
+        values[counter->k]++;
+        return true;
+    }
+
+    uint64_t hash = family_hash(family);
+    memo_slot_t* slot = memo_find(counter, family, hash);
+    if (slot->key_offset != -1) {
+        const uint64_t* stored = counter->values + slot->value_offset;
+        for (int b = 0; b <= counter->k; b++) {
+            values[b] += stored[b];
+        }
+        counter->memo_hits++;
+        return true;
+    }
+
+    counter->subproblems++;
+    uint64_t completions[COUNT_DP_MAX_N + 1] = {0};
+    int agent = __builtin_ctz(~family->decided & counter->all_agents);
+
+    // Leave the lowest undecided agent unmatched
+    improving_family_t child = *family;
+    child.decided |= (uint32_t)1 << agent;
+    family_add(&child, improving_set(counter, instance, agent, -1));
+    if (!add_completions(counter, instance, &child, 1, completions)) {
+        return false;
+    }
+
+    // Or give it house partner and partner house agent
+    uint32_t partners = ~child.decided & counter->all_agents;
+    while (partners != 0) {
+        int partner = __builtin_ctz(partners);
+        partners &= partners - 1;
+        child = *family;
+        child.decided |= ((uint32_t)1 << agent) | ((uint32_t)1 << partner);
+        family_add(&child, improving_set(counter, instance, agent, partner));
+        family_add(&child, improving_set(counter, instance, partner, agent));
+        if (!add_completions(counter, instance, &child, 2, completions)) {
+            return false;
+        }
+    }
+
+    if (!memo_insert(counter, family, hash, completions)) {
+        return false;
+    }
+    for (int b = 0; b <= counter->k; b++) {
+        values[b] += completions[b];
+    }
+    return true;
+}
+
+// Completions of a child whose last choice is on leaf_weight search paths;
+// children that already block k have none below k
+static bool add_completions(subset_counter_t* counter, const problem_instance_t* instance,
+                            const improving_family_t* family, uint64_t leaf_weight, uint64_t* values) {
+    improving_family_t child = *family;
+    child.blocking = family_reduce(&child, counter->k);
+    if (child.blocking >= counter->k) {
+        return true;
+    }
+
+    // Each undecided agent ends up preferring at least the houses above its
+    // best remaining partner, so these sets bound the final blocking number
+    improving_family_t bound = child;
+    uint32_t undecided = ~child.decided & counter->all_agents;
+    for (uint32_t rest = undecided; rest != 0; rest &= rest - 1) {
+        family_add(&bound, least_improving_set(counter, instance, __builtin_ctz(rest), undecided));
+    }
+    if (family_reduce(&bound, counter->k) >= counter->k) {
+        return true;
+    }
+
+    uint64_t completions[COUNT_DP_MAX_N + 1] = {0};
+    if (!count_completions(counter, instance, &child, completions)) {
+        return false;
+    }
+    for (int b = 0; b < counter->k; b++) {
+        values[b] += completions[b];
+    }
+    values[counter->k] += leaf_weight * completions[counter->k];
+    return true;
+}
+
+// Matchings in the search space: the last agent stays unmatched or pairs with
+// one of the others
+static long long count_all_matchings(int n) {
+    long long previous = 1;
+    long long current = 1;
+    for (int m = 2; m <= n; m++) {
+        long long next = current + (long long)(m - 1) * previous;
+        previous = current;
+        current = next;
+    }
+    return current;
+}
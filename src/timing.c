@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/matching.h"
+
+// Timing on the monotonic wall clock and the CPU clocks, plus a process-wide
+// profile of nested named phases. Phases are opened and closed on the main
+// thread only; work done on worker threads is folded in with phase_add.
+// Every distinct path of phase names (e.g. existence_complexity/generate)
+// accumulates its own call count, wall time and CPU time.
+
+#define PHASE_MAX_NODES 128
+#define PHASE_MAX_DEPTH 16
+
+typedef struct {
+    const char* name;
+    int parent;                  // enclosing phase, -1 at top level
+    long long calls;
+    double wall_ms;
+    double cpu_ms;
+} phase_node_t;
+
+typedef struct {
+    phase_node_t nodes[PHASE_MAX_NODES];
+    int num_nodes;
+    int open[PHASE_MAX_DEPTH];   // node of each open phase, -1 if it did not fit
+    stopwatch_t watches[PHASE_MAX_DEPTH];
+    int depth;
+} phase_profile_t;
+
+static phase_profile_t profile = { .num_nodes = 0, .depth = 0 };
+
+// Forward declarations
+static double timespec_ms(clockid_t clock_id);
+static int phase_node(int parent, const char* name);
+static void print_phase_children(int parent, int level);
+
+// Monotonic wall clock in milliseconds (arbitrary origin)
+double wall_time_ms(void) {
+    return timespec_ms(CLOCK_MONOTONIC);
+}
+
+// CPU time consumed by the calling thread, in milliseconds
+double thread_cpu_time_ms(void) {
+    return timespec_ms(CLOCK_THREAD_CPUTIME_ID);
+}
+
+// CPU time consumed by all threads of the process, in milliseconds
+double process_cpu_time_ms(void) {
+    return timespec_ms(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void stopwatch_start(stopwatch_t* watch) {
+    watch->wall_start = wall_time_ms();
+    watch->cpu_start = thread_cpu_time_ms();
+    watch->wall_ms = 0.0;
+    watch->cpu_ms = 0.0;
+}
+
+// Set wall_ms / cpu_ms to the time since stopwatch_start
+void stopwatch_stop(stopwatch_t* watch) {
+    double cpu_end = thread_cpu_time_ms();
+    watch->wall_ms = wall_time_ms() - watch->wall_start;
+    watch->cpu_ms = cpu_end - watch->cpu_start;
+}
+
+// Open a phase nested inside the innermost open one
+void phase_begin(const char* name) {
+    if (profile.depth >= PHASE_MAX_DEPTH) {
+        profile.depth++;
+        return;
+    }
+    int parent = (profile.depth > 0) ? profile.open[profile.depth - 1] : -1;
+    profile.open[profile.depth] = (parent == -1 && profile.depth > 0) ? -1 : phase_node(parent, name);
+    stopwatch_start(&profile.watches[profile.depth]);
+    profile.depth++;
+}
+
+// Close the innermost phase; its elapsed times are copied to elapsed if not NULL
+void phase_end(stopwatch_t* elapsed) {
+    if (profile.depth == 0) {
+        return;
+    }
+    profile.depth--;
+    if (profile.depth >= PHASE_MAX_DEPTH) {
+        return;
+    }
+    
+    stopwatch_t* watch = &profile.watches[profile.depth];
+    stopwatch_stop(watch);
+    int node = profile.open[profile.depth];
+    if (node >= 0) {
+        profile.nodes[node].calls++;
+        profile.nodes[node].wall_ms += watch->wall_ms;
+        profile.nodes[node].cpu_ms += watch->cpu_ms;
+    }
+    if (elapsed != NULL) {
+        *elapsed = *watch;
+    }
+}
+
+// Charge time measured elsewhere (e.g. summed over worker threads) to a phase
+// nested inside the innermost open one
+void phase_add(const char* name, double wall_ms, double cpu_ms, long long calls) {
+    if (profile.depth > PHASE_MAX_DEPTH) {
+        return;
+    }
+    int parent = (profile.depth > 0) ? profile.open[profile.depth - 1] : -1;
+    if (parent == -1 && profile.depth > 0) {
+        return;
+    }
+    int node = phase_node(parent, name);
+    if (node >= 0) {
+        profile.nodes[node].calls += calls;
+        profile.nodes[node].wall_ms += wall_ms;
+        profile.nodes[node].cpu_ms += cpu_ms;
+    }
+}
+
+// Forget all phases (open phases stay open but start over)
+void phase_profile_reset(void) {
+    profile.num_nodes = 0;
+    for (int d = 0; d < profile.depth && d < PHASE_MAX_DEPTH; d++) {
+        profile.open[d] = -1;
+    }
+}
+
+// Print the phase tree with calls, wall and CPU time, and each phase's share
+// of its parent's wall time
+void phase_profile_print(void) {
+    if (profile.num_nodes == 0) {
+        return;
+    }
+    printf("\n=== Phase Profile ===\n");
+    printf("%-36s %10s %14s %14s %8s\n", "Phase", "Calls", "Wall (ms)", "CPU (ms)", "Share");
+    print_phase_children(-1, 0);
+}
+
+// Clock reading in milliseconds; falls back to clock() for CPU clocks the
+// platform does not provide
+static double timespec_ms(clockid_t clock_id) {
+    struct timespec now;
+    if (clock_gettime(clock_id, &now) != 0) {
+        return (double)clock() / CLOCKS_PER_SEC * 1000.0;
+    }
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1e6;
+}
+
+// Node for the phase called name under parent, created on first use
+// (-1 when the profile is full)
+static int phase_node(int parent, const char* name) {
+    for (int i = 0; i < profile.num_nodes; i++) {
+        if (profile.nodes[i].parent == parent && strcmp(profile.nodes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (profile.num_nodes >= PHASE_MAX_NODES) {
+        return -1;
+    }
+    phase_node_t* node = &profile.nodes[profile.num_nodes];
+    node->name = name;
+    node->parent = parent;
+    node->calls = 0;
+    node->wall_ms = 0.0;
+    node->cpu_ms = 0.0;
+    return profile.num_nodes++;
+}
+
+static void print_phase_children(int parent, int level) {
+    for (int i = 0; i < profile.num_nodes; i++) {
+        const phase_node_t* node = &profile.nodes[i];
+        if (node->parent != parent) {
+            continue;
+        }
+        
+        char label[64];
+        snprintf(label, sizeof(label), "%*s%s", level * 2, "", node->name);
+        double parent_wall = (parent >= 0) ? profile.nodes[parent].wall_ms : 0.0;
+        if (parent_wall > 0.0) {
+            printf("%-36s %10lld %14.3f %14.3f %7.1f%%\n", label, node->calls, node->wall_ms,
+                   node->cpu_ms, 100.0 * node->wall_ms / parent_wall);
+        } else {
+            printf("%-36s %10lld %14.3f %14.3f %8s\n", label, node->calls, node->wall_ms,
+                   node->cpu_ms, "-");
+        }
+        print_phase_children(i, level + 1);
+    }
+}
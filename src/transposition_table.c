@@ -0,0 +1,141 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../include/matching.h"
+
+// Transposition table for the recursive searches. The searches assign agents
+// in index order, but an agent left unmatched can still be taken by a later
+// one, so the same partial matching at the same agent index is reached along
+// several paths; the subtree below it has the same result every time.
+//
+// A node is keyed by a Zobrist hash: the XOR of one random 64-bit value per
+// matched pair and one for the agent index, updated with a single XOR per
+// (un)assignment. Each search XORs in its own salt, so the process-wide table
+// is shared by concurrent searches and never cleared: another search's
+// entries (or a stale one from a finished search) simply do not match.
+//
+// Entries are two words written with plain atomic stores and no lock: the
+// first holds key ^ value, so an entry torn by a concurrent writer fails the
+// key check and reads as a miss. Slots are always replaced.
+
+#define TRANSPOSITION_DEFAULT_BYTES ((size_t)16 << 20)
+#define ZOBRIST_PAIR_SEED  0x243f6a8885a308d3ULL
+#define ZOBRIST_DEPTH_SEED 0x13198a2e03707344ULL
+
+typedef struct {
+    uint64_t check;              // key ^ value
+    uint64_t value;
+} transposition_entry_t;
+
+typedef struct {
+    transposition_entry_t* entries;
+    uint64_t mask;               // entries - 1 (a power of two), 0 when disabled
+    size_t budget;
+    bool configured;
+    uint64_t next_salt;          // atomic
+} transposition_table_t;
+
+static transposition_table_t table = { NULL, 0, TRANSPOSITION_DEFAULT_BYTES, false, 0 };
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+
+// Forward declarations
+static uint64_t mix64(uint64_t z);
+static void allocate_default_table(void);
+static bool allocate_table(size_t budget_bytes);
+
+// Size the table to the largest power-of-two entry count within budget_bytes
+// (0 disables it). Call before any search runs; entries are not carried over.
+bool transposition_table_configure(size_t budget_bytes) {
+    table.configured = true;
+    return allocate_table(budget_bytes);
+}
+
+// Bytes the table occupies (0 when disabled)
+size_t transposition_table_bytes(void) {
+    pthread_once(&table_once, allocate_default_table);
+    return (table.entries != NULL) ? (size_t)(table.mask + 1) * sizeof(transposition_entry_t) : 0;
+}
+
+// A fresh salt for one search's keys
+uint64_t transposition_table_salt(void) {
+    return mix64(__atomic_add_fetch(&table.next_salt, 1, __ATOMIC_RELAXED));
+}
+
+// Zobrist value of the pair {a, b}
+uint64_t zobrist_pair_key(int a, int b) {
+    uint64_t low = (uint64_t)(uint32_t)(a < b ? a : b);
+    uint64_t high = (uint64_t)(uint32_t)(a < b ? b : a);
+    return mix64(ZOBRIST_PAIR_SEED ^ ((high << 32) | low));
+}
+
+// Zobrist value of the agent index a node sits at
+uint64_t zobrist_depth_key(int depth) {
+    return mix64(ZOBRIST_DEPTH_SEED + (uint64_t)(uint32_t)depth);
+}
+
+// Value stored under key, if its slot still holds it
+bool transposition_table_probe(uint64_t key, uint64_t* value) {
+    pthread_once(&table_once, allocate_default_table);
+    if (table.entries == NULL) {
+        return false;
+    }
+    transposition_entry_t* entry = &table.entries[key & table.mask];
+    uint64_t stored = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    if ((check ^ stored) != key) {
+        return false;
+    }
+    *value = stored;
+    return true;
+}
+
+void transposition_table_store(uint64_t key, uint64_t value) {
+    pthread_once(&table_once, allocate_default_table);
+    if (table.entries == NULL) {
+        return;
+    }
+    transposition_entry_t* entry = &table.entries[key & table.mask];
+    __atomic_store_n(&entry->check, key ^ value, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+}
+
+// SplitMix64 finalizer (a bijection on 64-bit words)
+static uint64_t mix64(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// First use without transposition_table_configure: the default budget
+static void allocate_default_table(void) {
+    if (!table.configured) {
+        allocate_table(table.budget);
+    }
+}
+
+static bool allocate_table(size_t budget_bytes) {
+    free(table.entries);
+    table.entries = NULL;
+    table.mask = 0;
+    table.budget = budget_bytes;
+
+    size_t count = 1;
+    while (count * 2 * sizeof(transposition_entry_t) <= budget_bytes) {
+        count *= 2;
+    }
+    if (budget_bytes < sizeof(transposition_entry_t)) {
+        return true;
+    }
+    // Zeroed entries read as key 0, which no salted key is in practice
+    table.entries = calloc(count, sizeof(transposition_entry_t));
+    if (table.entries == NULL) {
+        return false;
+    }
+    table.mask = count - 1;
+    return true;
+}
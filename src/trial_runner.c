@@ -0,0 +1,393 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include "../include/matching.h"
+
+// Batches of independent benchmark trials. A benchmark queues one group of
+// trials per table cell, each trial a (source, task, n, k, seed) job; the
+// batch then runs on worker threads claiming one job at a time. Every worker
+// adds its outcomes to its own row of group totals and keeps its own instance
+// and matching buffers, regenerated in place job after job, so nothing is
+// shared or reallocated while the jobs run; the rows are merged in
+// worker order at the end. Seeds are the process-wide base plus a per-trial
+// offset, so a run is reproducible and its counts do not depend on the
+// number of threads.
+
+#define TRIAL_CHUNK_SIZE 1
+#define TRIAL_BATCH_INITIAL_CAPACITY 64
+
+// Process-wide settings (--threads, --seed); 0 threads means all cores
+static int trial_thread_setting = 0;
+static uint32_t trial_base_seed = 1;
+
+typedef struct {
+    trial_totals_t* totals;      // [num_groups]
+    problem_instance_t* instance;   // generated jobs' instance, rebuilt in place
+    matching_t* matching;        // reused while jobs keep the same size and model
+    double generate_wall;
+    double generate_cpu;
+    long long generated;
+    double task_wall[2];         // by trial_task_t
+    double task_cpu[2];
+    long long task_calls[2];
+} trial_worker_t;
+
+typedef struct {
+    const trial_batch_t* batch;
+    const char* benchmark;
+    bool collect_stats;
+    trial_worker_t* workers;
+} trial_run_t;
+
+// Forward declarations
+static void run_trial_chunk(void* context, int worker, uint64_t begin, uint64_t end);
+static matching_t* trial_matching(trial_worker_t* worker, const problem_instance_t* instance, bool fixed);
+static void add_trial_outcome(trial_totals_t* totals, double generate_ms, const stopwatch_t* timer,
+                              bool positive, const search_stats_t* stats);
+static void merge_trial_totals(trial_totals_t* into, const trial_totals_t* from);
+static void reset_trial_totals(trial_totals_t* totals);
+
+void set_trial_threads(int num_threads) {
+    trial_thread_setting = (num_threads > 0) ? num_threads : 0;
+}
+
+// Worker threads a batch runs on: the --threads setting, else all cores
+int trial_threads(void) {
+    return (trial_thread_setting > 0) ? trial_thread_setting : default_thread_count();
+}
+
+void set_trial_base_seed(uint32_t seed) {
+    trial_base_seed = seed;
+}
+
+// Generator seed of the trial at offset from the base seed
+uint32_t trial_seed(uint32_t offset) {
+    return trial_base_seed + offset;
+}
+
+void trial_batch_init(trial_batch_t* batch, const problem_instance_t* instance) {
+    batch->jobs = NULL;
+    batch->num_jobs = 0;
+    batch->capacity = 0;
+    batch->num_groups = 0;
+    batch->totals = NULL;
+    batch->instance = instance;
+}
+
+// Queue num_trials trials of one configuration as a new group; trial t is
+// seeded with trial_seed(seed_offset + t). Returns the group, or -1 if out of memory.
+int trial_batch_add_group(trial_batch_t* batch, trial_source_t source, trial_task_t task,
+                          int n, int param, int k, uint32_t seed_offset, int num_trials) {
+    if (num_trials < 0 || (source == TRIAL_FIXED && batch->instance == NULL)) {
+        return -1;
+    }
+    if (batch->num_jobs + num_trials > batch->capacity) {
+        int capacity = (batch->capacity > 0) ? batch->capacity : TRIAL_BATCH_INITIAL_CAPACITY;
+        while (capacity < batch->num_jobs + num_trials) {
+            capacity *= 2;
+        }
+        trial_job_t* jobs = realloc(batch->jobs, (size_t)capacity * sizeof(trial_job_t));
+        if (jobs == NULL) {
+            return -1;
+        }
+        batch->jobs = jobs;
+        batch->capacity = capacity;
+    }
+
+    int group = batch->num_groups++;
+    for (int trial = 0; trial < num_trials; trial++) {
+        trial_job_t* job = &batch->jobs[batch->num_jobs++];
+        job->source = source;
+        job->task = task;
+        job->n = n;
+        job->param = param;
+        job->k = k;
+        job->seed = (source == TRIAL_FIXED) ? 0 : trial_seed(seed_offset + (uint32_t)trial);
+        job->group = group;
+    }
+    return group;
+}
+
+// Run every queued job on trial_threads() workers and fill batch->totals.
+// Records go to the result sink under the benchmark's name; search counters
+// are summed into the totals when collect_stats is set (or records are being
+// written). Generation and task times are charged to "generate" and
+// "verify" / "search" phases nested in the innermost open one.
+bool trial_batch_run(trial_batch_t* batch, const char* benchmark, bool collect_stats) {
+    free(batch->totals);
+    batch->totals = calloc(batch->num_groups > 0 ? batch->num_groups : 1, sizeof(trial_totals_t));
+    if (batch->totals == NULL) {
+        return false;
+    }
+    for (int g = 0; g < batch->num_groups; g++) {
+        reset_trial_totals(&batch->totals[g]);
+    }
+
+    int num_threads = trial_threads();
+    if (num_threads > batch->num_jobs) {
+        num_threads = (batch->num_jobs > 0) ? batch->num_jobs : 1;
+    }
+    trial_run_t run = { batch, benchmark, collect_stats, calloc(num_threads, sizeof(trial_worker_t)) };
+    bool ok = run.workers != NULL;
+    for (int t = 0; ok && t < num_threads; t++) {
+        run.workers[t].totals = malloc((size_t)(batch->num_groups > 0 ? batch->num_groups : 1) *
+                                       sizeof(trial_totals_t));
+        ok = run.workers[t].totals != NULL;
+        for (int g = 0; ok && g < batch->num_groups; g++) {
+            reset_trial_totals(&run.workers[t].totals[g]);
+        }
+    }
+    if (ok) {
+        ok = parallel_for_chunks((uint64_t)batch->num_jobs, TRIAL_CHUNK_SIZE, num_threads,
+                                 run_trial_chunk, &run);
+    }
+
+    // Merge the per-worker totals in worker order; the time the workers
+    // measured is charged to phases nested in the caller's
+    trial_worker_t merged = { NULL, NULL, NULL, 0.0, 0.0, 0, {0.0, 0.0}, {0.0, 0.0}, {0, 0} };
+    for (int t = 0; run.workers != NULL && t < num_threads; t++) {
+        trial_worker_t* worker = &run.workers[t];
+        for (int g = 0; ok && g < batch->num_groups; g++) {
+            merge_trial_totals(&batch->totals[g], &worker->totals[g]);
+        }
+        merged.generate_wall += worker->generate_wall;
+        merged.generate_cpu += worker->generate_cpu;
+        merged.generated += worker->generated;
+        for (int task = 0; task < 2; task++) {
+            merged.task_wall[task] += worker->task_wall[task];
+            merged.task_cpu[task] += worker->task_cpu[task];
+            merged.task_calls[task] += worker->task_calls[task];
+        }
+        free(worker->totals);
+        destroy_problem_instance(worker->instance);
+        destroy_matching(worker->matching);
+    }
+    free(run.workers);
+    if (ok) {
+        if (merged.generated > 0) {
+            phase_add("generate", merged.generate_wall, merged.generate_cpu, merged.generated);
+        }
+        if (merged.task_calls[TRIAL_VERIFY] > 0) {
+            phase_add("verify", merged.task_wall[TRIAL_VERIFY], merged.task_cpu[TRIAL_VERIFY],
+                      merged.task_calls[TRIAL_VERIFY]);
+        }
+        if (merged.task_calls[TRIAL_SEARCH] > 0) {
+            phase_add("search", merged.task_wall[TRIAL_SEARCH], merged.task_cpu[TRIAL_SEARCH],
+                      merged.task_calls[TRIAL_SEARCH]);
+        }
+    }
+    return ok;
+}
+
+void trial_batch_destroy(trial_batch_t* batch) {
+    free(batch->jobs);
+    free(batch->totals);
+    batch->jobs = NULL;
+    batch->totals = NULL;
+    batch->num_jobs = 0;
+    batch->capacity = 0;
+    batch->num_groups = 0;
+}
+
+// Mean task wall time of a group (0 if none of its trials ran)
+double trial_mean_ms(const trial_totals_t* totals) {
+    return (totals->trials > 0) ? totals->wall_ms / totals->trials : 0.0;
+}
+
+// Population standard deviation of a group's task wall times
+double trial_std_dev_ms(const trial_totals_t* totals) {
+    if (totals->trials == 0) {
+        return 0.0;
+    }
+    double mean = trial_mean_ms(totals);
+    double variance = totals->wall_sq_ms / totals->trials - mean * mean;
+    return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+// Name of the algorithm k_stable_matching_exists dispatches to for k out of n
+const char* existence_algorithm_name(int n, int k) {
+    double k_ratio = (double)k / n;
+    return (k_ratio <= 0.1) ? "small-k" : (k_ratio >= 0.8) ? "large-k" : "pruning";
+}
+
+// Emit one trial to the result sink, if one is open. stats (NULL for
+// verification trials) supplies the node count when search stats are compiled in.
+void record_trial(const char* benchmark, const char* algorithm, matching_model_t model,
+                  int n, int k, uint64_t seed, long long weight, const stopwatch_t* timer,
+                  long long result, const search_stats_t* stats) {
+    if (!result_sink_active()) {
+        return;
+    }
+    long long nodes = -1;
+#ifdef MATCHING_SEARCH_STATS
+    if (stats != NULL) {
+        nodes = stats->nodes_expanded;
+    }
+#else
+    (void)stats;
+#endif
+    trial_record_t record = {
+        benchmark, algorithm, model, n, k, seed, timer->wall_ms, timer->cpu_ms, result, nodes, weight
+    };
+    result_sink_emit(&record);
+}
+
+// Run jobs [begin, end) into the worker's totals
+static void run_trial_chunk(void* context, int worker_id, uint64_t begin, uint64_t end) {
+    trial_run_t* run = context;
+    const trial_batch_t* batch = run->batch;
+    trial_worker_t* worker = &run->workers[worker_id];
+    bool want_stats = run->collect_stats || result_sink_active();
+
+    for (uint64_t index = begin; index < end; index++) {
+        const trial_job_t* job = &batch->jobs[index];
+        bool fixed = job->source == TRIAL_FIXED;
+
+        stopwatch_t generate_timer;
+        stopwatch_start(&generate_timer);
+        if (!fixed) {
+            worker->instance = generate_trial_instance(worker->instance, job->source, job->n, job->param, job->seed);
+        }
+        stopwatch_stop(&generate_timer);
+        const problem_instance_t* instance = fixed ? batch->instance : worker->instance;
+        if (instance == NULL) {
+            continue;
+        }
+        if (!fixed) {
+            worker->generate_wall += generate_timer.wall_ms;
+            worker->generate_cpu += generate_timer.cpu_ms;
+            worker->generated++;
+        }
+
+        search_stats_t stats;
+        search_stats_reset(&stats);
+        stopwatch_t timer;
+        bool positive;
+        const char* algorithm;
+        if (job->task == TRIAL_VERIFY) {
+            matching_t* matching = trial_matching(worker, instance, fixed);
+            if (matching == NULL) {
+                continue;
+            }
+            stopwatch_start(&timer);
+            positive = fixed ? is_k_stable(matching, instance, job->k) :
+                               is_k_stable_direct(matching, instance, job->k);
+            stopwatch_stop(&timer);
+            algorithm = "verify";
+        } else {
+            stopwatch_start(&timer);
+            positive = k_stable_matching_exists_with_stats(instance, job->k, want_stats ? &stats : NULL);
+            stopwatch_stop(&timer);
+            algorithm = existence_algorithm_name(job->n, job->k);
+        }
+        worker->task_wall[job->task] += timer.wall_ms;
+        worker->task_cpu[job->task] += timer.cpu_ms;
+        worker->task_calls[job->task]++;
+
+        record_trial(run->benchmark, algorithm, instance->model, job->n, job->k, job->seed, 1, &timer,
+                     positive, (job->task == TRIAL_SEARCH) ? &stats : NULL);
+        add_trial_outcome(&worker->totals[job->group], fixed ? 0.0 : generate_timer.wall_ms, &timer, positive,
+                          (job->task == TRIAL_SEARCH && want_stats) ? &stats : NULL);
+    }
+}
+
+// The worker's matching buffer, set to the matching verification trials
+// check: the empty matching on a fixed instance (feasible in every model),
+// otherwise agent i with house i, man i with woman i, or adjacent roommates
+static matching_t* trial_matching(trial_worker_t* worker, const problem_instance_t* instance, bool fixed) {
+    int n = instance->num_agents;
+    matching_t* matching = worker->matching;
+    if (matching == NULL || matching->num_agents != n || matching->model != instance->model) {
+        destroy_matching(matching);
+        matching = worker->matching = create_matching(n, instance->model);
+        if (matching == NULL) {
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        matching->pairs[i] = -1;
+    }
+    if (fixed) {
+        return matching;
+    }
+    if (instance->model == MARRIAGE) {
+        for (int i = 0; i < n / 2; i++) {
+            matching->pairs[i] = n / 2 + i;
+            matching->pairs[n / 2 + i] = i;
+        }
+    } else if (instance->model == ROOMMATES) {
+        for (int i = 0; i < n - 1; i += 2) {
+            matching->pairs[i] = i + 1;
+            matching->pairs[i + 1] = i;
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            matching->pairs[i] = i;
+        }
+    }
+    return matching;
+}
+
+static void add_trial_outcome(trial_totals_t* totals, double generate_ms, const stopwatch_t* timer,
+                              bool positive, const search_stats_t* stats) {
+    double time_ms = timer->wall_ms;
+    if (totals->trials == 0 || time_ms < totals->min_wall_ms) totals->min_wall_ms = time_ms;
+    if (totals->trials == 0 || time_ms > totals->max_wall_ms) totals->max_wall_ms = time_ms;
+    totals->trials++;
+    totals->wall_ms += time_ms;
+    totals->wall_sq_ms += time_ms * time_ms;
+    totals->generate_ms += generate_ms;
+    if (positive) totals->positive++;
+
+    if (stats != NULL) {
+        totals->stats.nodes_expanded += stats->nodes_expanded;
+        totals->stats.leaves_verified += stats->leaves_verified;
+        if (stats->max_depth > totals->stats.max_depth) totals->stats.max_depth = stats->max_depth;
+        totals->stats.prunes_promising += stats->prunes_promising;
+        totals->stats.prunes_conflict += stats->prunes_conflict;
+        totals->stats.prunes_reachable += stats->prunes_reachable;
+        totals->stats.prunes_invalid += stats->prunes_invalid;
+        totals->stats.verify_ms += stats->verify_ms;
+        totals->stats.table_hits += stats->table_hits;
+        totals->stats.table_misses += stats->table_misses;
+        totals->stats.memo_subproblems += stats->memo_subproblems;
+        totals->stats.memo_hits += stats->memo_hits;
+    }
+}
+
+static void merge_trial_totals(trial_totals_t* into, const trial_totals_t* from) {
+    if (from->trials == 0) {
+        return;
+    }
+    if (into->trials == 0 || from->min_wall_ms < into->min_wall_ms) into->min_wall_ms = from->min_wall_ms;
+    if (into->trials == 0 || from->max_wall_ms > into->max_wall_ms) into->max_wall_ms = from->max_wall_ms;
+    into->trials += from->trials;
+    into->positive += from->positive;
+    into->wall_ms += from->wall_ms;
+    into->wall_sq_ms += from->wall_sq_ms;
+    into->generate_ms += from->generate_ms;
+
+    into->stats.nodes_expanded += from->stats.nodes_expanded;
+    into->stats.leaves_verified += from->stats.leaves_verified;
+    if (from->stats.max_depth > into->stats.max_depth) into->stats.max_depth = from->stats.max_depth;
+    into->stats.prunes_promising += from->stats.prunes_promising;
+    into->stats.prunes_conflict += from->stats.prunes_conflict;
+    into->stats.prunes_reachable += from->stats.prunes_reachable;
+    into->stats.prunes_invalid += from->stats.prunes_invalid;
+    into->stats.verify_ms += from->stats.verify_ms;
+    into->stats.table_hits += from->stats.table_hits;
+    into->stats.table_misses += from->stats.table_misses;
+    into->stats.memo_subproblems += from->stats.memo_subproblems;
+    into->stats.memo_hits += from->stats.memo_hits;
+}
+
+static void reset_trial_totals(trial_totals_t* totals) {
+    memset(totals, 0, sizeof(*totals));
+    search_stats_reset(&totals->stats);
+}
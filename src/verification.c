@@ -4,25 +4,37 @@
 #include <string.h>
 #include "../include/matching.h"
 
+// Largest coalition size whose combinations are enumerated exhaustively
+#define MAX_EXHAUSTIVE_COALITION 6
+
 // Forward declarations for helper functions
-static bool has_k_blocking_coalition(const matching_t* matching, const problem_instance_t* instance, int k);
-static bool check_alternative_matching(const matching_t* current, const matching_t* alternative, 
+static bool has_k_blocking_coalition(const matching_t* matching, const problem_instance_t* instance, int k,
+                                     matching_arena_t* arena);
+static bool check_alternative_matching(const matching_overlay_t* alternative,
                                      const problem_instance_t* instance, int k);
-static matching_t* generate_alternative_matching(const matching_t* current, const problem_instance_t* instance, 
-                                               int* agents, int num_agents);
-static bool is_feasible_matching(const matching_t* matching, const problem_instance_t* instance);
+static void generate_alternative_matching(const matching_t* current, const problem_instance_t* instance, 
+                                          int* agents, int num_agents, matching_overlay_t* alternative);
+static bool is_feasible_matching(const matching_t* matching, const problem_instance_t* instance,
+                                 matching_arena_t* arena);
 // Removed unused function declaration
+static int find_improvement_candidates(const matching_t* matching, const problem_instance_t* instance,
+                                       int* candidates);
 static bool check_coalitions_of_size(const matching_t* matching, const problem_instance_t* instance, 
-                                    int coalition_size, int k);
+                                    int* candidates, int candidate_count, int coalition_size, int k,
+                                    matching_overlay_t* alternative);
 static bool check_small_coalitions(const matching_t* matching, const problem_instance_t* instance,
-                                  int* candidates, int candidate_count, int coalition_size, int k);
+                                  int* candidates, int candidate_count, int coalition_size, int k,
+                                  matching_overlay_t* alternative);
 static bool check_large_coalitions(const matching_t* matching, const problem_instance_t* instance,
-                                  int* candidates, int candidate_count, int coalition_size, int k);
+                                  int* candidates, int candidate_count, int coalition_size, int k,
+                                  matching_overlay_t* alternative);
 static bool generate_combinations(int* candidates, int candidate_count, int* coalition, int coalition_pos,
                                 int coalition_size, int start_idx, const matching_t* matching,
-                                const problem_instance_t* instance, int k);
+                                const problem_instance_t* instance, int k, matching_overlay_t* alternative);
 static bool can_coalition_block(const matching_t* matching, const problem_instance_t* instance,
-                               int* coalition, int coalition_size, int k);
+                               int* coalition, int coalition_size, int k, matching_overlay_t* alternative);
+static bool is_k_stable_by_coalitions(const matching_t* matching, const problem_instance_t* instance, int k,
+                                      matching_arena_t* arena);
 
 // Main k-stability verification function (polynomial time)
 bool is_k_stable(const matching_t* matching, const problem_instance_t* instance, int k) {
@@ -30,21 +42,134 @@ bool is_k_stable(const matching_t* matching, const problem_instance_t* instance,
         return false;
     }
     
+    // One scratch arena per call; nothing is allocated per coalition
+    matching_arena_t arena;
+    if (!matching_arena_init(&arena, k_stability_scratch_bytes(instance))) {
+        return false;
+    }
+    
+    bool stable = is_k_stable_in_arena(matching, instance, k, &arena);
+    matching_arena_destroy(&arena);
+    return stable;
+}
+
+// Scratch bytes is_k_stable_in_arena needs for an instance
+size_t k_stability_scratch_bytes(const problem_instance_t* instance) {
+    int n = instance->num_agents;
+    int num_houses = (instance->model == HOUSE_ALLOCATION_PARTIAL) ?
+                     instance->model_data.house_partial_data.num_houses : n;
+    
+    // Feasibility check house set is released before the coalition search starts
+    size_t feasibility = matching_arena_bytes(bitset_bytes(num_houses > n ? num_houses : n));
+    size_t search = matching_arena_bytes((size_t)n * sizeof(int)) +   // Unmatched agents / candidates
+                    matching_arena_bytes(bitset_bytes(n)) +           // Paired agents
+                    matching_overlay_bytes(n);                        // Alternative matching
+    size_t exact = blocking_number_scratch_bytes(instance);            // Hopcroft-Karp arrays
+    size_t largest = (feasibility > search) ? feasibility : search;
+    return (exact > largest) ? exact : largest;
+}
+
+// k-stability verification drawing all scratch memory from arena
+// (at least k_stability_scratch_bytes free); the arena is left as it was found
+bool is_k_stable_in_arena(const matching_t* matching, const problem_instance_t* instance, int k,
+                          matching_arena_t* arena) {
+    if (matching == NULL || instance == NULL || arena == NULL) {
+        return false;
+    }
+    
     if (k <= 0 || k > instance->num_agents) {
         return false;
     }
     
     // Validate that the matching is feasible for the given model
-    if (!is_feasible_matching(matching, instance)) {
+    if (!is_feasible_matching(matching, instance, arena)) {
         return false;
     }
     
-    // A matching is k-stable if there is no blocking coalition of size at least k
-    return !has_k_blocking_coalition(matching, instance, k);
+    // Exact engine: k-stable iff fewer than k agents can be made better off at
+    // once (counting stops as soon as k are found)
+    int blocking = blocking_number_in_arena(matching, instance, k, arena);
+    if (blocking >= 0) {
+        return blocking < k;
+    }
+    
+    return is_k_stable_by_coalitions(matching, instance, k, arena);
+}
+
+// Fallback if the exact engine could not run: a matching is k-stable if
+// there is no blocking coalition of size at least k
+static bool is_k_stable_by_coalitions(const matching_t* matching, const problem_instance_t* instance, int k,
+                                      matching_arena_t* arena) {
+    size_t mark = matching_arena_mark(arena);
+    bool blocked = has_k_blocking_coalition(matching, instance, k, arena);
+    matching_arena_release(arena, mark);
+    return !blocked;
+}
+
+// k-stability of a matching of the context's instance (same answer as is_k_stable)
+bool verifier_is_k_stable(verifier_context_t* context, const matching_t* matching, int k) {
+    bool stable = false;
+    return verify_batch_k_stable(context, &matching, 1, &k, 1, &stable) && stable;
+}
+
+// Blocking numbers (capped at limit) of count matchings of the context's
+// instance. Returns false if any of them could not be computed (-1).
+bool verify_batch_blocking_numbers(verifier_context_t* context, const matching_t* const* matchings,
+                                   int count, int limit, int* blocking_numbers) {
+    if (context == NULL || (count > 0 && (matchings == NULL || blocking_numbers == NULL))) {
+        return false;
+    }
+    
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        blocking_numbers[i] = verifier_blocking_number(context, matchings[i], limit);
+        ok = ok && blocking_numbers[i] >= 0;
+    }
+    return ok;
+}
+
+// k-stability of count matchings for num_k values of k: stable[i * num_k + j]
+// answers matchings[i] at k_values[j]. Each matching is checked for feasibility
+// and its blocking number computed once (capped at the largest k), which
+// answers every k.
+bool verify_batch_k_stable(verifier_context_t* context, const matching_t* const* matchings, int count,
+                           const int* k_values, int num_k, bool* stable) {
+    if (context == NULL || (count > 0 && num_k > 0 && (matchings == NULL || k_values == NULL || stable == NULL))) {
+        return false;
+    }
+    
+    const problem_instance_t* instance = context->instance;
+    int max_k = 0;
+    for (int j = 0; j < num_k; j++) {
+        if (k_values[j] > max_k && k_values[j] <= instance->num_agents) {
+            max_k = k_values[j];
+        }
+    }
+    
+    for (int i = 0; i < count; i++) {
+        const matching_t* matching = matchings[i];
+        bool feasible = max_k > 0 && matching != NULL &&
+                        is_feasible_matching(matching, instance, &context->arena);
+        int blocking = feasible ? verifier_blocking_number(context, matching, max_k) : -1;
+        
+        for (int j = 0; j < num_k; j++) {
+            int k = k_values[j];
+            bool* answer = &stable[(size_t)i * num_k + j];
+            if (!feasible || k <= 0 || k > instance->num_agents) {
+                *answer = false;
+            } else if (blocking >= 0) {
+                *answer = blocking < k;
+            } else {
+                *answer = is_k_stable_by_coalitions(matching, instance, k, &context->arena);
+            }
+        }
+    }
+    return true;
 }
 
 // Check if there exists a blocking coalition of size at least k (polynomial-time algorithm)
-static bool has_k_blocking_coalition(const matching_t* matching, const problem_instance_t* instance, int k) {
+static bool has_k_blocking_coalition(const matching_t* matching, const problem_instance_t* instance, int k,
+                                     matching_arena_t* arena) {
     // Polynomial-time algorithm: systematically check for blocking coalitions
     // Key insight: we need to find if there exists an alternative matching where
     // at least k agents are strictly better off
@@ -55,7 +180,10 @@ static bool has_k_blocking_coalition(const matching_t* matching, const problem_i
     // We use a more efficient approach than full enumeration
     
     // Strategy 1: Check obvious blocking coalitions first (unmatched agents)
-    int unmatched_agents[MAX_AGENTS];
+    int* unmatched_agents = matching_arena_alloc(arena, n * sizeof(int));
+    if (unmatched_agents == NULL) {
+        return false;
+    }
     int unmatched_count = 0;
     
     for (int i = 0; i < n; i++) {
@@ -68,37 +196,54 @@ static bool has_k_blocking_coalition(const matching_t* matching, const problem_i
     if (unmatched_count >= k) {
         // Check if these agents can form mutually beneficial matchings
         int beneficial_pairs = 0;
-        bool used[MAX_AGENTS] = {false};
+        size_t mark = matching_arena_mark(arena);
+        bitset_t used;
+        if (!bitset_init_in_arena(&used, unmatched_count, arena)) {
+            return false;
+        }
         
         for (int i = 0; i < unmatched_count && beneficial_pairs * 2 < k; i++) {
-            if (used[i]) continue;
+            if (bitset_test(&used, i)) continue;
             
             int agent1 = unmatched_agents[i];
             for (int j = i + 1; j < unmatched_count; j++) {
-                if (used[j]) continue;
+                if (bitset_test(&used, j)) continue;
                 
                 int agent2 = unmatched_agents[j];
                 
                 // Check if they mutually prefer each other over being unmatched
-                if (get_agent_rank(&instance->agents[agent1], agent2) != -1 &&
-                    get_agent_rank(&instance->agents[agent2], agent1) != -1) {
+                if (get_agent_rank(instance, agent1, agent2) != RANK_UNACCEPTABLE &&
+                    get_agent_rank(instance, agent2, agent1) != RANK_UNACCEPTABLE) {
                     beneficial_pairs++;
-                    used[i] = used[j] = true;
+                    bitset_set(&used, i);
+                    bitset_set(&used, j);
                     break;
                 }
             }
         }
         
+        matching_arena_release(arena, mark);
+        
         if (beneficial_pairs * 2 >= k) {
             return true; // Found blocking coalition of unmatched agents
         }
     }
     
     // Strategy 2: Check for blocking coalitions involving matched agents
-    // For efficiency, we focus on agents who have better alternatives available
+    // For efficiency, we focus on agents who have better alternatives available.
+    // The candidates do not depend on the coalition size, so they are found once
+    // (reusing the unmatched agents buffer).
+    int* candidates = unmatched_agents;
+    int candidate_count = find_improvement_candidates(matching, instance, candidates);
+    
+    // Every coalition's alternative matching is an overlay on the current one
+    matching_overlay_t alternative;
+    if (!matching_overlay_init(&alternative, matching, arena)) {
+        return false;
+    }
     
     for (int size = k; size <= n && size <= k + 5; size++) { // Limit search for efficiency
-        if (check_coalitions_of_size(matching, instance, size, k)) {
+        if (check_coalitions_of_size(matching, instance, candidates, candidate_count, size, k, &alternative)) {
             return true;
         }
     }
@@ -106,13 +251,10 @@ static bool has_k_blocking_coalition(const matching_t* matching, const problem_i
     return false;
 }
 
-// Check if coalitions of a specific size can form blocking coalitions
-static bool check_coalitions_of_size(const matching_t* matching, const problem_instance_t* instance, 
-                                    int coalition_size, int k) {
+// Collect the agents with improvement potential into candidates, returning their count
+static int find_improvement_candidates(const matching_t* matching, const problem_instance_t* instance,
+                                       int* candidates) {
     int n = instance->num_agents;
-    
-    // Use a more efficient approach: focus on agents with improvement potential
-    int candidates[MAX_AGENTS];
     int candidate_count = 0;
     
     // Identify agents who have potential for improvement
@@ -121,18 +263,18 @@ static bool check_coalitions_of_size(const matching_t* matching, const problem_i
         bool has_better_option = false;
         
         // Check if agent has a more preferred partner available
-        for (int j = 0; j < instance->agents[i].num_preferences; j++) {
-            int preferred = instance->agents[i].preferences[j];
-            
-            // Stop when we reach current partner (no better options after this)
-            if (preferred == current_partner) {
-                break;
-            }
+        // (only entries ranked above the current partner can be improvements)
+        const int* preferences = instance_preferences(instance, i);
+        int current_rank = get_agent_rank(instance, i, current_partner);
+        int num_better = (current_rank == RANK_UNACCEPTABLE) ?
+                         instance_num_preferences(instance, i) : current_rank;
+        for (int j = 0; j < num_better; j++) {
+            int preferred = preferences[j];
             
             // Check if this preferred partner is available or also wants to switch
             int preferred_partner = (preferred < n) ? matching->pairs[preferred] : -1;
             if (preferred_partner == -1 || 
-                (preferred_partner != -1 && agent_prefers(&instance->agents[preferred], i, preferred_partner))) {
+                (preferred_partner != -1 && agent_prefers(instance, preferred, i, preferred_partner))) {
                 has_better_option = true;
                 break;
             }
@@ -143,41 +285,45 @@ static bool check_coalitions_of_size(const matching_t* matching, const problem_i
         }
     }
     
+    return candidate_count;
+}
+
+// Check if coalitions of a specific size can form blocking coalitions
+static bool check_coalitions_of_size(const matching_t* matching, const problem_instance_t* instance, 
+                                    int* candidates, int candidate_count, int coalition_size, int k,
+                                    matching_overlay_t* alternative) {
     // If we don't have enough candidates, no blocking coalition possible
     if (candidate_count < coalition_size) {
         return false;
     }
     
     // For small coalition sizes, check all combinations
-    if (coalition_size <= 6) {
-        return check_small_coalitions(matching, instance, candidates, candidate_count, coalition_size, k);
+    if (coalition_size <= MAX_EXHAUSTIVE_COALITION) {
+        return check_small_coalitions(matching, instance, candidates, candidate_count, coalition_size, k, alternative);
     }
     
     // For larger coalitions, use heuristic approach
-    return check_large_coalitions(matching, instance, candidates, candidate_count, coalition_size, k);
+    return check_large_coalitions(matching, instance, candidates, candidate_count, coalition_size, k, alternative);
 }
 
 // Helper function to check small coalitions exhaustively
 static bool check_small_coalitions(const matching_t* matching, const problem_instance_t* instance,
-                                  int* candidates, int candidate_count, int coalition_size, int k) {
+                                  int* candidates, int candidate_count, int coalition_size, int k,
+                                  matching_overlay_t* alternative) {
     // Generate all combinations of coalition_size from candidates
-    int coalition[MAX_AGENTS];
+    int coalition[MAX_EXHAUSTIVE_COALITION];
     return generate_combinations(candidates, candidate_count, coalition, 0, coalition_size, 0,
-                               matching, instance, k);
+                               matching, instance, k, alternative);
 }
 
 // Helper function to check large coalitions using heuristics
 static bool check_large_coalitions(const matching_t* matching, const problem_instance_t* instance,
-                                  int* candidates, int candidate_count, int coalition_size, int k) {
+                                  int* candidates, int candidate_count, int coalition_size, int k,
+                                  matching_overlay_t* alternative) {
     // Use greedy approach: select agents with highest improvement potential
-    int coalition[MAX_AGENTS];
-    
-    // Sort candidates by improvement potential (simplified heuristic)
-    for (int i = 0; i < coalition_size && i < candidate_count; i++) {
-        coalition[i] = candidates[i];
-    }
-    
-    return can_coalition_block(matching, instance, coalition, coalition_size, k);
+    // (simplified heuristic: the first coalition_size candidates, used in place)
+    (void)candidate_count;
+    return can_coalition_block(matching, instance, candidates, coalition_size, k, alternative);
 }
 
 // Implement the missing helper functions
@@ -185,15 +331,15 @@ static bool check_large_coalitions(const matching_t* matching, const problem_ins
 // Generate combinations recursively
 static bool generate_combinations(int* candidates, int candidate_count, int* coalition, int coalition_pos,
                                 int coalition_size, int start_idx, const matching_t* matching,
-                                const problem_instance_t* instance, int k) {
+                                const problem_instance_t* instance, int k, matching_overlay_t* alternative) {
     if (coalition_pos == coalition_size) {
-        return can_coalition_block(matching, instance, coalition, coalition_size, k);
+        return can_coalition_block(matching, instance, coalition, coalition_size, k, alternative);
     }
     
     for (int i = start_idx; i <= candidate_count - (coalition_size - coalition_pos); i++) {
         coalition[coalition_pos] = candidates[i];
         if (generate_combinations(candidates, candidate_count, coalition, coalition_pos + 1,
-                                coalition_size, i + 1, matching, instance, k)) {
+                                coalition_size, i + 1, matching, instance, k, alternative)) {
             return true;
         }
     }
@@ -202,16 +348,13 @@ static bool generate_combinations(int* candidates, int candidate_count, int* coa
 
 // Check if a specific coalition can block the current matching
 static bool can_coalition_block(const matching_t* matching, const problem_instance_t* instance,
-                               int* coalition, int coalition_size, int k) {
+                               int* coalition, int coalition_size, int k, matching_overlay_t* alternative) {
     // Try to construct an alternative matching where coalition members are better off
-    matching_t* alternative = generate_alternative_matching(matching, instance, coalition, coalition_size);
-    if (alternative == NULL) {
-        return false;
-    }
+    // (recorded as overrides on the current matching, discarded in O(1) for the next coalition)
+    matching_overlay_clear(alternative);
+    generate_alternative_matching(matching, instance, coalition, coalition_size, alternative);
     
-    bool blocks = check_alternative_matching(matching, alternative, instance, k);
-    destroy_matching(alternative);
-    return blocks;
+    return check_alternative_matching(alternative, instance, k);
 }
 
 // Full polynomial-time k-stability verification algorithm  
@@ -221,13 +364,8 @@ bool is_k_stable_direct(const matching_t* matching, const problem_instance_t* in
 }
 
 // Generate an alternative matching for a given coalition
-static matching_t* generate_alternative_matching(const matching_t* current, const problem_instance_t* instance, 
-                                               int* agents, int num_agents) {
-    matching_t* alternative = copy_matching(current);
-    if (alternative == NULL) {
-        return NULL;
-    }
-    
+static void generate_alternative_matching(const matching_t* current, const problem_instance_t* instance, 
+                                          int* agents, int num_agents, matching_overlay_t* alternative) {
     // Try to improve the matching for the given agents
     // This is a simplified approach - in practice, you'd use more sophisticated algorithms
     
@@ -235,51 +373,49 @@ static matching_t* generate_alternative_matching(const matching_t* current, cons
         int agent = agents[i];
         int current_partner = current->pairs[agent];
         
-        // Try to find a better partner
-        for (int j = 0; j < instance->agents[agent].num_preferences; j++) {
-            int preferred = instance->agents[agent].preferences[j];
-            
-            // Stop when we reach current partner
-            if (preferred == current_partner) {
-                break;
-            }
+        // Try to find a better partner among entries ranked above the current one
+        const int* preferences = instance_preferences(instance, agent);
+        int current_rank = get_agent_rank(instance, agent, current_partner);
+        int num_better = (current_rank == RANK_UNACCEPTABLE) ?
+                         instance_num_preferences(instance, agent) : current_rank;
+        for (int j = 0; j < num_better; j++) {
+            int preferred = preferences[j];
             
             // Check if this preferred partner is available or willing to switch
             if (preferred < instance->num_agents) {
-                int preferred_current = alternative->pairs[preferred];
+                int preferred_current = matching_overlay_partner(alternative, preferred);
                 
                 if (preferred_current == -1 || 
-                    agent_prefers(&instance->agents[preferred], agent, preferred_current)) {
+                    agent_prefers(instance, preferred, agent, preferred_current)) {
                     
                     // Make the switch
                     if (current_partner != -1) {
-                        alternative->pairs[current_partner] = -1;
+                        matching_overlay_set(alternative, current_partner, -1);
                     }
                     if (preferred_current != -1) {
-                        alternative->pairs[preferred_current] = -1;
+                        matching_overlay_set(alternative, preferred_current, -1);
                     }
                     
-                    alternative->pairs[agent] = preferred;
-                    alternative->pairs[preferred] = agent;
+                    matching_overlay_set(alternative, agent, preferred);
+                    matching_overlay_set(alternative, preferred, agent);
                     break;
                 }
             }
         }
     }
-    
-    return alternative;
 }
 
 // Check if an alternative matching provides k or more improvements
-static bool check_alternative_matching(const matching_t* current, const matching_t* alternative, 
+static bool check_alternative_matching(const matching_overlay_t* alternative,
                                      const problem_instance_t* instance, int k) {
-    int improved_count = count_improved_agents(current, alternative, instance);
+    int improved_count = count_improved_agents_overlay(alternative, instance);
     return improved_count >= k;
 }
 
 // Check if a matching is feasible for the given model
-static bool is_feasible_matching(const matching_t* matching, const problem_instance_t* instance) {
-    return is_valid_matching(matching, instance);
+static bool is_feasible_matching(const matching_t* matching, const problem_instance_t* instance,
+                                 matching_arena_t* arena) {
+    return is_valid_matching_in_arena(matching, instance, arena);
 }
 
 // Note: enumerate_agent_subsets function removed as it was unused
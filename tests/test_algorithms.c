@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
+#include <limits.h>
 #include "../include/matching.h"
 
 // Test helper functions
@@ -30,7 +32,7 @@ void test_k_stability_verification() {
     printf("  k=3 stable: %s\n", result_k3 ? "YES" : "NO");
     
     destroy_matching(matching);
-    free(instance);
+    destroy_problem_instance(instance);
     
     printf("  ✓ k-stability verification tests passed\n");
 }
@@ -52,7 +54,7 @@ void test_existence_algorithms() {
     bool exists_large = k_stable_matching_exists_large_k(small_instance, 5);
     printf("  Large k=5 exists: %s\n", exists_large ? "YES" : "NO");
     
-    free(small_instance);
+    destroy_problem_instance(small_instance);
     
     printf("  ✓ Existence algorithm tests passed\n");
 }
@@ -79,7 +81,7 @@ void test_model_specific_logic() {
     printf("  Invalid house allocation detected: %s\n", !invalid_house ? "YES" : "NO");
     
     destroy_matching(house_matching);
-    free(house_instance);
+    destroy_problem_instance(house_instance);
     
     // Test marriage model
     problem_instance_t* marriage_instance = generate_random_marriage(2, 2, 98765);
@@ -101,7 +103,7 @@ void test_model_specific_logic() {
     printf("  Invalid marriage detected: %s\n", !invalid_marriage ? "YES" : "NO");
     
     destroy_matching(marriage_matching);
-    free(marriage_instance);
+    destroy_problem_instance(marriage_instance);
     
     printf("  ✓ Model-specific logic tests passed\n");
 }
@@ -123,8 +125,8 @@ void test_random_number_quality() {
         bool different = false;
         for (int agent = 0; agent < 5 && !different; agent++) {
             for (int pref = 0; pref < 5 && !different; pref++) {
-                if (instances[i]->agents[agent].preferences[pref] != 
-                    instances[i+1]->agents[agent].preferences[pref]) {
+                if (instance_preferences(instances[i], agent)[pref] != 
+                    instance_preferences(instances[i+1], agent)[pref]) {
                     different = true;
                     diversity_count++;
                 }
@@ -136,7 +138,7 @@ void test_random_number_quality() {
            (diversity_count >= 3) ? "GOOD" : "POOR");
     
     for (int i = 0; i < 5; i++) {
-        free(instances[i]);
+        destroy_problem_instance(instances[i]);
     }
     
     printf("  ✓ Random number generator tests passed\n");
@@ -163,11 +165,1493 @@ void test_performance_improvements() {
     printf("  Result: %s\n", large_stable ? "k-stable" : "not k-stable");
     
     destroy_matching(large_matching);
-    free(large_instance);
+    destroy_problem_instance(large_instance);
     
     printf("  ✓ Performance improvement tests passed\n");
 }
 
+void test_arena_verification() {
+    printf("Testing arena-backed verification...\n");
+    
+    problem_instance_t* instance = generate_random_house_allocation(8, 24680);
+    assert(instance != NULL);
+    
+    matching_arena_t arena;
+    bool arena_ready = matching_arena_init(&arena, matching_arena_matching_bytes(8) +
+                                                   k_stability_scratch_bytes(instance));
+    assert(arena_ready);
+    
+    matching_t* matching = matching_arena_create_matching(&arena, 8, HOUSE_ALLOCATION);
+    assert(matching != NULL);
+    for (int i = 0; i < 8; i++) {
+        matching->pairs[i] = i;
+    }
+    size_t mark = matching_arena_mark(&arena);
+    
+    // Same answers as the heap-backed verifier, and the arena is left as it was found
+    for (int k = 1; k <= 8; k++) {
+        bool in_arena = is_k_stable_in_arena(matching, instance, k, &arena);
+        bool on_heap = is_k_stable(matching, instance, k);
+        assert(in_arena == on_heap);
+        assert(matching_arena_mark(&arena) == mark);
+    }
+    printf("  Arena and heap verification agree for k=1..8\n");
+    
+    matching_arena_destroy(&arena);
+    destroy_problem_instance(instance);
+    
+    printf("  ✓ Arena verification tests passed\n");
+}
+
+void test_overlay_and_trail() {
+    printf("Testing matching overlays and undo trails...\n");
+    
+    problem_instance_t* instance = generate_random_roommates(6, 13579);
+    assert(instance != NULL);
+    
+    matching_t* matching = create_matching(6, ROOMMATES);
+    assert(matching != NULL);
+    for (int i = 0; i < 6; i += 2) {
+        matching->pairs[i] = i + 1;
+        matching->pairs[i + 1] = i;
+    }
+    
+    matching_arena_t arena;
+    bool arena_ready = matching_arena_init(&arena, matching_overlay_bytes(6) + matching_trail_bytes(6));
+    assert(arena_ready);
+    
+    // An overlay swapping partners counts improvements like a full copy does
+    matching_overlay_t overlay;
+    bool overlay_ready = matching_overlay_init(&overlay, matching, &arena);
+    assert(overlay_ready);
+    matching_overlay_set(&overlay, 0, 2);
+    matching_overlay_set(&overlay, 2, 0);
+    matching_overlay_set(&overlay, 1, 3);
+    matching_overlay_set(&overlay, 3, 1);
+    
+    matching_t* alternative = copy_matching(matching);
+    for (int i = 0; i < 6; i++) {
+        alternative->pairs[i] = matching_overlay_partner(&overlay, i);
+    }
+    assert(count_improved_agents_overlay(&overlay, instance) ==
+           count_improved_agents(matching, alternative, instance));
+    
+    matching_overlay_clear(&overlay);
+    assert(overlay.num_changed == 0 && matching_overlay_partner(&overlay, 0) == 1);
+    printf("  Overlay improvement count matches the copied matching\n");
+    
+    // Undoing a trail restores the matching exactly
+    matching_trail_t trail;
+    bool trail_ready = matching_trail_init(&trail, 6, &arena);
+    assert(trail_ready);
+    int mark = matching_trail_mark(&trail);
+    matching_trail_set(matching, &trail, 4, -1);
+    matching_trail_set(matching, &trail, 5, -1);
+    matching_trail_undo(matching, &trail, mark);
+    assert(matching->pairs[4] == 5 && matching->pairs[5] == 4);
+    printf("  Trail undo restores the matching\n");
+    
+    destroy_matching(alternative);
+    destroy_matching(matching);
+    matching_arena_destroy(&arena);
+    destroy_problem_instance(instance);
+    
+    printf("  ✓ Overlay and trail tests passed\n");
+}
+
+void test_exact_blocking_number() {
+    printf("Testing exact blocking numbers...\n");
+    
+    // Three agents with identical lists 0 > 1 > 2
+    problem_instance_t* instance = create_problem_instance(3, HOUSE_ALLOCATION, 9, false);
+    assert(instance != NULL);
+    instance->model_data.house_data.num_houses = 3;
+    for (int i = 0; i < 3; i++) {
+        int* preferences = instance_add_agent(instance, 3);
+        for (int j = 0; j < 3; j++) {
+            preferences[j] = j;
+        }
+    }
+    bool finalized = instance_finalize(instance);
+    assert(finalized);
+    
+    // 0 -> 2, 1 -> 1, 2 -> 0: agents 0 and 1 can both improve by swapping in houses 1 and 0
+    matching_t* matching = create_matching(3, HOUSE_ALLOCATION);
+    assert(matching != NULL);
+    matching->pairs[0] = 2;
+    matching->pairs[1] = 1;
+    matching->pairs[2] = 0;
+    
+    assert(blocking_number(matching, instance) == 2);
+    assert(!is_k_stable(matching, instance, 2));
+    assert(is_k_stable(matching, instance, 3));
+    printf("  Blocking number 2: not 2-stable, 3-stable\n");
+    
+    // Roommates cycle 0: 1 > 2, 1: 2 > 0, 2: 0 > 1 with 0-1 matched and 2 alone:
+    // only the pair 1-2 improves both partners
+    static const int cycle[3][2] = { {1, 2}, {2, 0}, {0, 1} };
+    problem_instance_t* roommates = create_problem_instance(3, ROOMMATES, 6, false);
+    assert(roommates != NULL);
+    for (int i = 0; i < 3; i++) {
+        int* preferences = instance_add_agent(roommates, 2);
+        preferences[0] = cycle[i][0];
+        preferences[1] = cycle[i][1];
+    }
+    finalized = instance_finalize(roommates);
+    assert(finalized);
+    
+    matching_t* pair = create_matching(3, ROOMMATES);
+    assert(pair != NULL);
+    pair->pairs[0] = 1;
+    pair->pairs[1] = 0;
+    
+    assert(blocking_number(pair, roommates) == 2);
+    assert(!is_k_stable(pair, roommates, 2));
+    assert(is_k_stable(pair, roommates, 3));
+    printf("  Roommates blocking number 2 via the weighted matching engine\n");
+    
+    destroy_matching(pair);
+    destroy_problem_instance(roommates);
+    destroy_matching(matching);
+    destroy_problem_instance(instance);
+    printf("  ✓ Exact blocking number tests passed\n");
+}
+
+// Whether any matching (each agent unmatched or paired with another) passes
+// is_k_stable, by enumerating them all
+static bool any_k_stable_matching(matching_t* matching, const problem_instance_t* instance, int k, int agent) {
+    int n = instance->num_agents;
+    while (agent < n && matching->pairs[agent] != -1) {
+        agent++;
+    }
+    if (agent == n) {
+        return is_k_stable(matching, instance, k);
+    }
+    
+    if (any_k_stable_matching(matching, instance, k, agent + 1)) {
+        return true;
+    }
+    for (int partner = agent + 1; partner < n; partner++) {
+        if (matching->pairs[partner] != -1) continue;
+        matching->pairs[agent] = partner;
+        matching->pairs[partner] = agent;
+        bool found = any_k_stable_matching(matching, instance, k, agent + 1);
+        matching->pairs[agent] = -1;
+        matching->pairs[partner] = -1;
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void test_parallel_existence() {
+    printf("Testing parallel existence search...\n");
+    
+    problem_instance_t* instances[3] = {
+        generate_random_house_allocation(6, 97531),
+        generate_random_marriage(3, 3, 97531),
+        generate_random_roommates(7, 97531)
+    };
+    
+    for (int m = 0; m < 3; m++) {
+        problem_instance_t* instance = instances[m];
+        assert(instance != NULL);
+        int n = instance->num_agents;
+        
+        for (int k = 1; k <= n; k++) {
+            // Same answer as exhaustive counting, same witness for any thread count
+            bool complete[3] = {false, false, false};
+            matching_t* serial = find_k_stable_matching_parallel(instance, k, 1, &complete[0]);
+            matching_t* parallel = find_k_stable_matching_parallel(instance, k, 3, &complete[1]);
+            assert(complete[0] && complete[1]);
+            assert((serial != NULL) == (count_k_stable_matchings(instance, k) > 0));
+            assert((serial != NULL) == (parallel != NULL));
+            assert(k_stable_matching_exists_parallel(instance, k, 2, &complete[2]) == (serial != NULL));
+            assert(complete[2]);
+            
+            if (serial != NULL) {
+                assert(is_k_stable(serial, instance, k));
+                assert(memcmp(serial->pairs, parallel->pairs, n * sizeof(int)) == 0);
+                destroy_matching(serial);
+                destroy_matching(parallel);
+            }
+        }
+        
+        // A search that cannot run is reported as incomplete, not as "none"
+        bool complete = true;
+        assert(find_k_stable_matching_parallel(instance, n + 1, 2, &complete) == NULL && !complete);
+        destroy_problem_instance(instance);
+    }
+    
+    // Marriage sides of different sizes leave agents unmatched; the searches
+    // and the count must still find every k-stable matching
+    for (int seed = 0; seed < 8; seed++) {
+        problem_instance_t* unequal = generate_random_marriage(3, 4, 24680 + seed);
+        assert(unequal != NULL && unequal->num_agents == 7);
+        for (int k = 1; k <= 7; k++) {
+            matching_t* matching = create_matching(7, MARRIAGE);
+            bool expected = any_k_stable_matching(matching, unequal, k, 0);
+            destroy_matching(matching);
+            
+            bool complete = false;
+            matching_t* witness = find_k_stable_matching_parallel(unequal, k, 2, &complete);
+            assert(complete && (witness != NULL) == expected);
+            if (witness != NULL) {
+                assert(is_k_stable(witness, unequal, k));
+                destroy_matching(witness);
+            }
+            assert((count_k_stable_matchings(unequal, k) > 0) == expected);
+        }
+        destroy_problem_instance(unequal);
+    }
+    
+    // House allocation subtrees are cut by the improving-set bound; the answers
+    // still match exact counting at sizes exhaustive enumeration cannot reach
+    problem_instance_t* house = generate_random_house_allocation(14, 97531);
+    for (int k = 1; k <= 14; k++) {
+        matching_count_t counted;
+        assert(count_k_stable_matchings_dp(house, k, &counted));
+        bool complete = false;
+        assert(k_stable_matching_exists_parallel(house, k, 2, &complete) == (counted.k_stable > 0));
+        assert(complete);
+    }
+    destroy_problem_instance(house);
+    
+    printf("  Parallel search agrees with exhaustive counting; witnesses are deterministic\n");
+    printf("  ✓ Parallel existence tests passed\n");
+}
+
+// Sum of the chunk bounds seen by each worker, to check the loop covers every index once
+static void sum_chunk(void* context, int worker, uint64_t begin, uint64_t end) {
+    uint64_t* sums = context;
+    for (uint64_t i = begin; i < end; i++) {
+        sums[worker] += i + 1;
+    }
+}
+
+void test_profile_enumeration() {
+    printf("Testing ranked profile enumeration...\n");
+    
+    assert(permutation_count(4) == 24);
+    assert(preference_profile_count(3) == 216);
+    assert(preference_profile_count(7) == 0);
+    
+    // Ranks follow lexicographic order, so consecutive permutations strictly increase
+    int previous[5], perm[5];
+    for (uint64_t rank = 0; rank < permutation_count(5); rank++) {
+        unrank_permutation(rank, 5, perm);
+        int seen = 0;
+        for (int i = 0; i < 5; i++) {
+            seen |= 1 << perm[i];
+        }
+        assert(seen == 0x1f);
+        if (rank > 0) {
+            int i = 0;
+            while (perm[i] == previous[i]) i++;
+            assert(previous[i] < perm[i]);
+        }
+        memcpy(previous, perm, sizeof(perm));
+    }
+    
+    // Agent 0 is the most significant digit of a profile rank
+    int profile[9];
+    unrank_preference_profile(6 * 6 * 5 + 1, 3, profile);
+    int expected[9] = {2, 1, 0, 0, 1, 2, 0, 2, 1};
+    assert(memcmp(profile, expected, sizeof(expected)) == 0);
+    
+    // Ranking inverts unranking, and the iterator steps through the same
+    // profiles without unranking (the range crosses carries into agent 0)
+    profile_iterator_t iterator;
+    uint64_t rank = 100;
+    assert(profile_iterator_init(&iterator, 3, rank, 216));
+    do {
+        unrank_preference_profile(rank, 3, profile);
+        assert(memcmp(iterator.profile, profile, sizeof(profile)) == 0);
+        assert(rank_preference_profile(profile, 3) == rank);
+        assert(iterator.rank == rank++);
+    } while (profile_iterator_next(&iterator));
+    assert(rank == 216);
+    assert(rank_permutation(perm, 5) == permutation_count(5) - 1);
+    assert(!profile_iterator_init(&iterator, 3, 216, 216));
+    
+    // Shards tile the rank range in order
+    uint64_t shard_end = 0;
+    for (int shard = 0; shard < 7; shard++) {
+        uint64_t begin, end;
+        shard_range(1000, shard, 7, &begin, &end);
+        assert(begin == shard_end && end - begin >= 142 && end - begin <= 143);
+        shard_end = end;
+    }
+    assert(shard_end == 1000);
+    
+    // One representative per orbit of relabelings; the orbit sizes add up to
+    // every profile (38 orbits for n = 3, by Burnside's lemma)
+    uint64_t representatives = 0;
+    uint64_t covered = 0;
+    for (uint64_t rank = 0; rank < preference_profile_count(3); rank++) {
+        unrank_preference_profile(rank, 3, profile);
+        uint64_t orbit_size = canonical_profile_orbit_size(profile, 3);
+        representatives += orbit_size > 0;
+        covered += orbit_size;
+    }
+    assert(representatives == 38);
+    assert(covered == 216);
+    
+    // The canonical iterator generates the same representatives in rank
+    // order, also when the range is split (13,902 orbits for n = 4)
+    assert(canonical_profile_iterator_init(&iterator, 3, 0, 216));
+    rank = 0;
+    do {
+        while (rank < iterator.rank) {
+            unrank_preference_profile(rank++, 3, profile);
+            assert(canonical_profile_orbit_size(profile, 3) == 0);
+        }
+        assert(canonical_profile_orbit_size(iterator.profile, 3) == iterator.orbit_size);
+        assert(iterator.orbit_size > 0);
+        rank++;
+    } while (canonical_profile_iterator_next(&iterator));
+    representatives = 0;
+    covered = 0;
+    for (uint64_t prefix = 0; prefix < 24 * 24; prefix++) {
+        if (!canonical_profile_iterator_init(&iterator, 4, prefix * 576, (prefix + 1) * 576)) {
+            continue;
+        }
+        do {
+            assert(iterator.rank >= prefix * 576 && iterator.rank < (prefix + 1) * 576);
+            representatives++;
+            covered += iterator.orbit_size;
+        } while (canonical_profile_iterator_next(&iterator));
+    }
+    assert(representatives == 13902);
+    assert(covered == 331776);
+    
+    // Swapping the labels of agents/houses 0 and 1 maps the all-identity
+    // profile to a larger one in the same orbit, which is not canonical
+    int identity[9] = {0, 1, 2, 0, 1, 2, 0, 1, 2};
+    int relabeled[9] = {1, 0, 2, 1, 0, 2, 1, 0, 2};
+    assert(canonical_profile_orbit_size(identity, 3) == 6);
+    assert(canonical_profile_orbit_size(relabeled, 3) == 0);
+    
+    uint64_t sums[4] = {0, 0, 0, 0};
+    assert(parallel_for_chunks(1000, 7, 4, sum_chunk, sums));
+    assert(sums[0] + sums[1] + sums[2] + sums[3] == 1000 * 1001 / 2);
+    
+    printf("  Unranking is lexicographic and inverted by ranking; the iterator and\n");
+    printf("  shards cover every profile; 38 orbits cover the 216 profiles for n = 3;\n");
+    printf("  the canonical iterator generates exactly the orbit representatives;\n");
+    printf("  chunked loop visits every index once\n");
+    printf("  ✓ Profile enumeration tests passed\n");
+}
+
+void test_bitset_operations() {
+    printf("Testing bitset kernels...\n");
+    
+    // Dynamic set spanning several words, including a partial last word
+    uint64_t words[3];
+    bitset_t set;
+    bitset_attach(&set, words, 150);
+    assert(bitset_count(&set) == 0);
+    assert(bitset_next(&set, 0) == -1);
+    
+    int ids[] = {0, 5, 63, 64, 100, 149};
+    for (int i = 0; i < 6; i++) {
+        bitset_set(&set, ids[i]);
+    }
+    assert(bitset_count(&set) == 6);
+    assert(bitset_count_prefix(&set, 64) == 3);
+    assert(bitset_count_prefix(&set, 65) == 4);
+    assert(bitset_count_prefix(&set, 150) == 6);
+    assert(bitset_test(&set, 63) && !bitset_test(&set, 62));
+    
+    int visited = 0;
+    for (int id = bitset_next(&set, 0); id != -1; id = bitset_next(&set, id + 1)) {
+        assert(id == ids[visited]);
+        visited++;
+    }
+    assert(visited == 6);
+    
+    bitset_clear(&set, 64);
+    assert(bitset_next(&set, 64) == 100);
+    
+    // Fixed-width storage behind the same kernels
+    bitset256_t small = {{0, 0, 0, 0}};
+    bitset_t other;
+    bitset_attach(&other, small.words, 150);
+    bitset_set(&other, 5);
+    bitset_set(&other, 149);
+    bitset_set(&other, 64);
+    assert(bitset_count_and(&set, &other) == 2);
+    assert(bitset256_count(&small) == 3 && bitset256_test(&small, 149));
+    
+    // The fixed-width ops write the same words as the view
+    bitset256_clear(&small, 149);
+    bitset256_set(&small, 120);
+    assert(bitset_test(&other, 120) && !bitset_test(&other, 149));
+    assert(bitset256_count(&small) == 3 && bitset_count(&other) == 3);
+    
+    bitset64_t word = 0;
+    bitset64_set(&word, 3);
+    bitset64_set(&word, 40);
+    bitset64_set(&word, 63);
+    bitset64_clear(&word, 3);
+    assert(bitset64_count(word) == 2 && bitset64_test(word, 40) && bitset64_test(word, 63) &&
+           !bitset64_test(word, 3) && !bitset64_test(word, 41));
+    
+    printf("  Membership, counts, prefix counts and iteration agree\n");
+    printf("  ✓ Bitset tests passed\n");
+}
+
+// Overwrite the int at byte offset of an instance file (of its payload if
+// in_payload), then recompute the payload checksum so only the content checks
+// can reject it. The header (layout in generators.c) ends with payload_bytes
+// and checksum, and its size is stored at byte 16.
+static void patch_instance_file(const char* path, bool in_payload, long offset, int32_t value) {
+    FILE* file = fopen(path, "r+b");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long bytes = ftell(file);
+    unsigned char* contents = malloc(bytes);
+    assert(contents != NULL);
+    fseek(file, 0, SEEK_SET);
+    assert(fread(contents, 1, bytes, file) == (size_t)bytes);
+    uint32_t header_bytes;
+    memcpy(&header_bytes, contents + 16, sizeof(header_bytes));
+    memcpy(contents + (in_payload ? header_bytes : 0) + offset, &value, sizeof(value));
+    uint64_t checksum = 14695981039346656037ull;
+    for (long at = header_bytes; at < bytes; at += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, contents + at, sizeof(word));
+        checksum = (checksum ^ word) * 1099511628211ull;
+    }
+    memcpy(contents + header_bytes - sizeof(checksum), &checksum, sizeof(checksum));
+    fseek(file, 0, SEEK_SET);
+    assert(fwrite(contents, 1, bytes, file) == (size_t)bytes);
+    fclose(file);
+    free(contents);
+}
+
+void test_instance_files() {
+    printf("Testing binary instance files...\n");
+    
+    const char* path = "test_instance.bin";
+    problem_instance_t* instances[3] = {
+        generate_random_marriage(4, 5, 2468),                 // Dense rank table
+        generate_truncated_house_allocation(5000, 3, 2468),   // Hashed rank index
+        generate_k_hai_with_indifferences(6, 4, 2468)         // Indifference groups
+    };
+    
+    for (int m = 0; m < 3; m++) {
+        problem_instance_t* original = instances[m];
+        assert(original != NULL);
+        assert(save_problem_instance(original, path));
+        
+        problem_instance_t* loaded = load_problem_instance(path);
+        assert(loaded != NULL && loaded->mapping != NULL);
+        int n = original->num_agents;
+        assert(loaded->num_agents == n && loaded->model == original->model);
+        assert(loaded->num_targets == original->num_targets);
+        assert(memcmp(loaded->pref_offsets, original->pref_offsets, (n + 1) * sizeof(int)) == 0);
+        assert(memcmp(loaded->preferences, original->preferences,
+                      original->pref_offsets[n] * sizeof(int)) == 0);
+        assert((loaded->tie_groups == NULL) == (original->tie_groups == NULL));
+        assert((loaded->rank_table == NULL) == (original->rank_table == NULL));
+        for (int agent = 0; agent < n && agent < 50; agent++) {
+            for (int target = -1; target <= original->num_targets; target++) {
+                assert(get_agent_rank(loaded, agent, target) == get_agent_rank(original, agent, target));
+            }
+        }
+        
+        // A loaded instance behaves like the original
+        matching_t* empty = create_matching(n, original->model);
+        assert(blocking_number(empty, loaded) == blocking_number(empty, original));
+        destroy_matching(empty);
+        destroy_problem_instance(loaded);
+    }
+    
+    // Any flipped payload byte fails the checksum
+    FILE* file = fopen(path, "r+b");
+    assert(file != NULL);
+    fseek(file, -5, SEEK_END);
+    int byte = fgetc(file);
+    fseek(file, -5, SEEK_END);
+    fputc(byte ^ 0x40, file);
+    fclose(file);
+    assert(load_problem_instance(path) == NULL);
+    assert(load_problem_instance("no_such_instance.bin") == NULL);
+    
+    // Checksum-valid files with entries or metadata out of range are rejected:
+    // a negative preference (the payload starts with the 6 offsets of a
+    // 5-agent instance), and marriage sides that do not add up to the agents
+    // (num_men is header byte 32)
+    problem_instance_t* house = generate_random_house_allocation(5, 2468);
+    assert(save_problem_instance(house, path));
+    patch_instance_file(path, true, 6 * sizeof(int), house->preferences[0]);
+    problem_instance_t* reloaded = load_problem_instance(path);
+    assert(reloaded != NULL);
+    destroy_problem_instance(reloaded);
+    patch_instance_file(path, true, 6 * sizeof(int), -100000);
+    assert(load_problem_instance(path) == NULL);
+    destroy_problem_instance(house);
+    assert(save_problem_instance(instances[0], path));
+    patch_instance_file(path, false, 32, 6);
+    assert(load_problem_instance(path) == NULL);
+    
+    // Rank indexes must agree with the lists: a dense cell naming another
+    // entry, and a hash table with no empty slot (a probe for an unlisted
+    // target would never end). Payload sections are padded to 8 bytes: the
+    // offsets, the preferences, then the rank table or the hash offsets and slots.
+    problem_instance_t* marriage = instances[0];
+    long dense_table = ((marriage->num_agents + 1) * sizeof(int) + 7) / 8 * 8 +
+                       (marriage->pref_offsets[marriage->num_agents] * sizeof(int) + 7) / 8 * 8;
+    assert(save_problem_instance(marriage, path));
+    patch_instance_file(path, true, dense_table + marriage->preferences[0] * sizeof(int), 1);
+    assert(load_problem_instance(path) == NULL);
+    
+    problem_instance_t* truncated = generate_truncated_house_allocation(8000, 3, 7);
+    assert(truncated != NULL && truncated->rank_table == NULL);
+    long hash_slots = 2 * (((truncated->num_agents + 1) * sizeof(int) + 7) / 8 * 8) +
+                      (truncated->pref_offsets[truncated->num_agents] * sizeof(int) + 7) / 8 * 8;
+    assert(save_problem_instance(truncated, path));
+    for (int slot = 0; slot < truncated->rank_hash_offsets[1]; slot++) {
+        patch_instance_file(path, true, hash_slots + slot * sizeof(int), 0);
+    }
+    assert(load_problem_instance(path) == NULL);
+    destroy_problem_instance(truncated);
+    remove(path);
+    
+    for (int m = 0; m < 3; m++) {
+        destroy_problem_instance(instances[m]);
+    }
+    
+    printf("  Saved instances load back identically; corrupted files are rejected\n");
+    printf("  ✓ Instance file tests passed\n");
+}
+
+void test_result_sink() {
+    printf("Testing result sink...\n");
+    
+    const char* path = "test_results.out";
+    result_format_t format;
+    assert(parse_result_format("jsonl", &format) && format == RESULT_FORMAT_JSONL);
+    assert(parse_result_format("csv", &format) && format == RESULT_FORMAT_CSV);
+    assert(!parse_result_format("xml", &format));
+    
+    // Enough records to overflow the write buffer several times
+    int num_records = 5000;
+    trial_record_t record = { "unit_test", "pruning", MARRIAGE, 8, 3, 42, 1.5, 1.25, 1, -1, 1 };
+    char line[512];
+    for (int f = 0; f < 2; f++) {
+        assert(!result_sink_active());
+        assert(result_sink_open(path, f == 0 ? RESULT_FORMAT_JSONL : RESULT_FORMAT_CSV));
+        assert(result_sink_active());
+        assert(!result_sink_open(path, RESULT_FORMAT_JSONL));   // one sink at a time
+        for (int i = 0; i < num_records; i++) {
+            record.seed = i;
+            record.result = (i == 0) ? -1 : 1;
+            record.nodes = (i == 0) ? -1 : i;
+            result_sink_emit(&record);
+        }
+        assert(result_sink_close());
+        
+        FILE* file = fopen(path, "r");
+        assert(file != NULL);
+        int lines = 0;
+        while (fgets(line, sizeof(line), file) != NULL) {
+            if (f == 0 && lines == 0) {
+                assert(strcmp(line, "{\"benchmark\":\"unit_test\",\"model\":\"marriage\",\"n\":8,\"k\":3,"
+                                    "\"seed\":0,\"algorithm\":\"pruning\",\"wall_ms\":1.500000,"
+                                    "\"cpu_ms\":1.250000,\"result\":null,\"nodes\":null,\"weight\":1}\n") == 0);
+            }
+            if (f == 1 && lines == 0) {
+                assert(strcmp(line, "benchmark,model,n,k,seed,algorithm,wall_ms,cpu_ms,result,nodes,weight\n") == 0);
+            }
+            if (f == 1 && lines == num_records) {
+                assert(strcmp(line, "unit_test,marriage,8,3,4999,pruning,1.500000,1.250000,1,4999,1\n") == 0);
+            }
+            lines++;
+        }
+        fclose(file);
+        assert(lines == num_records + f);   // CSV adds a header row
+    }
+    remove(path);
+    
+    // Emitting without an open sink is a no-op
+    result_sink_emit(&record);
+    assert(result_sink_close());
+    
+    printf("  JSONL and CSV records stream through the buffer intact\n");
+    printf("  ✓ Result sink tests passed\n");
+}
+
+void test_search_stats() {
+    printf("Testing search statistics...\n");
+    
+    search_stats_t stats;
+    for (int n = 4; n <= 6; n++) {
+        problem_instance_t* instance = generate_random_house_allocation(n, 1357 + n);
+        assert(instance != NULL);
+        
+        for (int k = 1; k <= n; k++) {
+            // Statistics never change the answer
+            bool exists = k_stable_matching_exists_with_stats(instance, k, &stats);
+            assert(exists == k_stable_matching_exists(instance, k));
+#ifdef MATCHING_SEARCH_STATS
+            // Node-level rules cut at most one subtree per node; the greedy
+            // paths verify one matching outside the search
+            assert(stats.max_depth <= n);
+            assert(stats.prunes_promising + stats.prunes_conflict <= stats.nodes_expanded);
+            assert(stats.leaves_verified <= stats.nodes_expanded + 1);
+            assert(stats.verify_ms >= 0.0);
+#endif
+            
+            int count = count_k_stable_matchings_with_stats(instance, k, &stats);
+            assert(count == count_k_stable_matchings(instance, k));
+#ifdef MATCHING_SEARCH_STATS
+            // The counting search has no pruning: it reaches every leaf at depth n
+            assert(stats.max_depth == n && stats.leaves_verified > 0);
+            assert(stats.nodes_expanded > stats.leaves_verified);
+            assert(stats.prunes_promising == 0 && stats.prunes_invalid == 0);
+#else
+            assert(stats.nodes_expanded == 0 && stats.leaves_verified == 0);
+#endif
+        }
+        destroy_problem_instance(instance);
+    }
+    
+    // Invalid arguments leave zeroed stats
+    assert(!k_stable_matching_exists_with_stats(NULL, 1, &stats));
+    assert(stats.nodes_expanded == 0 && stats.max_depth == 0 && stats.verify_ms == 0.0);
+    
+#ifdef MATCHING_SEARCH_STATS
+    printf("  Counters are consistent with the search results\n");
+#else
+    printf("  Search statistics compiled out; counters stay zero\n");
+#endif
+    printf("  ✓ Search statistics tests passed\n");
+}
+
+void test_search_tally() {
+    printf("Testing incremental search tallies...\n");
+    
+    problem_instance_t* instances[4] = {
+        generate_random_house_allocation(10, 8642),
+        generate_truncated_house_allocation(9, 3, 8642),
+        generate_random_marriage(5, 6, 8642),
+        generate_random_roommates(10, 8642)
+    };
+    
+    enum { MAX_STEPS = 512 };
+    static int steps[MAX_STEPS][2];
+    for (int m = 0; m < 4; m++) {
+        problem_instance_t* instance = instances[m];
+        assert(instance != NULL);
+        int n = instance->num_agents;
+        int num_men = (instance->model == MARRIAGE) ? instance->model_data.marriage_data.num_men : 0;
+        int pairs[16], paired[16];
+        assert(n <= 16);
+        for (int a = 0; a < n; a++) {
+            pairs[a] = -1;
+        }
+        
+        // Descend to every depth up to n / 2 pairs in turn, backing up a random
+        // number of pairings after each, then unwind: replay checks the tally
+        // against a recount after every step. Partners are drawn from whole
+        // lists and beyond (unlisted ones rank as unacceptable)
+        srand(4242 + m);
+        int num_steps = 0;
+        int depth = 0;
+        for (int round = 0; round < 24; round++) {
+            int target = 1 + round % (n / 2);
+            while (depth < target) {
+                int agent, partner;
+                do {
+                    agent = rand() % n;
+                    partner = rand() % n;
+                } while (agent == partner || pairs[agent] != -1 || pairs[partner] != -1 ||
+                         (num_men > 0 && (agent < num_men) == (partner < num_men)));
+                pairs[agent] = partner;
+                pairs[partner] = agent;
+                paired[depth++] = agent;
+                steps[num_steps][0] = agent;
+                steps[num_steps][1] = partner;
+                num_steps++;
+            }
+            int back = (round == 23) ? 0 : rand() % (depth + 1);
+            while (depth > back) {
+                int agent = paired[--depth];
+                pairs[pairs[agent]] = -1;
+                pairs[agent] = -1;
+                steps[num_steps][0] = -1;
+                steps[num_steps][1] = -1;
+                num_steps++;
+            }
+        }
+        assert(num_steps <= MAX_STEPS);
+        assert(search_tally_replay(instance, (const int (*)[2])steps, num_steps) == num_steps);
+    }
+    
+    // Pairing a matched agent, or undoing with nothing paired, is rejected
+    const int rematch[2][2] = {{0, 1}, {1, 2}};
+    const int unpaired[1][2] = {{-1, -1}};
+    assert(search_tally_replay(instances[3], rematch, 2) == -1);
+    assert(search_tally_replay(instances[3], unpaired, 1) == -1);
+    
+    for (int m = 0; m < 4; m++) {
+        destroy_problem_instance(instances[m]);
+    }
+    
+    printf("  Tallies match a recount after every assignment and undo, at depths 1 to n/2\n");
+    printf("  ✓ Incremental search tally tests passed\n");
+}
+
+void test_timing_phases() {
+    printf("Testing timing and phase profiling...\n");
+    
+    // The wall clock never goes backwards
+    double previous = wall_time_ms();
+    for (int i = 0; i < 1000; i++) {
+        double now = wall_time_ms();
+        assert(now >= previous);
+        previous = now;
+    }
+    
+    // A nested phase takes no longer than the phase enclosing it
+    phase_profile_reset();
+    stopwatch_t outer, inner;
+    phase_begin("outer");
+    problem_instance_t* instance = generate_random_house_allocation(6, 2468);
+    assert(instance != NULL);
+    phase_begin("inner");
+    count_k_stable_matchings(instance, 2);
+    phase_end(&inner);
+    phase_add("workers", 1.0, 2.0, 4);
+    phase_end(&outer);
+    destroy_problem_instance(instance);
+    
+    assert(inner.wall_ms >= 0.0 && inner.cpu_ms >= 0.0);
+    assert(outer.wall_ms >= inner.wall_ms);
+    assert(outer.cpu_ms >= inner.cpu_ms);
+    
+    // Closing with nothing open is a no-op and leaves elapsed untouched
+    stopwatch_t untouched = outer;
+    phase_end(&untouched);
+    assert(untouched.wall_ms == outer.wall_ms);
+    
+    // Phases nested past the depth limit are not recorded but stay balanced
+    for (int d = 0; d < 20; d++) phase_begin("deep");
+    for (int d = 0; d < 20; d++) phase_end(NULL);
+    stopwatch_t after;
+    phase_begin("after");
+    phase_end(&after);
+    assert(after.wall_ms >= 0.0);
+    
+    phase_profile_reset();
+    printf("  Nested phase times are bounded by their enclosing phase\n");
+    printf("  ✓ Timing and phase profiling tests passed\n");
+}
+
+// Fill matching with a pseudo-random feasible matching of instance; every
+// third seed leaves one pair unmatched
+static void fill_random_matching(matching_t* matching, const problem_instance_t* instance, unsigned seed) {
+    int n = instance->num_agents;
+    int order[64];
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+        matching->pairs[i] = -1;
+    }
+    srand(seed);
+    if (instance->model == MARRIAGE) {
+        // Shuffle the women and pair them with the men in order
+        int num_men = instance->model_data.marriage_data.num_men;
+        for (int i = n - 1; i > num_men; i--) {
+            int j = num_men + rand() % (i - num_men + 1);
+            int tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+        }
+        for (int m = (seed % 3 == 0) ? 1 : 0; m < num_men && num_men + m < n; m++) {
+            matching->pairs[m] = order[num_men + m];
+            matching->pairs[order[num_men + m]] = m;
+        }
+    } else {
+        // Shuffled pairs (is_valid_matching wants symmetric pairs in every model)
+        for (int i = n - 1; i > 0; i--) {
+            int j = rand() % (i + 1);
+            int tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+        }
+        for (int i = (seed % 3 == 0) ? 2 : 0; i + 1 < n; i += 2) {
+            matching->pairs[order[i]] = order[i + 1];
+            matching->pairs[order[i + 1]] = order[i];
+        }
+    }
+}
+
+void test_verifier_context() {
+    printf("Testing verifier contexts and batch verification...\n");
+    
+    problem_instance_t* instances[3] = {
+        generate_random_house_allocation(7, 8642),
+        generate_random_marriage(4, 4, 8642),
+        generate_random_roommates(8, 8642)
+    };
+    
+    for (int m = 0; m < 3; m++) {
+        problem_instance_t* instance = instances[m];
+        assert(instance != NULL);
+        int n = instance->num_agents;
+        
+        verifier_context_t verifier;
+        bool ready = verifier_context_init(&verifier, instance);
+        assert(ready);
+        assert((verifier.partner_ranks != NULL) == (instance->model != HOUSE_ALLOCATION));
+        
+        enum { NUM_MATCHINGS = 12 };
+        matching_t* matchings[NUM_MATCHINGS];
+        for (int i = 0; i < NUM_MATCHINGS; i++) {
+            matchings[i] = create_matching(n, instance->model);
+            assert(matchings[i] != NULL);
+            fill_random_matching(matchings[i], instance, 100 + i);
+        }
+        
+        // Single checks agree with the one-shot verifier and blocking number
+        for (int i = 0; i < NUM_MATCHINGS; i++) {
+            assert(verifier_blocking_number(&verifier, matchings[i], INT_MAX) ==
+                   blocking_number(matchings[i], instance));
+            for (int k = 0; k <= n + 1; k++) {
+                assert(verifier_is_k_stable(&verifier, matchings[i], k) == is_k_stable(matchings[i], instance, k));
+            }
+            assert(matching_arena_mark(&verifier.arena) == 0);
+        }
+        
+        // Batches answer every matching and every k at once
+        int k_values[] = {1, 2, 3, n / 2, n, n + 1};
+        int num_k = (int)(sizeof(k_values) / sizeof(k_values[0]));
+        int numbers[NUM_MATCHINGS];
+        bool stable[NUM_MATCHINGS * 6];
+        bool computed = verify_batch_blocking_numbers(&verifier, (const matching_t* const*)matchings,
+                                                      NUM_MATCHINGS, INT_MAX, numbers);
+        assert(computed);
+        bool checked = verify_batch_k_stable(&verifier, (const matching_t* const*)matchings,
+                                             NUM_MATCHINGS, k_values, num_k, stable);
+        assert(checked);
+        for (int i = 0; i < NUM_MATCHINGS; i++) {
+            assert(numbers[i] == blocking_number(matchings[i], instance));
+            for (int j = 0; j < num_k; j++) {
+                assert(stable[i * num_k + j] == is_k_stable(matchings[i], instance, k_values[j]));
+            }
+            destroy_matching(matchings[i]);
+        }
+        
+        verifier_context_destroy(&verifier);
+        destroy_problem_instance(instance);
+    }
+    
+    printf("  Single and batch checks match is_k_stable and blocking_number in every model\n");
+    printf("  ✓ Verifier context tests passed\n");
+}
+
+// Position of target in agent's list, -1 if it is not listed
+static int listed_rank(const problem_instance_t* instance, int agent, int target) {
+    const int* preferences = instance_preferences(instance, agent);
+    for (int r = 0; r < instance_num_preferences(instance, agent); r++) {
+        if (preferences[r] == target) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+// Most agents any alternative matching makes strictly better off, found by
+// trying every matching: the lowest undecided agent stays single or takes
+// each later undecided agent it may pair with (alternative[a] == -2: undecided)
+static int brute_force_blocking_number(const matching_t* matching, const problem_instance_t* instance,
+                                       int* alternative) {
+    int n = instance->num_agents;
+    int a = 0;
+    while (a < n && alternative[a] != -2) {
+        a++;
+    }
+    if (a == n) {
+        int improved = 0;
+        for (int i = 0; i < n; i++) {
+            int current = matching->pairs[i];
+            int limit = (current == -1) ? instance_num_preferences(instance, i) : listed_rank(instance, i, current);
+            int rank = (alternative[i] == -1) ? -1 : listed_rank(instance, i, alternative[i]);
+            improved += rank != -1 && rank < limit;
+        }
+        return improved;
+    }
+    
+    alternative[a] = -1;
+    int best = brute_force_blocking_number(matching, instance, alternative);
+    int num_men = instance->model_data.marriage_data.num_men;
+    for (int b = a + 1; b < n; b++) {
+        if (alternative[b] != -2 || (instance->model == MARRIAGE && (a < num_men) == (b < num_men))) {
+            continue;
+        }
+        alternative[a] = b;
+        alternative[b] = a;
+        int improved = brute_force_blocking_number(matching, instance, alternative);
+        best = (improved > best) ? improved : best;
+        alternative[b] = -2;
+    }
+    alternative[a] = -2;
+    return best;
+}
+
+void test_blocking_number_brute_force() {
+    printf("Testing blocking numbers against brute force...\n");
+    
+    // Marriage 3+3, 4+4 and 3+5, roommates n = 5..8, several seeds each
+    int checked = 0;
+    for (int seed = 1; seed <= 4; seed++) {
+        problem_instance_t* instances[7] = {
+            generate_random_marriage(3, 3, 1357 + seed),
+            generate_random_marriage(4, 4, 1357 + seed),
+            generate_random_marriage(3, 5, 1357 + seed),
+            generate_random_roommates(5, 1357 + seed),
+            generate_random_roommates(6, 1357 + seed),
+            generate_random_roommates(7, 1357 + seed),
+            generate_random_roommates(8, 1357 + seed)
+        };
+        
+        for (int m = 0; m < 7; m++) {
+            problem_instance_t* instance = instances[m];
+            assert(instance != NULL);
+            int n = instance->num_agents;
+            verifier_context_t verifier;
+            bool ready = verifier_context_init(&verifier, instance);
+            assert(ready);
+            
+            // The empty matching, then full and partial random ones (every
+            // other one loses a further pair)
+            matching_t* matching = create_matching(n, instance->model);
+            assert(matching != NULL);
+            for (int t = 0; t < 8; t++) {
+                if (t > 0) {
+                    fill_random_matching(matching, instance, 31 * seed + t);
+                    for (int a = 0; (t & 1) && a < n; a++) {
+                        if (matching->pairs[a] > a) {
+                            matching->pairs[matching->pairs[a]] = -1;
+                            matching->pairs[a] = -1;
+                            break;
+                        }
+                    }
+                }
+                assert(is_valid_matching(matching, instance));
+                
+                int alternative[8];
+                for (int a = 0; a < n; a++) {
+                    alternative[a] = -2;
+                }
+                int expected = brute_force_blocking_number(matching, instance, alternative);
+                assert(blocking_number(matching, instance) == expected);
+                assert(verifier_blocking_number(&verifier, matching, n + 1) == expected);
+                for (int k = 1; k <= n; k++) {
+                    assert(is_k_stable(matching, instance, k) == (expected < k));
+                    assert(is_k_stable_direct(matching, instance, k) == (expected < k));
+                    assert(verifier_is_k_stable(&verifier, matching, k) == (expected < k));
+                }
+                checked++;
+            }
+            
+            destroy_matching(matching);
+            verifier_context_destroy(&verifier);
+            destroy_problem_instance(instance);
+        }
+    }
+    
+    printf("  %d marriage and roommates matchings agree with enumerating every alternative\n", checked);
+    printf("  ✓ Brute-force blocking number tests passed\n");
+}
+
+void test_blocking_tracker() {
+    printf("Testing incremental blocking numbers...\n");
+    
+    problem_instance_t* instances[2] = {
+        generate_random_house_allocation(7, 7531),
+        generate_truncated_house_allocation(9, 3, 7531)
+    };
+    
+    for (int m = 0; m < 2; m++) {
+        problem_instance_t* instance = instances[m];
+        assert(instance != NULL);
+        int n = instance->num_agents;
+        
+        matching_t* matching = create_matching(n, HOUSE_ALLOCATION);
+        assert(matching != NULL);
+        for (int a = 0; a < n; a++) {
+            matching->pairs[a] = a;
+        }
+        blocking_tracker_t* tracker = create_blocking_tracker(instance, matching);
+        assert(tracker != NULL);
+        assert(blocking_tracker_value(tracker) == blocking_number(matching, instance));
+        
+        // Swap two agents' houses at a time, now and then leaving one unmatched;
+        // the tracked value always equals a fresh computation
+        srand(2024 + m);
+        int spare = -1;
+        for (int step = 0; step < 500; step++) {
+            int changed[2] = {rand() % n, rand() % n};
+            if (step % 11 == 0) {
+                int house = matching->pairs[changed[0]];
+                matching->pairs[changed[0]] = spare;
+                spare = house;
+                blocking_tracker_update(tracker, matching, changed, 1);
+            } else {
+                int house = matching->pairs[changed[0]];
+                matching->pairs[changed[0]] = matching->pairs[changed[1]];
+                matching->pairs[changed[1]] = house;
+                blocking_tracker_update(tracker, matching, changed, changed[0] == changed[1] ? 1 : 2);
+            }
+            assert(blocking_tracker_value(tracker) == blocking_number(matching, instance));
+        }
+        
+        destroy_blocking_tracker(tracker);
+        destroy_matching(matching);
+        destroy_problem_instance(instance);
+    }
+    
+    // Only house allocation has a tracker
+    problem_instance_t* roommates = generate_random_roommates(4, 7531);
+    matching_t* empty = create_matching(4, ROOMMATES);
+    assert(create_blocking_tracker(roommates, empty) == NULL);
+    destroy_matching(empty);
+    destroy_problem_instance(roommates);
+    
+    printf("  Tracked blocking numbers match blocking_number over 500 swaps\n");
+    printf("  ✓ Incremental blocking number tests passed\n");
+}
+
+void test_matching_census() {
+    printf("Testing the parallel matching census...\n");
+    
+    // n = 8 gives eight chunks of 7! matchings, split differently per thread count
+    int n = 8, k = 6;
+    problem_instance_t* instance = generate_random_house_allocation(n, 4242);
+    assert(instance != NULL);
+    
+    // Direct count over the permutations in lexicographic order
+    matching_census_t expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.min_preferring = n;
+    matching_t* matching = create_matching(n, HOUSE_ALLOCATION);
+    assert(matching != NULL);
+    uint64_t count = permutation_count(n);
+    for (uint64_t rank = 0; rank < count; rank++) {
+        unrank_permutation(rank, n, matching->pairs);
+        int blocking = blocking_number(matching, instance);
+        int preferring = 0;
+        for (int a = 0; a < n; a++) {
+            preferring += get_agent_rank(instance, a, matching->pairs[a]) > 0;
+        }
+        expected.total++;
+        expected.k_stable += is_valid_matching(matching, instance) && blocking < k;
+        expected.preferring_sum += preferring;
+        expected.blocking_histogram[blocking]++;
+        if (preferring < expected.min_preferring) expected.min_preferring = preferring;
+        if (preferring > expected.max_preferring) expected.max_preferring = preferring;
+    }
+    destroy_matching(matching);
+    
+    for (int threads = 1; threads <= 3; threads++) {
+        matching_census_t census;
+        assert(house_allocation_matching_census(instance, k, threads, &census));
+        assert(census.total == expected.total);
+        assert(census.k_stable == expected.k_stable);
+        assert(census.preferring_sum == expected.preferring_sum);
+        assert(census.min_preferring == expected.min_preferring);
+        assert(census.max_preferring == expected.max_preferring);
+        for (int b = 0; b <= MATCHING_CENSUS_MAX_N; b++) {
+            assert(census.blocking_histogram[b] == expected.blocking_histogram[b]);
+        }
+    }
+    printf("  %lld matchings, %lld %d-stable, same totals on 1-3 threads\n",
+           expected.total, expected.k_stable, k);
+    
+    // Only house allocation instances can be enumerated this way
+    problem_instance_t* marriage = generate_random_marriage(2, 2, 4242);
+    matching_census_t census;
+    assert(!house_allocation_matching_census(marriage, 2, 1, &census));
+    destroy_problem_instance(marriage);
+    destroy_problem_instance(instance);
+    
+    printf("  ✓ Matching census tests passed\n");
+}
+
+// Whether two instances have the same lists (and tie groups)
+static bool same_instance(const problem_instance_t* a, const problem_instance_t* b) {
+    if (a->num_agents != b->num_agents || a->model != b->model ||
+        memcmp(a->pref_offsets, b->pref_offsets, (a->num_agents + 1) * sizeof(int)) != 0) {
+        return false;
+    }
+    size_t entries = (size_t)a->pref_offsets[a->num_agents];
+    if (memcmp(a->preferences, b->preferences, entries * sizeof(int)) != 0) {
+        return false;
+    }
+    if ((a->tie_groups == NULL) != (b->tie_groups == NULL)) {
+        return false;
+    }
+    return a->tie_groups == NULL ||
+           (memcmp(a->tie_groups, b->tie_groups, entries * sizeof(int)) == 0 &&
+            memcmp(a->has_indifferences, b->has_indifferences, a->num_agents * sizeof(bool)) == 0);
+}
+
+#define GENERATION_TEST_KINDS 6
+
+static problem_instance_t* generate_test_instance(int kind, uint32_t seed) {
+    switch (kind) {
+        case 0: return generate_random_house_allocation(9, seed);
+        case 1: return generate_random_marriage(4, 6, seed);
+        case 2: return generate_random_roommates(7, seed);
+        case 3: return generate_k_hai_instance(8, 6, seed);
+        case 4: return generate_k_hai_with_indifferences(8, 6, seed);
+        default: return generate_truncated_house_allocation(40, 5, seed);
+    }
+}
+
+typedef struct {
+    problem_instance_t** expected;   // [kind * 16 + seed]
+    int mismatches[4];
+} generation_check_t;
+
+// Regenerate every instance on this worker and compare with the main thread's
+static void regenerate_chunk(void* context, int worker, uint64_t begin, uint64_t end) {
+    generation_check_t* check = context;
+    for (uint64_t i = begin; i < end; i++) {
+        problem_instance_t* instance = generate_test_instance((int)(i / 16), (uint32_t)(i % 16));
+        if (instance == NULL || !same_instance(instance, check->expected[i])) {
+            check->mismatches[worker]++;
+        }
+        destroy_problem_instance(instance);
+    }
+}
+
+void test_parallel_generation() {
+    printf("Testing reentrant instance generation...\n");
+    
+    // Generators keep no shared state, so workers regenerating the same
+    // seeds concurrently get the same instances bit for bit
+    problem_instance_t* expected[GENERATION_TEST_KINDS * 16];
+    for (int i = 0; i < GENERATION_TEST_KINDS * 16; i++) {
+        expected[i] = generate_test_instance(i / 16, (uint32_t)(i % 16));
+        assert(expected[i] != NULL);
+    }
+    generation_check_t check = { expected, {0, 0, 0, 0} };
+    for (int round = 0; round < 4; round++) {
+        assert(parallel_for_chunks(GENERATION_TEST_KINDS * 16, 1, 4, regenerate_chunk, &check));
+    }
+    assert(check.mismatches[0] + check.mismatches[1] + check.mismatches[2] + check.mismatches[3] == 0);
+    
+    // Seeds give different instances, and lists are well formed
+    assert(!same_instance(expected[0], expected[1]));
+    for (int agent = 0; agent < 40; agent++) {
+        const int* houses = instance_preferences(expected[5 * 16], agent);
+        for (int i = 0; i < 5; i++) {
+            for (int j = i + 1; j < 5; j++) {
+                assert(houses[i] != houses[j]);
+            }
+        }
+    }
+    
+    // Large enough to be filled on all cores; the result is still reproducible
+    problem_instance_t* large = generate_truncated_house_allocation(100000, 3, 99);
+    problem_instance_t* again = generate_truncated_house_allocation(100000, 3, 99);
+    assert(large != NULL && again != NULL && same_instance(large, again));
+    destroy_problem_instance(large);
+    destroy_problem_instance(again);
+    
+    for (int i = 0; i < GENERATION_TEST_KINDS * 16; i++) {
+        destroy_problem_instance(expected[i]);
+    }
+    
+    // One reused buffer gives every trial source's instance: sizes grow and
+    // shrink, tie groups come and go, rank tables switch between dense and hashed
+    const struct { trial_source_t source; int n; int param; } sequence[] = {
+        {TRIAL_HOUSE_ALLOCATION, 6, 0}, {TRIAL_HOUSE_ALLOCATION, 12, 0}, {TRIAL_MARRIAGE, 8, 0},
+        {TRIAL_K_HAI_INDIFFERENCES, 10, 7}, {TRIAL_ROOMMATES, 5, 0}, {TRIAL_K_HAI_INDIFFERENCES, 14, 9},
+        {TRIAL_TRUNCATED, 3000, 4}, {TRIAL_K_HAI, 9, 6}, {TRIAL_HOUSE_ALLOCATION, 20, 0},
+        {TRIAL_TRUNCATED, 200, 3}, {TRIAL_HOUSE_ALLOCATION, 4, 0}
+    };
+    int num_sequence = sizeof(sequence) / sizeof(sequence[0]);
+    problem_instance_t* buffer = NULL;
+    for (int i = 0; i < num_sequence; i++) {
+        int n = sequence[i].n;
+        uint32_t seed = 500 + (uint32_t)i;
+        buffer = generate_trial_instance(buffer, sequence[i].source, n, sequence[i].param, seed);
+        problem_instance_t* fresh = generate_trial_instance(NULL, sequence[i].source, n, sequence[i].param, seed);
+        assert(buffer != NULL && fresh != NULL && same_instance(buffer, fresh));
+        assert((buffer->rank_table == NULL) == (fresh->rank_table == NULL));
+        for (int agent = 0; agent < n; agent += (n > 100) ? 97 : 1) {
+            for (int target = -1; target <= fresh->num_targets; target++) {
+                assert(get_agent_rank(buffer, agent, target) == get_agent_rank(fresh, agent, target));
+            }
+        }
+        destroy_problem_instance(fresh);
+    }
+    assert(generate_trial_instance(buffer, TRIAL_FIXED, 4, 0, 1) == NULL);
+    
+    printf("  %d instances regenerated identically on 4 threads\n", GENERATION_TEST_KINDS * 16 * 4);
+    printf("  %d trial instances rebuilt in one buffer match fresh ones\n", num_sequence);
+    printf("  ✓ Reentrant generation tests passed\n");
+}
+
+// Counts of a batch of existence and verification trials run on num_threads workers
+static void run_test_batch(int num_threads, trial_totals_t* totals) {
+    set_trial_threads(num_threads);
+    trial_batch_t batch;
+    trial_batch_init(&batch, NULL);
+    assert(trial_batch_add_group(&batch, TRIAL_HOUSE_ALLOCATION, TRIAL_SEARCH, 6, 0, 5, 0, 24) == 0);
+    assert(trial_batch_add_group(&batch, TRIAL_K_HAI, TRIAL_SEARCH, 6, 4, 2, 1000, 24) == 1);
+    assert(trial_batch_add_group(&batch, TRIAL_MARRIAGE, TRIAL_VERIFY, 8, 0, 4, 0, 24) == 2);
+    assert(trial_batch_add_group(&batch, TRIAL_ROOMMATES, TRIAL_VERIFY, 8, 0, 4, 0, 24) == 3);
+    assert(batch.num_jobs == 96);
+    assert(trial_batch_run(&batch, "test", true));
+    for (int g = 0; g < 4; g++) {
+        totals[g] = batch.totals[g];
+    }
+    trial_batch_destroy(&batch);
+}
+
+void test_trial_runner() {
+    printf("Testing the benchmark trial runner...\n");
+    
+    // Every group's outcomes match the same trials run one by one
+    trial_totals_t serial[4];
+    run_test_batch(1, serial);
+    int exists = 0;
+    for (int trial = 0; trial < 24; trial++) {
+        problem_instance_t* instance = generate_random_house_allocation(6, trial_seed(trial));
+        assert(instance != NULL);
+        if (k_stable_matching_exists(instance, 5)) exists++;
+        destroy_problem_instance(instance);
+    }
+    assert(serial[0].trials == 24 && serial[0].positive == exists);
+    for (int g = 0; g < 4; g++) {
+        assert(serial[g].trials == 24);
+        assert(serial[g].min_wall_ms <= trial_mean_ms(&serial[g]));
+        assert(trial_mean_ms(&serial[g]) <= serial[g].max_wall_ms);
+    }
+    
+    // Counts do not depend on the thread count
+    for (int num_threads = 2; num_threads <= 5; num_threads += 3) {
+        trial_totals_t parallel[4];
+        run_test_batch(num_threads, parallel);
+        for (int g = 0; g < 4; g++) {
+            assert(parallel[g].trials == serial[g].trials);
+            assert(parallel[g].positive == serial[g].positive);
+            assert(parallel[g].stats.nodes_expanded == serial[g].stats.nodes_expanded);
+            assert(parallel[g].stats.max_depth == serial[g].stats.max_depth);
+        }
+    }
+    set_trial_threads(0);
+    
+    // Seeds are offsets from the base seed
+    set_trial_base_seed(41);
+    assert(trial_seed(0) == 41 && trial_seed(1000) == 1041);
+    set_trial_base_seed(1);
+    
+    printf("  k-stable matchings exist in %d of 24 trials for n=6, k=5 on 1, 2 and 5 threads\n", exists);
+    printf("  ✓ Trial runner tests passed\n");
+}
+
+void test_transposition_table() {
+    printf("Testing the search transposition table...\n");
+    
+    // Entries round-trip, and an entry only answers its own key
+    uint64_t salt = transposition_table_salt();
+    assert(salt != transposition_table_salt());
+    uint64_t key = salt ^ zobrist_pair_key(0, 3) ^ zobrist_depth_key(2);
+    assert(zobrist_pair_key(0, 3) == zobrist_pair_key(3, 0));
+    uint64_t value = 0;
+    transposition_table_store(key, 42);
+    assert(transposition_table_probe(key, &value) && value == 42);
+    assert(!transposition_table_probe(key ^ zobrist_depth_key(3), &value));
+    
+    // Counts and existence answers are the same with and without the table,
+    // and the table answers repeated subtrees
+    int counts[3][7][2];
+    bool exists[3][7][2];
+    long long hits = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        assert(transposition_table_configure(pass == 0 ? 0 : (size_t)1 << 20));
+        assert((transposition_table_bytes() == 0) == (pass == 0));
+        for (int model = 0; model < 3; model++) {
+            problem_instance_t* instance = (model == 0) ? generate_random_house_allocation(6, 77) :
+                                           (model == 1) ? generate_random_marriage(3, 3, 77) :
+                                                          generate_random_roommates(6, 77);
+            assert(instance != NULL);
+            for (int k = 1; k <= 6; k++) {
+                search_stats_t stats;
+                counts[model][k][pass] = count_k_stable_matchings_with_stats(instance, k, &stats);
+                exists[model][k][pass] = k_stable_matching_exists(instance, k);
+                hits += stats.table_hits;
+                if (pass == 0) {
+                    assert(stats.table_hits == 0);
+                } else {
+                    assert(counts[model][k][1] == counts[model][k][0]);
+                    assert(exists[model][k][1] == exists[model][k][0]);
+                }
+            }
+            destroy_problem_instance(instance);
+        }
+    }
+#ifdef MATCHING_SEARCH_STATS
+    assert(hits > 0);
+#endif
+    assert(transposition_table_configure((size_t)16 << 20));
+    
+    printf("  %lld counting subtrees answered from the table, same counts as without it\n", hits);
+    printf("  ✓ Transposition table tests passed\n");
+}
+
+// Blocking numbers of every distinct matching count_k_stable_matchings searches
+// (each agent unmatched or paired with another), added to histogram
+static void tally_searched_matchings(matching_t* matching, const problem_instance_t* instance,
+                                     bool* decided, int agent, long long* histogram) {
+    int n = instance->num_agents;
+    while (agent < n && decided[agent]) {
+        agent++;
+    }
+    if (agent == n) {
+        histogram[blocking_number(matching, instance)]++;
+        return;
+    }
+    
+    decided[agent] = true;
+    tally_searched_matchings(matching, instance, decided, agent + 1, histogram);
+    for (int partner = agent + 1; partner < n; partner++) {
+        if (decided[partner]) continue;
+        decided[partner] = true;
+        matching->pairs[agent] = partner;
+        matching->pairs[partner] = agent;
+        tally_searched_matchings(matching, instance, decided, agent + 1, histogram);
+        matching->pairs[agent] = -1;
+        matching->pairs[partner] = -1;
+        decided[partner] = false;
+    }
+    decided[agent] = false;
+}
+
+void test_subset_counting() {
+    printf("Testing subset dynamic programming counts...\n");
+    
+    // Same leaf counts as the recursive search, and the distribution of every
+    // distinct matching's blocking number, for random and master-list preferences
+    int master[7 * 7];
+    for (int i = 0; i < 7 * 7; i++) {
+        master[i] = i % 7;
+    }
+    long long memo_hits = 0;
+    for (int trial = 0; trial < 4; trial++) {
+        int n = (trial < 3) ? 5 + trial : 7;
+        problem_instance_t* instance = (trial < 3) ? generate_random_house_allocation(n, 500 + trial) :
+                                                     generate_house_allocation_from_profile(n, master);
+        assert(instance != NULL);
+        
+        matching_t* matching = create_matching(n, HOUSE_ALLOCATION);
+        bool decided[8] = {false};
+        long long histogram[8] = {0};
+        tally_searched_matchings(matching, instance, decided, 0, histogram);
+        destroy_matching(matching);
+        
+        for (int k = 1; k <= n; k++) {
+            matching_count_t counted;
+            assert(count_k_stable_matchings_dp(instance, k, &counted));
+            assert(counted.search_leaves == count_k_stable_matchings(instance, k));
+            
+            long long total = 0;
+            long long above = 0;
+            for (int b = 0; b <= n; b++) {
+                total += histogram[b];
+                if (b < k) {
+                    assert(counted.blocking_histogram[b] == histogram[b]);
+                } else {
+                    above += histogram[b];
+                }
+            }
+            assert(counted.total == total);
+            assert(counted.blocking_histogram[k] == above);
+            assert(counted.k_stable == total - above);
+            memo_hits += counted.memo_hits;
+        }
+        
+        // As a backend of count_k_stable_matchings, with its own counters
+        matching_count_t counted;
+        assert(count_k_stable_matchings_dp(instance, n, &counted));
+        search_stats_t stats;
+        set_count_backend(COUNT_BACKEND_SUBSET_DP);
+        int dp_count = count_k_stable_matchings_with_stats(instance, n, &stats);
+        set_count_backend(COUNT_BACKEND_RECURSIVE);
+        assert(dp_count == count_k_stable_matchings(instance, n));
+#ifdef MATCHING_SEARCH_STATS
+        assert(stats.memo_subproblems == counted.subproblems && stats.memo_hits == counted.memo_hits);
+#endif
+        assert(stats.nodes_expanded == 0 && stats.table_hits == 0 && stats.table_misses == 0);
+        destroy_problem_instance(instance);
+    }
+    assert(memo_hits > 0);
+    
+    // A memo budget too small to hold every subproblem (here a few hundred of
+    // about a thousand) or none leaves the rest uncached; the counts do not change
+    int common[10 * 10];
+    for (int i = 0; i < 10 * 10; i++) {
+        common[i] = i % 10;
+    }
+    problem_instance_t* listed = generate_house_allocation_from_profile(10, common);
+    size_t budget = count_memo_budget();
+    matching_count_t full;
+    assert(count_k_stable_matchings_dp(listed, 10, &full));
+    assert(full.uncached == 0);
+    size_t limits[2] = {0, 96 << 10};
+    for (int l = 0; l < 2; l++) {
+        set_count_memo_budget(limits[l]);
+        matching_count_t bounded;
+        assert(count_k_stable_matchings_dp(listed, 10, &bounded));
+        set_count_memo_budget(budget);
+        assert(bounded.search_leaves == full.search_leaves);
+        assert(bounded.k_stable == full.k_stable);
+        assert(memcmp(bounded.blocking_histogram, full.blocking_histogram,
+                      sizeof(full.blocking_histogram)) == 0);
+        assert(bounded.uncached > 0 && bounded.subproblems > full.subproblems);
+        assert((bounded.memo_hits == 0) == (limits[l] == 0));
+    }
+    destroy_problem_instance(listed);
+    
+    // A count past INT_MAX is a failure, not a clamped answer
+    int common16[16 * 16];
+    for (int i = 0; i < 16 * 16; i++) {
+        common16[i] = i % 16;
+    }
+    problem_instance_t* wide = generate_house_allocation_from_profile(16, common16);
+    matching_count_t wide_count;
+    assert(count_k_stable_matchings_dp(wide, 16, &wide_count));
+    assert(wide_count.search_leaves > INT_MAX);
+    set_count_backend(COUNT_BACKEND_SUBSET_DP);
+    assert(count_k_stable_matchings(wide, 16) == -1);
+    set_count_backend(COUNT_BACKEND_RECURSIVE);
+    destroy_problem_instance(wide);
+    
+    // Other models stay on the recursive search with the dp backend selected
+    problem_instance_t* roommates = generate_random_roommates(6, 500);
+    matching_count_t counted;
+    assert(!count_k_stable_matchings_dp(roommates, 3, &counted));
+    set_count_backend(COUNT_BACKEND_SUBSET_DP);
+    int recursive = count_k_stable_matchings(roommates, 3);
+    set_count_backend(COUNT_BACKEND_RECURSIVE);
+    assert(recursive >= 0 && recursive == count_k_stable_matchings(roommates, 3));
+    destroy_problem_instance(roommates);
+    
+    // A house allocation instance past the dp's limits fails instead
+    problem_instance_t* large = generate_random_house_allocation(COUNT_DP_MAX_N + 1, 500);
+    set_count_backend(COUNT_BACKEND_SUBSET_DP);
+    assert(count_k_stable_matchings(large, 2) == -1);
+    set_count_backend(COUNT_BACKEND_RECURSIVE);
+    destroy_problem_instance(large);
+    
+    printf("  Leaf counts and blocking-number distributions match enumeration (%lld memo hits)\n", memo_hits);
+    printf("  ✓ Subset counting tests passed\n");
+}
+
 int main() {
     printf("=== Comprehensive Algorithm Tests ===\n\n");
     
@@ -186,6 +1670,61 @@ int main() {
     test_performance_improvements();
     printf("\n");
     
+    test_arena_verification();
+    printf("\n");
+    
+    test_overlay_and_trail();
+    printf("\n");
+    
+    test_exact_blocking_number();
+    printf("\n");
+    
+    test_parallel_existence();
+    printf("\n");
+    
+    test_profile_enumeration();
+    printf("\n");
+    
+    test_bitset_operations();
+    printf("\n");
+    
+    test_instance_files();
+    printf("\n");
+    
+    test_result_sink();
+    printf("\n");
+    
+    test_search_stats();
+    test_search_tally();
+    printf("\n");
+    
+    test_timing_phases();
+    printf("\n");
+    
+    test_verifier_context();
+    printf("\n");
+    
+    test_blocking_number_brute_force();
+    printf("\n");
+    
+    test_blocking_tracker();
+    printf("\n");
+    
+    test_matching_census();
+    printf("\n");
+    
+    test_parallel_generation();
+    printf("\n");
+    
+    test_trial_runner();
+    printf("\n");
+    
+    test_transposition_table();
+    printf("\n");
+    
+    test_subset_counting();
+    printf("\n");
+    
     printf("=== All Tests Completed Successfully ===\n");
     return 0;
 }
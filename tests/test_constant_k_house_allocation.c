@@ -2,7 +2,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdbool.h>
-#include <time.h>
+#include <string.h>
 #include "../include/matching.h"
 
 // Test configuration
@@ -11,14 +11,40 @@
 #define NUM_RANDOM_TRIALS 50
 #define MAX_CONSTANT_K 10
 
+// Profiles handed to each worker per claim
+#define PROFILE_CHUNK_SIZE 256
+
+// Phase 1 options: with --shard i/N (0 <= i < N) this process covers only the
+// i-th of N slices of each n's profile ranks, so N processes together count
+// every profile once; --threads T sets the worker threads (1 to 256, default:
+// all cores)
+static int shard_index = 0;
+static int num_shards = 1;
+static int num_threads = 0;
+
+// Per-worker counts of one n, merged once all workers have finished
+typedef struct {
+    int n;
+    uint64_t first_rank;             // chunk indices are offsets from the shard's first rank
+    long long* tested;               // [worker]
+    long long* exists;               // [worker * (n + 1) + k]
+} profile_count_t;
+
 // Function prototypes
+static bool parse_options(int argc, char* argv[]);
+static void count_profile_chunk(void* context, int worker, uint64_t begin, uint64_t end);
 void test_constant_k_brute_force(void);
 void test_constant_k_random_sampling(void);
 void test_constant_k_comprehensive(void);
 void print_results_table(const char* title, int* results, int max_n, int max_k);
 void print_summary_analysis(int* brute_force_results, int* random_results);
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (!parse_options(argc, argv)) {
+        printf("Usage: %s [--shard i/N] [--threads T (1-256)]\n", argv[0]);
+        return 1;
+    }
+    
     printf("=== Constant k Analysis for House Allocation ===\n");
     printf("Model: House Allocation with Complete Preferences (No Ties)\n");
     printf("Focus: Existence of k-stable matchings for constant k values\n\n");
@@ -26,6 +52,13 @@ int main() {
     test_constant_k_brute_force();
     printf("\n");
     
+    // A shard's counts are partial, so only the exhaustive phase runs
+    if (num_shards > 1) {
+        printf("Shard %d/%d: add the counts of all %d shards for the full tables\n",
+               shard_index, num_shards, num_shards);
+        return 0;
+    }
+    
     test_constant_k_random_sampling();
     printf("\n");
     
@@ -34,65 +67,119 @@ int main() {
     return 0;
 }
 
+static bool parse_options(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d/%d", &shard_index, &num_shards) != 2 ||
+                num_shards <= 0 || shard_index < 0 || shard_index >= num_shards) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            // Checked like the main program's --threads
+            char* end = NULL;
+            long long value = strtoll(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || value < 1 || value > 256) {
+                return false;
+            }
+            num_threads = (int)value;
+        } else {
+            return false;
+        }
+    }
+    if (num_threads == 0) {
+        num_threads = default_thread_count();
+    }
+    return true;
+}
+
 void test_constant_k_brute_force(void) {
     printf("=== PHASE 1: Brute Force Analysis (Small Instances) ===\n");
     printf("Testing all possible preference profiles for n <= %d\n", MAX_BRUTE_FORCE_SIZE);
     printf("Note: This is computationally intensive for n > %d\n\n", MAX_BRUTE_FORCE_SIZE);
     
-    // Results array: results[n][k] = number of instances where k-stable matching exists
-    static int results[MAX_BRUTE_FORCE_SIZE + 1][MAX_CONSTANT_K + 1];
-    static int total_instances[MAX_BRUTE_FORCE_SIZE + 1][MAX_CONSTANT_K + 1];
-    
-    // Initialize results
-    for (int n = 0; n <= MAX_BRUTE_FORCE_SIZE; n++) {
-        for (int k = 0; k <= MAX_CONSTANT_K; k++) {
-            results[n][k] = 0;
-            total_instances[n][k] = 0;
-        }
-    }
-    
     // Test each instance size
     for (int n = 2; n <= MAX_BRUTE_FORCE_SIZE; n++) {
         printf("--- n = %d agents ---\n", n);
         
-        // Generate all possible preference profiles
-        // For house allocation, each agent has a complete preference list over all n objects
-        int num_permutations = 1;
-        for (int i = 1; i <= n; i++) {
-            num_permutations *= i;
+        // For house allocation, each agent has a complete preference list over
+        // all n objects: (n!)^n profiles, of which this shard takes one slice
+        uint64_t begin, end;
+        shard_range(preference_profile_count(n), shard_index, num_shards, &begin, &end);
+        printf("Profiles [%llu, %llu) of %llu (shard %d/%d, %d thread%s)\n",
+               (unsigned long long)begin, (unsigned long long)end, 
+               (unsigned long long)preference_profile_count(n), shard_index, num_shards, num_threads,
+               num_threads == 1 ? "" : "s");
+        
+        profile_count_t count = { n, begin, NULL, NULL };
+        count.tested = calloc(num_threads, sizeof(long long));
+        count.exists = calloc((size_t)num_threads * (n + 1), sizeof(long long));
+        stopwatch_t timer;
+        stopwatch_start(&timer);
+        bool ok = count.tested != NULL && count.exists != NULL &&
+                  (begin == end ||
+                   parallel_for_chunks(end - begin, PROFILE_CHUNK_SIZE, num_threads, count_profile_chunk, &count));
+        stopwatch_stop(&timer);
+        if (!ok) {
+            printf("Out of memory for n=%d\n\n", n);
+            free(count.tested);
+            free(count.exists);
+            continue;
         }
         
-        // Test each possible preference profile
-        for (int profile = 0; profile < num_permutations; profile++) {
-            // Generate preference profile
-            problem_instance_t* instance = generate_random_house_allocation(n, profile);
-            if (instance == NULL) continue;
-            
-            // Test each constant k value
+        // Merge the per-worker counts; results[k] = number of profiles where a
+        // k-stable matching exists
+        long long total_instances = 0;
+        long long results[MAX_BRUTE_FORCE_SIZE + 1] = {0};
+        for (int t = 0; t < num_threads; t++) {
+            total_instances += count.tested[t];
             for (int k = 1; k <= n; k++) {
-                total_instances[n][k]++;
-                
-                // Check if k-stable matching exists
-                bool exists = k_stable_matching_exists(instance, k);
-                if (exists) {
-                    results[n][k]++;
-                }
+                results[k] += count.exists[(size_t)t * (n + 1) + k];
             }
-            
-            free(instance);
         }
+        free(count.tested);
+        free(count.exists);
         
         // Print results for this n
         printf("k       Total Instances  k-Stable Exist  Existence Rate\n");
         printf("-       --------------  --------------  --------------\n");
         for (int k = 1; k <= n; k++) {
-            double rate = (double)results[n][k] / total_instances[n][k];
-            printf("%-7d %-15d %-15d %.4f\n", k, total_instances[n][k], results[n][k], rate);
+            double rate = total_instances > 0 ? (double)results[k] / total_instances : 0.0;
+            printf("%-7d %-15lld %-15lld %.4f\n", k, total_instances, results[k], rate);
+        }
+        if (timer.wall_ms > 0.0) {
+            printf("Throughput: %.0f profiles/s (%d searches each, %.3f s)\n",
+                   total_instances / (timer.wall_ms / 1000.0), n, timer.wall_ms / 1000.0);
         }
         printf("\n");
     }
 }
 
+// Test profiles [begin, end) of the shard, stepping the iterator from one to the next
+static void count_profile_chunk(void* context, int worker, uint64_t begin, uint64_t end) {
+    profile_count_t* count = context;
+    int n = count->n;
+    long long* exists = count->exists + (size_t)worker * (n + 1);
+    
+    profile_iterator_t iterator;
+    if (!profile_iterator_init(&iterator, n, count->first_rank + begin, count->first_rank + end)) {
+        return;
+    }
+    do {
+        problem_instance_t* instance = generate_house_allocation_from_profile(n, iterator.profile);
+        if (instance == NULL) continue;
+        
+        // Test each constant k value
+        count->tested[worker]++;
+        for (int k = 1; k <= n; k++) {
+            if (k_stable_matching_exists(instance, k)) {
+                exists[k]++;
+            }
+        }
+        
+        destroy_problem_instance(instance);
+    } while (profile_iterator_next(&iterator));
+}
+
 void test_constant_k_random_sampling(void) {
     printf("=== PHASE 2: Random Sampling Analysis (Larger Instances) ===\n");
     printf("Testing k-stable matching existence for constant k values\n");
@@ -120,8 +207,10 @@ void test_constant_k_random_sampling(void) {
             
             // Run multiple trials
             for (int trial = 0; trial < NUM_RANDOM_TRIALS; trial++) {
-                // Generate random instance
-                problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial + n * 1000);
+                // Generate random instance, seeded by n and the trial as the
+                // benchmarks seed theirs, so every k sees the same instances
+                // and reruns repeat
+                problem_instance_t* instance = generate_random_house_allocation(n, trial_seed((uint32_t)(n * 1000 + trial)));
                 if (instance == NULL) continue;
                 
                 // Check if k-stable matching exists
@@ -130,7 +219,7 @@ void test_constant_k_random_sampling(void) {
                     exists_count++;
                 }
                 
-                free(instance);
+                destroy_problem_instance(instance);
             }
             
             results[n][k] = exists_count;
@@ -188,7 +277,7 @@ void test_constant_k_comprehensive(void) {
                 int num_trials = (n <= 3) ? 50 : 20; // Fewer trials for larger n
                 
                 for (int trial = 0; trial < num_trials; trial++) {
-                    problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial + n * 1000);
+                    problem_instance_t* instance = generate_random_house_allocation(n, trial_seed((uint32_t)(n * 1000 + trial)));
                     if (instance == NULL) continue;
                     
                     bool exists = k_stable_matching_exists(instance, k);
@@ -196,7 +285,7 @@ void test_constant_k_comprehensive(void) {
                         exists_count++;
                     }
                     
-                    free(instance);
+                    destroy_problem_instance(instance);
                 }
                 
                 existence_rate = (double)exists_count / num_trials;
@@ -206,7 +295,7 @@ void test_constant_k_comprehensive(void) {
                 int num_trials = NUM_RANDOM_TRIALS;
                 
                 for (int trial = 0; trial < num_trials; trial++) {
-                    problem_instance_t* instance = generate_random_house_allocation(n, time(NULL) + trial + n * 1000);
+                    problem_instance_t* instance = generate_random_house_allocation(n, trial_seed((uint32_t)(n * 1000 + trial)));
                     if (instance == NULL) continue;
                     
                     bool exists = k_stable_matching_exists(instance, k);
@@ -214,7 +303,7 @@ void test_constant_k_comprehensive(void) {
                         exists_count++;
                     }
                     
-                    free(instance);
+                    destroy_problem_instance(instance);
                 }
                 
                 existence_rate = (double)exists_count / num_trials;